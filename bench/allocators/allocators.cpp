@@ -0,0 +1,180 @@
+#include "bench_header.h"
+
+using namespace allo;
+using namespace allo::bench;
+
+static constexpr size_t memory = 64UL << 20;
+static constexpr size_t operations = 20000;
+static constexpr size_t burst = 1000;
+
+/// Free everything in allocations, if the allocator can free.
+template <typename Allocator>
+static void cleanup(Allocator& ally, const std::vector<bytes_t>& allocations)
+{
+    if constexpr (detail::is_freer<Allocator>) {
+        for (size_t i = allocations.size(); i > 0; --i)
+            (void)ally.free_bytes(allocations[i - 1], 0);
+    }
+}
+
+/// Allocate and immediately free the same size over and over, the best case
+/// for most allocators.
+static void alloc_free_pair(context_t& context)
+{
+    const requirements_t requirements{.free = true};
+    for (AllocatorKind kind : all_allocator_kinds) {
+        if (!supports(kind, requirements))
+            continue;
+        context.run("alloc_free_pair", name(kind), 1, operations * 2, [&]() {
+            return with_allocator(kind, requirements, memory, [](auto& ally) {
+                if constexpr (detail::is_freer<std::decay_t<decltype(ally)>>) {
+                    const stopwatch_t timer;
+                    for (size_t i = 0; i < operations; ++i) {
+                        auto res = ally.alloc_bytes(64, 3, 0);
+                        if (!res.okay())
+                            return failed;
+                        do_not_optimize(res.release_ref().data());
+                        (void)ally.free_bytes(res.release(), 0);
+                    }
+                    return timer.elapsed_ns();
+                }
+                return failed;
+            });
+        });
+    }
+}
+
+/// Only allocate, never free.
+static void alloc_only(context_t& context)
+{
+    const requirements_t requirements{};
+    for (AllocatorKind kind : all_allocator_kinds) {
+        if (!supports(kind, requirements))
+            continue;
+        context.run("alloc_only", name(kind), 1, operations, [&]() {
+            return with_allocator(kind, requirements, memory, [](auto& ally) {
+                std::vector<bytes_t> allocations;
+                allocations.reserve(operations);
+                const stopwatch_t timer;
+                for (size_t i = 0; i < operations; ++i) {
+                    auto res = ally.alloc_bytes(64, 3, 0);
+                    if (!res.okay()) {
+                        cleanup(ally, allocations);
+                        return failed;
+                    }
+                    allocations.push_back(res.release());
+                }
+                const uint64_t elapsed = timer.elapsed_ns();
+                cleanup(ally, allocations);
+                return elapsed;
+            });
+        });
+    }
+}
+
+/// Allocate a burst of allocations and free them all, either most recent
+/// first or in a random order.
+static void bursts(context_t& context, bool lifo)
+{
+    const requirements_t requirements{.free = true, .free_in_any_order = !lifo};
+    std::vector<size_t> order(burst);
+    for (size_t i = 0; i < burst; ++i)
+        order[i] = burst - 1 - i;
+    if (!lifo) {
+        rng_t rng(1);
+        for (size_t i = burst - 1; i > 0; --i)
+            std::swap(order[i], order[rng.between(0, i)]);
+    }
+
+    const char* benchmark = lifo ? "burst_free_lifo" : "burst_free_random";
+    constexpr size_t rounds = operations / burst;
+    for (AllocatorKind kind : all_allocator_kinds) {
+        if (!supports(kind, requirements))
+            continue;
+        context.run(benchmark, name(kind), 1, rounds * burst * 2, [&]() {
+            return with_allocator(kind, requirements, memory, [&](auto& ally) {
+                if constexpr (detail::is_freer<std::decay_t<decltype(ally)>>) {
+                    std::vector<uint8_t*> allocations(burst);
+                    const stopwatch_t timer;
+                    for (size_t round = 0; round < rounds; ++round) {
+                        for (size_t i = 0; i < burst; ++i) {
+                            auto res = ally.alloc_bytes(64, 3, 0);
+                            if (!res.okay())
+                                return failed;
+                            allocations[i] = res.release().data();
+                        }
+                        for (size_t i : order) {
+                            (void)ally.free_bytes(
+                                zl::raw_slice(*allocations[i], 64), 0);
+                        }
+                    }
+                    return timer.elapsed_ns();
+                }
+                return failed;
+            });
+        });
+    }
+}
+
+/// Keep a window of live allocations between 16 and 2048 bytes, and randomly
+/// free or fill slots in it.
+static void mixed_sizes(context_t& context)
+{
+    constexpr size_t max_size = 2048;
+    const requirements_t requirements{
+        .free = true, .free_in_any_order = true, .max_size = max_size};
+    for (AllocatorKind kind : all_allocator_kinds) {
+        if (!supports(kind, requirements))
+            continue;
+        context.run("mixed_sizes", name(kind), 1, operations, [&]() {
+            return with_allocator(kind, requirements, memory, [](auto& ally) {
+                if constexpr (detail::is_freer<std::decay_t<decltype(ally)>>) {
+                    struct slot_t
+                    {
+                        uint8_t* data;
+                        size_t size;
+                    };
+                    std::vector<slot_t> slots(burst, slot_t{nullptr, 0});
+                    rng_t rng(2);
+                    const stopwatch_t timer;
+                    for (size_t i = 0; i < operations; ++i) {
+                        slot_t& slot = slots[rng.between(0, burst - 1)];
+                        if (slot.data) {
+                            (void)ally.free_bytes(
+                                zl::raw_slice(*slot.data, slot.size), 0);
+                            slot.data = nullptr;
+                            continue;
+                        }
+                        const size_t size = rng.between(16, max_size);
+                        auto res = ally.alloc_bytes(size, 3, 0);
+                        if (!res.okay())
+                            return failed;
+                        slot = slot_t{res.release().data(), size};
+                    }
+                    const uint64_t elapsed = timer.elapsed_ns();
+                    for (const slot_t& slot : slots) {
+                        if (slot.data) {
+                            (void)ally.free_bytes(
+                                zl::raw_slice(*slot.data, slot.size), 0);
+                        }
+                    }
+                    return elapsed;
+                }
+                return failed;
+            });
+        });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    context_t context;
+    if (!context_t::make("allocators", argc, argv, context))
+        return 2;
+    alloc_free_pair(context);
+    alloc_only(context);
+    bursts(context, true);
+    bursts(context, false);
+    mixed_sizes(context);
+    return 0;
+}
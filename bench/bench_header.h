@@ -0,0 +1,310 @@
+#pragma once
+/// Header to be included in benchmarks and benchmarks only. Must be included
+/// first in the file.
+///
+/// Every benchmark prints one JSON object per line to stdout, so that results
+/// can be saved and compared between commits:
+///
+///   {"suite": "allocators", "benchmark": "alloc_free_pair",
+///    "allocator": "heap", "threads": 1, "operations": 100000, "rounds": 5,
+///    "failed": false, "best_ns": 812345, "median_ns": 823456,
+///    "ns_per_op": 8.12, "ops_per_second": 123000000.0, "build": "release"}
+///
+/// Each benchmark is run several times and the fastest round is reported as
+/// ns_per_op and ops_per_second.
+#ifndef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY
+#endif
+
+#include "allo/block_allocator.h"
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/reservation_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/stack_allocator.h"
+#include "allo/typed_allocation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace allo::bench {
+
+/// Returned by a round which could not complete because the allocator failed.
+inline constexpr uint64_t failed = UINT64_MAX;
+
+/// Stop the compiler from optimizing away an allocation which is never used.
+inline void do_not_optimize(const void* pointer) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(pointer) : "memory");
+#else
+    static volatile const void* sink;
+    sink = pointer;
+#endif
+}
+
+class stopwatch_t
+{
+  public:
+    inline stopwatch_t() noexcept : m_start(std::chrono::steady_clock::now()) {}
+
+    [[nodiscard]] inline uint64_t elapsed_ns() const noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - m_start)
+            .count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/// xorshift64, so that every run does exactly the same operations.
+class rng_t
+{
+  public:
+    inline explicit rng_t(uint64_t seed) noexcept : m_state(seed | 1) {}
+
+    inline uint64_t next() noexcept
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 7;
+        m_state ^= m_state << 17;
+        return m_state;
+    }
+
+    /// A number in [low, high].
+    inline size_t between(size_t low, size_t high) noexcept
+    {
+        return low + static_cast<size_t>(next() % (high - low + 1));
+    }
+
+  private:
+    uint64_t m_state;
+};
+
+enum class AllocatorKind : uint8_t
+{
+    C,
+    Heap,
+    Block,
+    Stack,
+    Scratch,
+    /// heap_allocator_t on top of a reservation_allocator_t, which grows in
+    /// place instead of up front.
+    Reservation,
+};
+
+inline constexpr AllocatorKind all_allocator_kinds[] = {
+    AllocatorKind::C,     AllocatorKind::Heap,    AllocatorKind::Block,
+    AllocatorKind::Stack, AllocatorKind::Scratch, AllocatorKind::Reservation,
+};
+
+[[nodiscard]] inline constexpr const char* name(AllocatorKind kind) noexcept
+{
+    switch (kind) {
+    case AllocatorKind::C:
+        return "c";
+    case AllocatorKind::Heap:
+        return "heap";
+    case AllocatorKind::Block:
+        return "block";
+    case AllocatorKind::Stack:
+        return "stack";
+    case AllocatorKind::Scratch:
+        return "scratch";
+    case AllocatorKind::Reservation:
+        return "reservation";
+    }
+    return "unknown";
+}
+
+/// What a benchmark does with an allocator, so that it is only run on the
+/// allocators which can do it.
+struct requirements_t
+{
+    /// Frees allocations, most recent first.
+    bool free = false;
+    /// Frees allocations in any order.
+    bool free_in_any_order = false;
+    /// Makes allocations of different sizes, or reallocates. Otherwise every
+    /// allocation is at most max_size, and a block allocator is used with that
+    /// as its blocksize.
+    bool any_size = false;
+    size_t max_size = 64;
+    uint8_t alignment_exponent = 3;
+};
+
+[[nodiscard]] inline constexpr bool
+supports(AllocatorKind kind, const requirements_t& requirements) noexcept
+{
+    switch (kind) {
+    case AllocatorKind::C:
+        // malloc only promises so much alignment
+        return requirements.alignment_exponent <= 5;
+    case AllocatorKind::Block:
+        return !requirements.any_size;
+    case AllocatorKind::Stack:
+        return !requirements.free_in_any_order;
+    case AllocatorKind::Scratch:
+        return !requirements.free && !requirements.free_in_any_order;
+    default:
+        return true;
+    }
+}
+
+template <typename Allocator>
+inline constexpr bool is_heap =
+    std::is_base_of_v<detail::abstract_heap_allocator_t, Allocator>;
+
+/// Make a new allocator of the given kind and return f(allocator). All but the
+/// c and reservation allocators get "memory" bytes up front, which should be
+/// enough that growing is not part of the benchmark. Returns failed if the
+/// allocator could not be made.
+template <typename F>
+inline uint64_t with_allocator(AllocatorKind kind,
+                               const requirements_t& requirements,
+                               size_t memory, F&& f) noexcept
+{
+    c_allocator_t parent;
+    if (kind == AllocatorKind::C)
+        return f(parent);
+
+    if (kind == AllocatorKind::Reservation) {
+        auto reservation = reservation_allocator_t::make(
+            {.committed = 1, .additional_pages_reserved = 1UL << 20});
+        if (!reservation.okay())
+            return failed;
+        reservation_allocator_t& pages = reservation.release_ref();
+        auto heap =
+            heap_allocator_t::make_owning(pages.current_memory(), pages);
+        return f(heap);
+    }
+
+    auto mem = allo::alloc<uint8_t>(parent, memory);
+    if (!mem.okay())
+        return failed;
+    switch (kind) {
+    case AllocatorKind::Heap: {
+        auto heap = heap_allocator_t::make_owning(mem.release(), parent);
+        return f(heap);
+    }
+    case AllocatorKind::Block: {
+        auto block = block_allocator_t::make_owning(mem.release(), parent,
+                                                    requirements.max_size);
+        return f(block);
+    }
+    case AllocatorKind::Stack: {
+        auto stack = stack_allocator_t::make_owning(mem.release(), parent);
+        return f(stack);
+    }
+    case AllocatorKind::Scratch: {
+        auto scratch = scratch_allocator_t::make_owning(mem.release(), parent);
+        return f(scratch);
+    }
+    default:
+        return failed;
+    }
+}
+
+/// Parses the command line and prints results.
+class context_t
+{
+  public:
+    /// usage: <benchmark> [--rounds N] [--filter SUBSTRING]
+    /// The filter is matched against "benchmark/allocator".
+    [[nodiscard]] static inline bool make(const char* suite, int argc,
+                                          char** argv, context_t& out) noexcept
+    {
+        out.m.suite = suite;
+        for (int i = 1; i < argc; ++i) {
+            const bool has_value = i + 1 < argc;
+            if (std::strcmp(argv[i], "--rounds") == 0 && has_value) {
+                out.m.rounds = std::strtoul(argv[++i], nullptr, 10);
+                if (out.m.rounds == 0)
+                    return false;
+            } else if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+                out.m.filter = argv[++i];
+            } else {
+                std::fprintf(stderr,
+                             "usage: %s [--rounds N] [--filter SUBSTRING]\n",
+                             argv[0]);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Call round() for each round, which returns how long the measured part
+    /// took in nanoseconds (or failed), and print the result. "operations" is
+    /// the number of operations performed per round, in total across threads.
+    template <typename F>
+    inline void run(const char* benchmark, const char* allocator,
+                    size_t threads, size_t operations, F&& round) noexcept
+    {
+        if (m.filter) {
+            char full_name[256];
+            std::snprintf(full_name, sizeof(full_name), "%s/%s", benchmark,
+                          allocator);
+            if (!std::strstr(full_name, m.filter))
+                return;
+        }
+
+        std::vector<uint64_t> times;
+        times.reserve(m.rounds);
+        bool any_failed = false;
+        for (size_t i = 0; i < m.rounds; ++i) {
+            const uint64_t time = round();
+            if (time == failed) {
+                any_failed = true;
+                break;
+            }
+            times.push_back(time);
+        }
+
+        std::printf("{\"suite\": \"%s\", \"benchmark\": \"%s\", "
+                    "\"allocator\": \"%s\", \"threads\": %zu, "
+                    "\"operations\": %zu, \"rounds\": %zu, ",
+                    m.suite, benchmark, allocator, threads, operations,
+                    m.rounds);
+        if (any_failed) {
+            std::printf("\"failed\": true, \"build\": \"%s\"}\n", build());
+        } else {
+            std::sort(times.begin(), times.end());
+            const uint64_t best = times.front();
+            const uint64_t median = times[times.size() / 2];
+            const double ns_per_op =
+                static_cast<double>(best) / static_cast<double>(operations);
+            std::printf("\"failed\": false, \"best_ns\": %llu, "
+                        "\"median_ns\": %llu, \"ns_per_op\": %.3f, "
+                        "\"ops_per_second\": %.1f, \"build\": \"%s\"}\n",
+                        static_cast<unsigned long long>(best),
+                        static_cast<unsigned long long>(median), ns_per_op,
+                        ns_per_op > 0 ? 1e9 / ns_per_op : 0.0, build());
+        }
+        std::fflush(stdout);
+    }
+
+  private:
+    [[nodiscard]] static inline constexpr const char* build() noexcept
+    {
+#ifdef NDEBUG
+        return "release";
+#else
+        return "debug";
+#endif
+    }
+
+    struct M
+    {
+        const char* suite = "";
+        const char* filter = nullptr;
+        size_t rounds = 5;
+    } m;
+};
+} // namespace allo::bench
@@ -0,0 +1,106 @@
+#include "bench_header.h"
+#include "allo/structures/collection.h"
+#include "allo/structures/list.h"
+#include "allo/structures/segmented_stack.h"
+
+using namespace allo;
+using namespace allo::bench;
+
+static constexpr size_t memory = 64UL << 20;
+static constexpr size_t items = 100000;
+
+/// Start with room for one item and put items one at a time, so that most of
+/// the time is spent reallocating.
+static void collection_put(context_t& context)
+{
+    const requirements_t requirements{
+        .free = true, .free_in_any_order = true, .any_size = true};
+    for (AllocatorKind kind : all_allocator_kinds) {
+        if (!supports(kind, requirements))
+            continue;
+        context.run("collection_put", name(kind), 1, items, [&]() {
+            return with_allocator(kind, requirements, memory, [](auto& ally) {
+                if constexpr (is_heap<std::decay_t<decltype(ally)>>) {
+                    const stopwatch_t timer;
+                    auto res = collection_t<int>::make_owning(ally, 1);
+                    if (!res.okay())
+                        return failed;
+                    collection_t<int>& collection = res.release_ref();
+                    for (size_t i = 0; i < items; ++i) {
+                        if (!collection.try_put(int(i)).okay())
+                            return failed;
+                    }
+                    do_not_optimize(collection.items().data());
+                    return timer.elapsed_ns();
+                }
+                return failed;
+            });
+        });
+    }
+}
+
+static void list_append(context_t& context)
+{
+    const requirements_t requirements{
+        .free = true, .free_in_any_order = true, .any_size = true};
+    for (AllocatorKind kind : all_allocator_kinds) {
+        if (!supports(kind, requirements))
+            continue;
+        context.run("list_append", name(kind), 1, items, [&]() {
+            return with_allocator(kind, requirements, memory, [](auto& ally) {
+                if constexpr (is_heap<std::decay_t<decltype(ally)>>) {
+                    const stopwatch_t timer;
+                    auto res = list_t<int>::make_owning(ally, 1);
+                    if (!res.okay())
+                        return failed;
+                    list_t<int>& list = res.release_ref();
+                    for (size_t i = 0; i < items; ++i) {
+                        if (!list.try_append(int(i)).okay())
+                            return failed;
+                    }
+                    do_not_optimize(list.items().data());
+                    return timer.elapsed_ns();
+                }
+                return failed;
+            });
+        });
+    }
+}
+
+/// A segmented stack only ever allocates new segments, so this works with any
+/// allocator which can give out cache line aligned memory.
+static void segmented_stack_push(context_t& context)
+{
+    const requirements_t requirements{.any_size = true,
+                                      .alignment_exponent = 6};
+    for (AllocatorKind kind : all_allocator_kinds) {
+        if (!supports(kind, requirements))
+            continue;
+        context.run("segmented_stack_push", name(kind), 1, items, [&]() {
+            return with_allocator(kind, requirements, memory, [](auto& ally) {
+                const stopwatch_t timer;
+                auto res = segmented_stack_t<int>::make(ally, 1);
+                if (!res.okay())
+                    return failed;
+                segmented_stack_t<int>& stack = res.release_ref();
+                for (size_t i = 0; i < items; ++i) {
+                    if (!stack.try_push(int(i)).okay())
+                        return failed;
+                }
+                do_not_optimize(&stack);
+                return timer.elapsed_ns();
+            });
+        });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    context_t context;
+    if (!context_t::make("structures", argc, argv, context))
+        return 2;
+    collection_put(context);
+    list_append(context);
+    segmented_stack_push(context);
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "bench_header.h"
+#include <atomic>
+#include <thread>
+
+using namespace allo;
+using namespace allo::bench;
+
+static constexpr size_t operations_per_thread = 200000;
+static constexpr size_t window = 256;
+static constexpr size_t thread_counts[] = {1, 2, 4, 8};
+
+/// Start a number of threads which all wait for each other before calling
+/// f(thread_index), and return how long it took from when they were released
+/// until they had all finished.
+template <typename F> static uint64_t run_threads(size_t threads, F&& f)
+{
+    std::atomic_size_t ready = 0;
+    std::atomic_bool go = false;
+    std::atomic_bool any_failed = false;
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t]() {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            if (!f(t))
+                any_failed.store(true);
+        });
+    }
+    while (ready.load() != threads)
+        std::this_thread::yield();
+    const stopwatch_t timer;
+    go.store(true, std::memory_order_release);
+    for (std::thread& thread : pool)
+        thread.join();
+    const uint64_t elapsed = timer.elapsed_ns();
+    return any_failed.load() ? failed : elapsed;
+}
+
+/// Keep a window of live allocations between 16 and 1024 bytes, and randomly
+/// free or fill slots in it.
+static bool mixed_sizes(c_allocator_t& ally, size_t seed)
+{
+    struct slot_t
+    {
+        uint8_t* data;
+        size_t size;
+    };
+    std::vector<slot_t> slots(window, slot_t{nullptr, 0});
+    rng_t rng(seed);
+    bool okay = true;
+    for (size_t i = 0; i < operations_per_thread; ++i) {
+        slot_t& slot = slots[rng.between(0, window - 1)];
+        if (slot.data) {
+            (void)ally.free_bytes(zl::raw_slice(*slot.data, slot.size), 0);
+            slot.data = nullptr;
+            continue;
+        }
+        const size_t size = rng.between(16, 1024);
+        auto res = ally.alloc_bytes(size, 3, 0);
+        if (!res.okay()) {
+            okay = false;
+            break;
+        }
+        slot = slot_t{res.release().data(), size};
+    }
+    for (const slot_t& slot : slots) {
+        if (slot.data)
+            (void)ally.free_bytes(zl::raw_slice(*slot.data, slot.size), 0);
+    }
+    return okay;
+}
+
+/// Every thread does mixed_sizes() at once, all with the same c_allocator_t.
+static void mixed_per_thread(context_t& context)
+{
+    for (size_t threads : thread_counts) {
+        const size_t operations = threads * operations_per_thread;
+        context.run("mixed_per_thread", "c", threads, operations, [&]() {
+            c_allocator_t ally;
+            return run_threads(threads, [&](size_t index) {
+                return mixed_sizes(ally, index + 1);
+            });
+        });
+    }
+}
+
+/// Single producer, single consumer ring of pointers. Waiting threads yield,
+/// so that this still finishes when there are more threads than cores.
+class handoff_t
+{
+  public:
+    inline void push(uint8_t* item) noexcept
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        while (tail - m_head.load(std::memory_order_acquire) == capacity)
+            std::this_thread::yield();
+        m_items[tail % capacity] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+    }
+
+    inline uint8_t* pop() noexcept
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        while (head == m_tail.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        uint8_t* item = m_items[head % capacity];
+        m_head.store(head + 1, std::memory_order_release);
+        return item;
+    }
+
+  private:
+    static constexpr size_t capacity = 1024;
+    alignas(detail::cache_line_size) std::atomic_size_t m_head = 0;
+    alignas(detail::cache_line_size) std::atomic_size_t m_tail = 0;
+    uint8_t* m_items[capacity];
+};
+
+static constexpr size_t handoff_size = 64;
+
+/// Allocate and hand every allocation to the consumer. If an allocation fails,
+/// null is handed over instead so that the consumer stops too.
+static bool produce(c_allocator_t& ally, handoff_t& handoff)
+{
+    for (size_t i = 0; i < operations_per_thread; ++i) {
+        auto res = ally.alloc_bytes(handoff_size, 3, 0);
+        if (!res.okay()) {
+            handoff.push(nullptr);
+            return false;
+        }
+        handoff.push(res.release().data());
+    }
+    return true;
+}
+
+static bool consume(c_allocator_t& ally, handoff_t& handoff)
+{
+    for (size_t i = 0; i < operations_per_thread; ++i) {
+        uint8_t* item = handoff.pop();
+        if (!item)
+            return false;
+        (void)ally.free_bytes(zl::raw_slice(*item, handoff_size), 0);
+    }
+    return true;
+}
+
+/// Half of the threads allocate and hand each allocation to a partner thread,
+/// which frees it. This is the case where a thread-caching malloc has to send
+/// memory back to the thread which allocated it.
+static void cross_thread_free(context_t& context)
+{
+    for (size_t threads : thread_counts) {
+        if (threads < 2)
+            continue;
+        const size_t pairs = threads / 2;
+        const size_t operations = pairs * operations_per_thread * 2;
+        context.run("cross_thread_free", "c", threads, operations, [&]() {
+            c_allocator_t ally;
+            std::vector<handoff_t> handoffs(pairs);
+            return run_threads(threads, [&](size_t index) {
+                handoff_t& handoff = handoffs[index / 2];
+                return index % 2 == 0 ? produce(ally, handoff)
+                                      : consume(ally, handoff);
+            });
+        });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    context_t context;
+    if (!context_t::make("threads", argc, argv, context))
+        return 2;
+    mixed_per_thread(context);
+    cross_thread_free(context);
+    return 0;
+}
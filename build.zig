@@ -42,7 +42,69 @@ const test_source_files = &[_][]const u8{
     "collection_t/collection_t.cpp",
     "stack_t/stack_t.cpp",
     "list_t/list_t.cpp",
+    "hashmap_t/hashmap_t.cpp",
+    "slot_map_t/slot_map_t.cpp",
+    "small_list_t/small_list_t.cpp",
+    "deque_t/deque_t.cpp",
+    "spsc_queue_t/spsc_queue_t.cpp",
+    "mpmc_queue_t/mpmc_queue_t.cpp",
+    "soa_collection_t/soa_collection_t.cpp",
+    "flat_map_t/flat_map_t.cpp",
+    "priority_queue_t/priority_queue_t.cpp",
+    "btree_map_t/btree_map_t.cpp",
+    "byte_buffer_t/byte_buffer_t.cpp",
+    "string_interner_t/string_interner_t.cpp",
     "segmented_stack_t/segmented_stack_t.cpp",
+    "mapped_file_allocator_t/mapped_file_allocator_t.cpp",
+    "shared_block_allocator_t/shared_block_allocator_t.cpp",
+    "ring_buffer_t/ring_buffer_t.cpp",
+    "tracing_allocator_t/tracing_allocator_t.cpp",
+    "sampling_allocator_t/sampling_allocator_t.cpp",
+    "event_hooks/event_hooks.cpp",
+};
+
+// the instrumented tests are built again with every ALLO_ENABLE_* flag, and
+// their executables get an "_instrumented" suffix
+const instrumentation_flags = &[_][]const u8{
+    "-DALLO_ENABLE_STATS",
+    "-DALLO_ENABLE_LATENCY_HISTOGRAMS",
+    "-DALLO_ENABLE_ALLOCATION_TAGS",
+    "-DALLO_ENABLE_PAGE_FAULT_STATS",
+};
+
+const instrumented_test_source_files = &[_][]const u8{
+    "allocator_stats/allocator_stats.cpp",
+    "trace_replay/trace_replay.cpp",
+    "latency_histograms/latency_histograms.cpp",
+    "allocation_tags/allocation_tags.cpp",
+    "syscall_stats/syscall_stats.cpp",
+    // structures which check how often they allocate
+    "small_list_t/small_list_t.cpp",
+    "deque_t/deque_t.cpp",
+    "btree_map_t/btree_map_t.cpp",
+    "byte_buffer_t/byte_buffer_t.cpp",
+    "string_interner_t/string_interner_t.cpp",
+};
+
+// the tool defines the allo options it needs itself
+const tool_flags = &[_][]const u8{
+    "-fno-rtti",
+    "-I./include/",
+};
+
+// benchmarks are always optimized, see bench/bench_header.h for the output
+const bench_source_files = &[_][]const u8{
+    "allocators/allocators.cpp",
+    "structures/structures.cpp",
+    "threads/threads.cpp",
+};
+
+const bench_flags = &[_][]const u8{
+    "-DNDEBUG",
+    "-std=c++17",
+    "-fno-rtti",
+    "-I./bench/",
+    "-I./include/",
 };
 
 const universal_tests_source_files = &[_][]const u8{
@@ -62,6 +124,15 @@ pub fn build(b: *std.Build) !void {
     try flags.appendSlice(if (optimize == .Debug) debug_flags else release_flags);
     try flags.appendSlice(testing_flags);
 
+    var replay_flags = std.ArrayList([]const u8).init(b.allocator);
+    defer replay_flags.deinit();
+    try replay_flags.appendSlice(if (optimize == .Debug) debug_flags else release_flags);
+    try replay_flags.appendSlice(tool_flags);
+
+    var benchmark_flags = std.ArrayList([]const u8).init(b.allocator);
+    defer benchmark_flags.deinit();
+    try benchmark_flags.appendSlice(bench_flags);
+
     var tests = std.ArrayList(*std.Build.Step.Compile).init(b.allocator);
     defer tests.deinit();
 
@@ -79,9 +150,17 @@ pub fn build(b: *std.Build) !void {
         ziglike = b.dependency("ziglike", .{ .target = target, .optimize = optimize });
         const ziglike_include_path = b.pathJoin(&.{ ziglike.?.builder.install_path, "include" });
         try flags.append(b.fmt("-I{s}", .{ziglike_include_path}));
+        try replay_flags.append(b.fmt("-I{s}", .{ziglike_include_path}));
+        try benchmark_flags.append(b.fmt("-I{s}", .{ziglike_include_path}));
     }
 
+    var instrumented_flags = std.ArrayList([]const u8).init(b.allocator);
+    defer instrumented_flags.deinit();
+    try instrumented_flags.appendSlice(flags.items);
+    try instrumented_flags.appendSlice(instrumentation_flags);
+
     const flags_owned = flags.toOwnedSlice() catch @panic("OOM");
+    const instrumented_flags_owned = instrumented_flags.toOwnedSlice() catch @panic("OOM");
 
     for (test_source_files) |source_file| {
         var test_exe = b.addExecutable(.{
@@ -102,6 +181,25 @@ pub fn build(b: *std.Build) !void {
         try tests.append(test_exe);
     }
 
+    for (instrumented_test_source_files) |source_file| {
+        var test_exe = b.addExecutable(.{
+            .name = b.fmt("{s}_instrumented", .{std.fs.path.stem(source_file)}),
+            .optimize = optimize,
+            .target = target,
+        });
+        test_exe.addCSourceFile(.{
+            .file = b.path(b.pathJoin(&.{ "tests", source_file })),
+            .flags = instrumented_flags_owned,
+        });
+        test_exe.addCSourceFiles(.{
+            .files = universal_tests_source_files,
+            .flags = instrumented_flags_owned,
+        });
+        test_exe.linkLibCpp();
+        test_exe.step.dependOn(ziglike.?.builder.getInstallStep());
+        try tests.append(test_exe);
+    }
+
     const run_tests_step = b.step("run_tests", "Compile and run all the tests");
     const install_tests_step = b.step("install_tests", "Install all the tests but don't run them");
     for (tests.items) |test_exe| {
@@ -115,5 +213,50 @@ pub fn build(b: *std.Build) !void {
         run_tests_step.dependOn(&test_run.step);
     }
 
+    const replay_exe = b.addExecutable(.{
+        .name = "allo-replay",
+        .optimize = optimize,
+        .target = target,
+    });
+    replay_exe.addCSourceFile(.{
+        .file = b.path("tools/replay/replay.cpp"),
+        .flags = replay_flags.toOwnedSlice() catch @panic("OOM"),
+    });
+    replay_exe.linkLibCpp();
+    replay_exe.step.dependOn(ziglike.?.builder.getInstallStep());
+    const replay_install = b.addInstallArtifact(replay_exe, .{});
+    const replay_step = b.step("replay", "Build allo-replay, which replays allocation traces onto each allocator");
+    replay_step.dependOn(&replay_install.step);
+
+    const bench_step = b.step("bench", "Compile and run the benchmarks, printing one JSON object per result");
+    const benchmark_flags_owned = benchmark_flags.toOwnedSlice() catch @panic("OOM");
+    // run one at a time, so the benchmarks dont compete for the cpu
+    var previous_bench_run: ?*std.Build.Step.Run = null;
+    for (bench_source_files) |source_file| {
+        const bench_exe = b.addExecutable(.{
+            .name = b.fmt("allo-bench-{s}", .{std.fs.path.stem(source_file)}),
+            .optimize = .ReleaseFast,
+            .target = target,
+        });
+        bench_exe.addCSourceFile(.{
+            .file = b.path(b.pathJoin(&.{ "bench", source_file })),
+            .flags = benchmark_flags_owned,
+        });
+        bench_exe.linkLibCpp();
+        bench_exe.step.dependOn(ziglike.?.builder.getInstallStep());
+
+        const bench_run = b.addRunArtifact(bench_exe);
+        if (b.args) |args| {
+            bench_run.addArgs(args);
+        }
+        if (previous_bench_run) |previous| {
+            bench_run.step.dependOn(&previous.step);
+        }
+        previous_bench_run = bench_run;
+        bench_step.dependOn(&bench_run.step);
+        try tests.append(bench_exe);
+    }
+
+    try tests.append(replay_exe);
     zcc.createStep(b, "cdb", try tests.toOwnedSlice());
 }
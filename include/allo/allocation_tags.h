@@ -0,0 +1,176 @@
+#pragma once
+
+#include "allo/detail/asserts.h"
+#include <cstddef>
+#include <cstdint>
+
+#if defined(ALLO_ENABLE_ALLOCATION_TAGS) && defined(ALLO_DISABLE_TYPEINFO)
+#error "allocation tags are stored in the typehash of each allocation"
+#endif
+
+namespace allo {
+
+/// A small integer identifying which part of a program made an allocation,
+/// for example one per subsystem. Allocations from a heap_allocator_t are
+/// counted towards their tag if allo is compiled with
+/// ALLO_ENABLE_ALLOCATION_TAGS defined. Tag zero is the default, for
+/// allocations made outside of any allocation_tag_scope_t.
+struct allocation_tag_t
+{
+    static constexpr uint8_t max = 32;
+    uint8_t value = 0;
+};
+
+/// Live and peak usage of one tag in one allocator.
+struct allocation_tag_stats_t
+{
+    size_t live_allocations;
+    /// Bytes requested by live allocations with this tag.
+    size_t bytes_requested;
+    size_t peak_bytes_requested;
+    /// Zero if this tag has no budget.
+    size_t budget;
+};
+
+namespace detail {
+/// The tag given to allocations made on this thread. Saved and restored by
+/// each allocation_tag_scope_t.
+inline thread_local uint8_t current_allocation_tag = 0;
+
+/// The tag is kept in the top bits of the typehash stored with an allocation,
+/// so that it takes up no extra memory. Typehashes are only compared with
+/// these bits masked out.
+inline constexpr size_t allocation_tag_shift = (sizeof(size_t) * 8) - 8;
+inline constexpr size_t typehash_without_tag_mask =
+    (size_t(1) << allocation_tag_shift) - 1;
+
+[[nodiscard]] inline constexpr size_t
+tag_typehash(size_t typehash, uint8_t tag) noexcept
+{
+    return (typehash & typehash_without_tag_mask) |
+           (size_t(tag) << allocation_tag_shift);
+}
+
+[[nodiscard]] inline constexpr uint8_t
+tag_of_typehash(size_t typehash) noexcept
+{
+    return static_cast<uint8_t>(typehash >> allocation_tag_shift);
+}
+
+[[nodiscard]] inline constexpr bool typehashes_match(size_t a,
+                                                     size_t b) noexcept
+{
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    return ((a ^ b) & typehash_without_tag_mask) == 0;
+#else
+    return a == b;
+#endif
+}
+
+/// Per-tag counters kept by an allocator. Not atomic, since only allocators
+/// which are not threadsafe keep them.
+class allocation_tag_counters_t
+{
+  public:
+    /// Whether this many more bytes can be requested with the tag without
+    /// going over its budget.
+    [[nodiscard]] inline bool within_budget(uint8_t tag,
+                                            size_t additional) const noexcept
+    {
+        const tag_t& counters = m.tags[tag];
+        return counters.budget == 0 ||
+               counters.bytes_requested + additional <= counters.budget;
+    }
+
+    inline void record_alloc(uint8_t tag, size_t requested) noexcept
+    {
+        tag_t& counters = m.tags[tag];
+        ++counters.live_allocations;
+        add_requested(counters, requested);
+    }
+
+    inline void record_free(uint8_t tag, size_t requested) noexcept
+    {
+        tag_t& counters = m.tags[tag];
+        --counters.live_allocations;
+        counters.bytes_requested -= requested;
+    }
+
+    inline void record_resize(uint8_t tag, size_t old_requested,
+                              size_t new_requested) noexcept
+    {
+        tag_t& counters = m.tags[tag];
+        counters.bytes_requested -= old_requested;
+        add_requested(counters, new_requested);
+    }
+
+    inline void set_budget(uint8_t tag, size_t bytes) noexcept
+    {
+        m.tags[tag].budget = bytes;
+    }
+
+    [[nodiscard]] inline allocation_tag_stats_t
+    get(uint8_t tag) const noexcept
+    {
+        const tag_t& counters = m.tags[tag];
+        return allocation_tag_stats_t{
+            .live_allocations = counters.live_allocations,
+            .bytes_requested = counters.bytes_requested,
+            .peak_bytes_requested = counters.peak_bytes_requested,
+            .budget = counters.budget,
+        };
+    }
+
+  private:
+    struct tag_t
+    {
+        size_t live_allocations;
+        size_t bytes_requested;
+        size_t peak_bytes_requested;
+        size_t budget;
+    };
+
+    struct M
+    {
+        tag_t tags[allocation_tag_t::max];
+    } m{};
+
+    static inline void add_requested(tag_t& counters, size_t bytes) noexcept
+    {
+        counters.bytes_requested += bytes;
+        if (counters.bytes_requested > counters.peak_bytes_requested)
+            counters.peak_bytes_requested = counters.bytes_requested;
+    }
+};
+} // namespace detail
+
+/// Gives every allocation made on this thread the tag, until the scope is
+/// destroyed and the previous tag is restored. Scopes can be nested.
+class allocation_tag_scope_t
+{
+  public:
+    inline explicit allocation_tag_scope_t(allocation_tag_t tag) noexcept
+        : m{.outer = detail::current_allocation_tag}
+    {
+        ALLO_VALID_ARG_ASSERT(tag.value < allocation_tag_t::max);
+        detail::current_allocation_tag =
+            tag.value < allocation_tag_t::max ? tag.value : 0;
+    }
+
+    inline ~allocation_tag_scope_t() noexcept
+    {
+        detail::current_allocation_tag = m.outer;
+    }
+
+    allocation_tag_scope_t(const allocation_tag_scope_t&) = delete;
+    allocation_tag_scope_t& operator=(const allocation_tag_scope_t&) = delete;
+    allocation_tag_scope_t(allocation_tag_scope_t&&) = delete;
+    allocation_tag_scope_t& operator=(allocation_tag_scope_t&&) = delete;
+
+  private:
+    struct M
+    {
+        uint8_t outer;
+    } m;
+};
+} // namespace allo
@@ -23,6 +23,9 @@ class block_allocator_t : public detail::abstract_heap_allocator_t
         // head of free list
         void* last_freed;
         any_allocator_t parent;
+        // the most blocks that have been in use since the last trim()
+        size_t peak_blocks_in_use = 0;
+        bool auto_trim = false;
     } m;
 
   public:
@@ -73,6 +76,21 @@ class block_allocator_t : public detail::abstract_heap_allocator_t
     register_destruction_callback(destruction_callback_t callback,
                                   void* user_data) noexcept;
 
+    /// Give every chunk of blocks which were allocated together from the
+    /// parent back to the parent, if none of the blocks in the chunk are in
+    /// use. The chunk currently being allocated from is kept. Only possible if
+    /// the parent is a heap allocator; otherwise nothing is done. Returns the
+    /// number of bytes given back.
+    size_t trim() noexcept;
+
+    /// Call trim() automatically when freeing, once the blocks in use fall to
+    /// a quarter of the most that have been in use since the last trim. Off by
+    /// default.
+    inline void set_auto_trim(bool enabled) noexcept
+    {
+        m.auto_trim = enabled;
+    }
+
     ~block_allocator_t() noexcept;
     // cannot be copied
     block_allocator_t(const block_allocator_t& other) = delete;
@@ -94,6 +112,7 @@ class block_allocator_t : public detail::abstract_heap_allocator_t
     inline block_allocator_t(M&& members) noexcept : m(members)
     {
         m_type = enum_value;
+        ALLO_RECORD_STATS(record_block_acquired());
     }
 
   private:
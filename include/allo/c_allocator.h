@@ -52,6 +52,7 @@ class c_allocator_t : public detail::abstract_threadsafe_heap_allocator_t
     [[nodiscard]] inline allocation_result_t
     remap_bytes(bytes_t, size_t, size_t, size_t) noexcept
     {
+        ALLO_RECORD_STATS(record_failed_remap());
         return AllocationStatusCode::InvalidArgument;
     }
 };
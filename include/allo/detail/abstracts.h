@@ -1,6 +1,10 @@
 #pragma once
 #include "allo/detail/destruction_callback.h"
+#include "allo/detail/event_hooks_policy.h"
+#include "allo/latency.h"
+#include "allo/stats.h"
 #include "allo/status.h"
+#include "allo/syscall_stats.h"
 #include <type_traits>
 
 namespace allo::detail {
@@ -13,6 +17,10 @@ enum class AllocatorType : uint8_t
     ScratchAllocator,
     ReservationAllocator,
     HeapAllocator,
+    MappedFileAllocator,
+    SharedBlockAllocator,
+    TracingAllocator,
+    SamplingAllocator,
     MAX_ALLOCATOR_TYPE
 };
 
@@ -20,8 +28,45 @@ class abstract_allocator_t
 {
   protected:
     AllocatorType m_type; // NOLINT
+#ifdef ALLO_ENABLE_STATS
+    allocator_stats_counters_t m_stats; // NOLINT
+#endif
+#ifdef ALLO_ENABLE_LATENCY_HISTOGRAMS
+    allocator_latency_counters_t m_latencies; // NOLINT
+#endif
     abstract_allocator_t() = default;
 
+#ifdef ALLO_ENABLE_STATS
+    /// Used by ALLO_RECORD_STATS. abstract_threadsafe_heap_allocator_t hides
+    /// this with a recorder which is safe to use from many threads at once.
+    inline allocator_stats_recorder_t<false> stats_recorder() noexcept
+    {
+        return allocator_stats_recorder_t<false>(m_stats);
+    }
+#endif
+#ifdef ALLO_ENABLE_LATENCY_HISTOGRAMS
+    /// Used by ALLO_TIME_OPERATION, and hidden in the same way.
+    inline allocator_latency_recorder_t<false> latency_recorder() noexcept
+    {
+        return allocator_latency_recorder_t<false>(m_latencies);
+    }
+#endif
+
+    /// Called by the move constructors of allocators so that the stats and
+    /// latency histograms of the moved-from allocator carry over
+    inline void move_stats_from(abstract_allocator_t& other) noexcept
+    {
+#ifdef ALLO_ENABLE_STATS
+        m_stats.restore(other.m_stats.snapshot());
+        other.m_stats.restore({});
+#endif
+#ifdef ALLO_ENABLE_LATENCY_HISTOGRAMS
+        m_latencies.restore(other.m_latencies.snapshot());
+        other.m_latencies.restore(allocator_latencies_t::empty());
+#endif
+        (void)other;
+    }
+
   public:
     abstract_allocator_t(const abstract_allocator_t&) = delete;
     abstract_allocator_t& operator=(const abstract_allocator_t&) = delete;
@@ -49,11 +94,62 @@ class abstract_allocator_t
             return "reservation_allocator_t";
         case Type::HeapAllocator:
             return "heap_allocator_t";
+        case Type::MappedFileAllocator:
+            return "mapped_file_allocator_t";
+        case Type::SharedBlockAllocator:
+            return "shared_block_allocator_t";
+        case Type::TracingAllocator:
+            return "tracing_allocator_t";
+        case Type::SamplingAllocator:
+            return "sampling_allocator_t";
         default:
             return "<unknown allocator>";
         }
     }
 
+    /// Get a snapshot of the counters this allocator keeps about itself.
+    /// Every counter is zero unless ALLO_ENABLE_STATS is defined.
+    [[nodiscard]] inline allocator_stats_t stats() const noexcept
+    {
+#ifdef ALLO_ENABLE_STATS
+        return m_stats.snapshot();
+#else
+        return {};
+#endif
+    }
+
+    /// Set peak_bytes_requested and peak_bytes_consumed back to the bytes
+    /// which are live right now, so that later peaks only measure what
+    /// happens from here on.
+    inline void reset_peak_stats() noexcept
+    {
+#ifdef ALLO_ENABLE_STATS
+        m_stats.reset_peaks();
+#endif
+    }
+
+    /// Get a snapshot of how long this allocator's alloc, free, and remap
+    /// calls have taken. Every histogram is empty unless
+    /// ALLO_ENABLE_LATENCY_HISTOGRAMS is defined.
+    [[nodiscard]] inline allocator_latencies_t latencies() const noexcept
+    {
+#ifdef ALLO_ENABLE_LATENCY_HISTOGRAMS
+        return m_latencies.snapshot();
+#else
+        return allocator_latencies_t::empty();
+#endif
+    }
+
+    /// Empty every latency histogram, for example after taking a snapshot at
+    /// the end of a frame. Not threadsafe: operations which finish while the
+    /// histograms are being reset may be partly lost.
+    inline void reset_latencies() noexcept
+    {
+#ifdef ALLO_ENABLE_LATENCY_HISTOGRAMS
+        m_latencies.restore(allocator_latencies_t::empty());
+#endif
+    }
+
     /// Request an allocation for some number of bytes with some alignment, and
     /// providing the typehash. If a non-typed allocator, 0 can be supplied as
     /// the hash.
@@ -91,6 +187,20 @@ class abstract_heap_allocator_t : public abstract_stack_allocator_t
 // A heap allocator which is also threadsafe.
 class abstract_threadsafe_heap_allocator_t : public abstract_heap_allocator_t
 {
+  protected:
+#ifdef ALLO_ENABLE_STATS
+    inline allocator_stats_recorder_t<true> stats_recorder() noexcept
+    {
+        return allocator_stats_recorder_t<true>(m_stats);
+    }
+#endif
+#ifdef ALLO_ENABLE_LATENCY_HISTOGRAMS
+    inline allocator_latency_recorder_t<true> latency_recorder() noexcept
+    {
+        return allocator_latency_recorder_t<true>(m_latencies);
+    }
+#endif
+
   public:
     [[nodiscard]] allocation_result_t
     threadsafe_realloc_bytes(bytes_t mem, size_t old_typehash, size_t new_size,
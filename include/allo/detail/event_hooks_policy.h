@@ -0,0 +1,16 @@
+#pragma once
+
+#include "allo/event_hooks.h"
+
+namespace allo::detail {
+#ifdef ALLO_EVENT_HOOKS
+using event_hooks_t = ALLO_EVENT_HOOKS;
+#else
+using event_hooks_t = null_event_hooks_t;
+#endif
+} // namespace allo::detail
+
+/// Used inside of allocators to call one of the hooks of the event hook
+/// policy, passing the allocator itself as the first argument.
+#define ALLO_EMIT_EVENT(hook, ...) \
+    ::allo::detail::event_hooks_t::hook(*this, __VA_ARGS__)
@@ -7,4 +7,8 @@ class block_allocator_t;
 class scratch_allocator_t;
 class heap_allocator_t;
 class reservation_allocator_t;
+class mapped_file_allocator_t;
+class shared_block_allocator_t;
+class tracing_allocator_t;
+class sampling_allocator_t;
 } // namespace allo
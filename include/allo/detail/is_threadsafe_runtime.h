@@ -6,6 +6,7 @@ inline constexpr bool is_threadsafe_runtime(abstract_allocator_t& allocator)
 {
     switch (allocator.type()) {
     case AllocatorType::CAllocator:
+    case AllocatorType::SharedBlockAllocator:
         return true;
     default:
         return false;
@@ -9,4 +9,11 @@ template <size_t N> inline constexpr size_t round_up_to_multiple_of(size_t x)
                   "round_up_to_multiple_of only supports powers of 2.");
     return (x + (N - 1)) & ~(N - 1);
 }
+
+/// Runtime version, for when the multiple is not known at compile time (for
+/// example, the page size). Multiple does not need to be a power of two.
+inline constexpr size_t round_up_to_multiple_of(size_t x, size_t multiple)
+{
+    return ((x + multiple - 1) / multiple) * multiple;
+}
 } // namespace allo::detail
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "allo/status.h"
+
+namespace allo {
+
+/// The default event hook policy, which ignores every event. Allocators call
+/// these hooks when something notable happens, passing themselves as the first
+/// argument (as their concrete type, for example `const heap_allocator_t&`).
+/// Every hook here is an empty inline template, so with this policy the calls
+/// compile to nothing.
+///
+/// To receive events, inherit from this struct, hide the hooks you care about
+/// with functions of the same name, and define ALLO_EVENT_HOOKS to the name of
+/// your struct before including any allocator. When allo is not header-only,
+/// its implementation must be compiled with the same definition.
+///
+/// Hooks are called from inside the allocator, so they must not allocate from
+/// the allocator which triggered them.
+struct null_event_hooks_t
+{
+    /// The allocator got "bytes" more memory from its parent or the OS, by
+    /// remapping its memory or by getting a new block.
+    template <typename allocator_t>
+    static inline constexpr void on_grow(const allocator_t& /*allocator*/,
+                                         size_t /*bytes*/) noexcept
+    {
+    }
+
+    /// An allocation of "bytes" failed because the allocator was out of memory
+    /// and could not get more from its parent.
+    template <typename allocator_t>
+    static inline constexpr void on_oom(const allocator_t& /*allocator*/,
+                                        size_t /*bytes*/) noexcept
+    {
+    }
+
+    /// Memory passed to free_bytes() was rejected, for example because it does
+    /// not belong to the allocator or its size does not match the allocation.
+    template <typename allocator_t>
+    static inline constexpr void
+    on_invalid_free(const allocator_t& /*allocator*/, bytes_t /*mem*/,
+                    AllocationStatusCode /*reason*/) noexcept
+    {
+    }
+
+    /// Memory was freed or remapped with a different typehash than the one
+    /// it was allocated with.
+    template <typename allocator_t>
+    static inline constexpr void
+    on_type_mismatch(const allocator_t& /*allocator*/, bytes_t /*mem*/,
+                     size_t /*allocated_typehash*/,
+                     size_t /*given_typehash*/) noexcept
+    {
+    }
+
+    /// The allocator tried to grow its memory in place to "new_size" bytes,
+    /// and its parent (or the OS) refused. The allocator may still be able to
+    /// grow by getting a new block instead.
+    template <typename allocator_t>
+    static inline constexpr void
+    on_parent_remap_failed(const allocator_t& /*allocator*/, bytes_t /*mem*/,
+                           size_t /*new_size*/,
+                           AllocationStatusCode /*reason*/) noexcept
+    {
+    }
+};
+} // namespace allo
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "allo/allocation_tags.h"
 #include "allo/detail/abstracts.h"
 #include "allo/detail/destruction_callback.h"
 #include "allo/structures/any_allocator.h"
@@ -7,12 +8,69 @@
 
 namespace allo {
 
+/// A snapshot of how the memory inside of a heap_allocator_t is laid out,
+/// from heap_allocator_t::heap_report(). Sizes of free blocks include the
+/// space their own free list node takes up.
+struct heap_report_t
+{
+    /// free_size_histogram[i] is the number of free blocks whose size is at
+    /// least 2^i bytes and less than 2^(i + 1) bytes.
+    static constexpr size_t num_size_classes = 64;
+
+    /// Number of blocks of memory the heap has gotten from its parent, and
+    /// their total size. Does not include allocations above the mmap
+    /// threshold.
+    size_t block_count;
+    size_t heap_bytes;
+    /// Live allocations inside the heap's blocks, the bytes that were
+    /// requested for them, and the bytes they actually take up.
+    size_t live_allocations;
+    size_t bytes_requested;
+    size_t bytes_in_use;
+    /// Part of bytes_in_use taken up by the header stored before every
+    /// allocation. The rest of the difference between bytes_in_use and
+    /// bytes_requested is alignment padding and leftovers too small to free.
+    size_t bookkeeping_bytes;
+    size_t free_block_count;
+    size_t free_bytes;
+    size_t largest_free_block;
+    size_t free_size_histogram[num_size_classes];
+    /// Same as mapped_allocation_count() and mapped_allocation_bytes().
+    size_t mapped_allocation_count;
+    size_t mapped_allocation_bytes;
+
+    /// Fraction of the free bytes which are not in the largest free block,
+    /// from 0 (all free memory is contiguous) to almost 1 (free memory is in
+    /// many small pieces). Zero if nothing is free.
+    [[nodiscard]] inline double external_fragmentation() const noexcept
+    {
+        if (free_bytes == 0)
+            return 0;
+        return 1.0 - (static_cast<double>(largest_free_block) /
+                      static_cast<double>(free_bytes));
+    }
+};
+
+enum class HeapReportFormat : uint8_t
+{
+    /// Human readable, one line per statistic and per block.
+    Text,
+    /// A single JSON object, with no trailing newline.
+    Json,
+};
+
+/// Receives the output of heap_allocator_t::write_heap_report() a piece at a
+/// time. The text is not null terminated.
+using heap_report_writer_t = void (*)(const char* text, size_t length,
+                                      void* user_data);
+
 class heap_allocator_t : public detail::abstract_heap_allocator_t
 {
   public:
     using destruction_callback_node_t =
         detail::destruction_callback_entry_list_node_cacheline_t;
     struct free_node_t;
+    struct large_allocation_t;
     /// Stored before every allocation
     struct allocation_bookkeeping_t
     {
@@ -39,6 +97,26 @@ class heap_allocator_t : public detail::abstract_heap_allocator_t
         free_node_t* free_list_head;
         segmented_stack_t<bytes_t>* blocks;
         any_allocator_t parent;
+        // allocations of at least this many bytes get their own pages from
+        // the OS instead of going in the heap. zero to disable
+        size_t mmap_threshold;
+        size_t pagesize;
+        // doubly linked list of all the allocations made directly from the OS
+        large_allocation_t* large_allocations;
+        size_t large_allocations_count;
+        size_t large_allocations_bytes;
+        // bytes taken up by live allocations in the heap's blocks, and the
+        // most there have been since the last trim()
+        size_t bytes_in_use;
+        size_t peak_bytes_in_use;
+        // live allocations in the heap's blocks, and the sum of their
+        // requested sizes
+        size_t allocations_in_use;
+        size_t bytes_requested_in_use;
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+        detail::allocation_tag_counters_t tags;
+#endif
+        bool auto_trim;
     } m;
 
     [[nodiscard]] static heap_allocator_t
@@ -89,6 +167,96 @@ class heap_allocator_t : public detail::abstract_heap_allocator_t
     register_destruction_callback(destruction_callback_t callback,
                                   void* user_data) noexcept;
 
+    /// Make allocations of at least "bytes" bytes skip the heap and instead
+    /// get their own pages directly from the OS, which are returned to the OS
+    /// as soon as they are freed. This stops a single large allocation from
+    /// permanently growing the heap. Zero (the default) disables this, in
+    /// which case the heap allocator never makes any syscalls. Returns OsErr
+    /// if the page size could not be determined.
+    allocation_status_t set_mmap_threshold(size_t bytes) noexcept;
+
+    [[nodiscard]] inline constexpr size_t mmap_threshold() const noexcept
+    {
+        return m.mmap_threshold;
+    }
+
+    /// Number of live allocations which were made directly from the OS
+    /// because they were bigger than the mmap threshold.
+    [[nodiscard]] inline constexpr size_t
+    mapped_allocation_count() const noexcept
+    {
+        return m.large_allocations_count;
+    }
+
+    /// Total bytes, rounded up to pages, of all the live allocations made
+    /// directly from the OS.
+    [[nodiscard]] inline constexpr size_t
+    mapped_allocation_bytes() const noexcept
+    {
+        return m.large_allocations_bytes;
+    }
+
+    /// Give every block of memory which has no live allocations in it back
+    /// to the parent, except for the block currently being allocated from.
+    /// Only possible if the parent is a heap allocator; otherwise nothing is
+    /// done. Returns the number of bytes given back. This has to look at every
+    /// free node in the heap, so it should not be called very often.
+    size_t trim() noexcept;
+
+    /// Call trim() automatically when freeing, once the bytes in use fall to a
+    /// quarter of the most that have been in use since the last trim. The gap
+    /// between the two means that a heap whose usage goes back and forth
+    /// across the end of a block does not keep freeing and reallocating it.
+    /// Off by default.
+    inline void set_auto_trim(bool enabled) noexcept
+    {
+        m.auto_trim = enabled;
+    }
+
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    /// Limit the bytes requested by live allocations with the tag. Allocations
+    /// which would go over it fail with BudgetExceeded, and so do remaps which
+    /// would grow past it. Zero removes the budget. Returns InvalidArgument if
+    /// the tag is out of range.
+    inline allocation_status_t set_tag_budget(allocation_tag_t tag,
+                                              size_t bytes) noexcept
+    {
+        ALLO_VALID_ARG_ASSERT(tag.value < allocation_tag_t::max);
+        if (tag.value >= allocation_tag_t::max)
+            return AllocationStatusCode::InvalidArgument;
+        m.tags.set_budget(tag.value, bytes);
+        return AllocationStatusCode::Okay;
+    }
+
+    /// Live and peak usage of the tag, in the heap's blocks and allocations
+    /// above the mmap threshold.
+    [[nodiscard]] inline allocation_tag_stats_t
+    tag_stats(allocation_tag_t tag) const noexcept
+    {
+        ALLO_VALID_ARG_ASSERT(tag.value < allocation_tag_t::max);
+        if (tag.value >= allocation_tag_t::max)
+            return {};
+        return m.tags.get(tag.value);
+    }
+#endif
+
+    /// Walk the free list and blocks and count up how fragmented the heap
+    /// is. Takes time proportional to the number of free blocks, and does not
+    /// allocate.
+    [[nodiscard]] heap_report_t heap_report() const noexcept;
+
+    /// Number of characters in each block's map in write_heap_report().
+    static constexpr size_t chunk_map_cells = 64;
+
+    /// Write heap_report(), followed by a map of each block, to the writer.
+    /// Each block is divided into chunk_map_cells equal parts, each drawn as
+    /// '.' if it is entirely free, '#' if it is entirely in use, and '+' if
+    /// it is partially free. Takes time proportional to the number of free
+    /// blocks times the number of blocks, and does not allocate.
+    void write_heap_report(HeapReportFormat format,
+                           heap_report_writer_t writer,
+                           void* user_data) const noexcept;
+
     ~heap_allocator_t() noexcept;
     // cannot be copied
     heap_allocator_t(const heap_allocator_t& other) = delete;
@@ -121,7 +289,23 @@ class heap_allocator_t : public detail::abstract_heap_allocator_t
                                 free_node_t* newmem_insert_location) noexcept;
 
     [[nodiscard]] zl::res<allocation_bookkeeping_t*, AllocationStatusCode>
-    free_common(bytes_t mem, size_t typehash) const noexcept;
+    free_common(bytes_t mem) const noexcept;
+
+    /// Returns the header of an allocation made directly from the OS, or
+    /// nullptr if the memory was allocated normally. The header may belong to
+    /// another heap, so callers must check its owner.
+    [[nodiscard]] static large_allocation_t*
+    large_allocation_of(bytes_t mem) noexcept;
+
+    [[nodiscard]] allocation_result_t
+    alloc_large(size_t bytes, uint8_t alignment_exponent,
+                size_t typehash) noexcept;
+
+    [[nodiscard]] allocation_result_t
+    remap_large(large_allocation_t& large, bytes_t mem, size_t new_size,
+                size_t new_typehash) noexcept;
+
+    void free_large(large_allocation_t& large) noexcept;
 #ifndef NDEBUG
     [[nodiscard]] bool contains(bytes_t) const noexcept;
 #endif
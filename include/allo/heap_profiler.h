@@ -0,0 +1,265 @@
+#pragma once
+
+#include "allo/status.h"
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
+namespace allo {
+
+/// One sampled allocation which has not been freed yet.
+struct heap_sample_t
+{
+    static constexpr size_t max_frames = 32;
+
+    /// Zero for an empty slot in the profiler's table.
+    uintptr_t address;
+    size_t size;
+    size_t typehash;
+    uint8_t alignment_exponent;
+    /// Number of valid entries in frames, innermost first. Zero on platforms
+    /// without backtrace().
+    uint8_t depth;
+    void* frames[max_frames];
+};
+
+namespace detail {
+struct heap_profiler_thread_cache_t
+{
+    uint64_t profiler_id = 0;
+    int64_t bytes_until_sample = 0;
+    uint64_t rng_state = 0;
+};
+/// Each thread counts down to its next sample separately, so deciding not to
+/// sample an allocation touches nothing shared.
+inline thread_local heap_profiler_thread_cache_t heap_profiler_thread_cache;
+} // namespace detail
+
+/// Samples allocations made through sampling_allocator_t, like tcmalloc's heap
+/// profiler: roughly one sample is taken every sample_interval bytes, and each
+/// one records the size, typehash, and a backtrace of the allocating thread.
+/// Samples stay in a table until the allocation is freed, so at any point the
+/// table shows which code paths are holding memory.
+///
+/// The interval between samples is random, from an exponential distribution,
+/// so that allocations which happen in a regular pattern are still sampled
+/// fairly. Allocations which are not sampled cost a thread-local subtraction,
+/// and frees of them usually cost a single relaxed atomic load.
+///
+/// Threadsafe. Recording and removing samples takes a lock, but that only
+/// happens once per sample.
+class heap_profiler_t
+{
+  public:
+    struct options_t
+    {
+        /// Average number of bytes allocated between samples.
+        size_t sample_interval = 512UL * 1024;
+        /// Most samples which can be live at once. Samples taken while the
+        /// table is full are dropped and counted in dropped_samples().
+        size_t max_live_samples = 4096;
+    };
+
+  private:
+    static constexpr size_t filter_size = 4096;
+
+    struct state_t
+    {
+        uint64_t id;
+        size_t mapped_bytes;
+        size_t sample_interval;
+        size_t max_live_samples;
+        /// Number of slots in table, a power of two.
+        size_t capacity;
+        heap_sample_t* table;
+        std::atomic<size_t> total_samples;
+        std::atomic<size_t> dropped_samples;
+        /// How many live samples' addresses hash to each entry. If an entry is
+        /// zero, an address which hashes to it was definitely not sampled.
+        std::atomic<uint32_t> filter[filter_size];
+        std::mutex mutex;
+        // guarded by mutex
+        size_t live_samples;
+    };
+
+    struct M
+    {
+        state_t* state;
+    } m;
+
+  public:
+    /// May return OOM or OsErr if the memory for the table could not be mapped,
+    /// or InvalidArgument if sample_interval or max_live_samples is zero.
+    [[nodiscard]] static zl::res<heap_profiler_t, AllocationStatusCode>
+    make(const options_t& options) noexcept;
+
+    /// Count an allocation of this many bytes towards the calling thread's
+    /// next sample, and return whether this allocation should be sampled.
+    [[nodiscard]] inline bool should_sample(size_t bytes) noexcept
+    {
+        detail::heap_profiler_thread_cache_t& cache =
+            detail::heap_profiler_thread_cache;
+        if (cache.profiler_id != m.state->id) [[unlikely]] {
+            // the intervals are memoryless, so starting a new one whenever a
+            // thread switches profilers does not skew the samples
+            cache.profiler_id = m.state->id;
+            if (cache.rng_state == 0)
+                cache.rng_state = seed_for_this_thread();
+            cache.bytes_until_sample = next_interval(cache);
+        }
+        cache.bytes_until_sample -= static_cast<int64_t>(bytes);
+        if (cache.bytes_until_sample > 0) [[likely]]
+            return false;
+        cache.bytes_until_sample = next_interval(cache);
+        return true;
+    }
+
+    /// Take a backtrace of the calling thread and add the allocation to the
+    /// live samples. Call only when should_sample() returned true.
+    void record_sample(const void* address, size_t size,
+                       uint8_t alignment_exponent, size_t typehash) noexcept;
+
+    /// Must be called before any allocation which may have been sampled is
+    /// freed or moved, so that its address is not mistaken for a later
+    /// allocation.
+    inline void record_free(const void* address) noexcept
+    {
+        if (m.state->filter[filter_index(address)].load(
+                std::memory_order_relaxed) == 0) [[likely]]
+            return;
+        remove_sample(address, nullptr);
+    }
+
+    /// Same as record_free(), but copies the removed sample into out and
+    /// returns true if the allocation was sampled, so that it can be put back
+    /// with restore_sample() if the allocation ends up not being freed or
+    /// moved after all.
+    [[nodiscard]] inline bool take_sample(const void* address,
+                                          heap_sample_t& out) noexcept
+    {
+        if (m.state->filter[filter_index(address)].load(
+                std::memory_order_relaxed) == 0) [[likely]]
+            return false;
+        return remove_sample(address, &out);
+    }
+
+    /// Add a sample which was removed by take_sample() back to the live
+    /// samples, without counting it again in total_samples().
+    inline void restore_sample(const heap_sample_t& sample) noexcept
+    {
+        insert_sample(sample);
+    }
+
+    [[nodiscard]] inline size_t sample_interval() const noexcept
+    {
+        return m.state->sample_interval;
+    }
+
+    [[nodiscard]] inline size_t total_samples() const noexcept
+    {
+        return m.state->total_samples.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] inline size_t dropped_samples() const noexcept
+    {
+        return m.state->dropped_samples.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] size_t live_samples() const noexcept;
+
+    /// How many bytes a sampled allocation of this size stands for: its size
+    /// divided by the chance that it was sampled.
+    [[nodiscard]] inline double
+    estimated_bytes_of(size_t sample_size) const noexcept
+    {
+        const double size = static_cast<double>(sample_size);
+        const double probability =
+            1.0 -
+            std::exp(-size / static_cast<double>(m.state->sample_interval));
+        return probability > 0 ? size / probability : 0;
+    }
+
+    /// The estimated total size of all live allocations, scaled up from the
+    /// live samples.
+    [[nodiscard]] size_t estimated_live_bytes() const noexcept;
+
+    /// Call f(const heap_sample_t&) for each live sample. Holds the
+    /// profiler's lock, so f must not allocate through a sampling_allocator_t
+    /// which uses this profiler.
+    template <typename Callable>
+    inline void for_each_live_sample(Callable&& f) const noexcept
+    {
+        static_assert(
+            std::is_invocable_r_v<void, Callable, const heap_sample_t&>,
+            "The given function either does not return void or cannot be "
+            "called with just a const heap_sample_t&.");
+        std::lock_guard lock(m.state->mutex);
+        for (size_t i = 0; i < m.state->capacity; ++i) {
+            const heap_sample_t& sample = m.state->table[i];
+            if (sample.address != 0)
+                f(sample);
+        }
+    }
+
+    /// Write the live samples to a file in the legacy text format of
+    /// tcmalloc's heap profiler ("heap_v2"), which pprof reads and scales up
+    /// by the sample interval itself. On linux, the file ends with the
+    /// process' memory mappings so that pprof can symbolize the addresses.
+    /// For example: pprof -top ./program heap.prof
+    ///
+    /// Returns OsErr if the file could not be written.
+    [[nodiscard]] allocation_status_t
+    write_profile(const char* path) const noexcept;
+
+    ~heap_profiler_t() noexcept;
+    // cannot be copied
+    heap_profiler_t(const heap_profiler_t& other) = delete;
+    heap_profiler_t& operator=(const heap_profiler_t& other) = delete;
+    // can be move constructed
+    heap_profiler_t(heap_profiler_t&& other) noexcept;
+    // but not move assigned
+    heap_profiler_t& operator=(heap_profiler_t&& other) = delete;
+
+  private:
+    inline heap_profiler_t(M&& members) noexcept : m(members) {}
+
+    [[nodiscard]] static inline size_t
+    filter_index(const void* address) noexcept
+    {
+        // fibonacci hashing, with the low bits of the address thrown away
+        // since they are mostly zero from alignment
+        const auto bits = reinterpret_cast<uintptr_t>(address) >> 4;
+        return static_cast<size_t>((bits * 0x9E3779B97F4A7C15ULL) >> 52) &
+               (filter_size - 1);
+    }
+
+    [[nodiscard]] inline int64_t
+    next_interval(detail::heap_profiler_thread_cache_t& cache) const noexcept
+    {
+        // xorshift64, then take the top 53 bits as a double in (0, 1]
+        cache.rng_state ^= cache.rng_state << 13;
+        cache.rng_state ^= cache.rng_state >> 7;
+        cache.rng_state ^= cache.rng_state << 17;
+        const double uniform =
+            static_cast<double>((cache.rng_state >> 11) + 1) *
+            (1.0 / 9007199254740992.0);
+        const double interval =
+            -std::log(uniform) * static_cast<double>(m.state->sample_interval);
+        return static_cast<int64_t>(interval) + 1;
+    }
+
+    [[nodiscard]] static uint64_t seed_for_this_thread() noexcept;
+
+    /// Returns false if the address was not sampled. Otherwise, copies the
+    /// sample into removed, if it is not null.
+    bool remove_sample(const void* address, heap_sample_t* removed) noexcept;
+
+    void insert_sample(const heap_sample_t& sample) noexcept;
+};
+} // namespace allo
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/heap_profiler.h"
+#endif
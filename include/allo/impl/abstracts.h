@@ -12,9 +12,13 @@
 #include "allo/block_allocator.h"
 #include "allo/c_allocator.h"
 #include "allo/heap_allocator.h"
+#include "allo/mapped_file_allocator.h"
 #include "allo/reservation_allocator.h"
+#include "allo/sampling_allocator.h"
 #include "allo/scratch_allocator.h"
+#include "allo/shared_block_allocator.h"
 #include "allo/stack_allocator.h"
+#include "allo/tracing_allocator.h"
 
 #ifdef ALLO_HEADER_ONLY
 #ifndef ALLO_FUNC
@@ -51,7 +55,7 @@ template <typename T, typename... Args> struct remap_bytes_generic
 {
     inline allocation_result_t operator()(T* item, Args&&... args)
     {
-        if constexpr (!std::is_same_v<T, scratch_allocator_t>) {
+        if constexpr (is_freer<T>) {
             return item->remap_bytes(std::forward<Args>(args)...);
         } else {
             std::abort();
@@ -63,7 +67,7 @@ template <typename T, typename... Args> struct free_bytes_generic
 {
     inline allocation_status_t operator()(T* item, Args&&... args)
     {
-        if constexpr (!std::is_same_v<T, scratch_allocator_t>) {
+        if constexpr (is_freer<T>) {
             return item->free_bytes(std::forward<Args>(args)...);
         } else {
             std::abort();
@@ -75,7 +79,7 @@ template <typename T, typename... Args> struct free_status_generic
 {
     inline allocation_status_t operator()(T* item, Args&&... args)
     {
-        if constexpr (!std::is_same_v<T, scratch_allocator_t>) {
+        if constexpr (is_freer<T>) {
             return item->free_status(std::forward<Args>(args)...);
         } else {
             std::abort();
@@ -128,6 +132,26 @@ auto return_from(detail::abstract_allocator_t* self, Args&&... args)
         return Callable<reservation_allocator_t, Args...>{}(
             reservation, std::forward<Args>(args)...);
     }
+    case AllocatorType::MappedFileAllocator: {
+        auto* mapped_file = reinterpret_cast<mapped_file_allocator_t*>(self);
+        return Callable<mapped_file_allocator_t, Args...>{}(
+            mapped_file, std::forward<Args>(args)...);
+    }
+    case AllocatorType::SharedBlockAllocator: {
+        auto* shared = reinterpret_cast<shared_block_allocator_t*>(self);
+        return Callable<shared_block_allocator_t, Args...>{}(
+            shared, std::forward<Args>(args)...);
+    }
+    case AllocatorType::TracingAllocator: {
+        auto* tracing = reinterpret_cast<tracing_allocator_t*>(self);
+        return Callable<tracing_allocator_t, Args...>{}(
+            tracing, std::forward<Args>(args)...);
+    }
+    case AllocatorType::SamplingAllocator: {
+        auto* sampling = reinterpret_cast<sampling_allocator_t*>(self);
+        return Callable<sampling_allocator_t, Args...>{}(
+            sampling, std::forward<Args>(args)...);
+    }
     default:
         // some sort of memory corruption going on
         std::abort();
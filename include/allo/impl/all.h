@@ -6,6 +6,15 @@
 #include "allo/impl/block_allocator.h"
 #include "allo/impl/c_allocator.h"
 #include "allo/impl/heap_allocator.h"
+#include "allo/impl/heap_profiler.h"
+#include "allo/impl/mapped_file_allocator.h"
 #include "allo/impl/reservation_allocator.h"
+#include "allo/impl/ring_buffer.h"
+#include "allo/impl/sampling_allocator.h"
 #include "allo/impl/scratch_allocator.h"
+#include "allo/impl/shared_block_allocator.h"
 #include "allo/impl/stack_allocator.h"
+#include "allo/impl/syscall_stats.h"
+#include "allo/impl/trace.h"
+#include "allo/impl/trace_replay.h"
+#include "allo/impl/tracing_allocator.h"
@@ -50,6 +50,7 @@ block_allocator_t::block_allocator_t(block_allocator_t&& other) noexcept
     : m(other.m)
 {
     m_type = other.m_type;
+    move_stats_from(other);
     other.m.parent = {};
     other.m.last_callback_array = nullptr;
 #ifndef NDEBUG
@@ -116,6 +117,7 @@ ALLO_FUNC allocation_status_t block_allocator_t::grow() noexcept
 {
     if (m.parent.is_null())
         return AllocationStatusCode::OOM;
+    ALLO_COUNT_PAGE_FAULTS();
 
     const auto additional_blocks_needed = static_cast<size_t>(
         std::ceil(static_cast<float>(m.total_blocks) * growth_percentage));
@@ -129,6 +131,8 @@ ALLO_FUNC allocation_status_t block_allocator_t::grow() noexcept
         auto res = m.parent.get_heap_unchecked().remap_bytes(
             m.memory, 0, m.memory.size() + additional_bytes_needed, 0);
         if (res.okay()) {
+            ALLO_RECORD_STATS(record_parent_grow());
+            ALLO_MARK_SLOW_PATH();
             if (m.blocks) {
                 ALLO_INTERNAL_ASSERT(m.blocks->end_unchecked() == m.memory);
                 m.blocks->pop();
@@ -155,8 +159,11 @@ ALLO_FUNC allocation_status_t block_allocator_t::grow() noexcept
 
             m.last_freed = oldmem.end().ptr();
 
+            ALLO_EMIT_EVENT(on_grow, additional_bytes_needed);
             return AllocationStatusCode::Okay;
         }
+        ALLO_EMIT_EVENT(on_parent_remap_failed, m.memory,
+                        m.memory.size() + additional_bytes_needed, res.err());
     }
 
     auto& parent = m.parent.cast_to_basic();
@@ -205,8 +212,12 @@ ALLO_FUNC allocation_status_t block_allocator_t::grow() noexcept
         return res.err();
     }
 
+    ALLO_RECORD_STATS(record_parent_grow());
+    ALLO_MARK_SLOW_PATH();
+    ALLO_RECORD_STATS(record_block_acquired());
     m.memory = res.release_ref();
     m.blocks->end_unchecked() = m.memory;
+    ALLO_EMIT_EVENT(on_grow, m.memory.size());
     // otherwise we would need to point the thing at the end of the free list to
     // us
     ALLO_INTERNAL_ASSERT(m.blocks_free == 0);
@@ -223,6 +234,50 @@ ALLO_FUNC allocation_status_t block_allocator_t::grow() noexcept
     return AllocationStatusCode::Okay;
 }
 
+ALLO_FUNC size_t block_allocator_t::trim() noexcept
+{
+    m.peak_blocks_in_use = m.total_blocks - m.blocks_free;
+    if (!m.blocks || !m.parent.is_heap())
+        return 0;
+
+    size_t bytes_released = 0;
+    m.blocks->remove_if([this, &bytes_released](bytes_t& chunk) -> bool {
+        if (chunk == m.memory)
+            return false;
+
+        const size_t blocks_in_chunk = chunk.size() / m.blocksize;
+        size_t free_blocks_in_chunk = 0;
+        void* iter = m.last_freed;
+        for (size_t i = 0; i < m.blocks_free; ++i) {
+            if (zl::memcontains_one(chunk, static_cast<uint8_t*>(iter)))
+                ++free_blocks_in_chunk;
+            iter = *static_cast<void**>(iter);
+        }
+        if (free_blocks_in_chunk != blocks_in_chunk)
+            return false;
+
+        // remove this chunk's blocks from the free list. the next pointer of
+        // each free block is stored at the start of the block
+        void** link = &m.last_freed;
+        for (size_t i = 0; i < m.blocks_free; ++i) {
+            void* const block = *link;
+            if (zl::memcontains_one(chunk, static_cast<uint8_t*>(block)))
+                *link = *static_cast<void**>(block);
+            else
+                link = static_cast<void**>(block);
+        }
+        m.blocks_free -= blocks_in_chunk;
+        m.total_blocks -= blocks_in_chunk;
+
+        bytes_released += chunk.size();
+        m.parent.get_heap_unchecked().free_bytes(chunk, 0);
+        ALLO_RECORD_STATS(record_block_released());
+        ALLO_MARK_SLOW_PATH();
+        return true;
+    });
+    return bytes_released;
+}
+
 #ifndef NDEBUG
 ALLO_FUNC bool block_allocator_t::contains(bytes_t bytes) const noexcept
 {
@@ -247,12 +302,15 @@ ALLO_FUNC bool block_allocator_t::contains(bytes_t bytes) const noexcept
 ALLO_FUNC allocation_result_t block_allocator_t::alloc_bytes(
     size_t bytes, uint8_t alignment_exponent, size_t typehash) noexcept
 {
+    ALLO_TIME_OPERATION(Alloc);
     // make sure it can even fit in a block
     ALLO_VALID_ARG_ASSERT(
         bytes <= m.blocksize &&
         "Attempted allocation too big for block allocator...");
-    if (bytes > m.blocksize) [[unlikely]]
+    if (bytes > m.blocksize) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_alloc());
         return AllocationStatusCode::OOM;
+    }
 
     // check if we can guarantee that a given block will be aligned to the
     // requested exponent
@@ -260,14 +318,18 @@ ALLO_FUNC allocation_result_t block_allocator_t::alloc_bytes(
         detail::nearest_alignment_exponent(m.blocksize);
     ALLO_INTERNAL_ASSERT(our_alignment != 64);
     if (alignment_exponent > our_alignment) {
+        ALLO_RECORD_STATS(record_failed_alloc());
         return AllocationStatusCode::AllocationTooAligned;
     }
 
     // allocate a new set of blocks if necessary
     if (m.blocks_free == 0) [[unlikely]] {
         auto res = grow();
-        if (!res.okay()) [[unlikely]]
+        if (!res.okay()) [[unlikely]] {
+            ALLO_RECORD_STATS(record_failed_alloc());
+            ALLO_EMIT_EVENT(on_oom, bytes);
             return res.err();
+        }
     }
     ALLO_INTERNAL_ASSERT(m.blocks_free >= 1);
 
@@ -284,6 +346,8 @@ ALLO_FUNC allocation_result_t block_allocator_t::alloc_bytes(
 
     m.last_freed = next_to_last_freed;
     --m.blocks_free;
+    if (m.total_blocks - m.blocks_free > m.peak_blocks_in_use)
+        m.peak_blocks_in_use = m.total_blocks - m.blocks_free;
 
 #ifndef ALLO_DISABLE_TYPEINFO
     // try to insert the typehash after the allocation
@@ -298,6 +362,7 @@ ALLO_FUNC allocation_result_t block_allocator_t::alloc_bytes(
 #endif
 
     ALLO_INTERNAL_ASSERT(chosen_block.size() >= bytes);
+    ALLO_RECORD_STATS(record_alloc(bytes, m.blocksize));
     return allocation_result_t(std::in_place, chosen_block, 0, bytes);
 }
 
@@ -323,7 +388,9 @@ ALLO_FUNC allocation_result_t
 block_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash,
                                size_t new_size, size_t new_typehash) noexcept
 {
+    ALLO_TIME_OPERATION(Remap);
     if (new_size > m.blocksize) {
+        ALLO_RECORD_STATS(record_failed_remap());
         return AllocationStatusCode::OOM;
     }
 #ifndef ALLO_DISABLE_TYPEINFO
@@ -331,6 +398,9 @@ block_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash,
         if (auto* typehash_location =
                 get_location_for_typehash(mem.data(), mem.size())) {
             if (*typehash_location != old_typehash) {
+                ALLO_RECORD_STATS(record_failed_remap());
+                ALLO_EMIT_EVENT(on_type_mismatch, mem, *typehash_location,
+                                old_typehash);
                 return AllocationStatusCode::InvalidType;
             }
         }
@@ -342,18 +412,40 @@ block_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash,
         }
     }
 #endif
+    ALLO_RECORD_STATS(
+        record_remap(mem.size(), new_size, m.blocksize, m.blocksize));
     return zl::raw_slice(*mem.data(), new_size);
 }
 
 ALLO_FUNC allocation_status_t
 block_allocator_t::free_bytes(bytes_t mem, size_t typehash) noexcept
 {
+    ALLO_TIME_OPERATION(Free);
     auto checkerr = free_status(mem, typehash);
-    if (!checkerr.okay())
+    if (!checkerr.okay()) {
+        ALLO_RECORD_STATS(record_failed_free());
+#ifndef ALLO_DISABLE_TYPEINFO
+        if (checkerr.err() == AllocationStatusCode::InvalidType) {
+            ALLO_EMIT_EVENT(on_type_mismatch, mem,
+                            *get_location_for_typehash(mem.data(), mem.size()),
+                            typehash);
+            return checkerr;
+        }
+#endif
+        ALLO_EMIT_EVENT(on_invalid_free, mem, checkerr.err());
         return checkerr;
+    }
 
+    ALLO_RECORD_STATS(record_free(mem.size(), m.blocksize));
     *reinterpret_cast<void**>(mem.data()) = m.last_freed;
     m.last_freed = mem.data();
+    ++m.blocks_free;
+
+    if (m.auto_trim && m.blocks &&
+        m.total_blocks - m.blocks_free <= m.peak_blocks_in_use / 4)
+        [[unlikely]] {
+        trim();
+    }
 
     return AllocationStatusCode::Okay;
 }
@@ -21,26 +21,42 @@ namespace allo {
 ALLO_FUNC allocation_result_t c_allocator_t::alloc_bytes(
     size_t bytes, uint8_t alignment_exponent, size_t) noexcept
 {
-    if (alignment_exponent > 5)
+    ALLO_TIME_OPERATION(Alloc);
+    if (alignment_exponent > 5) {
+        ALLO_RECORD_STATS(record_failed_alloc());
         return AllocationStatusCode::AllocationTooAligned;
+    }
+    ALLO_COUNT_C_LIBRARY_CALL(malloc);
     void* newmem = ::malloc(bytes);
+    if (newmem == nullptr) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_alloc());
+        return AllocationStatusCode::OOM;
+    }
+    ALLO_RECORD_STATS(record_alloc(bytes, bytes));
     return zl::raw_slice(*reinterpret_cast<uint8_t*>(newmem), bytes);
 }
 
 ALLO_FUNC allocation_result_t c_allocator_t::threadsafe_realloc_bytes(
     bytes_t mem, size_t, size_t new_size, size_t) noexcept
 {
+    ALLO_TIME_OPERATION(Remap);
+    ALLO_COUNT_C_LIBRARY_CALL(realloc);
     void* newmem = ::realloc(mem.data(), new_size);
     if (newmem == nullptr) {
+        ALLO_RECORD_STATS(record_failed_remap());
         return AllocationStatusCode::OOM;
     }
+    ALLO_RECORD_STATS(record_remap(mem.size(), new_size, mem.size(), new_size));
     return zl::raw_slice(*reinterpret_cast<uint8_t*>(newmem), new_size);
 }
 
 ALLO_FUNC allocation_status_t c_allocator_t::free_bytes(bytes_t mem,
                                                         size_t) noexcept
 {
+    ALLO_TIME_OPERATION(Free);
+    ALLO_COUNT_C_LIBRARY_CALL(free);
     ::free(mem.data());
+    ALLO_RECORD_STATS(record_free(mem.size(), mem.size()));
     return AllocationStatusCode::Okay;
 }
 }; // namespace allo
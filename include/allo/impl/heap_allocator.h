@@ -7,9 +7,14 @@
 #endif
 #endif
 
+#include "allo/detail/alignment.h"
 #include "allo/detail/asserts.h"
+#include "allo/detail/round_up_to_multiple_of.h"
 #include "allo/heap_allocator.h"
+#include "allo/memory_map.h"
 #include <cmath>
+#include <cstdarg>
+#include <cstdio>
 #include <memory>
 #include <ziglike/stdmem.h>
 
@@ -29,6 +34,30 @@ struct heap_allocator_t::free_node_t
     free_node_t* next = nullptr;
 };
 
+/// Stored directly before every allocation which was made with its own pages
+/// from the OS, in the same place as the allocation_bookkeeping_t of a normal
+/// allocation
+struct heap_allocator_t::large_allocation_t
+{
+    large_allocation_t* prev;
+    large_allocation_t* next;
+    // the heap whose list this is in. anything with the magic number in front
+    // of it but a different owner was not allocated by this heap
+    const heap_allocator_t* owner;
+    // start of the pages containing this header and the allocation
+    void* mapping;
+    size_t mapped_bytes;
+    size_t size_requested;
+#ifndef ALLO_DISABLE_TYPEINFO
+    size_t typehash;
+#endif
+    // NOTE: this is in the same place as allocation_bookkeeping_t::magic,
+    // and is odd and not a valid address so it cannot be mistaken for either
+    // the bookkeeping magic or a pointer to a bookkeeping struct
+    static constexpr size_t static_magic = 0x0B16A11001A46E01;
+    size_t magic = static_magic;
+};
+
 ALLO_FUNC heap_allocator_t heap_allocator_t::make_inner(
     const bytes_t& memory, any_allocator_t parent) noexcept
 {
@@ -59,14 +88,19 @@ ALLO_FUNC heap_allocator_t heap_allocator_t::make_inner(
 ALLO_FUNC heap_allocator_t::heap_allocator_t(M&& members) noexcept : m(members)
 {
     m_type = enum_value;
+    ALLO_RECORD_STATS(record_block_acquired());
 }
 
 ALLO_FUNC heap_allocator_t::heap_allocator_t(heap_allocator_t&& other) noexcept
     : m(other.m)
 {
     m_type = enum_value;
+    move_stats_from(other);
     other.m.parent = {};
     other.m.last_callback_node = nullptr;
+    other.m.large_allocations = nullptr;
+    for (auto* iter = m.large_allocations; iter; iter = iter->next)
+        iter->owner = this;
 }
 
 ALLO_FUNC heap_allocator_t::~heap_allocator_t() noexcept
@@ -75,6 +109,10 @@ ALLO_FUNC heap_allocator_t::~heap_allocator_t() noexcept
         m.last_callback_node, destruction_callback_node_t::num_entries,
         m.last_callback_array_size);
 
+    while (m.large_allocations) {
+        free_large(*m.large_allocations);
+    }
+
     if (!m.parent.is_heap())
         return;
 
@@ -103,7 +141,9 @@ ALLO_FUNC allocation_status_t heap_allocator_t::register_destruction_callback(
             destruction_callback_node_t::num_entries) {
         // allocate new destruction callback node
         auto res = alloc_bytes(sizeof(destruction_callback_node_t),
-                               alignof(destruction_callback_node_t), 0);
+                               detail::nearest_alignment_exponent(
+                                   alignof(destruction_callback_node_t)),
+                               0);
         if (!res.okay())
             return res.err();
         auto* newnode = (destruction_callback_node_t*)res.release().data();
@@ -128,18 +168,61 @@ ALLO_FUNC allocation_result_t
 heap_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash, size_t new_size,
                               size_t new_typehash) noexcept
 {
+    ALLO_TIME_OPERATION(Remap);
+#ifndef ALLO_DISABLE_TYPEINFO
+    ALLO_VALID_ARG_ASSERT(old_typehash == new_typehash &&
+                          "heap allocator cannot change types on reallocation");
+    if (old_typehash != new_typehash) {
+        ALLO_RECORD_STATS(record_failed_remap());
+        return AllocationStatusCode::InvalidArgument;
+    }
+#endif
+    if (auto* large = large_allocation_of(mem)) {
+        if (large->owner != this) [[unlikely]] {
+            ALLO_RECORD_STATS(record_failed_remap());
+            return AllocationStatusCode::MemoryInvalid;
+        }
+#ifndef ALLO_DISABLE_TYPEINFO
+        if (!detail::typehashes_match(large->typehash, old_typehash))
+            [[unlikely]] {
+            ALLO_RECORD_STATS(record_failed_remap());
+            ALLO_EMIT_EVENT(on_type_mismatch, mem, large->typehash,
+                            old_typehash);
+            return AllocationStatusCode::InvalidType;
+        }
+#endif
+        return remap_large(*large, mem, new_size, new_typehash);
+    }
+
     // not possible to remap
     // TODO: remapping with this kind of allocator? maybe?
     if (mem.size() < new_size) {
+        ALLO_RECORD_STATS(record_failed_remap());
         return AllocationStatusCode::OOM;
     }
+
+    auto res = free_common(mem);
+    if (!res.okay()) {
+        ALLO_RECORD_STATS(record_failed_remap());
+        return res.err();
+    }
+    auto* bk = res.release();
 #ifndef ALLO_DISABLE_TYPEINFO
-    ALLO_VALID_ARG_ASSERT(old_typehash == new_typehash &&
-                          "heap allocator cannot change types on reallocation");
-    if (old_typehash != new_typehash) {
-        return AllocationStatusCode::InvalidArgument;
+    if (!detail::typehashes_match(bk->typehash, old_typehash)) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_remap());
+        ALLO_EMIT_EVENT(on_type_mismatch, mem, bk->typehash, old_typehash);
+        return AllocationStatusCode::InvalidType;
     }
 #endif
+    // so that the new size is what is expected when freeing
+    bk->size_requested = new_size;
+    m.bytes_requested_in_use -= mem.size() - new_size;
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    m.tags.record_resize(detail::tag_of_typehash(bk->typehash), mem.size(),
+                         new_size);
+#endif
+    ALLO_RECORD_STATS(record_remap(mem.size(), new_size, bk->size_actual,
+                                   bk->size_actual));
 
     return bytes_t(mem, 0, new_size);
 }
@@ -147,20 +230,60 @@ heap_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash, size_t new_size,
 ALLO_FUNC allocation_status_t
 heap_allocator_t::free_bytes(bytes_t mem, size_t typehash) noexcept
 {
-    auto res = free_common(mem, typehash);
-    if (!res.okay())
+    ALLO_TIME_OPERATION(Free);
+    if (auto* large = large_allocation_of(mem)) {
+        if (large->owner != this || large->size_requested != mem.size()) {
+            ALLO_RECORD_STATS(record_failed_free());
+            ALLO_EMIT_EVENT(on_invalid_free, mem,
+                            AllocationStatusCode::MemoryInvalid);
+            return AllocationStatusCode::MemoryInvalid;
+        }
+#ifndef ALLO_DISABLE_TYPEINFO
+        if (!detail::typehashes_match(large->typehash, typehash)) [[unlikely]] {
+            ALLO_RECORD_STATS(record_failed_free());
+            ALLO_EMIT_EVENT(on_type_mismatch, mem, large->typehash, typehash);
+            return AllocationStatusCode::InvalidType;
+        }
+#endif
+        free_large(*large);
+        return AllocationStatusCode::Okay;
+    }
+
+    auto res = free_common(mem);
+    if (!res.okay()) {
+        ALLO_RECORD_STATS(record_failed_free());
+        ALLO_EMIT_EVENT(on_invalid_free, mem, res.err());
         return res.err();
+    }
     auto* bk = res.release();
+#ifndef ALLO_DISABLE_TYPEINFO
+    if (!detail::typehashes_match(bk->typehash, typehash)) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_free());
+        ALLO_EMIT_EVENT(on_type_mismatch, mem, bk->typehash, typehash);
+        return AllocationStatusCode::InvalidType;
+    }
+#endif
 
+    ALLO_RECORD_STATS(record_free(mem.size(), bk->size_actual));
+    m.bytes_in_use -= bk->size_actual;
+    --m.allocations_in_use;
+    m.bytes_requested_in_use -= mem.size();
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    m.tags.record_free(detail::tag_of_typehash(bk->typehash), mem.size());
+#endif
     auto* node = reinterpret_cast<free_node_t*>(bk);
     *node = free_node_t{.size = bk->size_actual, .next = m.free_list_head};
     m.free_list_head = node;
 
+    if (m.auto_trim && m.blocks &&
+        m.bytes_in_use <= m.peak_bytes_in_use / 4) [[unlikely]] {
+        trim();
+    }
+
     return AllocationStatusCode::Okay;
 }
 
-ALLO_FUNC auto heap_allocator_t::free_common(bytes_t mem,
-                                             size_t typehash) const noexcept
+ALLO_FUNC auto heap_allocator_t::free_common(bytes_t mem) const noexcept
     -> zl::res<allocation_bookkeeping_t*, AllocationStatusCode>
 {
 
@@ -185,15 +308,11 @@ ALLO_FUNC auto heap_allocator_t::free_common(bytes_t mem,
         assert(contains(
             zl::raw_slice(*(uint8_t*)bk, sizeof(allocation_bookkeeping_t))));
     }
-    if (bk->size_requested == mem.size()) {
+    if (bk->size_requested != mem.size()) {
         return AllocationStatusCode::MemoryInvalid;
     }
-#ifndef ALLO_DISABLE_TYPEINFO
-    // NOTE: this really should be a log message
-    // TODO: return error if type doesnt match on a free? idk if this would be a
-    // good idea
-    assert(bk->typehash == typehash);
-#endif
+    // the typehash is checked by the callers, so that only the ones which
+    // actually free or remap emit on_type_mismatch
     return bk;
 }
 
@@ -222,15 +341,37 @@ ALLO_FUNC bool heap_allocator_t::contains(bytes_t bytes) const noexcept
 ALLO_FUNC allocation_result_t heap_allocator_t::alloc_bytes(
     size_t bytes, uint8_t alignment_exponent, size_t typehash) noexcept
 {
-    if (m.free_list_head == nullptr)
+    ALLO_TIME_OPERATION(Alloc);
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    const uint8_t tag = detail::current_allocation_tag;
+    if (!m.tags.within_budget(tag, bytes)) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_alloc());
+        return AllocationStatusCode::BudgetExceeded;
+    }
+    // stored in the bookkeeping with the allocation, to know which tag to
+    // count it against when it is freed
+    typehash = detail::tag_typehash(typehash, tag);
+#endif
+    // NOTE: allocations aligned to more than a page are left to the heap
+    if (m.mmap_threshold != 0 && bytes >= m.mmap_threshold &&
+        (size_t(1) << alignment_exponent) <= m.pagesize) [[unlikely]] {
+        return alloc_large(bytes, alignment_exponent, typehash);
+    }
+    if (m.free_list_head == nullptr) {
+        ALLO_RECORD_STATS(record_failed_alloc());
+        ALLO_EMIT_EVENT(on_oom, bytes);
         return AllocationStatusCode::OOM;
+    }
     auto res = alloc_bytes_inner(bytes, alignment_exponent, typehash,
                                  m.free_list_head);
     if (!res.success) {
         allocation_status_t status = try_make_space_for_at_least(
             res.actual_needed_size, res.last_searched);
-        if (!status.okay())
+        if (!status.okay()) {
+            ALLO_RECORD_STATS(record_failed_alloc());
+            ALLO_EMIT_EVENT(on_oom, bytes);
             return status.err();
+        }
         auto second_attempt = alloc_bytes_inner(bytes, alignment_exponent,
                                                 typehash, res.last_searched);
         ALLO_INTERNAL_ASSERT(second_attempt.success);
@@ -352,6 +493,16 @@ ALLO_FUNC auto heap_allocator_t::alloc_bytes_inner(
 #endif
             };
 
+            ALLO_RECORD_STATS(record_alloc(bytes, bookkeeping->size_actual));
+            m.bytes_in_use += bookkeeping->size_actual;
+            ++m.allocations_in_use;
+            m.bytes_requested_in_use += bytes;
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+            m.tags.record_alloc(detail::tag_of_typehash(typehash), bytes);
+#endif
+            if (m.bytes_in_use > m.peak_bytes_in_use)
+                m.peak_bytes_in_use = m.bytes_in_use;
+
             return inner_allocation_attempt_t{
                 .success =
                     zl::raw_slice(*reinterpret_cast<uint8_t*>(block), bytes)};
@@ -384,6 +535,7 @@ ALLO_FUNC allocation_status_t heap_allocator_t::try_make_space_for_at_least(
 {
     if (m.parent.is_null())
         return AllocationStatusCode::OOM;
+    ALLO_COUNT_PAGE_FAULTS();
 
     bytes_t oldmem = m.memory;
     constexpr auto minbytes = sizeof(free_node_t) + alignof(free_node_t);
@@ -415,6 +567,8 @@ ALLO_FUNC allocation_status_t heap_allocator_t::try_make_space_for_at_least(
         auto res = m.parent.get_heap_unchecked().remap_bytes(
             m.memory, 0, new_size_remapped, 0);
         if (res.okay()) {
+            ALLO_RECORD_STATS(record_parent_grow());
+            ALLO_MARK_SLOW_PATH();
             if (m.blocks) {
                 ALLO_INTERNAL_ASSERT(m.blocks->end_unchecked() == m.memory);
                 m.blocks->pop();
@@ -427,8 +581,11 @@ ALLO_FUNC allocation_status_t heap_allocator_t::try_make_space_for_at_least(
 
             format_new_memory(oldmem.end().ptr(),
                               m.memory.size() - oldmem.size());
+            ALLO_EMIT_EVENT(on_grow, m.memory.size() - oldmem.size());
             return AllocationStatusCode::Okay;
         }
+        ALLO_EMIT_EVENT(on_parent_remap_failed, m.memory, new_size_remapped,
+                        res.err());
     }
 
     auto& parent = m.parent.cast_to_basic();
@@ -466,18 +623,22 @@ ALLO_FUNC allocation_status_t heap_allocator_t::try_make_space_for_at_least(
         return pushres.err();
 
     // make actual allocation for the new buffer
-    auto res =
-        parent.alloc_bytes(round_up_to_valid_buffersize(
-                               actual_bytes, m.current_memory_original_size),
-                           alignof(free_node_t), 0);
+    auto res = parent.alloc_bytes(
+        round_up_to_valid_buffersize(actual_bytes,
+                                     m.current_memory_original_size),
+        detail::nearest_alignment_exponent(alignof(free_node_t)), 0);
     if (!res.okay()) [[unlikely]] {
         m.blocks->pop();
         return res.err();
     }
 
+    ALLO_RECORD_STATS(record_parent_grow());
+    ALLO_MARK_SLOW_PATH();
+    ALLO_RECORD_STATS(record_block_acquired());
     m.memory = res.release_ref();
     m.blocks->end_unchecked() = m.memory;
     format_new_memory(m.memory.data(), m.memory.size());
+    ALLO_EMIT_EVENT(on_grow, m.memory.size());
     // new current memory, so new original size
     m.current_memory_original_size = m.memory.size();
     return AllocationStatusCode::Okay;
@@ -486,7 +647,434 @@ ALLO_FUNC allocation_status_t heap_allocator_t::try_make_space_for_at_least(
 ALLO_FUNC allocation_status_t
 heap_allocator_t::free_status(bytes_t mem, size_t typehash) const noexcept
 {
-    return free_common(mem, typehash).err();
+    if (auto* large = large_allocation_of(mem)) {
+        if (large->owner != this || large->size_requested != mem.size())
+            return AllocationStatusCode::MemoryInvalid;
+#ifndef ALLO_DISABLE_TYPEINFO
+        if (!detail::typehashes_match(large->typehash, typehash))
+            return AllocationStatusCode::InvalidType;
+#endif
+        return AllocationStatusCode::Okay;
+    }
+    auto res = free_common(mem);
+    if (!res.okay())
+        return res.err();
+#ifndef ALLO_DISABLE_TYPEINFO
+    if (!detail::typehashes_match(res.release()->typehash, typehash))
+        return AllocationStatusCode::InvalidType;
+#endif
+    return AllocationStatusCode::Okay;
+}
+
+ALLO_FUNC size_t heap_allocator_t::trim() noexcept
+{
+    m.peak_bytes_in_use = m.bytes_in_use;
+    if (!m.blocks || !m.parent.is_heap())
+        return 0;
+
+    size_t bytes_released = 0;
+    m.blocks->remove_if([this, &bytes_released](bytes_t& block) -> bool {
+        if (block == m.memory)
+            return false;
+
+        // free nodes are never merged, but every byte of a block belongs to
+        // exactly one free node or allocation, so a block is empty if the
+        // sizes of the free nodes inside of it add up to its size
+        size_t free_bytes_in_block = 0;
+        for (free_node_t* iter = m.free_list_head; iter; iter = iter->next) {
+            if (zl::memcontains_one(block, reinterpret_cast<uint8_t*>(iter)))
+                free_bytes_in_block += iter->size;
+        }
+        if (free_bytes_in_block != block.size())
+            return false;
+
+        free_node_t** link = &m.free_list_head;
+        while (*link) {
+            if (zl::memcontains_one(block, reinterpret_cast<uint8_t*>(*link)))
+                *link = (*link)->next;
+            else
+                link = &(*link)->next;
+        }
+
+        bytes_released += block.size();
+        m.parent.get_heap_unchecked().free_bytes(block, 0);
+        ALLO_RECORD_STATS(record_block_released());
+        ALLO_MARK_SLOW_PATH();
+        return true;
+    });
+    return bytes_released;
+}
+
+ALLO_FUNC heap_report_t heap_allocator_t::heap_report() const noexcept
+{
+    heap_report_t report{
+        .block_count = 0,
+        .heap_bytes = 0,
+        .live_allocations = m.allocations_in_use,
+        .bytes_requested = m.bytes_requested_in_use,
+        .bytes_in_use = m.bytes_in_use,
+        .bookkeeping_bytes =
+            m.allocations_in_use * sizeof(allocation_bookkeeping_t),
+        .free_block_count = 0,
+        .free_bytes = 0,
+        .largest_free_block = 0,
+        .free_size_histogram = {},
+        .mapped_allocation_count = m.large_allocations_count,
+        .mapped_allocation_bytes = m.large_allocations_bytes,
+    };
+
+    if (m.blocks) {
+        m.blocks->for_each([&report](const bytes_t& block) {
+            ++report.block_count;
+            report.heap_bytes += block.size();
+        });
+    } else {
+        report.block_count = 1;
+        report.heap_bytes = m.memory.size();
+    }
+
+    for (free_node_t* iter = m.free_list_head; iter; iter = iter->next) {
+        ++report.free_block_count;
+        report.free_bytes += iter->size;
+        if (iter->size > report.largest_free_block)
+            report.largest_free_block = iter->size;
+        size_t size_class = 0;
+        for (size_t v = iter->size; v > 1; v >>= 1)
+            ++size_class;
+        ++report.free_size_histogram[size_class];
+    }
+    return report;
+}
+
+namespace detail {
+/// Formats text into a small buffer and hands it to a heap_report_writer_t
+class heap_report_printer_t
+{
+  public:
+    inline heap_report_printer_t(heap_report_writer_t writer,
+                                 void* user_data) noexcept
+        : m_writer(writer), m_user_data(user_data)
+    {
+    }
+
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    inline void
+    print(const char* format, ...) noexcept
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        const int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (length <= 0)
+            return;
+        // everything printed is much shorter than the buffer
+        const auto written = static_cast<size_t>(length) < sizeof(buffer)
+                                 ? static_cast<size_t>(length)
+                                 : sizeof(buffer) - 1;
+        m_writer(buffer, written, m_user_data);
+    }
+
+  private:
+    heap_report_writer_t m_writer;
+    void* m_user_data;
+};
+} // namespace detail
+
+ALLO_FUNC void
+heap_allocator_t::write_heap_report(HeapReportFormat format,
+                                    heap_report_writer_t writer,
+                                    void* user_data) const noexcept
+{
+    ALLO_VALID_ARG_ASSERT(writer != nullptr);
+    if (!writer)
+        return;
+    detail::heap_report_printer_t out(writer, user_data);
+    const heap_report_t report = heap_report();
+    const bool json = format == HeapReportFormat::Json;
+
+    if (json) {
+        out.print("{\"block_count\":%zu,\"heap_bytes\":%zu,"
+                  "\"live_allocations\":%zu,\"bytes_requested\":%zu,"
+                  "\"bytes_in_use\":%zu,\"bookkeeping_bytes\":%zu,",
+                  report.block_count, report.heap_bytes,
+                  report.live_allocations, report.bytes_requested,
+                  report.bytes_in_use, report.bookkeeping_bytes);
+        out.print("\"free_block_count\":%zu,\"free_bytes\":%zu,"
+                  "\"largest_free_block\":%zu,"
+                  "\"external_fragmentation\":%.4f,"
+                  "\"mapped_allocation_count\":%zu,"
+                  "\"mapped_allocation_bytes\":%zu,"
+                  "\"free_size_histogram\":[",
+                  report.free_block_count, report.free_bytes,
+                  report.largest_free_block, report.external_fragmentation(),
+                  report.mapped_allocation_count,
+                  report.mapped_allocation_bytes);
+    } else {
+        out.print("heap report\n"
+                  "  blocks: %zu (%zu bytes)\n"
+                  "  live allocations: %zu (%zu bytes requested, %zu in use, "
+                  "%zu bookkeeping)\n",
+                  report.block_count, report.heap_bytes,
+                  report.live_allocations, report.bytes_requested,
+                  report.bytes_in_use, report.bookkeeping_bytes);
+        out.print("  free blocks: %zu (%zu bytes, largest %zu)\n"
+                  "  external fragmentation: %.4f\n"
+                  "  mapped allocations: %zu (%zu bytes)\n"
+                  "  free block sizes:\n",
+                  report.free_block_count, report.free_bytes,
+                  report.largest_free_block, report.external_fragmentation(),
+                  report.mapped_allocation_count,
+                  report.mapped_allocation_bytes);
+    }
+
+    // only the size classes which have any free blocks in them
+    bool first = true;
+    for (size_t i = 0; i < heap_report_t::num_size_classes; ++i) {
+        const size_t count = report.free_size_histogram[i];
+        if (count == 0)
+            continue;
+        const size_t low = size_t(1) << i;
+        if (json) {
+            out.print("%s{\"min_size\":%zu,\"count\":%zu}", first ? "" : ",",
+                      low, count);
+        } else if (i + 1 < heap_report_t::num_size_classes) {
+            out.print("    [%zu, %zu): %zu\n", low, low << 1, count);
+        } else {
+            out.print("    [%zu, ...): %zu\n", low, count);
+        }
+        first = false;
+    }
+    if (json)
+        out.print("],\"blocks\":[");
+
+    size_t block_index = 0;
+    auto print_block = [&](const bytes_t& block) {
+        const size_t cells =
+            block.size() < chunk_map_cells ? block.size() : chunk_map_cells;
+        size_t free_in_cell[chunk_map_cells] = {};
+        size_t free_blocks = 0;
+        size_t free_bytes = 0;
+        size_t largest_free_block = 0;
+        const auto cell_begin = [&block, cells](size_t cell) {
+            return (cell * block.size()) / cells;
+        };
+
+        for (free_node_t* iter = m.free_list_head; iter; iter = iter->next) {
+            const auto* const node = reinterpret_cast<uint8_t*>(iter);
+            if (!zl::memcontains_one(block, node))
+                continue;
+            ++free_blocks;
+            free_bytes += iter->size;
+            if (iter->size > largest_free_block)
+                largest_free_block = iter->size;
+            // spread the free node over all of the cells it overlaps
+            const size_t begin = node - block.data();
+            const size_t end = begin + iter->size;
+            for (size_t cell = (begin * cells) / block.size();
+                 cell < cells && cell_begin(cell) < end; ++cell) {
+                const size_t cell_low = cell_begin(cell);
+                const size_t cell_high = cell_begin(cell + 1);
+                const size_t low = begin > cell_low ? begin : cell_low;
+                const size_t high = end < cell_high ? end : cell_high;
+                if (high > low)
+                    free_in_cell[cell] += high - low;
+            }
+        }
+
+        char map[chunk_map_cells];
+        for (size_t cell = 0; cell < cells; ++cell) {
+            const size_t width = cell_begin(cell + 1) - cell_begin(cell);
+            map[cell] = free_in_cell[cell] == 0       ? '#'
+                        : free_in_cell[cell] >= width ? '.'
+                                                      : '+';
+        }
+
+        if (json) {
+            out.print("%s{\"address\":\"%p\",\"size\":%zu,"
+                      "\"free_blocks\":%zu,\"free_bytes\":%zu,"
+                      "\"largest_free_block\":%zu,\"map\":\"%.*s\"}",
+                      block_index == 0 ? "" : ",",
+                      static_cast<const void*>(block.data()), block.size(),
+                      free_blocks, free_bytes, largest_free_block,
+                      static_cast<int>(cells), map);
+        } else {
+            out.print("  block %zu at %p: %zu bytes, %zu free blocks, %zu "
+                      "free, largest %zu\n    |%.*s|\n",
+                      block_index, static_cast<const void*>(block.data()),
+                      block.size(), free_blocks, free_bytes,
+                      largest_free_block, static_cast<int>(cells), map);
+        }
+        ++block_index;
+    };
+
+    if (m.blocks)
+        m.blocks->for_each(print_block);
+    else
+        print_block(m.memory);
+
+    if (json)
+        out.print("]}");
+}
+
+ALLO_FUNC allocation_status_t
+heap_allocator_t::set_mmap_threshold(size_t bytes) noexcept
+{
+    if (bytes != 0 && m.pagesize == 0) {
+        const auto pagesize_res = mm_get_page_size();
+        if (!pagesize_res.has_value)
+            return AllocationStatusCode::OsErr;
+        m.pagesize = pagesize_res.value;
+    }
+    m.mmap_threshold = bytes;
+    return AllocationStatusCode::Okay;
+}
+
+ALLO_FUNC auto heap_allocator_t::large_allocation_of(bytes_t mem) noexcept
+    -> large_allocation_t*
+{
+    // every allocation has either a bookkeeping magic number, a pointer to
+    // bookkeeping, or the large allocation magic number right before it
+    const size_t before = *(reinterpret_cast<size_t*>(mem.data()) - 1);
+    if (before != large_allocation_t::static_magic)
+        return nullptr;
+    return reinterpret_cast<large_allocation_t*>(mem.data()) - 1;
+}
+
+ALLO_FUNC allocation_result_t heap_allocator_t::alloc_large(
+    size_t bytes, uint8_t alignment_exponent, size_t typehash) noexcept
+{
+    ALLO_COUNT_PAGE_FAULTS();
+    const size_t alignment = size_t(1) << alignment_exponent;
+    ALLO_INTERNAL_ASSERT(alignment <= m.pagesize);
+    const size_t data_offset =
+        detail::round_up_to_multiple_of(sizeof(large_allocation_t), alignment);
+    const size_t mapped_bytes =
+        detail::round_up_to_multiple_of(data_offset + bytes, m.pagesize);
+    const size_t pages = mapped_bytes / m.pagesize;
+
+    const auto reserve_res = mm_reserve_pages(nullptr, pages);
+    if (reserve_res.code != 0) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_alloc());
+        ALLO_EMIT_EVENT(on_oom, bytes);
+        return AllocationStatusCode::OOM;
+    }
+    if (mm_commit_pages(reserve_res.data, pages) != 0) [[unlikely]] {
+        mm_memory_unmap(reserve_res.data, reserve_res.bytes);
+        ALLO_RECORD_STATS(record_failed_alloc());
+        ALLO_EMIT_EVENT(on_oom, bytes);
+        return AllocationStatusCode::OsErr;
+    }
+
+    uint8_t* const data = static_cast<uint8_t*>(reserve_res.data) + data_offset;
+    auto* const large = reinterpret_cast<large_allocation_t*>(data) - 1;
+    *large = large_allocation_t{
+        .prev = nullptr,
+        .next = m.large_allocations,
+        .owner = this,
+        .mapping = reserve_res.data,
+        .mapped_bytes = mapped_bytes,
+        .size_requested = bytes,
+#ifndef ALLO_DISABLE_TYPEINFO
+        .typehash = typehash,
+#endif
+    };
+    if (m.large_allocations)
+        m.large_allocations->prev = large;
+    m.large_allocations = large;
+
+    ++m.large_allocations_count;
+    m.large_allocations_bytes += mapped_bytes;
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    m.tags.record_alloc(detail::tag_of_typehash(typehash), bytes);
+#endif
+    ALLO_RECORD_STATS(record_parent_grow());
+    ALLO_MARK_SLOW_PATH();
+    ALLO_EMIT_EVENT(on_grow, mapped_bytes);
+    ALLO_RECORD_STATS(record_block_acquired());
+    ALLO_RECORD_STATS(record_alloc(bytes, mapped_bytes));
+    return zl::raw_slice(*data, bytes);
+}
+
+ALLO_FUNC allocation_result_t
+heap_allocator_t::remap_large(large_allocation_t& large, bytes_t mem,
+                              size_t new_size, size_t new_typehash) noexcept
+{
+    ALLO_COUNT_PAGE_FAULTS();
+    if (large.size_requested != mem.size()) {
+        ALLO_RECORD_STATS(record_failed_remap());
+        return AllocationStatusCode::MemoryInvalid;
+    }
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    const uint8_t tag = detail::tag_of_typehash(large.typehash);
+    if (new_size > large.size_requested &&
+        !m.tags.within_budget(tag, new_size - large.size_requested))
+        [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_remap());
+        return AllocationStatusCode::BudgetExceeded;
+    }
+#endif
+
+    const size_t data_offset =
+        mem.data() - static_cast<uint8_t*>(large.mapping);
+    const size_t new_mapped_bytes =
+        detail::round_up_to_multiple_of(data_offset + new_size, m.pagesize);
+
+    if (new_mapped_bytes != large.mapped_bytes) {
+        // grow or shrink in place, which fails if something else is mapped
+        // right after us
+        if (mm_memory_remap(large.mapping, large.mapped_bytes,
+                            new_mapped_bytes) != 0) {
+            ALLO_RECORD_STATS(record_failed_remap());
+            ALLO_EMIT_EVENT(on_parent_remap_failed, mem, new_size,
+                            AllocationStatusCode::OOM);
+            return AllocationStatusCode::OOM;
+        }
+        if (new_mapped_bytes > large.mapped_bytes)
+            ALLO_EMIT_EVENT(on_grow, new_mapped_bytes - large.mapped_bytes);
+        ALLO_RECORD_STATS(record_remap(large.size_requested, new_size,
+                                       large.mapped_bytes, new_mapped_bytes));
+        ALLO_MARK_SLOW_PATH();
+        m.large_allocations_bytes -= large.mapped_bytes;
+        m.large_allocations_bytes += new_mapped_bytes;
+        large.mapped_bytes = new_mapped_bytes;
+    } else {
+        ALLO_RECORD_STATS(record_remap(large.size_requested, new_size,
+                                       large.mapped_bytes, large.mapped_bytes));
+    }
+
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    m.tags.record_resize(tag, large.size_requested, new_size);
+    new_typehash = detail::tag_typehash(new_typehash, tag);
+#endif
+    large.size_requested = new_size;
+#ifndef ALLO_DISABLE_TYPEINFO
+    large.typehash = new_typehash;
+#endif
+    return zl::raw_slice(*mem.data(), new_size);
+}
+
+ALLO_FUNC void heap_allocator_t::free_large(large_allocation_t& large) noexcept
+{
+    if (large.prev)
+        large.prev->next = large.next;
+    else
+        m.large_allocations = large.next;
+    if (large.next)
+        large.next->prev = large.prev;
+
+    --m.large_allocations_count;
+    m.large_allocations_bytes -= large.mapped_bytes;
+#ifdef ALLO_ENABLE_ALLOCATION_TAGS
+    m.tags.record_free(detail::tag_of_typehash(large.typehash),
+                       large.size_requested);
+#endif
+    ALLO_RECORD_STATS(record_free(large.size_requested, large.mapped_bytes));
+    ALLO_RECORD_STATS(record_block_released());
+    ALLO_MARK_SLOW_PATH();
+    mm_memory_unmap(large.mapping, large.mapped_bytes);
 }
 
 } // namespace allo
@@ -0,0 +1,278 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/detail/round_up_to_multiple_of.h"
+#include "allo/heap_profiler.h"
+#include "allo/memory_map.h"
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <ziglike/defer.h>
+
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define ALLO_HEAP_PROFILER_HAS_BACKTRACE
+#endif
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+
+namespace detail {
+// never zero, so that an empty heap_profiler_thread_cache_t never matches
+inline std::atomic<uint64_t> next_heap_profiler_id{1};
+
+[[nodiscard]] inline size_t heap_profiler_table_home(uintptr_t address,
+                                                     size_t capacity) noexcept
+{
+    return static_cast<size_t>(((address >> 4) * 0x9E3779B97F4A7C15ULL) >>
+                               20) &
+           (capacity - 1);
+}
+
+/// Find the slot holding address, or the empty slot where it would go.
+[[nodiscard]] inline size_t heap_profiler_find_slot(const heap_sample_t* table,
+                                                    size_t capacity,
+                                                    uintptr_t address) noexcept
+{
+    size_t index = heap_profiler_table_home(address, capacity);
+    while (table[index].address != 0 && table[index].address != address)
+        index = (index + 1) & (capacity - 1);
+    return index;
+}
+} // namespace detail
+
+ALLO_FUNC zl::res<heap_profiler_t, AllocationStatusCode>
+heap_profiler_t::make(const options_t& options) noexcept
+{
+    using namespace zl;
+    if (options.sample_interval == 0 || options.max_live_samples == 0)
+        return AllocationStatusCode::InvalidArgument;
+
+    const auto pagesize_res = mm_get_page_size();
+    if (!pagesize_res.has_value)
+        return AllocationStatusCode::OsErr;
+    const size_t pagesize = pagesize_res.value;
+
+    // at most half full, so that probing stays short
+    size_t capacity = 1;
+    while (capacity < options.max_live_samples * 2)
+        capacity *= 2;
+
+    // the state is shared between threads, so it gets its own pages instead
+    // of moving around with the heap_profiler_t. the table goes right after
+    // it, and starts out zeroed, which means every slot is empty.
+    const size_t table_offset =
+        detail::round_up_to_multiple_of<alignof(heap_sample_t)>(
+            sizeof(state_t));
+    const size_t mapped_bytes = detail::round_up_to_multiple_of(
+        table_offset + (capacity * sizeof(heap_sample_t)), pagesize);
+    const auto reserve_res = mm_reserve_pages(nullptr, mapped_bytes / pagesize);
+    if (reserve_res.code != 0)
+        return AllocationStatusCode::OOM;
+    defer unmap([&reserve_res]() {
+        mm_memory_unmap(reserve_res.data, reserve_res.bytes);
+    });
+    if (mm_commit_pages(reserve_res.data, mapped_bytes / pagesize) != 0)
+        return AllocationStatusCode::OOM;
+
+    auto* const state = new (reserve_res.data) state_t{
+        .id = detail::next_heap_profiler_id.fetch_add(1),
+        .mapped_bytes = mapped_bytes,
+        .sample_interval = options.sample_interval,
+        .max_live_samples = options.max_live_samples,
+        .capacity = capacity,
+        .table = reinterpret_cast<heap_sample_t*>(
+            static_cast<uint8_t*>(reserve_res.data) + table_offset),
+        .total_samples = 0,
+        .dropped_samples = 0,
+        .filter = {},
+        .mutex = {},
+        .live_samples = 0,
+    };
+
+    unmap.cancel();
+    return res<heap_profiler_t, AllocationStatusCode>{
+        std::in_place, heap_profiler_t(M{.state = state})};
+}
+
+ALLO_FUNC heap_profiler_t::~heap_profiler_t() noexcept
+{
+    if (!m.state)
+        return;
+    const size_t mapped_bytes = m.state->mapped_bytes;
+    m.state->~state_t();
+    mm_memory_unmap(m.state, mapped_bytes);
+}
+
+ALLO_FUNC heap_profiler_t::heap_profiler_t(heap_profiler_t&& other) noexcept
+    : m(other.m)
+{
+    other.m.state = nullptr;
+}
+
+ALLO_FUNC uint64_t heap_profiler_t::seed_for_this_thread() noexcept
+{
+    // different for every thread, and for every run of the program
+    const auto now = static_cast<uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto local =
+        reinterpret_cast<uintptr_t>(&detail::heap_profiler_thread_cache);
+    const uint64_t seed = (now ^ local) * 0x9E3779B97F4A7C15ULL;
+    return seed == 0 ? 1 : seed;
+}
+
+ALLO_FUNC void heap_profiler_t::record_sample(const void* address, size_t size,
+                                              uint8_t alignment_exponent,
+                                              size_t typehash) noexcept
+{
+    heap_sample_t sample{
+        .address = reinterpret_cast<uintptr_t>(address),
+        .size = size,
+        .typehash = typehash,
+        .alignment_exponent = alignment_exponent,
+        .depth = 0,
+        .frames = {},
+    };
+    if (sample.address == 0) [[unlikely]]
+        return;
+#ifdef ALLO_HEAP_PROFILER_HAS_BACKTRACE
+    const int depth =
+        ::backtrace(sample.frames, static_cast<int>(heap_sample_t::max_frames));
+    sample.depth = depth > 0 ? static_cast<uint8_t>(depth) : 0;
+#endif
+
+    m.state->total_samples.fetch_add(1, std::memory_order_relaxed);
+    insert_sample(sample);
+}
+
+ALLO_FUNC void
+heap_profiler_t::insert_sample(const heap_sample_t& sample) noexcept
+{
+    state_t& state = *m.state;
+    std::lock_guard lock(state.mutex);
+    const size_t index = detail::heap_profiler_find_slot(
+        state.table, state.capacity, sample.address);
+    if (state.table[index].address == sample.address) {
+        // the allocation at this address was freed without record_free()
+        state.table[index] = sample;
+        return;
+    }
+    if (state.live_samples == state.max_live_samples) {
+        state.dropped_samples.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    state.table[index] = sample;
+    ++state.live_samples;
+    const auto* address = reinterpret_cast<const void*>(sample.address);
+    state.filter[filter_index(address)].fetch_add(1,
+                                                  std::memory_order_relaxed);
+}
+
+ALLO_FUNC bool heap_profiler_t::remove_sample(const void* address,
+                                              heap_sample_t* removed) noexcept
+{
+    state_t& state = *m.state;
+    const auto key = reinterpret_cast<uintptr_t>(address);
+    const size_t mask = state.capacity - 1;
+    std::lock_guard lock(state.mutex);
+    size_t hole = detail::heap_profiler_find_slot(state.table, state.capacity,
+                                                  key);
+    // another sample hashed to the same filter entry
+    if (state.table[hole].address != key)
+        return false;
+    if (removed)
+        *removed = state.table[hole];
+    --state.live_samples;
+    state.filter[filter_index(address)].fetch_sub(1,
+                                                  std::memory_order_relaxed);
+
+    // backward shift deletion, so that lookups never need tombstones
+    size_t next = hole;
+    while (true) {
+        next = (next + 1) & mask;
+        if (state.table[next].address == 0)
+            break;
+        const size_t home = detail::heap_profiler_table_home(
+            state.table[next].address, state.capacity);
+        // distance from each slot's home, wrapping around the table
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            state.table[hole] = state.table[next];
+            hole = next;
+        }
+    }
+    state.table[hole].address = 0;
+    return true;
+}
+
+ALLO_FUNC size_t heap_profiler_t::live_samples() const noexcept
+{
+    std::lock_guard lock(m.state->mutex);
+    return m.state->live_samples;
+}
+
+ALLO_FUNC size_t heap_profiler_t::estimated_live_bytes() const noexcept
+{
+    double total = 0;
+    for_each_live_sample([this, &total](const heap_sample_t& sample) {
+        total += estimated_bytes_of(sample.size);
+    });
+    return static_cast<size_t>(total);
+}
+
+ALLO_FUNC allocation_status_t
+heap_profiler_t::write_profile(const char* path) const noexcept
+{
+    std::FILE* file = std::fopen(path, "w");
+    if (!file)
+        return AllocationStatusCode::OsErr;
+
+    size_t count = 0;
+    size_t bytes = 0;
+    for_each_live_sample([&count, &bytes](const heap_sample_t& sample) {
+        ++count;
+        bytes += sample.size;
+    });
+
+    // every sample is still live, so the in-use and allocated columns are the
+    // same. pprof scales each line up by the interval in the header.
+    bool okay = std::fprintf(file, "heap profile: %zu: %zu [%zu: %zu] @ "
+                                   "heap_v2/%zu\n",
+                             count, bytes, count, bytes,
+                             m.state->sample_interval) > 0;
+    for_each_live_sample([file, &okay](const heap_sample_t& sample) {
+        okay = okay && std::fprintf(file, "1: %zu [1: %zu] @", sample.size,
+                                    sample.size) > 0;
+        for (size_t i = 0; i < sample.depth; ++i) {
+            okay = okay && std::fprintf(file, " %p", sample.frames[i]) > 0;
+        }
+        okay = okay && std::fputc('\n', file) != EOF;
+    });
+
+#if defined(__linux__)
+    if (std::FILE* maps = std::fopen("/proc/self/maps", "r")) {
+        okay = okay && std::fputs("\nMAPPED_LIBRARIES:\n", file) >= 0;
+        char buffer[4096];
+        size_t read = 0;
+        while (okay && (read = std::fread(buffer, 1, sizeof(buffer), maps)))
+            okay = std::fwrite(buffer, 1, read, file) == read;
+        std::fclose(maps);
+    }
+#endif
+
+    okay = std::fclose(file) == 0 && okay;
+    return okay ? AllocationStatusCode::Okay : AllocationStatusCode::OsErr;
+}
+} // namespace allo
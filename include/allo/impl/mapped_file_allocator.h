@@ -0,0 +1,232 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/detail/asserts.h"
+#include "allo/detail/round_up_to_multiple_of.h"
+#include "allo/mapped_file_allocator.h"
+#include "allo/memory_map.h"
+#include <cstdint>
+#include <ziglike/defer.h>
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+
+ALLO_FUNC mapped_file_allocator_t::~mapped_file_allocator_t() noexcept
+{
+    if (!m.header)
+        return;
+    mm_memory_unmap(m.header, m.reserved_bytes);
+    mm_close_file(m.file);
+}
+
+ALLO_FUNC mapped_file_allocator_t::mapped_file_allocator_t(
+    mapped_file_allocator_t&& other) noexcept
+    : m(other.m)
+{
+    m_type = enum_value;
+    move_stats_from(other);
+    other.m.header = nullptr;
+}
+
+ALLO_FUNC zl::res<mapped_file_allocator_t, AllocationStatusCode>
+mapped_file_allocator_t::make(const options_t& options) noexcept
+{
+    using namespace zl;
+    const auto pagesize_res = mm_get_page_size();
+    if (!pagesize_res.has_value) {
+        return AllocationStatusCode::OsErr;
+    }
+    const size_t pagesize = pagesize_res.value;
+
+    const mm_file_result_t file_res = mm_open_file(options.path);
+    if (file_res.code != 0) {
+        return AllocationStatusCode::OsErr;
+    }
+    const mm_file_t file = file_res.file;
+    defer close_file([file]() { mm_close_file(file); });
+
+    uint64_t existing_size = 0;
+    if (mm_file_size(file, &existing_size) != 0) {
+        return AllocationStatusCode::OsErr;
+    }
+
+    const bool fresh = existing_size == 0;
+    void* hint = options.hint;
+
+    if (!fresh) {
+        // peek at the header of the existing file to find out where it wants
+        // to be mapped
+        if (existing_size < sizeof(file_header_t)) {
+            return AllocationStatusCode::Corruption;
+        }
+        const auto peek = mm_map_file(nullptr, file, sizeof(file_header_t), 0);
+        if (peek.code != 0) {
+            return AllocationStatusCode::OsErr;
+        }
+        const file_header_t existing = *static_cast<file_header_t*>(peek.data);
+        mm_memory_unmap(peek.data, peek.bytes);
+
+        if (existing.magic != file_header_t::static_magic ||
+            existing.version != file_header_t::current_version ||
+            existing.top > existing_size) {
+            return AllocationStatusCode::Corruption;
+        }
+        hint = reinterpret_cast<void*>(existing.base_address); // NOLINT
+    }
+
+    const size_t file_bytes = detail::round_up_to_multiple_of(
+        fresh ? (options.initial_size < sizeof(file_header_t)
+                     ? sizeof(file_header_t)
+                     : options.initial_size)
+              : existing_size,
+        pagesize);
+    const size_t reserved_bytes = detail::round_up_to_multiple_of(
+        options.max_size < file_bytes ? file_bytes : options.max_size,
+        pagesize);
+
+    if (file_bytes != existing_size) {
+        if (mm_resize_file(file, file_bytes) != 0) {
+            return AllocationStatusCode::OsErr;
+        }
+    }
+
+    // reserve all the address space the file could grow to, then put the
+    // file at the start of it
+    const auto reserve_res =
+        mm_reserve_pages(hint, reserved_bytes / pagesize);
+    if (reserve_res.code != 0) {
+        return AllocationStatusCode::OOM;
+    }
+    defer unmap([&reserve_res]() {
+        mm_memory_unmap(reserve_res.data, reserve_res.bytes);
+    });
+
+    const auto map_res = mm_map_file(reserve_res.data, file, file_bytes, 1);
+    if (map_res.code != 0) {
+        return AllocationStatusCode::OsErr;
+    }
+
+    auto* const header = static_cast<file_header_t*>(reserve_res.data);
+    const auto base_address = reinterpret_cast<uint64_t>(header);
+    bool relocated = false;
+
+    if (fresh) {
+        *header = file_header_t{
+            .magic = file_header_t::static_magic,
+            .version = file_header_t::current_version,
+            .base_address = base_address,
+            .top = sizeof(file_header_t),
+            .root = 0,
+        };
+    } else {
+        relocated = header->base_address != base_address;
+        header->base_address = base_address;
+    }
+
+    unmap.cancel();
+    close_file.cancel();
+    return res<mapped_file_allocator_t, AllocationStatusCode>{
+        std::in_place,
+        M{
+            .header = header,
+            .mapped_bytes = file_bytes,
+            .reserved_bytes = reserved_bytes,
+            .pagesize = pagesize,
+            .file = file,
+            .fresh = fresh,
+            .relocated = relocated,
+        }};
+}
+
+ALLO_FUNC allocation_status_t
+mapped_file_allocator_t::grow(size_t bytes) noexcept
+{
+    if (bytes > m.reserved_bytes)
+        return AllocationStatusCode::OOM;
+    ALLO_COUNT_PAGE_FAULTS();
+
+    // double the file each time, within what we have reserved
+    size_t new_size = m.mapped_bytes * 2;
+    if (new_size < bytes)
+        new_size = bytes;
+    new_size = detail::round_up_to_multiple_of(new_size, m.pagesize);
+    if (new_size > m.reserved_bytes)
+        new_size = m.reserved_bytes;
+    ALLO_INTERNAL_ASSERT(new_size >= bytes);
+
+    if (mm_resize_file(m.file, new_size) != 0)
+        return AllocationStatusCode::OsErr;
+
+    // remap the whole file at the same address. the pages after the old end
+    // of the file were previously reserved by us, so nothing is clobbered
+    const auto map_res = mm_map_file(m.header, m.file, new_size, 1);
+    if (map_res.code != 0) [[unlikely]] {
+        // put the file back how it was. the old mapping is still intact
+        mm_resize_file(m.file, m.mapped_bytes);
+        return AllocationStatusCode::OsErr;
+    }
+    ALLO_INTERNAL_ASSERT(map_res.data == m.header);
+
+    ALLO_EMIT_EVENT(on_grow, new_size - m.mapped_bytes);
+    m.mapped_bytes = new_size;
+    ALLO_RECORD_STATS(record_parent_grow());
+    ALLO_MARK_SLOW_PATH();
+    return AllocationStatusCode::Okay;
+}
+
+ALLO_FUNC allocation_result_t mapped_file_allocator_t::alloc_bytes(
+    size_t bytes, uint8_t alignment_exponent, size_t) noexcept
+{
+    ALLO_TIME_OPERATION(Alloc);
+    const size_t alignment = 1UL << alignment_exponent;
+    // alignment of offsets is only preserved between mappings because the
+    // file is always mapped at a page boundary
+    if (alignment > m.pagesize) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_alloc());
+        return AllocationStatusCode::AllocationTooAligned;
+    }
+
+    const size_t begin = (m.header->top + alignment - 1) & ~(alignment - 1);
+    // otherwise end wraps around and looks like it fits
+    if (bytes > SIZE_MAX - begin) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_alloc());
+        ALLO_EMIT_EVENT(on_oom, bytes);
+        return AllocationStatusCode::OOM;
+    }
+    const size_t end = begin + bytes;
+
+    if (end > m.mapped_bytes) {
+        auto status = grow(end);
+        if (!status.okay()) [[unlikely]] {
+            ALLO_RECORD_STATS(record_failed_alloc());
+            ALLO_EMIT_EVENT(on_oom, bytes);
+            return status.err();
+        }
+    }
+
+    ALLO_RECORD_STATS(record_alloc(bytes, end - m.header->top));
+    m.header->top = end;
+    return zl::raw_slice(*(reinterpret_cast<uint8_t*>(m.header) + begin),
+                         bytes);
+}
+
+ALLO_FUNC allocation_status_t mapped_file_allocator_t::sync() noexcept
+{
+    if (mm_sync(m.header, m.mapped_bytes) != 0)
+        return AllocationStatusCode::OsErr;
+    return AllocationStatusCode::Okay;
+}
+} // namespace allo
@@ -31,17 +31,21 @@ ALLO_FUNC reservation_allocator_t::reservation_allocator_t(
     : m(other.m)
 {
     m_type = enum_value;
+    move_stats_from(other);
 }
 
 ALLO_FUNC allocation_result_t reservation_allocator_t::remap_bytes(
     bytes_t mem, size_t, size_t new_size, size_t) noexcept
 {
+    ALLO_TIME_OPERATION(Remap);
     if (mem.data() != m.mem.data()) {
+        ALLO_RECORD_STATS(record_failed_remap());
         return AllocationStatusCode::MemoryInvalid;
     }
 
     // requires new pages which are not committed
     if (new_size > m.mem.size()) {
+        ALLO_COUNT_PAGE_FAULTS();
         const auto pages_needed = static_cast<size_t>(
             std::ceil(static_cast<double>(new_size - m.mem.size()) /
                       static_cast<double>(m.pagesize)));
@@ -49,13 +53,27 @@ ALLO_FUNC allocation_result_t reservation_allocator_t::remap_bytes(
         ALLO_INTERNAL_ASSERT(m.mem.size() % m.pagesize == 0);
         const size_t total_pages = pages_needed + current_pages;
         // catch error before it happens
-        if (total_pages > m.num_pages_reserved)
+        if (total_pages > m.num_pages_reserved) {
+            ALLO_RECORD_STATS(record_failed_remap());
+            ALLO_EMIT_EVENT(on_oom, new_size);
             return AllocationStatusCode::OOM;
+        }
         // add some read/write pages to this allocation
         int64_t res = mm_commit_pages(m.mem.data(), total_pages);
-        if (res != 0)
+        if (res != 0) {
+            ALLO_RECORD_STATS(record_failed_remap());
+            ALLO_EMIT_EVENT(on_oom, new_size);
             return AllocationStatusCode::OOM;
+        }
+        ALLO_EMIT_EVENT(on_grow, (total_pages * m.pagesize) - m.mem.size());
+        ALLO_RECORD_STATS(record_parent_grow());
+        ALLO_MARK_SLOW_PATH();
+        ALLO_RECORD_STATS(record_remap(m.mem.size(), total_pages * m.pagesize,
+                                       m.mem.size(),
+                                       total_pages * m.pagesize));
         m.mem = zl::raw_slice(*m.mem.data(), total_pages * m.pagesize);
+    } else {
+        ALLO_RECORD_STATS(record_remap(0, 0, 0, 0));
     }
     return bytes_t(m.mem, 0, new_size);
 }
@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/detail/round_up_to_multiple_of.h"
+#include "allo/memory_map.h"
+#include "allo/ring_buffer.h"
+#include <ziglike/defer.h>
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+
+ALLO_FUNC ring_buffer_t::~ring_buffer_t() noexcept
+{
+    if (!m.memory)
+        return;
+    mm_memory_unmap(m.memory, m.capacity * 2);
+    mm_close_file(m.file);
+}
+
+ALLO_FUNC ring_buffer_t::ring_buffer_t(ring_buffer_t&& other) noexcept
+    : ring_buffer_t(other.m.memory, other.m.capacity, other.m.file)
+{
+    m.write_cursor = other.m.write_cursor.load();
+    m.read_cursor = other.m.read_cursor.load();
+    other.m.memory = nullptr;
+}
+
+ALLO_FUNC zl::res<ring_buffer_t, AllocationStatusCode>
+ring_buffer_t::make(size_t minimum_capacity) noexcept
+{
+    using namespace zl;
+    const auto pagesize_res = mm_get_page_size();
+    if (!pagesize_res.has_value)
+        return AllocationStatusCode::OsErr;
+    const size_t pagesize = pagesize_res.value;
+    const size_t capacity = detail::round_up_to_multiple_of(
+        minimum_capacity == 0 ? 1 : minimum_capacity, pagesize);
+
+    const mm_file_result_t file_res =
+        mm_create_anonymous_shared_memory("allo_ring_buffer");
+    if (file_res.code != 0)
+        return AllocationStatusCode::OsErr;
+    const mm_file_t file = file_res.file;
+    defer close_file([file]() { mm_close_file(file); });
+
+    if (mm_resize_file(file, capacity) != 0)
+        return AllocationStatusCode::OsErr;
+
+    // reserve space for both copies so nothing else gets mapped in between
+    const auto reserve_res =
+        mm_reserve_pages(nullptr, (capacity * 2) / pagesize);
+    if (reserve_res.code != 0)
+        return AllocationStatusCode::OOM;
+    defer unmap([&reserve_res]() {
+        mm_memory_unmap(reserve_res.data, reserve_res.bytes);
+    });
+
+    auto* const first = static_cast<uint8_t*>(reserve_res.data);
+    if (mm_map_file(first, file, capacity, 1).code != 0)
+        return AllocationStatusCode::OsErr;
+    if (mm_map_file(first + capacity, file, capacity, 1).code != 0)
+        return AllocationStatusCode::OsErr;
+
+    unmap.cancel();
+    close_file.cancel();
+    return res<ring_buffer_t, AllocationStatusCode>{
+        std::in_place, ring_buffer_t(first, capacity, file)};
+}
+} // namespace allo
@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/sampling_allocator.h"
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+
+ALLO_FUNC
+sampling_allocator_t::sampling_allocator_t(
+    sampling_allocator_t&& other) noexcept
+    : m(other.m)
+{
+    m_type = enum_value;
+    move_stats_from(other);
+}
+
+ALLO_FUNC allocation_result_t sampling_allocator_t::alloc_bytes(
+    size_t bytes, uint8_t alignment_exponent, size_t typehash) noexcept
+{
+    ALLO_TIME_OPERATION(Alloc);
+    auto res = m.parent.cast_to_basic().alloc_bytes(bytes, alignment_exponent,
+                                                    typehash);
+    if (res.okay() && m.profiler->should_sample(bytes)) [[unlikely]] {
+        m.profiler->record_sample(res.release_ref().data(), bytes,
+                                  alignment_exponent, typehash);
+    }
+    return res;
+}
+
+ALLO_FUNC allocation_result_t
+sampling_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash,
+                                  size_t new_size, size_t new_typehash) noexcept
+{
+    ALLO_TIME_OPERATION(Remap);
+    if (m.parent.is_basic()) [[unlikely]]
+        return AllocationStatusCode::InvalidArgument;
+    // removed before remapping for the same reason as in free_bytes, since
+    // the allocation may move and free its old address
+    heap_sample_t old_sample;
+    const bool was_sampled = m.profiler->take_sample(mem.data(), old_sample);
+    auto res = m.parent.is_heap()
+                   ? m.parent.get_heap_unchecked().remap_bytes(
+                         mem, old_typehash, new_size, new_typehash)
+                   : m.parent.get_stack_unchecked().remap_bytes(
+                         mem, old_typehash, new_size, new_typehash);
+    if (!res.okay()) {
+        // the allocation is still live where it was
+        if (was_sampled) [[unlikely]]
+            m.profiler->restore_sample(old_sample);
+        return res;
+    }
+    // the new size is counted from scratch, which slightly oversamples
+    // allocations which are remapped many times
+    if (m.profiler->should_sample(new_size)) [[unlikely]] {
+        // allocators do not remember alignment, so record it as unknown
+        m.profiler->record_sample(res.release_ref().data(), new_size, 0,
+                                  new_typehash);
+    }
+    return res;
+}
+
+ALLO_FUNC allocation_status_t
+sampling_allocator_t::free_bytes(bytes_t mem, size_t typehash) noexcept
+{
+    ALLO_TIME_OPERATION(Free);
+    if (m.parent.is_basic()) [[unlikely]]
+        return AllocationStatusCode::InvalidArgument;
+    // removed before freeing, so that another thread cannot get the same
+    // address and sample it in between
+    heap_sample_t old_sample;
+    const bool was_sampled = m.profiler->take_sample(mem.data(), old_sample);
+    auto status =
+        m.parent.is_heap()
+            ? m.parent.get_heap_unchecked().free_bytes(mem, typehash)
+            : m.parent.get_stack_unchecked().free_bytes(mem, typehash);
+    // a refused free leaves the allocation live
+    if (!status.okay() && was_sampled) [[unlikely]]
+        m.profiler->restore_sample(old_sample);
+    return status;
+}
+
+ALLO_FUNC allocation_status_t
+sampling_allocator_t::free_status(bytes_t mem, size_t typehash) const noexcept
+{
+    if (m.parent.is_heap())
+        return m.parent.get_heap_unchecked().free_status(mem, typehash);
+    if (m.parent.is_stack())
+        return m.parent.get_stack_unchecked().free_status(mem, typehash);
+    return AllocationStatusCode::InvalidArgument;
+}
+
+ALLO_FUNC allocation_status_t
+sampling_allocator_t::register_destruction_callback(
+    destruction_callback_t callback, void* user_data) noexcept
+{
+    return m.parent.cast_to_basic().register_destruction_callback(callback,
+                                                                  user_data);
+}
+} // namespace allo
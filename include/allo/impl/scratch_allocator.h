@@ -49,6 +49,7 @@ ALLO_FUNC allocation_status_t scratch_allocator_t::try_make_space_for_at_least(
 {
     if (m.parent.is_null())
         return AllocationStatusCode::OOM;
+    ALLO_COUNT_PAGE_FAULTS();
 
     // if the parent is a heap allocator, we can remap
     if (m.parent.is_heap()) {
@@ -78,9 +79,13 @@ ALLO_FUNC allocation_status_t scratch_allocator_t::try_make_space_for_at_least(
                 // now-remapped block
                 m.blocks->end_unchecked() = newmem;
             }
+            ALLO_EMIT_EVENT(on_grow, newmem.size() - m.memory.size());
             m.memory = newmem;
+            ALLO_RECORD_STATS(record_parent_grow());
+            ALLO_MARK_SLOW_PATH();
             return AllocationStatusCode::Okay;
         }
+        ALLO_EMIT_EVENT(on_parent_remap_failed, m.memory, new_size, res.err());
     }
 
     // if we're not a heap, or if heap failed the remap, then do this.
@@ -145,6 +150,8 @@ ALLO_FUNC allocation_status_t scratch_allocator_t::try_make_space_for_at_least(
             if (!maybe_newblock.okay()) [[unlikely]]
                 return maybe_newblock.err();
 
+            ALLO_RECORD_STATS(record_parent_grow());
+            ALLO_MARK_SLOW_PATH();
             bytes_t newblock = maybe_newblock.release();
             auto status = make_segmented_stack_at(newblock.data());
             if (!status.okay()) [[unlikely]] {
@@ -153,6 +160,7 @@ ALLO_FUNC allocation_status_t scratch_allocator_t::try_make_space_for_at_least(
                 }
                 return status.err();
             }
+            ALLO_RECORD_STATS(record_block_acquired());
 
             m.blocks =
                 reinterpret_cast<segmented_stack_t<bytes_t>*>(newblock.data());
@@ -164,6 +172,7 @@ ALLO_FUNC allocation_status_t scratch_allocator_t::try_make_space_for_at_least(
             ALLO_INTERNAL_ASSERT(res.okay());
             m.memory = newblock;
             m.top = reinterpret_cast<uint8_t*>(m.blocks + 1);
+            ALLO_EMIT_EVENT(on_grow, newblock.size());
             return AllocationStatusCode::Okay;
         }
     }
@@ -178,13 +187,17 @@ ALLO_FUNC allocation_status_t scratch_allocator_t::try_make_space_for_at_least(
     if (!maybe_newblock.okay()) [[unlikely]]
         return maybe_newblock.err();
 
+    ALLO_RECORD_STATS(record_parent_grow());
+    ALLO_MARK_SLOW_PATH();
     const auto newblock = maybe_newblock.release();
 
     const auto res = m.blocks->try_push(newblock);
-    if (res.okay()) [[unlikely]]
+    if (!res.okay()) [[unlikely]]
         return res.err();
+    ALLO_RECORD_STATS(record_block_acquired());
     m.memory = newblock;
     m.top = newblock.data();
+    ALLO_EMIT_EVENT(on_grow, newblock.size());
 
     return AllocationStatusCode::Okay;
 }
@@ -192,6 +205,7 @@ ALLO_FUNC allocation_status_t scratch_allocator_t::try_make_space_for_at_least(
 ALLO_FUNC allocation_result_t scratch_allocator_t::alloc_bytes(
     size_t bytes, uint8_t alignment_exponent, size_t) noexcept
 {
+    ALLO_TIME_OPERATION(Alloc);
     auto tryalloc = [this](size_t bytes,
                            uint8_t alignment_exponent) -> allocation_result_t {
         void* new_top = m.top;
@@ -199,6 +213,8 @@ ALLO_FUNC allocation_result_t scratch_allocator_t::alloc_bytes(
         if (std::align(1UL << alignment_exponent, bytes, new_top, remaining)) {
             ALLO_INTERNAL_ASSERT(remaining >= bytes);
             auto result = zl::raw_slice(*static_cast<uint8_t*>(new_top), bytes);
+            ALLO_RECORD_STATS(record_alloc(
+                bytes, static_cast<uint8_t*>(new_top) + bytes - m.top));
             m.top = static_cast<uint8_t*>(new_top) + bytes;
             return result;
         }
@@ -209,9 +225,15 @@ ALLO_FUNC allocation_result_t scratch_allocator_t::alloc_bytes(
         auto status = try_make_space_for_at_least(bytes, alignment_exponent);
         if (!status.okay()) [[unlikely]] {
             // NOTE: should we ignore errors here and just still try to alloc?
+            ALLO_RECORD_STATS(record_failed_alloc());
+            ALLO_EMIT_EVENT(on_oom, bytes);
             return status.err();
         }
-        return tryalloc(bytes, alignment_exponent);
+        auto retry = tryalloc(bytes, alignment_exponent);
+        if (!retry.okay()) [[unlikely]] {
+            ALLO_RECORD_STATS(record_failed_alloc());
+        }
+        return retry;
     }
     return res;
 }
@@ -243,15 +265,25 @@ ALLO_FUNC scratch_allocator_t::~scratch_allocator_t() noexcept
     if (!m.parent.is_heap())
         return;
 
+    auto& parent = m.parent.get_heap_unchecked();
     if (m.blocks) {
+        // the blocks stack is placed inside of one of the blocks, so that
+        // block has to be freed after the stack is done being used
+        zl::opt<bytes_t> holder;
         while (auto iter = m.blocks->end()) {
-            m.parent.get_heap_unchecked().free_bytes(iter.value(), 0);
+            const bytes_t block = iter.value();
+            if (zl::memcontains_one(block,
+                                    reinterpret_cast<uint8_t*>(m.blocks)))
+                holder.emplace(block);
+            else
+                parent.free_bytes(block, 0);
             m.blocks->pop();
         }
         m.blocks->~segmented_stack_t<bytes_t>();
-        free_one(m.parent.get_heap_unchecked(), *m.blocks);
+        ALLO_INTERNAL_ASSERT(holder);
+        parent.free_bytes(holder.value(), 0);
     } else {
-        m.parent.get_heap_unchecked().free_bytes(m.memory, 0);
+        parent.free_bytes(m.memory, 0);
     }
 }
 
@@ -260,6 +292,7 @@ scratch_allocator_t::scratch_allocator_t(scratch_allocator_t&& other) noexcept
     : m(other.m)
 {
     m_type = other.m_type;
+    move_stats_from(other);
     other.m.parent = any_allocator_t();
     other.m.last_callback = nullptr;
 }
@@ -0,0 +1,317 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/detail/alignment.h"
+#include "allo/detail/asserts.h"
+#include "allo/detail/round_up_to_multiple_of.h"
+#include "allo/memory_map.h"
+#include "allo/shared_block_allocator.h"
+#include <ziglike/defer.h>
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+
+namespace detail {
+// the first bytes of a free block store the index of the next free block plus
+// one, or zero if it is the last free block. it is read atomically because
+// another process may have popped the block and started writing to it
+inline std::atomic<uint32_t>& shared_block_next(uint8_t* block) noexcept
+{
+    return *reinterpret_cast<std::atomic<uint32_t>*>(block);
+}
+
+inline constexpr uint64_t pack_shared_free_list_head(uint64_t counter,
+                                                     uint32_t index) noexcept
+{
+    return (counter << 32) | index;
+}
+} // namespace detail
+
+ALLO_FUNC shared_block_allocator_t::~shared_block_allocator_t() noexcept
+{
+    if (!m.header)
+        return;
+    mm_memory_unmap(m.header, m.mapped_bytes);
+    mm_close_file(m.file);
+}
+
+ALLO_FUNC shared_block_allocator_t::shared_block_allocator_t(
+    shared_block_allocator_t&& other) noexcept
+    : m(other.m)
+{
+    m_type = enum_value;
+    move_stats_from(other);
+    other.m.header = nullptr;
+}
+
+ALLO_FUNC zl::res<shared_block_allocator_t, AllocationStatusCode>
+shared_block_allocator_t::make(const options_t& options) noexcept
+{
+    using namespace zl;
+    ALLO_VALID_ARG_ASSERT(options.num_blocks > 0 &&
+                          options.num_blocks < UINT32_MAX);
+    if (options.num_blocks == 0 || options.num_blocks >= UINT32_MAX)
+        return AllocationStatusCode::InvalidArgument;
+
+    const auto pagesize_res = mm_get_page_size();
+    if (!pagesize_res.has_value)
+        return AllocationStatusCode::OsErr;
+    const size_t pagesize = pagesize_res.value;
+
+    const size_t blocksize =
+        detail::round_up_to_multiple_of<8>(options.blocksize) <
+                minimum_blocksize
+            ? minimum_blocksize
+            : detail::round_up_to_multiple_of<8>(options.blocksize);
+
+    // blocks are aligned to their size, up to a page, so the whole region
+    // should have the same alignment in every process that maps it
+    uint8_t alignment_exponent = detail::nearest_alignment_exponent(blocksize);
+    if (alignment_exponent > detail::nearest_alignment_exponent(pagesize))
+        alignment_exponent = detail::nearest_alignment_exponent(pagesize);
+    const size_t first_block_offset = detail::round_up_to_multiple_of(
+        sizeof(shared_header_t), size_t(1) << alignment_exponent);
+    const size_t total_bytes = detail::round_up_to_multiple_of(
+        first_block_offset + (blocksize * options.num_blocks), pagesize);
+
+    // never open existing memory here, since initializing it would wipe out
+    // the blocks of every process attached to it
+    const mm_file_result_t file_res =
+        options.name ? mm_create_shared_memory(options.name)
+                     : mm_create_anonymous_shared_memory("allo");
+    if (file_res.code == EEXIST)
+        return AllocationStatusCode::InvalidArgument;
+    if (file_res.code != 0)
+        return AllocationStatusCode::OsErr;
+    const mm_file_t file = file_res.file;
+    defer close_file([file]() { mm_close_file(file); });
+
+    if (mm_resize_file(file, total_bytes) != 0)
+        return AllocationStatusCode::OsErr;
+
+    const auto map_res = mm_map_file(nullptr, file, total_bytes, 0);
+    if (map_res.code != 0)
+        return AllocationStatusCode::OsErr;
+
+    auto* const header = new (map_res.data) shared_header_t{
+        .magic = 0,
+        .version = shared_header_t::current_version,
+        .blocksize = blocksize,
+        .total_blocks = options.num_blocks,
+        .first_block_offset = first_block_offset,
+        .alignment_exponent = alignment_exponent,
+        .free_list_head = detail::pack_shared_free_list_head(0, 1),
+        .blocks_free = options.num_blocks,
+    };
+
+    shared_block_allocator_t out(M{
+        .header = header,
+        .mapped_bytes = total_bytes,
+        .file = file,
+    });
+    close_file.cancel();
+
+    // link every block to the next one
+    for (uint32_t i = 0; i < options.num_blocks; ++i) {
+        const uint32_t next = i + 1 == options.num_blocks ? 0 : i + 2;
+        new (out.block_at(i)) std::atomic<uint32_t>(next);
+    }
+
+    // only write the magic number once the rest is initialized, so that a
+    // process which attaches early sees the memory as invalid
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = shared_header_t::static_magic;
+
+    return res<shared_block_allocator_t, AllocationStatusCode>{std::in_place,
+                                                               std::move(out)};
+}
+
+ALLO_FUNC zl::res<shared_block_allocator_t, AllocationStatusCode>
+shared_block_allocator_t::attach(mm_file_t file) noexcept
+{
+    const mm_file_result_t dup_res = mm_duplicate_file(file);
+    if (dup_res.code != 0)
+        return AllocationStatusCode::OsErr;
+    return attach_inner(dup_res.file);
+}
+
+ALLO_FUNC zl::res<shared_block_allocator_t, AllocationStatusCode>
+shared_block_allocator_t::attach(const char* name) noexcept
+{
+    const mm_file_result_t file_res = mm_open_shared_memory(name, 0);
+    if (file_res.code != 0)
+        return AllocationStatusCode::OsErr;
+    return attach_inner(file_res.file);
+}
+
+ALLO_FUNC zl::res<shared_block_allocator_t, AllocationStatusCode>
+shared_block_allocator_t::attach_inner(mm_file_t file) noexcept
+{
+    using namespace zl;
+    defer close_file([file]() { mm_close_file(file); });
+
+    uint64_t size = 0;
+    if (mm_file_size(file, &size) != 0)
+        return AllocationStatusCode::OsErr;
+    if (size < sizeof(shared_header_t))
+        return AllocationStatusCode::Corruption;
+
+    const auto map_res = mm_map_file(nullptr, file, size, 0);
+    if (map_res.code != 0)
+        return AllocationStatusCode::OsErr;
+
+    auto* const header = static_cast<shared_header_t*>(map_res.data);
+    if (header->magic != shared_header_t::static_magic ||
+        header->version != shared_header_t::current_version ||
+        header->first_block_offset +
+                (header->blocksize * header->total_blocks) >
+            size) {
+        mm_memory_unmap(map_res.data, map_res.bytes);
+        return AllocationStatusCode::Corruption;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    close_file.cancel();
+    return res<shared_block_allocator_t, AllocationStatusCode>{
+        std::in_place, M{
+                           .header = header,
+                           .mapped_bytes = size,
+                           .file = file,
+                       }};
+}
+
+ALLO_FUNC uint8_t* shared_block_allocator_t::block_at(
+    uint32_t index) const noexcept
+{
+    ALLO_INTERNAL_ASSERT(index < m.header->total_blocks);
+    return reinterpret_cast<uint8_t*>(m.header) +
+           m.header->first_block_offset + (index * m.header->blocksize);
+}
+
+ALLO_FUNC bool shared_block_allocator_t::is_block(bytes_t mem) const noexcept
+{
+    const auto* const first = reinterpret_cast<const uint8_t*>(m.header) +
+                              m.header->first_block_offset;
+    if (mem.data() < first)
+        return false;
+    const size_t offset = mem.data() - first;
+    return offset % m.header->blocksize == 0 &&
+           offset / m.header->blocksize < m.header->total_blocks &&
+           mem.size() <= m.header->blocksize;
+}
+
+ALLO_FUNC allocation_result_t shared_block_allocator_t::alloc_bytes(
+    size_t bytes, uint8_t alignment_exponent, size_t) noexcept
+{
+    ALLO_TIME_OPERATION(Alloc);
+    shared_header_t& header = *m.header;
+    ALLO_VALID_ARG_ASSERT(
+        bytes <= header.blocksize &&
+        "Attempted allocation too big for shared block allocator...");
+    if (bytes > header.blocksize) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_alloc());
+        return AllocationStatusCode::OOM;
+    }
+    if (alignment_exponent > header.alignment_exponent) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_alloc());
+        return AllocationStatusCode::AllocationTooAligned;
+    }
+
+    uint64_t head = header.free_list_head.load(std::memory_order_acquire);
+    while (true) {
+        const auto index = static_cast<uint32_t>(head);
+        if (index == 0) {
+            ALLO_RECORD_STATS(record_failed_alloc());
+            return AllocationStatusCode::OOM;
+        }
+        uint8_t* const block = block_at(index - 1);
+        // if another thread pops this block first, this may read whatever
+        // it wrote into the block. that's fine, since the counter in head
+        // will have changed and the exchange below will fail.
+        const uint32_t next =
+            detail::shared_block_next(block).load(std::memory_order_relaxed);
+        const uint64_t new_head =
+            detail::pack_shared_free_list_head((head >> 32) + 1, next);
+        if (header.free_list_head.compare_exchange_weak(
+                head, new_head, std::memory_order_acquire,
+                std::memory_order_acquire)) {
+            header.blocks_free.fetch_sub(1, std::memory_order_relaxed);
+            ALLO_RECORD_STATS(record_alloc(bytes, header.blocksize));
+            return zl::raw_slice(*block, bytes);
+        }
+    }
+}
+
+ALLO_FUNC allocation_result_t shared_block_allocator_t::remap_bytes(
+    bytes_t mem, size_t, size_t new_size, size_t) noexcept
+{
+    ALLO_TIME_OPERATION(Remap);
+    ALLO_VALID_ARG_ASSERT(is_block(mem));
+    if (new_size > m.header->blocksize) {
+        ALLO_RECORD_STATS(record_failed_remap());
+        return AllocationStatusCode::OOM;
+    }
+    ALLO_RECORD_STATS(record_remap(mem.size(), new_size, m.header->blocksize,
+                                   m.header->blocksize));
+    return zl::raw_slice(*mem.data(), new_size);
+}
+
+ALLO_FUNC allocation_result_t
+shared_block_allocator_t::threadsafe_realloc_bytes(bytes_t mem,
+                                                   size_t old_typehash,
+                                                   size_t new_size,
+                                                   size_t new_typehash) noexcept
+{
+    return remap_bytes(mem, old_typehash, new_size, new_typehash);
+}
+
+ALLO_FUNC allocation_status_t
+shared_block_allocator_t::free_bytes(bytes_t mem, size_t typehash) noexcept
+{
+    ALLO_TIME_OPERATION(Free);
+    auto checkerr = free_status(mem, typehash);
+    if (!checkerr.okay()) {
+        ALLO_RECORD_STATS(record_failed_free());
+        return checkerr;
+    }
+
+    shared_header_t& header = *m.header;
+    ALLO_RECORD_STATS(record_free(mem.size(), header.blocksize));
+    const auto index = static_cast<uint32_t>(
+        ((mem.data() - reinterpret_cast<uint8_t*>(m.header)) -
+         header.first_block_offset) /
+        header.blocksize);
+    auto& next = detail::shared_block_next(mem.data());
+
+    uint64_t head = header.free_list_head.load(std::memory_order_relaxed);
+    do {
+        next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    } while (!header.free_list_head.compare_exchange_weak(
+        head, detail::pack_shared_free_list_head((head >> 32) + 1, index + 1),
+        std::memory_order_release, std::memory_order_relaxed));
+
+    header.blocks_free.fetch_add(1, std::memory_order_relaxed);
+    return AllocationStatusCode::Okay;
+}
+
+ALLO_FUNC allocation_status_t
+shared_block_allocator_t::free_status(bytes_t mem, size_t) const noexcept
+{
+    if (!is_block(mem))
+        return AllocationStatusCode::MemoryInvalid;
+    return AllocationStatusCode::Okay;
+}
+} // namespace allo
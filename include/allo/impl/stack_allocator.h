@@ -24,7 +24,6 @@
 
 namespace allo {
 
-// NOTE: this function is identical to scratch allocator
 ALLO_FUNC stack_allocator_t::~stack_allocator_t() noexcept
 {
     detail::call_all_destruction_callbacks(m.last_callback);
@@ -33,15 +32,28 @@ ALLO_FUNC stack_allocator_t::~stack_allocator_t() noexcept
     if (!m.parent.is_heap())
         return;
 
+    auto& parent = m.parent.get_heap_unchecked();
     if (m.blocks) {
+        // the blocks stack is placed inside of one of the blocks, so that
+        // block has to be freed after the stack is done being used
+        zl::opt<bytes_t> holder;
+        const auto release = [this, &parent, &holder](bytes_t block) {
+            if (holds_blocks_stack(block))
+                holder.emplace(block);
+            else
+                parent.free_bytes(block, 0);
+        };
+        if (m.spare)
+            release(m.spare.value());
         while (auto iter = m.blocks->end()) {
-            m.parent.get_heap_unchecked().free_bytes(iter.value(), 0);
+            release(iter.value());
             m.blocks->pop();
         }
         m.blocks->~segmented_stack_t<bytes_t>();
-        free_one(m.parent.get_heap_unchecked(), *m.blocks);
+        ALLO_INTERNAL_ASSERT(holder);
+        parent.free_bytes(holder.value(), 0);
     } else {
-        m.parent.get_heap_unchecked().free_bytes(m.memory, 0);
+        parent.free_bytes(m.memory, 0);
     }
 }
 
@@ -51,6 +63,7 @@ stack_allocator_t::stack_allocator_t(stack_allocator_t&& other) noexcept
     : m(other.m)
 {
     m_type = other.m_type;
+    move_stats_from(other);
     other.m.parent = any_allocator_t();
     other.m.last_callback = nullptr;
 }
@@ -78,6 +91,7 @@ ALLO_FUNC allocation_status_t stack_allocator_t::try_make_space_for_at_least(
 {
     if (m.parent.is_null())
         return AllocationStatusCode::OOM;
+    ALLO_COUNT_PAGE_FAULTS();
 
     // if the parent is a heap allocator, we can remap
     if (m.parent.is_heap()) {
@@ -107,9 +121,13 @@ ALLO_FUNC allocation_status_t stack_allocator_t::try_make_space_for_at_least(
                 // now-remapped block
                 m.blocks->end_unchecked() = newmem;
             }
+            ALLO_EMIT_EVENT(on_grow, newmem.size() - m.memory.size());
             m.memory = newmem;
+            ALLO_RECORD_STATS(record_parent_grow());
+            ALLO_MARK_SLOW_PATH();
             return AllocationStatusCode::Okay;
         }
+        ALLO_EMIT_EVENT(on_parent_remap_failed, m.memory, new_size, res.err());
     }
 
     // if we're not a heap, or if heap failed the remap, then do this.
@@ -174,6 +192,8 @@ ALLO_FUNC allocation_status_t stack_allocator_t::try_make_space_for_at_least(
             if (!maybe_newblock.okay()) [[unlikely]]
                 return maybe_newblock.err();
 
+            ALLO_RECORD_STATS(record_parent_grow());
+            ALLO_MARK_SLOW_PATH();
             bytes_t newblock = maybe_newblock.release();
             auto status = make_segmented_stack_at(newblock.data());
             if (!status.okay()) [[unlikely]] {
@@ -182,6 +202,7 @@ ALLO_FUNC allocation_status_t stack_allocator_t::try_make_space_for_at_least(
                 }
                 return status.err();
             }
+            ALLO_RECORD_STATS(record_block_acquired());
 
             m.blocks =
                 reinterpret_cast<segmented_stack_t<bytes_t>*>(newblock.data());
@@ -193,6 +214,7 @@ ALLO_FUNC allocation_status_t stack_allocator_t::try_make_space_for_at_least(
             ALLO_INTERNAL_ASSERT(res.okay());
             m.memory = newblock;
             m.top = reinterpret_cast<uint8_t*>(m.blocks + 1);
+            ALLO_EMIT_EVENT(on_grow, newblock.size());
             return AllocationStatusCode::Okay;
         }
     }
@@ -200,6 +222,23 @@ ALLO_FUNC allocation_status_t stack_allocator_t::try_make_space_for_at_least(
     const size_t new_buffersize = round_up_to_valid_buffersize(
         bytes + ((1UL << alignment_exponent) * 2UL));
 
+    if (m.spare) {
+        const bytes_t spare = m.spare.value();
+        uint8_t* const start =
+            holds_blocks_stack(spare)
+                ? reinterpret_cast<uint8_t*>(m.blocks + 1)
+                : spare.data();
+        if (size_t(spare.end().ptr() - start) >= new_buffersize) {
+            const auto res = m.blocks->try_push(spare);
+            if (!res.okay()) [[unlikely]]
+                return res.err();
+            m.spare.reset();
+            m.memory = spare;
+            m.top = start;
+            return AllocationStatusCode::Okay;
+        }
+    }
+
     auto maybe_newblock = m.parent.cast_to_basic().alloc_bytes(
         new_buffersize > m.memory.size() ? new_buffersize : m.memory.size(), 3,
         0);
@@ -207,13 +246,17 @@ ALLO_FUNC allocation_status_t stack_allocator_t::try_make_space_for_at_least(
     if (!maybe_newblock.okay()) [[unlikely]]
         return maybe_newblock.err();
 
+    ALLO_RECORD_STATS(record_parent_grow());
+    ALLO_MARK_SLOW_PATH();
     const auto newblock = maybe_newblock.release();
 
     const auto res = m.blocks->try_push(newblock);
     if (!res.okay()) [[unlikely]]
         return res.err();
+    ALLO_RECORD_STATS(record_block_acquired());
     m.memory = newblock;
     m.top = newblock.data();
+    ALLO_EMIT_EVENT(on_grow, newblock.size());
 
     return AllocationStatusCode::Okay;
 }
@@ -222,6 +265,7 @@ ALLO_FUNC allocation_result_t stack_allocator_t::alloc_bytes(
     const size_t bytes, const uint8_t alignment_exponent,
     const size_t typehash) noexcept
 {
+    ALLO_TIME_OPERATION(Alloc);
     // TODO: all the alignment stuff in this function could probably become some
     // bithacks, optimize this at some point
     const auto max = [](size_t a, size_t b) { return a > b ? a : b; };
@@ -258,6 +302,8 @@ ALLO_FUNC allocation_result_t stack_allocator_t::alloc_bytes(
             const allocation_status_t buffer_status = alloc_new_buffer();
             if (!buffer_status.okay()) [[unlikely]] {
                 m.top = oldtop;
+                ALLO_RECORD_STATS(record_failed_alloc());
+                ALLO_EMIT_EVENT(on_oom, bytes);
                 return buffer_status.err();
             }
 #ifndef NDEBUG
@@ -282,6 +328,8 @@ ALLO_FUNC allocation_result_t stack_allocator_t::alloc_bytes(
             const allocation_status_t buffer_status = alloc_new_buffer();
             if (!buffer_status.okay()) [[unlikely]] {
                 m.top = oldtop;
+                ALLO_RECORD_STATS(record_failed_alloc());
+                ALLO_EMIT_EVENT(on_oom, bytes);
                 return buffer_status.err();
             }
 #ifndef NDEBUG
@@ -333,6 +381,11 @@ ALLO_FUNC allocation_result_t stack_allocator_t::alloc_bytes(
     m.last_type_hashcode = typehash;
 #endif
 
+    // consumed space is counted from the start of the previous state, which is
+    // also where it is counted from when freeing
+    ALLO_RECORD_STATS(record_alloc(
+        bytes, static_cast<uint8_t*>(item) + bytes -
+                   reinterpret_cast<uint8_t*>(prevstate)));
     return zl::raw_slice<uint8_t>(*reinterpret_cast<uint8_t*>(item), bytes);
 }
 
@@ -402,18 +455,28 @@ stack_allocator_t::free_common(bytes_t mem, size_t typehash) const noexcept
 ALLO_FUNC allocation_status_t
 stack_allocator_t::free_bytes(bytes_t mem, size_t typehash) noexcept
 {
+    ALLO_TIME_OPERATION(Free);
     auto maybe_prevstate = free_common(mem, typehash);
-    if (!maybe_prevstate.okay()) [[unlikely]]
+    if (!maybe_prevstate.okay()) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_free());
+#ifndef ALLO_DISABLE_TYPEINFO
+        if (maybe_prevstate.err() == AllocationStatusCode::InvalidType) {
+            ALLO_EMIT_EVENT(on_type_mismatch, mem, m.last_type_hashcode,
+                            typehash);
+            return maybe_prevstate.err();
+        }
+#endif
+        ALLO_EMIT_EVENT(on_invalid_free, mem, maybe_prevstate.err());
         return maybe_prevstate.err();
+    }
 
     previous_state_t& prevstate = maybe_prevstate.release();
+    ALLO_RECORD_STATS(record_free(
+        mem.size(),
+        mem.end().ptr() - reinterpret_cast<uint8_t*>(&prevstate)));
     if (m.blocks && !zl::memcontains_one(m.memory, prevstate.stack_top)) {
         // stack top is not in our current block...
-        if (m.parent.is_heap()) {
-            m.parent.get_heap_unchecked().free_bytes(m.memory, 0);
-        }
-
-        // NOTE: leaking memory here if parent allocator is stack
+        keep_as_spare(m.memory);
         m.blocks->pop();
         m.memory = m.blocks->end_unchecked();
     }
@@ -426,17 +489,62 @@ stack_allocator_t::free_bytes(bytes_t mem, size_t typehash) noexcept
     return AllocationStatusCode::Okay;
 }
 
+ALLO_FUNC bool
+stack_allocator_t::holds_blocks_stack(bytes_t block) const noexcept
+{
+    return zl::memcontains_one(block, reinterpret_cast<uint8_t*>(m.blocks));
+}
+
+ALLO_FUNC void stack_allocator_t::keep_as_spare(bytes_t block) noexcept
+{
+    // the block holding the blocks stack can never be given back, so if it is
+    // the spare it stays the spare
+    bytes_t to_release = block;
+    if (!m.spare || !holds_blocks_stack(m.spare.value())) {
+        const zl::opt<bytes_t> old_spare = m.spare;
+        m.spare.emplace(block);
+        if (!old_spare)
+            return;
+        to_release = old_spare.value();
+    }
+    // NOTE: leaking memory here if parent allocator is not a heap
+    if (m.parent.is_heap()) {
+        m.parent.get_heap_unchecked().free_bytes(to_release, 0);
+        ALLO_RECORD_STATS(record_block_released());
+        ALLO_MARK_SLOW_PATH();
+    }
+}
+
+ALLO_FUNC size_t stack_allocator_t::trim() noexcept
+{
+    if (!m.spare || !m.parent.is_heap() ||
+        holds_blocks_stack(m.spare.value()))
+        return 0;
+    const size_t bytes_released = m.spare.value().size();
+    m.parent.get_heap_unchecked().free_bytes(m.spare.value(), 0);
+    m.spare.reset();
+    ALLO_RECORD_STATS(record_block_released());
+    ALLO_MARK_SLOW_PATH();
+    return bytes_released;
+}
+
 ALLO_FUNC allocation_result_t
 stack_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash,
                                size_t new_size, size_t new_typehash) noexcept
 {
+    ALLO_TIME_OPERATION(Remap);
 #ifndef ALLO_DISABLE_TYPEINFO
     ALLO_VALID_ARG_ASSERT(old_typehash == m.last_type_hashcode);
-    if (old_typehash != m.last_type_hashcode)
+    if (old_typehash != m.last_type_hashcode) {
+        ALLO_RECORD_STATS(record_failed_remap());
+        ALLO_EMIT_EVENT(on_type_mismatch, mem, m.last_type_hashcode,
+                        old_typehash);
         return AllocationStatusCode::InvalidType;
+    }
 #endif
     ALLO_VALID_ARG_ASSERT(m.top == mem.end().ptr());
     if (m.top != mem.end().ptr()) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_remap());
         return AllocationStatusCode::MemoryInvalid;
     }
 
@@ -445,9 +553,12 @@ stack_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash,
     const size_t byte_index_of_new_begin =
         byte_index_of_original_mem + new_size;
     if (byte_index_of_new_begin > m.memory.size()) [[unlikely]] {
+        ALLO_RECORD_STATS(record_failed_remap());
         return AllocationStatusCode::OOM;
     }
 
+    ALLO_RECORD_STATS(
+        record_remap(mem.size(), new_size, mem.size(), new_size));
     // modify our invariants
     m.top = m.memory.data() + byte_index_of_new_begin;
 #ifndef ALLO_DISABLE_TYPEINFO
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/memory_map.h"
+#include "allo/syscall_stats.h"
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+ALLO_FUNC syscall_stats_t syscall_stats() noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    const mm_syscall_counts_t counts = mm_get_syscall_counts();
+    return syscall_stats_t{
+        .reserve_pages = counts.reserve_pages,
+        .commit_pages = counts.commit_pages,
+        .memory_unmap = counts.memory_unmap,
+        .memory_remap = counts.memory_remap,
+        .map_file = counts.map_file,
+        .open_file = counts.open_file,
+        .close_file = counts.close_file,
+        .duplicate_file = counts.duplicate_file,
+        .file_size = counts.file_size,
+        .resize_file = counts.resize_file,
+        .write_file = counts.write_file,
+        .sync = counts.sync,
+        .create_shared_memory = counts.create_shared_memory,
+        .open_shared_memory = counts.open_shared_memory,
+        .unlink_shared_memory = counts.unlink_shared_memory,
+        .malloc_calls = detail::c_library_calls.malloc_calls.load(relaxed),
+        .realloc_calls = detail::c_library_calls.realloc_calls.load(relaxed),
+        .free_calls = detail::c_library_calls.free_calls.load(relaxed),
+    };
+}
+
+ALLO_FUNC page_faults_t current_page_faults() noexcept
+{
+#if defined(_WIN32)
+    return page_faults_t{.minor = 0, .major = 0};
+#else
+#if defined(RUSAGE_THREAD)
+    constexpr int who = RUSAGE_THREAD;
+#else
+    constexpr int who = RUSAGE_SELF;
+#endif
+    struct rusage usage = {};
+    if (::getrusage(who, &usage) != 0) [[unlikely]]
+        return page_faults_t{.minor = 0, .major = 0};
+    return page_faults_t{
+        .minor = static_cast<uint64_t>(usage.ru_minflt),
+        .major = static_cast<uint64_t>(usage.ru_majflt),
+    };
+#endif
+}
+} // namespace allo
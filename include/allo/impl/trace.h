@@ -0,0 +1,216 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/detail/round_up_to_multiple_of.h"
+#include "allo/trace.h"
+#include <new>
+#include <system_error>
+#include <ziglike/defer.h>
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+
+namespace detail {
+// never zero, so that an empty trace_thread_cache_t never matches
+inline std::atomic<uint64_t> next_trace_recorder_id{1};
+} // namespace detail
+
+ALLO_FUNC zl::res<trace_recorder_t, AllocationStatusCode>
+trace_recorder_t::make(const options_t& options) noexcept
+{
+    using namespace zl;
+    const auto pagesize_res = mm_get_page_size();
+    if (!pagesize_res.has_value)
+        return AllocationStatusCode::OsErr;
+    const size_t pagesize = pagesize_res.value;
+
+    const mm_file_result_t file_res = mm_open_file(options.path);
+    if (file_res.code != 0)
+        return AllocationStatusCode::OsErr;
+    const mm_file_t file = file_res.file;
+    defer close_file([file]() { mm_close_file(file); });
+
+    if (mm_resize_file(file, 0) != 0)
+        return AllocationStatusCode::OsErr;
+    const trace_file_header_t header{
+        .magic = trace_file_header_t::static_magic,
+        .version = trace_file_header_t::current_version,
+        .record_size = sizeof(trace_record_t),
+    };
+    if (mm_write_file(file, &header, sizeof(header)) != 0)
+        return AllocationStatusCode::OsErr;
+
+    // the state is shared with the background thread, so it gets its own pages
+    // instead of moving around with the trace_recorder_t
+    const size_t mapped_bytes =
+        detail::round_up_to_multiple_of(sizeof(state_t), pagesize);
+    const auto reserve_res = mm_reserve_pages(nullptr, mapped_bytes / pagesize);
+    if (reserve_res.code != 0)
+        return AllocationStatusCode::OOM;
+    defer unmap([&reserve_res]() {
+        mm_memory_unmap(reserve_res.data, reserve_res.bytes);
+    });
+    if (mm_commit_pages(reserve_res.data, mapped_bytes / pagesize) != 0)
+        return AllocationStatusCode::OOM;
+
+    auto* const state = new (reserve_res.data) state_t{
+        .id = detail::next_trace_recorder_id.fetch_add(1),
+        .file = file,
+        .ring_capacity = options.ring_capacity,
+        .flush_interval_ms = options.flush_interval_ms,
+        .mapped_bytes = mapped_bytes,
+        .next_allocator_id = 0,
+        .dropped_records = 0,
+        .running = true,
+        .num_rings = 0,
+    };
+    defer destroy([state]() { state->~state_t(); });
+
+    if (!write_clock_record(*state).okay())
+        return AllocationStatusCode::OsErr;
+
+    // starting a thread throws if the OS is out of threads. make() is
+    // noexcept, so that has to become an error instead of terminating
+#ifdef __cpp_exceptions
+    try {
+        state->flusher = std::thread(flush_loop, state);
+    } catch (const std::system_error&) {
+        return AllocationStatusCode::OsErr;
+    }
+#else
+    state->flusher = std::thread(flush_loop, state);
+#endif
+
+    destroy.cancel();
+    unmap.cancel();
+    close_file.cancel();
+    return res<trace_recorder_t, AllocationStatusCode>{
+        std::in_place, trace_recorder_t(M{.state = state})};
+}
+
+ALLO_FUNC trace_recorder_t::~trace_recorder_t() noexcept
+{
+    if (!m.state)
+        return;
+    m.state->running.store(false, std::memory_order_relaxed);
+    m.state->flusher.join();
+    (void)drain(*m.state);
+    (void)write_clock_record(*m.state);
+    mm_close_file(m.state->file);
+    const size_t mapped_bytes = m.state->mapped_bytes;
+    m.state->~state_t();
+    mm_memory_unmap(m.state, mapped_bytes);
+}
+
+ALLO_FUNC trace_recorder_t::trace_recorder_t(trace_recorder_t&& other) noexcept
+    : m(other.m)
+{
+    other.m.state = nullptr;
+}
+
+ALLO_FUNC allocation_status_t trace_recorder_t::flush() noexcept
+{
+    return drain(*m.state);
+}
+
+ALLO_FUNC ring_buffer_t* trace_recorder_t::register_thread() noexcept
+{
+    state_t& state = *m.state;
+    const std::thread::id self = std::this_thread::get_id();
+    ring_buffer_t* ring = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(state.register_mutex);
+        const size_t num_rings =
+            state.num_rings.load(std::memory_order_relaxed);
+        // the thread may have been registered before recording with some
+        // other recorder, which replaced it in the cache
+        for (size_t i = 0; i < num_rings; ++i) {
+            if (state.owners[i] == self) {
+                ring = &state.rings[i].value();
+                break;
+            }
+        }
+        if (!ring) {
+            if (num_rings == max_threads) [[unlikely]]
+                return nullptr;
+            auto ring_res = ring_buffer_t::make(state.ring_capacity);
+            if (!ring_res.okay()) [[unlikely]]
+                return nullptr;
+            state.rings[num_rings].emplace(ring_res.release());
+            state.owners[num_rings] = self;
+            ring = &state.rings[num_rings].value();
+            state.num_rings.store(num_rings + 1, std::memory_order_release);
+        }
+    }
+    detail::trace_thread_cache = detail::trace_thread_cache_t{
+        .state = m.state,
+        .recorder_id = state.id,
+        .ring = ring,
+    };
+    return ring;
+}
+
+ALLO_FUNC allocation_status_t trace_recorder_t::drain(state_t& state) noexcept
+{
+    std::lock_guard<std::mutex> lock(state.flush_mutex);
+    const size_t num_rings = state.num_rings.load(std::memory_order_acquire);
+    for (size_t i = 0; i < num_rings; ++i) {
+        ring_buffer_t& ring = state.rings[i].value();
+        const bytes_t span = ring.read_span();
+        if (span.size() == 0)
+            continue;
+        if (mm_write_file(state.file, span.data(), span.size()) != 0)
+            [[unlikely]]
+            return AllocationStatusCode::OsErr;
+        ring.commit_read(span.size());
+    }
+    return AllocationStatusCode::Okay;
+}
+
+ALLO_FUNC allocation_status_t
+trace_recorder_t::write_clock_record(state_t& state) noexcept
+{
+    const auto nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    const trace_record_t record{
+        .timestamp = detail::trace_clock(),
+        .address = 0,
+        .old_address = 0,
+        .size = static_cast<uint64_t>(nanoseconds),
+        .typehash = 0,
+        .allocator_id = 0,
+        .operation = TraceOperation::Clock,
+        .alignment_exponent = 0,
+        .status = AllocationStatusCode::Okay,
+        .reserved = 0,
+    };
+    std::lock_guard<std::mutex> lock(state.flush_mutex);
+    if (mm_write_file(state.file, &record, sizeof(record)) != 0)
+        return AllocationStatusCode::OsErr;
+    return AllocationStatusCode::Okay;
+}
+
+ALLO_FUNC void trace_recorder_t::flush_loop(state_t* state) noexcept
+{
+    while (state->running.load(std::memory_order_relaxed)) {
+        (void)drain(*state);
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(state->flush_interval_ms));
+    }
+}
+} // namespace allo
@@ -0,0 +1,428 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/detail/asserts.h"
+#include "allo/trace_replay.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include <algorithm>
+#include <ziglike/defer.h>
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+
+ALLO_FUNC zl::res<trace_reader_t, AllocationStatusCode>
+trace_reader_t::make(const char* path) noexcept
+{
+    using namespace zl;
+    const mm_file_result_t file_res = mm_open_file_readonly(path);
+    if (file_res.code != 0)
+        return AllocationStatusCode::OsErr;
+    const mm_file_t file = file_res.file;
+    defer close_file([file]() { mm_close_file(file); });
+
+    uint64_t size = 0;
+    if (mm_file_size(file, &size) != 0)
+        return AllocationStatusCode::OsErr;
+    if (size < sizeof(trace_file_header_t))
+        return AllocationStatusCode::InvalidArgument;
+
+    const auto map_res = mm_map_file_readonly(file, size);
+    if (map_res.code != 0)
+        return AllocationStatusCode::OsErr;
+    defer unmap(
+        [&map_res]() { mm_memory_unmap(map_res.data, map_res.bytes); });
+
+    const auto* header = static_cast<const trace_file_header_t*>(map_res.data);
+    const size_t records_bytes = size - sizeof(trace_file_header_t);
+    if (header->magic != trace_file_header_t::static_magic ||
+        header->version != trace_file_header_t::current_version ||
+        header->record_size != sizeof(trace_record_t) ||
+        records_bytes % sizeof(trace_record_t) != 0)
+        return AllocationStatusCode::InvalidArgument;
+
+    unmap.cancel();
+    close_file.cancel();
+    return res<trace_reader_t, AllocationStatusCode>{
+        std::in_place,
+        trace_reader_t(M{
+            .file = file,
+            .mapping = map_res.data,
+            .mapped_bytes = map_res.bytes,
+            .records = reinterpret_cast<const trace_record_t*>(header + 1),
+            .num_records = records_bytes / sizeof(trace_record_t),
+        })};
+}
+
+ALLO_FUNC double trace_reader_t::ticks_per_nanosecond() const noexcept
+{
+    const trace_record_t* first = nullptr;
+    const trace_record_t* last = nullptr;
+    for (const trace_record_t& record : records()) {
+        if (record.operation != TraceOperation::Clock)
+            continue;
+        if (!first)
+            first = &record;
+        last = &record;
+    }
+    if (!first || last->size <= first->size)
+        return 0;
+    return static_cast<double>(last->timestamp - first->timestamp) /
+           static_cast<double>(last->size - first->size);
+}
+
+ALLO_FUNC trace_reader_t::~trace_reader_t() noexcept
+{
+    if (!m.mapping)
+        return;
+    mm_memory_unmap(m.mapping, m.mapped_bytes);
+    mm_close_file(m.file);
+}
+
+ALLO_FUNC trace_reader_t::trace_reader_t(trace_reader_t&& other) noexcept
+    : m(other.m)
+{
+    other.m.mapping = nullptr;
+}
+
+namespace detail {
+/// An allocation made on the target of a replay, along with the address it had
+/// in the trace.
+struct replay_allocation_t
+{
+    /// Zero if this slot of the table is empty.
+    uint64_t trace_address;
+    uint32_t allocator_id;
+    uint8_t alignment_exponent;
+    uint8_t* data;
+    size_t size;
+    size_t typehash;
+};
+
+// The replay keeps its live allocations in a linear probing hash table keyed on
+// allocator id and address, since addresses are only unique per allocator. The
+// table has a power of two size and is never more than half full.
+
+inline size_t replay_ideal_slot(size_t mask, uint64_t trace_address,
+                                uint32_t allocator_id) noexcept
+{
+    const uint64_t key =
+        trace_address ^ (static_cast<uint64_t>(allocator_id) << 32);
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+/// Returns the index of the matching slot, or of the empty slot where it would
+/// go.
+inline size_t replay_find_slot(zl::slice<replay_allocation_t> table,
+                               uint64_t trace_address,
+                               uint32_t allocator_id) noexcept
+{
+    const size_t mask = table.size() - 1;
+    size_t index = replay_ideal_slot(mask, trace_address, allocator_id);
+    while (table.data()[index].trace_address != 0 &&
+           (table.data()[index].trace_address != trace_address ||
+            table.data()[index].allocator_id != allocator_id)) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+/// Empty a slot, shifting back any entries which were displaced past it so
+/// that no tombstones are needed.
+inline void replay_erase_slot(zl::slice<replay_allocation_t> table,
+                              size_t index) noexcept
+{
+    const size_t mask = table.size() - 1;
+    size_t hole = index;
+    size_t next = index;
+    while (true) {
+        next = (next + 1) & mask;
+        const replay_allocation_t& entry = table.data()[next];
+        if (entry.trace_address == 0)
+            break;
+        const size_t ideal =
+            replay_ideal_slot(mask, entry.trace_address, entry.allocator_id);
+        // the entry can fill the hole if the hole is between its ideal slot
+        // and where it is now
+        if (((next - ideal) & mask) >= ((next - hole) & mask)) {
+            table.data()[hole] = entry;
+            hole = next;
+        }
+    }
+    table.data()[hole].trace_address = 0;
+}
+
+inline allocation_status_t
+replay_free(any_allocator_t target,
+            const replay_allocation_t& allocation) noexcept
+{
+    const bytes_t mem = zl::raw_slice(*allocation.data, allocation.size);
+    if (target.is_heap()) {
+        return target.get_heap_unchecked().free_bytes(mem,
+                                                      allocation.typehash);
+    }
+    return target.get_stack_unchecked().free_bytes(mem, allocation.typehash);
+}
+
+/// Remap, falling back to allocating, copying, and freeing like realloc.
+inline allocation_result_t replay_remap(any_allocator_t target,
+                                        const replay_allocation_t& allocation,
+                                        size_t new_size,
+                                        size_t new_typehash) noexcept
+{
+    const bytes_t mem = zl::raw_slice(*allocation.data, allocation.size);
+    const bool can_free = target.is_heap() || target.is_stack();
+    if (can_free) {
+        auto res = target.is_heap()
+                       ? target.get_heap_unchecked().remap_bytes(
+                             mem, allocation.typehash, new_size, new_typehash)
+                       : target.get_stack_unchecked().remap_bytes(
+                             mem, allocation.typehash, new_size, new_typehash);
+        if (res.okay())
+            return res;
+    }
+    auto res = target.cast_to_basic().alloc_bytes(
+        new_size, allocation.alignment_exponent, new_typehash);
+    if (!res.okay())
+        return res;
+    bytes_t& newmem = res.release_ref();
+    std::memcpy(newmem.data(), allocation.data,
+                new_size < allocation.size ? new_size : allocation.size);
+    if (can_free)
+        (void)replay_free(target, allocation);
+    return newmem;
+}
+} // namespace detail
+
+ALLO_FUNC zl::res<replay_result_t, AllocationStatusCode>
+replay_trace(zl::slice<const trace_record_t> records, any_allocator_t target,
+             detail::abstract_heap_allocator_t& bookkeeping,
+             const replay_options_t& options) noexcept
+{
+    using namespace zl;
+    using detail::replay_allocation_t;
+    ALLO_VALID_ARG_ASSERT(!target.is_null());
+
+    const auto is_replayed = [&options](const trace_record_t& record) {
+        return record.operation != TraceOperation::Clock &&
+               (options.allocator_id == replay_options_t::all_allocators ||
+                record.allocator_id == options.allocator_id);
+    };
+
+    // every allocation or remap may add an entry to the table
+    size_t max_live = 0;
+    size_t max_operations = 0;
+    for (const trace_record_t& record : records) {
+        if (!is_replayed(record))
+            continue;
+        ++max_operations;
+        if (record.operation == TraceOperation::Alloc ||
+            record.operation == TraceOperation::Remap)
+            ++max_live;
+    }
+    size_t table_size = 16;
+    while (table_size < max_live * 2)
+        table_size *= 2;
+
+    auto table_res = alloc<replay_allocation_t>(bookkeeping, table_size);
+    if (!table_res.okay())
+        return table_res.err();
+    const slice<replay_allocation_t> table = table_res.release();
+    defer free_table([&]() { (void)allo::free(bookkeeping, table); });
+    std::memset(table.data(), 0, table.size() * sizeof(replay_allocation_t));
+
+    auto latencies_res =
+        alloc<uint64_t>(bookkeeping, max_operations == 0 ? 1 : max_operations);
+    if (!latencies_res.okay())
+        return latencies_res.err();
+    const slice<uint64_t> latencies = latencies_res.release();
+    defer free_latencies([&]() { (void)allo::free(bookkeeping, latencies); });
+
+    const bool can_free = target.is_heap() || target.is_stack();
+    replay_result_t result{};
+    size_t live_bytes = 0;
+
+    // a slot may still be occupied if the trace has records from different
+    // threads out of order, in which case the old allocation is dropped
+    const auto insert = [&](size_t index, const replay_allocation_t& entry) {
+        replay_allocation_t& slot = table.data()[index];
+        if (slot.trace_address != 0) {
+            live_bytes -= slot.size;
+            if (can_free)
+                (void)detail::replay_free(target, slot);
+        }
+        slot = entry;
+        live_bytes += entry.size;
+        if (live_bytes > result.peak_live_bytes)
+            result.peak_live_bytes = live_bytes;
+    };
+
+    detail::abstract_allocator_t& committed_source =
+        options.committed_source ? *options.committed_source
+                                 : target.cast_to_basic();
+    committed_source.reset_peak_stats();
+
+    const auto start_time = std::chrono::steady_clock::now();
+    const uint64_t start_ticks = detail::trace_clock();
+
+    for (const trace_record_t& record : records) {
+        if (!is_replayed(record))
+            continue;
+        if (record.status != AllocationStatusCode::Okay ||
+            record.operation == TraceOperation::RegisterDestructionCallback) {
+            ++result.skipped_operations;
+            continue;
+        }
+
+        switch (record.operation) {
+        case TraceOperation::Alloc: {
+            const uint64_t before = detail::trace_clock();
+            auto res = target.cast_to_basic().alloc_bytes(
+                record.size, record.alignment_exponent, record.typehash);
+            latencies.data()[result.operations++] =
+                detail::trace_clock() - before;
+            if (!res.okay()) {
+                ++result.failed_operations;
+                break;
+            }
+            insert(detail::replay_find_slot(table, record.address,
+                                            record.allocator_id),
+                   replay_allocation_t{
+                       .trace_address = record.address,
+                       .allocator_id = record.allocator_id,
+                       .alignment_exponent = record.alignment_exponent,
+                       .data = res.release_ref().data(),
+                       .size = record.size,
+                       .typehash = record.typehash,
+                   });
+            break;
+        }
+        case TraceOperation::Remap: {
+            const size_t index = detail::replay_find_slot(
+                table, record.old_address, record.allocator_id);
+            if (table.data()[index].trace_address == 0) {
+                ++result.skipped_operations;
+                break;
+            }
+            const replay_allocation_t old = table.data()[index];
+            const uint64_t before = detail::trace_clock();
+            auto res =
+                detail::replay_remap(target, old, record.size, record.typehash);
+            latencies.data()[result.operations++] =
+                detail::trace_clock() - before;
+            if (!res.okay()) {
+                ++result.failed_operations;
+                break;
+            }
+            detail::replay_erase_slot(table, index);
+            live_bytes -= old.size;
+            insert(detail::replay_find_slot(table, record.address,
+                                            record.allocator_id),
+                   replay_allocation_t{
+                       .trace_address = record.address,
+                       .allocator_id = record.allocator_id,
+                       .alignment_exponent = old.alignment_exponent,
+                       .data = res.release_ref().data(),
+                       .size = record.size,
+                       .typehash = record.typehash,
+                   });
+            break;
+        }
+        case TraceOperation::Free: {
+            const size_t index = detail::replay_find_slot(
+                table, record.address, record.allocator_id);
+            if (!can_free || table.data()[index].trace_address == 0) {
+                ++result.skipped_operations;
+                break;
+            }
+            const uint64_t before = detail::trace_clock();
+            const allocation_status_t status =
+                detail::replay_free(target, table.data()[index]);
+            latencies.data()[result.operations++] =
+                detail::trace_clock() - before;
+            if (!status.okay()) {
+                ++result.failed_operations;
+                break;
+            }
+            live_bytes -= table.data()[index].size;
+            detail::replay_erase_slot(table, index);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    const uint64_t end_ticks = detail::trace_clock();
+    const auto end_time = std::chrono::steady_clock::now();
+    const auto wall_nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end_time -
+                                                             start_time)
+            .count();
+    const double ticks_per_nanosecond =
+        wall_nanoseconds > 0 && end_ticks > start_ticks
+            ? static_cast<double>(end_ticks - start_ticks) /
+                  static_cast<double>(wall_nanoseconds)
+            : 1.0;
+    const auto to_nanoseconds = [ticks_per_nanosecond](uint64_t ticks) {
+        return static_cast<uint64_t>(static_cast<double>(ticks) /
+                                     ticks_per_nanosecond);
+    };
+
+    uint64_t total_ticks = 0;
+    for (size_t i = 0; i < result.operations; ++i)
+        total_ticks += latencies.data()[i];
+    result.elapsed_nanoseconds = to_nanoseconds(total_ticks);
+    if (result.elapsed_nanoseconds > 0) {
+        result.operations_per_second =
+            static_cast<double>(result.operations) * 1e9 /
+            static_cast<double>(result.elapsed_nanoseconds);
+    }
+
+    if (result.operations > 0) {
+        uint64_t* const first = latencies.data();
+        uint64_t* const last = first + result.operations;
+        std::sort(first, last);
+        const auto percentile = [&](size_t per_thousand) {
+            return to_nanoseconds(
+                first[(result.operations - 1) * per_thousand / 1000]);
+        };
+        result.latency = replay_latencies_t{
+            .p50 = percentile(500),
+            .p90 = percentile(900),
+            .p99 = percentile(990),
+            .p999 = percentile(999),
+            .max = to_nanoseconds(*(last - 1)),
+        };
+    }
+
+    result.peak_committed_bytes =
+        committed_source.stats().peak_bytes_consumed;
+    if (result.peak_committed_bytes > result.peak_live_bytes) {
+        result.fragmentation =
+            1.0 - static_cast<double>(result.peak_live_bytes) /
+                      static_cast<double>(result.peak_committed_bytes);
+    }
+
+    if (can_free) {
+        for (const replay_allocation_t& slot : table) {
+            if (slot.trace_address != 0)
+                (void)detail::replay_free(target, slot);
+        }
+    }
+    return result;
+}
+} // namespace allo
@@ -0,0 +1,111 @@
+#pragma once
+
+#ifndef ALLO_HEADER_ONLY
+#ifndef ALLO_OVERRIDE_IMPL_INCLUSION_GUARD
+#error \
+    "Attempt to include allo/impl header file but header-only mode is not enabled."
+#endif
+#endif
+
+#include "allo/tracing_allocator.h"
+
+#ifdef ALLO_HEADER_ONLY
+#ifndef ALLO_FUNC
+#define ALLO_FUNC inline
+#endif
+#else
+#define ALLO_FUNC
+#endif
+
+namespace allo {
+
+ALLO_FUNC
+tracing_allocator_t::tracing_allocator_t(tracing_allocator_t&& other) noexcept
+    : m(other.m)
+{
+    m_type = enum_value;
+    move_stats_from(other);
+}
+
+ALLO_FUNC allocation_result_t tracing_allocator_t::alloc_bytes(
+    size_t bytes, uint8_t alignment_exponent, size_t typehash) noexcept
+{
+    ALLO_TIME_OPERATION(Alloc);
+    auto res = m.parent.cast_to_basic().alloc_bytes(bytes, alignment_exponent,
+                                                    typehash);
+    if (res.okay()) {
+        bytes_t& mem = res.release_ref();
+        record(TraceOperation::Alloc, reinterpret_cast<uint64_t>(mem.data()),
+               0, bytes, typehash, alignment_exponent,
+               AllocationStatusCode::Okay);
+        return mem;
+    }
+    record(TraceOperation::Alloc, 0, 0, bytes, typehash, alignment_exponent,
+           res.err());
+    return res;
+}
+
+ALLO_FUNC allocation_result_t
+tracing_allocator_t::remap_bytes(bytes_t mem, size_t old_typehash,
+                                 size_t new_size, size_t new_typehash) noexcept
+{
+    ALLO_TIME_OPERATION(Remap);
+    const auto old_address = reinterpret_cast<uint64_t>(mem.data());
+    if (m.parent.is_basic()) [[unlikely]] {
+        record(TraceOperation::Remap, 0, old_address, new_size, new_typehash,
+               0, AllocationStatusCode::InvalidArgument);
+        return AllocationStatusCode::InvalidArgument;
+    }
+    auto res = m.parent.is_heap()
+                   ? m.parent.get_heap_unchecked().remap_bytes(
+                         mem, old_typehash, new_size, new_typehash)
+                   : m.parent.get_stack_unchecked().remap_bytes(
+                         mem, old_typehash, new_size, new_typehash);
+    if (res.okay()) {
+        bytes_t& newmem = res.release_ref();
+        record(TraceOperation::Remap,
+               reinterpret_cast<uint64_t>(newmem.data()), old_address,
+               new_size, new_typehash, 0, AllocationStatusCode::Okay);
+        return newmem;
+    }
+    record(TraceOperation::Remap, 0, old_address, new_size, new_typehash, 0,
+           res.err());
+    return res;
+}
+
+ALLO_FUNC allocation_status_t
+tracing_allocator_t::free_bytes(bytes_t mem, size_t typehash) noexcept
+{
+    ALLO_TIME_OPERATION(Free);
+    allocation_status_t status = AllocationStatusCode::InvalidArgument;
+    if (m.parent.is_heap())
+        status = m.parent.get_heap_unchecked().free_bytes(mem, typehash);
+    else if (m.parent.is_stack())
+        status = m.parent.get_stack_unchecked().free_bytes(mem, typehash);
+    record(TraceOperation::Free, reinterpret_cast<uint64_t>(mem.data()), 0,
+           mem.size(), typehash, 0, status.err());
+    return status;
+}
+
+ALLO_FUNC allocation_status_t
+tracing_allocator_t::free_status(bytes_t mem, size_t typehash) const noexcept
+{
+    if (m.parent.is_heap())
+        return m.parent.get_heap_unchecked().free_status(mem, typehash);
+    if (m.parent.is_stack())
+        return m.parent.get_stack_unchecked().free_status(mem, typehash);
+    return AllocationStatusCode::InvalidArgument;
+}
+
+ALLO_FUNC allocation_status_t
+tracing_allocator_t::register_destruction_callback(
+    destruction_callback_t callback, void* user_data) noexcept
+{
+    const allocation_status_t status =
+        m.parent.cast_to_basic().register_destruction_callback(callback,
+                                                               user_data);
+    record(TraceOperation::RegisterDestructionCallback,
+           reinterpret_cast<uint64_t>(user_data), 0, 0, 0, 0, status.err());
+    return status;
+}
+} // namespace allo
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace allo {
+
+enum class LatencyOperation : uint8_t
+{
+    Alloc,
+    Free,
+    /// remap_bytes, and threadsafe_realloc_bytes for threadsafe allocators
+    Remap,
+    MAX_LATENCY_OPERATION,
+};
+
+enum class LatencyPath : uint8_t
+{
+    /// The allocator served the operation with memory it already had.
+    Fast,
+    /// The allocator had to go to its parent or the OS: to grow, remap the
+    /// parent's memory, get a new block, or give memory back.
+    Slow,
+    MAX_LATENCY_PATH,
+};
+
+/// A histogram of operation latencies in nanoseconds, with buckets which get
+/// wider as latencies get longer, like an HDR histogram. Latencies below 16ns
+/// are counted exactly, and above that every power of two is split into eight
+/// buckets, so any latency is known to within 12.5%. Latencies from 2^36ns
+/// (about a minute) up are all counted in the last bucket.
+///
+/// This is a plain value which is not safe to update from multiple threads. To
+/// combine histograms from different allocators or threads, merge() them.
+struct latency_histogram_t
+{
+    static constexpr size_t sub_bucket_bits = 3;
+    static constexpr size_t sub_buckets = size_t(1) << sub_bucket_bits;
+    static constexpr size_t max_exponent = 36;
+    static constexpr size_t num_buckets =
+        (max_exponent - sub_bucket_bits + 1) * sub_buckets;
+
+    uint64_t buckets[num_buckets];
+    uint64_t count;
+    uint64_t total_nanoseconds;
+    /// UINT64_MAX if count is zero.
+    uint64_t min_nanoseconds;
+    uint64_t max_nanoseconds;
+
+    /// An empty histogram.
+    [[nodiscard]] static inline constexpr latency_histogram_t empty() noexcept
+    {
+        latency_histogram_t out{};
+        out.min_nanoseconds = UINT64_MAX;
+        return out;
+    }
+
+    [[nodiscard]] static inline constexpr size_t
+    bucket_of(uint64_t nanoseconds) noexcept
+    {
+        if (nanoseconds < sub_buckets)
+            return nanoseconds;
+        size_t exponent = 0;
+        for (uint64_t v = nanoseconds; v > 1; v >>= 1)
+            ++exponent;
+        if (exponent >= max_exponent)
+            return num_buckets - 1;
+        const size_t shift = exponent - sub_bucket_bits;
+        return (shift * sub_buckets) + size_t(nanoseconds >> shift);
+    }
+
+    /// The smallest latency which is counted in the given bucket.
+    [[nodiscard]] static inline constexpr uint64_t
+    bucket_lower_bound(size_t bucket) noexcept
+    {
+        if (bucket < sub_buckets)
+            return bucket;
+        const size_t shift = (bucket / sub_buckets) - 1;
+        return uint64_t((bucket % sub_buckets) + sub_buckets) << shift;
+    }
+
+    /// The largest latency which is counted in the given bucket.
+    [[nodiscard]] static inline constexpr uint64_t
+    bucket_upper_bound(size_t bucket) noexcept
+    {
+        if (bucket == num_buckets - 1)
+            return UINT64_MAX;
+        return bucket_lower_bound(bucket + 1) - 1;
+    }
+
+    inline constexpr void record(uint64_t nanoseconds) noexcept
+    {
+        ++buckets[bucket_of(nanoseconds)];
+        ++count;
+        total_nanoseconds += nanoseconds;
+        if (nanoseconds < min_nanoseconds)
+            min_nanoseconds = nanoseconds;
+        if (nanoseconds > max_nanoseconds)
+            max_nanoseconds = nanoseconds;
+    }
+
+    inline constexpr void merge(const latency_histogram_t& other) noexcept
+    {
+        for (size_t i = 0; i < num_buckets; ++i)
+            buckets[i] += other.buckets[i];
+        count += other.count;
+        total_nanoseconds += other.total_nanoseconds;
+        if (other.min_nanoseconds < min_nanoseconds)
+            min_nanoseconds = other.min_nanoseconds;
+        if (other.max_nanoseconds > max_nanoseconds)
+            max_nanoseconds = other.max_nanoseconds;
+    }
+
+    /// The latency which "fraction" of operations took at most, for example
+    /// 0.99 for the 99th percentile. Reported as the upper bound of the bucket
+    /// the percentile falls in, but never more than the slowest operation.
+    /// Zero if the histogram is empty.
+    [[nodiscard]] inline constexpr uint64_t
+    percentile(double fraction) const noexcept
+    {
+        if (count == 0)
+            return 0;
+        if (fraction <= 0)
+            return min_nanoseconds;
+        auto rank = static_cast<uint64_t>(fraction * double(count));
+        if (double(rank) < fraction * double(count))
+            ++rank;
+        if (rank > count)
+            rank = count;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < num_buckets; ++i) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                const uint64_t upper = bucket_upper_bound(i);
+                return upper < max_nanoseconds ? upper : max_nanoseconds;
+            }
+        }
+        return max_nanoseconds;
+    }
+
+    [[nodiscard]] inline constexpr double mean() const noexcept
+    {
+        return count == 0 ? 0.0 : double(total_nanoseconds) / double(count);
+    }
+};
+
+/// One histogram for every kind of operation and whether it took the fast or
+/// slow path.
+struct allocator_latencies_t
+{
+    static constexpr size_t num_operations =
+        size_t(LatencyOperation::MAX_LATENCY_OPERATION);
+    static constexpr size_t num_paths = size_t(LatencyPath::MAX_LATENCY_PATH);
+
+    latency_histogram_t histograms[num_operations][num_paths];
+
+    [[nodiscard]] static inline constexpr allocator_latencies_t empty() noexcept
+    {
+        allocator_latencies_t out{};
+        for (auto& per_operation : out.histograms) {
+            for (auto& histogram : per_operation)
+                histogram = latency_histogram_t::empty();
+        }
+        return out;
+    }
+
+    [[nodiscard]] inline constexpr latency_histogram_t&
+    get(LatencyOperation operation, LatencyPath path) noexcept
+    {
+        return histograms[size_t(operation)][size_t(path)];
+    }
+
+    [[nodiscard]] inline constexpr const latency_histogram_t&
+    get(LatencyOperation operation, LatencyPath path) const noexcept
+    {
+        return histograms[size_t(operation)][size_t(path)];
+    }
+
+    /// Both paths of one operation merged together.
+    [[nodiscard]] inline constexpr latency_histogram_t
+    get(LatencyOperation operation) const noexcept
+    {
+        latency_histogram_t out = get(operation, LatencyPath::Fast);
+        out.merge(get(operation, LatencyPath::Slow));
+        return out;
+    }
+
+    inline constexpr void merge(const allocator_latencies_t& other) noexcept
+    {
+        for (size_t op = 0; op < num_operations; ++op) {
+            for (size_t path = 0; path < num_paths; ++path)
+                histograms[op][path].merge(other.histograms[op][path]);
+        }
+    }
+};
+
+namespace detail {
+
+template <bool threadsafe> class allocator_latency_recorder_t;
+
+/// The counters behind allocator_latencies_t. Like the stats counters these
+/// are atomic with relaxed ordering, so that they can be read from another
+/// thread, but a snapshot taken while the allocator is in use may be torn
+/// between operations. They are only ever updated through an
+/// allocator_latency_recorder_t.
+class allocator_latency_counters_t
+{
+  public:
+    [[nodiscard]] inline allocator_latencies_t snapshot() const noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        allocator_latencies_t out{};
+        for (size_t op = 0; op < num_operations; ++op) {
+            for (size_t path = 0; path < num_paths; ++path) {
+                const histogram_t& h = m.histograms[op][path];
+                latency_histogram_t& out_h = out.histograms[op][path];
+                for (size_t i = 0; i < latency_histogram_t::num_buckets; ++i)
+                    out_h.buckets[i] = h.buckets[i].load(relaxed);
+                out_h.count = h.count.load(relaxed);
+                out_h.total_nanoseconds = h.total_nanoseconds.load(relaxed);
+                out_h.min_nanoseconds = h.min_nanoseconds.load(relaxed);
+                out_h.max_nanoseconds = h.max_nanoseconds.load(relaxed);
+            }
+        }
+        return out;
+    }
+
+    /// Overwrite these counters with a snapshot, used when an allocator is
+    /// moved and to reset them. Not threadsafe.
+    inline void restore(const allocator_latencies_t& latencies) noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        for (size_t op = 0; op < num_operations; ++op) {
+            for (size_t path = 0; path < num_paths; ++path) {
+                histogram_t& h = m.histograms[op][path];
+                const latency_histogram_t& in = latencies.histograms[op][path];
+                for (size_t i = 0; i < latency_histogram_t::num_buckets; ++i)
+                    h.buckets[i].store(in.buckets[i], relaxed);
+                h.count.store(in.count, relaxed);
+                h.total_nanoseconds.store(in.total_nanoseconds, relaxed);
+                h.min_nanoseconds.store(in.min_nanoseconds, relaxed);
+                h.max_nanoseconds.store(in.max_nanoseconds, relaxed);
+            }
+        }
+    }
+
+  private:
+    friend class allocator_latency_recorder_t<false>;
+    friend class allocator_latency_recorder_t<true>;
+
+    static constexpr size_t num_operations =
+        allocator_latencies_t::num_operations;
+    static constexpr size_t num_paths = allocator_latencies_t::num_paths;
+
+    struct histogram_t
+    {
+        std::atomic<uint64_t> buckets[latency_histogram_t::num_buckets]{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_nanoseconds{0};
+        std::atomic<uint64_t> min_nanoseconds{UINT64_MAX};
+        std::atomic<uint64_t> max_nanoseconds{0};
+    };
+
+    struct M
+    {
+        histogram_t histograms[num_operations][num_paths];
+    } m;
+};
+
+/// Records latencies into an allocator_latency_counters_t. Allocators which
+/// are not threadsafe use the non-threadsafe recorder, which updates the
+/// counters with plain loads and stores instead of read-modify-writes.
+template <bool threadsafe> class allocator_latency_recorder_t
+{
+  public:
+    inline constexpr explicit allocator_latency_recorder_t(
+        allocator_latency_counters_t& counters) noexcept
+        : m(counters.m)
+    {
+    }
+
+    inline void record(LatencyOperation operation, LatencyPath path,
+                       uint64_t nanoseconds) noexcept
+    {
+        histogram_t& h = m.histograms[size_t(operation)][size_t(path)];
+        add(h.buckets[latency_histogram_t::bucket_of(nanoseconds)], 1);
+        add(h.count, 1);
+        add(h.total_nanoseconds, nanoseconds);
+        lower_to(h.min_nanoseconds, nanoseconds);
+        raise_to(h.max_nanoseconds, nanoseconds);
+    }
+
+  private:
+    using histogram_t = allocator_latency_counters_t::histogram_t;
+    using counter_t = std::atomic<uint64_t>;
+
+    static inline void add(counter_t& counter, uint64_t amount) noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        if constexpr (threadsafe)
+            counter.fetch_add(amount, relaxed);
+        else
+            counter.store(counter.load(relaxed) + amount, relaxed);
+    }
+
+    static inline void lower_to(counter_t& counter, uint64_t value) noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        uint64_t old = counter.load(relaxed);
+        if constexpr (threadsafe) {
+            while (value < old &&
+                   !counter.compare_exchange_weak(old, value, relaxed)) {
+            }
+        } else if (value < old) {
+            counter.store(value, relaxed);
+        }
+    }
+
+    static inline void raise_to(counter_t& counter, uint64_t value) noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        uint64_t old = counter.load(relaxed);
+        if constexpr (threadsafe) {
+            while (value > old &&
+                   !counter.compare_exchange_weak(old, value, relaxed)) {
+            }
+        } else if (value > old) {
+            counter.store(value, relaxed);
+        }
+    }
+
+    allocator_latency_counters_t::M& m;
+};
+
+/// Set when the operation currently running on this thread takes a slow path.
+/// It is per thread so that threadsafe allocators do not see each other's
+/// slow paths, and saved and restored by each latency_scope_t so that an
+/// allocator calling into its parent does not lose track of its own.
+inline thread_local bool latency_took_slow_path = false;
+
+/// Times an allocator operation from construction to destruction.
+template <typename recorder_t> class latency_scope_t
+{
+  public:
+    inline latency_scope_t(recorder_t recorder,
+                           LatencyOperation operation) noexcept
+        : m{
+              .recorder = recorder,
+              .operation = operation,
+              .outer_took_slow_path = latency_took_slow_path,
+              .start = std::chrono::steady_clock::now(),
+          }
+    {
+        latency_took_slow_path = false;
+    }
+
+    inline ~latency_scope_t() noexcept
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - m.start;
+        const LatencyPath path =
+            latency_took_slow_path ? LatencyPath::Slow : LatencyPath::Fast;
+        latency_took_slow_path = m.outer_took_slow_path;
+        m.recorder.record(
+            m.operation, path,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count());
+    }
+
+    latency_scope_t(const latency_scope_t&) = delete;
+    latency_scope_t& operator=(const latency_scope_t&) = delete;
+    latency_scope_t(latency_scope_t&&) = delete;
+    latency_scope_t& operator=(latency_scope_t&&) = delete;
+
+  private:
+    struct M
+    {
+        recorder_t recorder;
+        LatencyOperation operation;
+        bool outer_took_slow_path;
+        std::chrono::steady_clock::time_point start;
+    } m;
+};
+} // namespace detail
+} // namespace allo
+
+/// Used at the top of an allocator's alloc, free, and remap functions to time
+/// them, and wherever those functions go to the parent allocator or the OS to
+/// mark the operation as slow. Both compile to nothing unless
+/// ALLO_ENABLE_LATENCY_HISTOGRAMS is defined.
+#ifdef ALLO_ENABLE_LATENCY_HISTOGRAMS
+#define ALLO_TIME_OPERATION(operation)                   \
+    ::allo::detail::latency_scope_t allo_latency_scope_( \
+        latency_recorder(), ::allo::LatencyOperation::operation)
+#define ALLO_MARK_SLOW_PATH() \
+    (::allo::detail::latency_took_slow_path = true)
+#else
+#define ALLO_TIME_OPERATION(operation)
+#define ALLO_MARK_SLOW_PATH()
+#endif
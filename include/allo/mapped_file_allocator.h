@@ -0,0 +1,179 @@
+#pragma once
+
+#include "allo/detail/abstracts.h"
+#include "allo/detail/asserts.h"
+#include "allo/memory_map.h"
+#include <ziglike/opt.h>
+
+namespace allo {
+
+/// An allocator which allocates into a memory mapped file, in first-in,
+/// never-out order like scratch_allocator_t. Everything it keeps track of is
+/// stored in a header at the start of the file as an offset, so the next time
+/// the same file is opened with a mapped_file_allocator_t, all the previous
+/// allocations are still there and allocation resumes after them. Nothing has
+/// to be parsed or reallocated on startup.
+///
+/// The file is mapped at the address it was mapped at last time if possible.
+/// If that address is not available, the file is mapped elsewhere and
+/// was_relocated() returns true, in which case any absolute pointers stored
+/// in the file are invalid. Use offset_ptr<T> for pointers stored in the file
+/// to avoid that problem.
+///
+/// Other allocators can be nested inside of this one (for example, a
+/// heap_allocator_t created with alloc<uint8_t>(file, n) and the file as its
+/// parent) but their bookkeeping lives outside of the file and does not
+/// survive a restart.
+///
+/// Destruction callbacks cannot be registered, since function pointers would
+/// not be valid when the file is reopened.
+///
+/// NOTE: windows does not allow mapping a file over reserved pages, so this
+/// allocator currently only works on linux and macos.
+class mapped_file_allocator_t : public detail::abstract_allocator_t
+{
+  public:
+    /// Stored at the very beginning of the file
+    struct file_header_t
+    {
+        static constexpr uint64_t static_magic = 0x464D4F4C4C41ULL;
+        static constexpr uint64_t current_version = 1;
+        uint64_t magic;
+        uint64_t version;
+        // the address the file was mapped at the last time it was opened
+        uint64_t base_address;
+        // offset from the start of the file to the first unallocated byte
+        uint64_t top;
+        // offset from the start of the file to the root object, or 0 if none
+        uint64_t root;
+    };
+
+  private:
+    struct M
+    {
+        file_header_t* header;
+        // bytes of the file which are currently mapped. always the same as the
+        // size of the file.
+        size_t mapped_bytes;
+        // bytes of address space reserved, starting at header. the file can
+        // grow into this without moving
+        size_t reserved_bytes;
+        size_t pagesize;
+        mm_file_t file;
+        bool fresh;
+        bool relocated;
+    } m;
+
+  public:
+    static constexpr detail::AllocatorType enum_value =
+        detail::AllocatorType::MappedFileAllocator;
+
+    struct options_t
+    {
+        const char* path;
+        // size in bytes to create the file with, if it does not exist
+        size_t initial_size;
+        // the maximum size in bytes that the file can be grown to. this
+        // amount of address space is reserved up front.
+        size_t max_size;
+        // where to try to map a newly created file. existing files prefer
+        // the address they were last mapped at.
+        void* hint = nullptr;
+    };
+
+    /// Open or create a file and map it into memory. Returns Corruption if the
+    /// file exists, is not empty, and was not created by a
+    /// mapped_file_allocator_t.
+    [[nodiscard]] static zl::res<mapped_file_allocator_t, AllocationStatusCode>
+    make(const options_t& options) noexcept;
+
+    [[nodiscard]] allocation_result_t alloc_bytes(size_t bytes,
+                                                  uint8_t alignment_exponent,
+                                                  size_t typehash) noexcept;
+
+    /// Always returns invalid argument
+    inline constexpr allocation_status_t
+    register_destruction_callback(destruction_callback_t, void*) noexcept
+    {
+        return AllocationStatusCode::InvalidArgument;
+    }
+
+    /// Block until all changes to the mapped memory are written to the file.
+    /// Not necessary for persistence, the OS will write back changes on its
+    /// own, but this guarantees the changes are on disk.
+    allocation_status_t sync() noexcept;
+
+    /// Mark an object inside the file as the root, so that it can be found
+    /// again with root() when the file is reopened.
+    template <typename T> inline void set_root(T& item) noexcept
+    {
+        auto* const item_bytes = reinterpret_cast<uint8_t*>(&item);
+        auto* const base = reinterpret_cast<uint8_t*>(m.header);
+        ALLO_VALID_ARG_ASSERT(item_bytes > base &&
+                              item_bytes + sizeof(T) <= base + m.mapped_bytes);
+        m.header->root = item_bytes - base;
+    }
+
+    /// Get the object previously passed to set_root(), possibly in a
+    /// previous run of the program. Returns an empty optional if no root
+    /// has been set.
+    template <typename T>
+    [[nodiscard]] inline zl::opt<T&> root() const noexcept
+    {
+        if (m.header->root == 0)
+            return {};
+        return *reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(m.header) +
+                                     m.header->root);
+    }
+
+    /// Whether the file was empty or did not exist when it was opened.
+    [[nodiscard]] inline constexpr bool is_fresh() const noexcept
+    {
+        return m.fresh;
+    }
+
+    /// Whether the file was mapped at a different address than it was the
+    /// last time it was opened, invalidating absolute pointers inside it.
+    [[nodiscard]] inline constexpr bool was_relocated() const noexcept
+    {
+        return m.relocated;
+    }
+
+    /// Number of bytes in the file which have been allocated, including the
+    /// file header.
+    [[nodiscard]] inline size_t bytes_used() const noexcept
+    {
+        return m.header->top;
+    }
+
+    [[nodiscard]] inline constexpr size_t file_size() const noexcept
+    {
+        return m.mapped_bytes;
+    }
+
+    ~mapped_file_allocator_t() noexcept;
+    // cannot be copied
+    mapped_file_allocator_t(const mapped_file_allocator_t& other) = delete;
+    mapped_file_allocator_t&
+    operator=(const mapped_file_allocator_t& other) = delete;
+    // can be move constructed
+    mapped_file_allocator_t(mapped_file_allocator_t&& other) noexcept;
+    // but not move assigned
+    mapped_file_allocator_t&
+    operator=(mapped_file_allocator_t&& other) = delete;
+
+    inline mapped_file_allocator_t(M&& members) noexcept : m(members)
+    {
+        m_type = enum_value;
+        ALLO_RECORD_STATS(record_block_acquired());
+    }
+
+  private:
+    /// Grow the file so that it is at least "bytes" long
+    [[nodiscard]] allocation_status_t grow(size_t bytes) noexcept;
+};
+} // namespace allo
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/mapped_file_allocator.h"
+#endif
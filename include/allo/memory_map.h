@@ -9,7 +9,9 @@
 // flAllocationType, DWORD flProtect);
 #elif defined(__linux__) || defined(__APPLE__)
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #else
 #error "Unsupported OS for memory_map.h"
@@ -37,6 +39,89 @@ extern "C"
         uint64_t has_value : 1;
     };
 
+#if defined(_WIN32)
+    typedef HANDLE mm_file_t;
+#else
+typedef int mm_file_t;
+#endif
+
+    struct mm_file_result_t
+    {
+        mm_file_t file;
+        /// Error-code, 0 on success. See mm_memory_map_result_t::code.
+        int64_t code;
+    };
+
+    /// Number of times each function in this file which makes a syscall has
+    /// been called by the whole process, including calls which failed. Each
+    /// one is (at least) one syscall.
+    struct mm_syscall_counts_t
+    {
+        uint64_t reserve_pages;
+        uint64_t commit_pages;
+        uint64_t memory_unmap;
+        uint64_t memory_remap;
+        uint64_t map_file;
+        /// mm_open_file() and mm_open_file_readonly()
+        uint64_t open_file;
+        uint64_t close_file;
+        uint64_t duplicate_file;
+        uint64_t file_size;
+        uint64_t resize_file;
+        uint64_t write_file;
+        uint64_t sync;
+        /// mm_create_anonymous_shared_memory() and mm_create_shared_memory()
+        uint64_t create_shared_memory;
+        uint64_t open_shared_memory;
+        uint64_t unlink_shared_memory;
+    };
+
+    /// The live counters. Use mm_get_syscall_counts() to read them.
+    inline mm_syscall_counts_t* mm_syscall_counters()
+    {
+        static mm_syscall_counts_t counters;
+        return &counters;
+    }
+
+    // only used in this header, and undefined at the end of it
+#if defined(_MSC_VER)
+#define ALLO_MM_COUNT_SYSCALL(name)                                            \
+    InterlockedIncrement64((volatile LONG64*)&mm_syscall_counters()->name)
+#define ALLO_MM_LOAD_SYSCALL_COUNT(name)                                       \
+    ((uint64_t)InterlockedOr64((volatile LONG64*)&mm_syscall_counters()->name, \
+                               0))
+#else
+#define ALLO_MM_COUNT_SYSCALL(name)                                            \
+    __atomic_fetch_add(&mm_syscall_counters()->name, 1, __ATOMIC_RELAXED)
+#define ALLO_MM_LOAD_SYSCALL_COUNT(name)                                       \
+    __atomic_load_n(&mm_syscall_counters()->name, __ATOMIC_RELAXED)
+#endif
+
+    /// A snapshot of the counters. Safe to call from any thread.
+    inline mm_syscall_counts_t mm_get_syscall_counts()
+    {
+        return (mm_syscall_counts_t){
+            .reserve_pages = ALLO_MM_LOAD_SYSCALL_COUNT(reserve_pages),
+            .commit_pages = ALLO_MM_LOAD_SYSCALL_COUNT(commit_pages),
+            .memory_unmap = ALLO_MM_LOAD_SYSCALL_COUNT(memory_unmap),
+            .memory_remap = ALLO_MM_LOAD_SYSCALL_COUNT(memory_remap),
+            .map_file = ALLO_MM_LOAD_SYSCALL_COUNT(map_file),
+            .open_file = ALLO_MM_LOAD_SYSCALL_COUNT(open_file),
+            .close_file = ALLO_MM_LOAD_SYSCALL_COUNT(close_file),
+            .duplicate_file = ALLO_MM_LOAD_SYSCALL_COUNT(duplicate_file),
+            .file_size = ALLO_MM_LOAD_SYSCALL_COUNT(file_size),
+            .resize_file = ALLO_MM_LOAD_SYSCALL_COUNT(resize_file),
+            .write_file = ALLO_MM_LOAD_SYSCALL_COUNT(write_file),
+            .sync = ALLO_MM_LOAD_SYSCALL_COUNT(sync),
+            .create_shared_memory =
+                ALLO_MM_LOAD_SYSCALL_COUNT(create_shared_memory),
+            .open_shared_memory =
+                ALLO_MM_LOAD_SYSCALL_COUNT(open_shared_memory),
+            .unlink_shared_memory =
+                ALLO_MM_LOAD_SYSCALL_COUNT(unlink_shared_memory),
+        };
+    }
+
     /// Get the system's memory page size in bytes.
     /// Can fail on linux, in which case the returned optional uint has its
     /// has_value bit set to 0.
@@ -76,6 +161,7 @@ extern "C"
             return (mm_memory_map_result_t){.code = 254};
         }
         size_t size = num_pages * result.value;
+        ALLO_MM_COUNT_SYSCALL(reserve_pages);
 #if defined(_WIN32)
         mm_memory_map_result_t res = (mm_memory_map_result_t){
             .data = VirtualAlloc(address_hint, size, MEM_RESERVE, 0),
@@ -117,6 +203,7 @@ extern "C"
         }
 
         size_t size = num_pages * result.value;
+        ALLO_MM_COUNT_SYSCALL(commit_pages);
 #if defined(_WIN32)
         int64_t err = 0;
         if (!VirtualAlloc(address, size, MEM_RESERVE | MEM_COMMIT, 0)) {
@@ -139,6 +226,7 @@ extern "C"
     /// Unmap pages starting at address and continuing for "size" bytes.
     inline int64_t mm_memory_unmap(void* address, size_t size)
     {
+        ALLO_MM_COUNT_SYSCALL(memory_unmap);
 #if defined(_WIN32)
         int64_t err = 0;
         if (!VirtualFree(address, size, MEM_DECOMMIT | MEM_RELEASE)) {
@@ -154,28 +242,434 @@ extern "C"
 #endif
     }
 
-    /*
-    inline int
-    mm_memory_map_resize(const mm_memory_map_resize_options_t *options)
+    /// Open a file for reading and writing so that it can be passed to
+    /// mm_map_file(). The file is created (empty) if it does not exist.
+    inline mm_file_result_t mm_open_file(const char* path)
+    {
+        ALLO_MM_COUNT_SYSCALL(open_file);
+#if defined(_WIN32)
+        mm_file_result_t res = (mm_file_result_t){
+            .file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL),
+            .code = 0,
+        };
+        if (res.file == INVALID_HANDLE_VALUE) {
+            res.code = GetLastError();
+            assert(res.code != 0);
+        }
+        return res;
+#else
+    mm_file_result_t res = (mm_file_result_t){
+        .file = open(path, O_RDWR | O_CREAT, 0644),
+        .code = 0,
+    };
+    if (res.file < 0) {
+        res.code = errno;
+    }
+    return res;
+#endif
+    }
+
+    /// Open an existing file for reading only, so that it can be passed to
+    /// mm_map_file_readonly(). Fails if the file does not exist.
+    inline mm_file_result_t mm_open_file_readonly(const char* path)
+    {
+        ALLO_MM_COUNT_SYSCALL(open_file);
+#if defined(_WIN32)
+        mm_file_result_t res = (mm_file_result_t){
+            .file = CreateFileA(path, GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL),
+            .code = 0,
+        };
+        if (res.file == INVALID_HANDLE_VALUE) {
+            res.code = GetLastError();
+            assert(res.code != 0);
+        }
+        return res;
+#else
+    mm_file_result_t res = (mm_file_result_t){
+        .file = open(path, O_RDONLY),
+        .code = 0,
+    };
+    if (res.file < 0) {
+        res.code = errno;
+    }
+    return res;
+#endif
+    }
+
+    /// Close a file opened with mm_open_file(). Mappings of the file remain
+    /// valid until they are unmapped. Returns 0 on success.
+    inline int64_t mm_close_file(mm_file_t file)
+    {
+        ALLO_MM_COUNT_SYSCALL(close_file);
+#if defined(_WIN32)
+        if (!CloseHandle(file)) {
+            return GetLastError();
+        }
+        return 0;
+#else
+    if (close(file) != 0) {
+        return errno;
+    }
+    return 0;
+#endif
+    }
+
+    /// Create a new file which refers to the same thing as an existing one,
+    /// and which must be closed separately.
+    inline mm_file_result_t mm_duplicate_file(mm_file_t file)
+    {
+        ALLO_MM_COUNT_SYSCALL(duplicate_file);
+#if defined(_WIN32)
+        mm_file_result_t res =
+            (mm_file_result_t){.file = INVALID_HANDLE_VALUE, .code = 0};
+        if (!DuplicateHandle(GetCurrentProcess(), file, GetCurrentProcess(),
+                             &res.file, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+            res.code = GetLastError();
+        }
+        return res;
+#else
+    mm_file_result_t res = (mm_file_result_t){.file = dup(file), .code = 0};
+    if (res.file < 0) {
+        res.code = errno;
+    }
+    return res;
+#endif
+    }
+
+    /// Write the size of the file in bytes to size_out. Returns 0 on success,
+    /// in which case size_out is written to.
+    inline int64_t mm_file_size(mm_file_t file, uint64_t* size_out)
+    {
+        ALLO_MM_COUNT_SYSCALL(file_size);
+#if defined(_WIN32)
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            return GetLastError();
+        }
+        *size_out = (uint64_t)size.QuadPart;
+        return 0;
+#else
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        return errno;
+    }
+    *size_out = (uint64_t)info.st_size;
+    return 0;
+#endif
+    }
+
+    /// Grow or shrink a file to exactly "bytes" bytes. New bytes are zeroed.
+    /// Returns 0 on success.
+    inline int64_t mm_resize_file(mm_file_t file, uint64_t bytes)
+    {
+        ALLO_MM_COUNT_SYSCALL(resize_file);
+#if defined(_WIN32)
+        LARGE_INTEGER size;
+        size.QuadPart = (LONGLONG)bytes;
+        if (!SetFilePointerEx(file, size, NULL, FILE_BEGIN) ||
+            !SetEndOfFile(file)) {
+            return GetLastError();
+        }
+        return 0;
+#else
+    if (ftruncate(file, (off_t)bytes) != 0) {
+        return errno;
+    }
+    return 0;
+#endif
+    }
+
+    /// Write "bytes" bytes to a file, starting at the file's current position
+    /// and advancing it. The position starts at the beginning of the file when
+    /// it is opened. Returns 0 once everything has been written.
+    inline int64_t mm_write_file(mm_file_t file, const void* data,
+                                 size_t bytes)
+    {
+        ALLO_MM_COUNT_SYSCALL(write_file);
+#if defined(_WIN32)
+        const char* head = (const char*)data;
+        while (bytes > 0) {
+            DWORD written = 0;
+            const DWORD chunk =
+                bytes > (size_t)0x40000000 ? (DWORD)0x40000000 : (DWORD)bytes;
+            if (!WriteFile(file, head, chunk, &written, NULL)) {
+                return GetLastError();
+            }
+            head += written;
+            bytes -= written;
+        }
+        return 0;
+#else
+    const char* head = (const char*)data;
+    while (bytes > 0) {
+        const ssize_t written = write(file, head, bytes);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        head += written;
+        bytes -= (size_t)written;
+    }
+    return 0;
+#endif
+    }
+
+    /// Map the first "bytes" bytes of a file into memory, readable and
+    /// writable, such that writes to the memory are written back to the file.
+    /// The file must be at least "bytes" long.
+    /// Address hint: like mm_reserve_pages(), a hint for where to place the
+    /// mapping. May be nullptr.
+    /// Fixed: if nonzero, the address hint is not a hint: the mapping is placed
+    /// exactly at that address, replacing any mapping that was there. Intended
+    /// for mapping a file over the top of pages obtained from
+    /// mm_reserve_pages(). Not supported on windows, where a nonzero "fixed"
+    /// instead causes an error to be returned if the mapping could not be
+    /// placed at the address hint.
+    inline mm_memory_map_result_t mm_map_file(void* address_hint,
+                                              mm_file_t file, size_t bytes,
+                                              int fixed)
+    {
+        ALLO_MM_COUNT_SYSCALL(map_file);
+#if defined(_WIN32)
+        mm_memory_map_result_t res =
+            (mm_memory_map_result_t){.data = NULL, .bytes = bytes, .code = 0};
+        HANDLE mapping =
+            CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                               (DWORD)((uint64_t)bytes >> 32),
+                               (DWORD)((uint64_t)bytes & 0xFFFFFFFF), NULL);
+        if (mapping == NULL) {
+            res.code = GetLastError();
+            return res;
+        }
+        res.data = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes,
+                                   address_hint);
+        if (res.data == NULL) {
+            res.code = GetLastError();
+        } else if (fixed && res.data != address_hint) {
+            UnmapViewOfFile(res.data);
+            res.data = NULL;
+            res.code = ERROR_INVALID_ADDRESS;
+        }
+        // the view holds its own reference to the mapping object
+        CloseHandle(mapping);
+        return res;
+#else
+    mm_memory_map_result_t res = (mm_memory_map_result_t){
+        .data = mmap(address_hint, bytes, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | (fixed ? MAP_FIXED : 0), file, 0),
+        .bytes = bytes,
+        .code = 0,
+    };
+    if (res.data == MAP_FAILED) {
+        res.code = errno;
+        res.data = NULL;
+    }
+    return res;
+#endif
+    }
+
+    /// Map the first "bytes" bytes of a file into memory, readable only. The
+    /// file may have been opened with mm_open_file_readonly(), and must be at
+    /// least "bytes" long.
+    inline mm_memory_map_result_t mm_map_file_readonly(mm_file_t file,
+                                                       size_t bytes)
+    {
+        ALLO_MM_COUNT_SYSCALL(map_file);
+#if defined(_WIN32)
+        mm_memory_map_result_t res =
+            (mm_memory_map_result_t){.data = NULL, .bytes = bytes, .code = 0};
+        HANDLE mapping =
+            CreateFileMappingA(file, NULL, PAGE_READONLY,
+                               (DWORD)((uint64_t)bytes >> 32),
+                               (DWORD)((uint64_t)bytes & 0xFFFFFFFF), NULL);
+        if (mapping == NULL) {
+            res.code = GetLastError();
+            return res;
+        }
+        res.data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, bytes);
+        if (res.data == NULL) {
+            res.code = GetLastError();
+        }
+        // the view holds its own reference to the mapping object
+        CloseHandle(mapping);
+        return res;
+#else
+    mm_memory_map_result_t res = (mm_memory_map_result_t){
+        .data = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, file, 0),
+        .bytes = bytes,
+        .code = 0,
+    };
+    if (res.data == MAP_FAILED) {
+        res.code = errno;
+        res.data = NULL;
+    }
+    return res;
+#endif
+    }
+
+    /// Synchronously write back any modified pages in the given range of a
+    /// mapping created by mm_map_file(). Address must be page aligned.
+    /// Returns 0 on success.
+    inline int64_t mm_sync(void* address, size_t bytes)
+    {
+        ALLO_MM_COUNT_SYSCALL(sync);
+#if defined(_WIN32)
+        if (!FlushViewOfFile(address, bytes)) {
+            return GetLastError();
+        }
+        return 0;
+#else
+    if (msync(address, bytes, MS_SYNC) != 0) {
+        return errno;
+    }
+    return 0;
+#endif
+    }
+
+    /// Create a block of shared memory with no name in the filesystem, which
+    /// starts out empty. Size it with mm_resize_file() and map it with
+    /// mm_map_file(). Other processes can map the same memory if they are
+    /// given the file (through fork() or a unix socket). The memory is freed
+    /// once every file and mapping referring to it is closed.
+    /// Name: only used for debugging, and may appear in /proc.
+    /// Uses memfd_create on linux, and shm_open followed immediately by
+    /// shm_unlink on macos. Not supported on windows.
+    inline mm_file_result_t mm_create_anonymous_shared_memory(const char* name)
+    {
+        ALLO_MM_COUNT_SYSCALL(create_shared_memory);
+#if defined(_WIN32)
+        (void)name;
+        return (mm_file_result_t){.file = INVALID_HANDLE_VALUE,
+                                  .code = ERROR_NOT_SUPPORTED};
+#elif defined(__linux__)
+    mm_file_result_t res = (mm_file_result_t){
+        .file = memfd_create(name, 0),
+        .code = 0,
+    };
+    if (res.file < 0) {
+        res.code = errno;
+    }
+    return res;
+#else
+    mm_file_result_t res =
+        (mm_file_result_t){.file = shm_open(name, O_RDWR | O_CREAT | O_EXCL,
+                                            0600),
+                           .code = 0};
+    if (res.file < 0) {
+        res.code = errno;
+        return res;
+    }
+    shm_unlink(name);
+    return res;
+#endif
+    }
+
+    /// Create a new block of shared memory with the given name, which starts
+    /// out empty. Fails with EEXIST if shared memory with that name already
+    /// exists, so that the caller never initializes memory which another
+    /// process is using. Names should begin with a "/". Not supported on
+    /// windows.
+    inline mm_file_result_t mm_create_shared_memory(const char* name)
+    {
+        ALLO_MM_COUNT_SYSCALL(create_shared_memory);
+#if defined(_WIN32)
+        (void)name;
+        return (mm_file_result_t){.file = INVALID_HANDLE_VALUE,
+                                  .code = ERROR_NOT_SUPPORTED};
+#else
+    mm_file_result_t res = (mm_file_result_t){
+        .file = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600),
+        .code = 0,
+    };
+    if (res.file < 0) {
+        res.code = errno;
+    }
+    return res;
+#endif
+    }
+
+    /// Open a block of shared memory by name, so that unrelated processes can
+    /// map the same memory. If create is nonzero, the shared memory is
+    /// created if it does not exist already. Names should begin with a "/".
+    /// The memory exists until mm_unlink_shared_memory() is called and
+    /// every file and mapping referring to it is closed. Not supported on
+    /// windows.
+    inline mm_file_result_t mm_open_shared_memory(const char* name, int create)
+    {
+        ALLO_MM_COUNT_SYSCALL(open_shared_memory);
+#if defined(_WIN32)
+        (void)name;
+        (void)create;
+        return (mm_file_result_t){.file = INVALID_HANDLE_VALUE,
+                                  .code = ERROR_NOT_SUPPORTED};
+#else
+    mm_file_result_t res = (mm_file_result_t){
+        .file = shm_open(name, O_RDWR | (create ? O_CREAT : 0), 0600),
+        .code = 0,
+    };
+    if (res.file < 0) {
+        res.code = errno;
+    }
+    return res;
+#endif
+    }
+
+    /// Remove the name of some shared memory created with
+    /// mm_create_shared_memory() or mm_open_shared_memory(). Returns 0 on
+    /// success.
+    inline int64_t mm_unlink_shared_memory(const char* name)
+    {
+        ALLO_MM_COUNT_SYSCALL(unlink_shared_memory);
+#if defined(_WIN32)
+        (void)name;
+        return ERROR_NOT_SUPPORTED;
+#else
+    if (shm_unlink(name) != 0) {
+        return errno;
+    }
+    return 0;
+#endif
+    }
+
+    /// Grow or shrink a mapping created by mm_reserve_pages() (and committed
+    /// with mm_commit_pages()) without moving it. Any new pages are readable
+    /// and writable. Fails if the pages after the mapping are already in use.
+    /// Returns 0 on success, otherwise an errcode.
+    /// Only supported on linux.
+    inline int64_t mm_memory_remap(void* address, size_t old_size,
+                                   size_t new_size)
     {
 #if defined(_WIN32)
-#error "currently unsupported"
         // NOTE: use
         // https://stackoverflow.com/questions/17197615/no-mremap-for-windows
-        // also see:
-        //
-https://learn.microsoft.com/en-us/windows/win32/api/memoryapi/nf-memoryapi-mapuserphysicalpages
-#else
-    void *res =
-        mremap(options->address, options->old_size, options->new_size, 0);
+        (void)address;
+        (void)old_size;
+        (void)new_size;
+        return ERROR_NOT_SUPPORTED;
+#elif defined(__linux__)
+    ALLO_MM_COUNT_SYSCALL(memory_remap);
+    void* res = mremap(address, old_size, new_size, 0);
     if (res == MAP_FAILED) {
         return errno;
     }
-    assert(res == options->address);
+    assert(res == address);
     return 0;
+#else
+    (void)address;
+    (void)old_size;
+    (void)new_size;
+    return ENOTSUP;
 #endif
     }
-    */
+
+#undef ALLO_MM_COUNT_SYSCALL
+#undef ALLO_MM_LOAD_SYSCALL_COUNT
 
 #ifdef __cplusplus
 }
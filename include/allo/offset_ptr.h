@@ -0,0 +1,126 @@
+#pragma once
+#include "allo/detail/asserts.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace allo {
+
+/// A pointer which stores the distance from itself to the thing it points at,
+/// instead of an absolute address. As long as an offset_ptr and its pointee
+/// live in the same block of memory, the block can be mapped at a different
+/// address (for example, a file mapped by mapped_file_allocator_t in a later
+/// run of the program, or a shared memory region mapped by another process)
+/// and the offset_ptr will still point at the right thing.
+///
+/// Because of this, copying or moving an offset_ptr recalculates the offset
+/// for its new location, so it is not trivially copyable. It can be stored
+/// in structures which move their contents with constructors, such as list_t
+/// and segmented_stack_t, but not those which require trivially copyable
+/// contents, such as collection_t.
+///
+/// NOTE: allo::realloc() with a c_allocator_t uses the C realloc function,
+/// which copies bytes without calling constructors. A list_t of offset_ptrs
+/// should be given some other heap allocator as its parent.
+template <typename T> class offset_ptr
+{
+  public:
+    using type = T;
+
+    inline constexpr offset_ptr() noexcept = default;
+
+    inline offset_ptr(std::nullptr_t) noexcept {}
+
+    inline offset_ptr(T* pointer) noexcept { set(pointer); }
+
+    inline offset_ptr(T& item) noexcept { set(std::addressof(item)); }
+
+    inline offset_ptr(const offset_ptr& other) noexcept { set(other.get()); }
+
+    inline offset_ptr& operator=(const offset_ptr& other) noexcept
+    {
+        set(other.get());
+        return *this;
+    }
+
+    inline offset_ptr& operator=(T* pointer) noexcept
+    {
+        set(pointer);
+        return *this;
+    }
+
+    inline offset_ptr& operator=(std::nullptr_t) noexcept
+    {
+        m.offset = null_offset;
+        return *this;
+    }
+
+    [[nodiscard]] inline T* get() const noexcept
+    {
+        if (m.offset == null_offset)
+            return nullptr;
+        return reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) +
+                                    m.offset);
+    }
+
+    [[nodiscard]] inline T& operator*() const noexcept
+    {
+        ALLO_UNCHECKED_ASSERT(m.offset != null_offset);
+        return *get();
+    }
+
+    [[nodiscard]] inline T* operator->() const noexcept
+    {
+        ALLO_UNCHECKED_ASSERT(m.offset != null_offset);
+        return get();
+    }
+
+    [[nodiscard]] inline explicit operator bool() const noexcept
+    {
+        return m.offset != null_offset;
+    }
+
+    [[nodiscard]] inline bool operator==(const offset_ptr& other) const noexcept
+    {
+        return get() == other.get();
+    }
+
+    [[nodiscard]] inline bool operator!=(const offset_ptr& other) const noexcept
+    {
+        return get() != other.get();
+    }
+
+    /// The raw offset from this offset_ptr to the pointee, in bytes
+    [[nodiscard]] inline constexpr intptr_t offset() const noexcept
+    {
+        return m.offset;
+    }
+
+  private:
+    // an offset of zero would be an offset_ptr pointing at itself, which is
+    // valid. an offset of one would require the pointee to overlap with the
+    // offset_ptr, which is not, so that represents null.
+    static constexpr intptr_t null_offset = 1;
+
+    inline void set(T* pointer) noexcept
+    {
+        if (pointer == nullptr) {
+            m.offset = null_offset;
+            return;
+        }
+        m.offset = reinterpret_cast<intptr_t>(pointer) -
+                   reinterpret_cast<intptr_t>(this);
+        ALLO_INTERNAL_ASSERT(m.offset != null_offset);
+    }
+
+    struct M
+    {
+        intptr_t offset = null_offset;
+    } m;
+};
+
+static_assert(sizeof(offset_ptr<int>) == sizeof(int*));
+static_assert(std::is_nothrow_copy_constructible_v<offset_ptr<int>>);
+static_assert(std::is_nothrow_destructible_v<offset_ptr<int>>);
+} // namespace allo
@@ -53,6 +53,7 @@ class reservation_allocator_t : public detail::abstract_heap_allocator_t
     alloc_bytes(size_t /*bytes*/, uint8_t /*alignment_exponent*/, // NOLINT
                 size_t /*typehash*/) noexcept
     {
+        ALLO_RECORD_STATS(record_failed_alloc());
         return AllocationStatusCode::OOM;
     }
 
@@ -95,6 +96,9 @@ class reservation_allocator_t : public detail::abstract_heap_allocator_t
     inline reservation_allocator_t(M&& members) noexcept : m(members)
     {
         m_type = enum_value;
+        // the committed memory is counted as this allocator's one allocation
+        ALLO_RECORD_STATS(record_block_acquired());
+        ALLO_RECORD_STATS(record_alloc(m.mem.size(), m.mem.size()));
     }
 };
 } // namespace allo
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "allo/detail/asserts.h"
+#include "allo/detail/cache_line_size.h"
+#include "allo/memory_map.h"
+#include "allo/status.h"
+#include <atomic>
+
+namespace allo {
+
+/// A ring buffer of bytes whose memory is mapped twice in a row, so that the
+/// byte after the last byte of the buffer is the first byte of the buffer
+/// again. Because of this, any span of the buffer up to its capacity is
+/// contiguous in memory even if it wraps around, and can be handed to
+/// functions which expect a single bytes_t (parsers, read(), write(), memcpy)
+/// without first copying the wrapped part somewhere else.
+///
+/// Data is added by the producer with write_span() and commit_write(), and
+/// removed by the consumer with read_span() and commit_read(). One producer
+/// thread and one consumer thread may use the ring buffer at the same time,
+/// without locking.
+///
+/// The capacity is always a multiple of the page size.
+///
+/// NOTE: not supported on windows.
+class ring_buffer_t
+{
+  private:
+    struct M
+    {
+        uint8_t* memory;
+        size_t capacity;
+        mm_file_t file;
+        // total bytes ever written and read. position in the buffer is the
+        // cursor modulo capacity. each is on its own cache line, so the
+        // producer and consumer do not invalidate each other's line on every
+        // commit
+        alignas(detail::cache_line_size) std::atomic<size_t> write_cursor;
+        alignas(detail::cache_line_size) std::atomic<size_t> read_cursor;
+    } m;
+
+  public:
+    /// Create a ring buffer which can hold at least minimum_capacity bytes.
+    /// May return OsErr or OOM.
+    [[nodiscard]] static zl::res<ring_buffer_t, AllocationStatusCode>
+    make(size_t minimum_capacity) noexcept;
+
+    /// Get all of the free space in the ring buffer, starting at the write
+    /// cursor. Nothing is added to the ring buffer until commit_write() is
+    /// called. Only the producer should call this.
+    [[nodiscard]] inline bytes_t write_span() noexcept
+    {
+        const size_t write = m.write_cursor.load(std::memory_order_relaxed);
+        const size_t read = m.read_cursor.load(std::memory_order_acquire);
+        return zl::raw_slice(*(m.memory + (write % m.capacity)),
+                             m.capacity - (write - read));
+    }
+
+    /// Mark "bytes" bytes at the start of write_span() as readable by the
+    /// consumer.
+    inline void commit_write(size_t bytes) noexcept
+    {
+        const size_t write = m.write_cursor.load(std::memory_order_relaxed);
+        ALLO_VALID_ARG_ASSERT(
+            bytes <= m.capacity - (write - m.read_cursor.load(
+                                               std::memory_order_acquire)));
+        m.write_cursor.store(write + bytes, std::memory_order_release);
+    }
+
+    /// Get all of the committed data in the ring buffer, starting at the read
+    /// cursor. Only the consumer should call this.
+    [[nodiscard]] inline bytes_t read_span() noexcept
+    {
+        const size_t read = m.read_cursor.load(std::memory_order_relaxed);
+        const size_t write = m.write_cursor.load(std::memory_order_acquire);
+        return zl::raw_slice(*(m.memory + (read % m.capacity)), write - read);
+    }
+
+    /// Mark "bytes" bytes at the start of read_span() as consumed, so that the
+    /// producer can write over them.
+    inline void commit_read(size_t bytes) noexcept
+    {
+        const size_t read = m.read_cursor.load(std::memory_order_relaxed);
+        ALLO_VALID_ARG_ASSERT(
+            bytes <= m.write_cursor.load(std::memory_order_acquire) - read);
+        m.read_cursor.store(read + bytes, std::memory_order_release);
+    }
+
+    /// Number of bytes which have been written and not yet read.
+    [[nodiscard]] inline size_t size() const noexcept
+    {
+        return m.write_cursor.load(std::memory_order_acquire) -
+               m.read_cursor.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] inline constexpr size_t capacity() const noexcept
+    {
+        return m.capacity;
+    }
+
+    ~ring_buffer_t() noexcept;
+    // cannot be copied
+    ring_buffer_t(const ring_buffer_t& other) = delete;
+    ring_buffer_t& operator=(const ring_buffer_t& other) = delete;
+    // can be move constructed, if no other threads are using it
+    ring_buffer_t(ring_buffer_t&& other) noexcept;
+    // but not move assigned
+    ring_buffer_t& operator=(ring_buffer_t&& other) = delete;
+
+  private:
+    inline ring_buffer_t(uint8_t* memory, size_t capacity,
+                         mm_file_t file) noexcept
+        : m{
+              .memory = memory,
+              .capacity = capacity,
+              .file = file,
+              .write_cursor = 0,
+              .read_cursor = 0,
+          }
+    {
+    }
+};
+} // namespace allo
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/ring_buffer.h"
+#endif
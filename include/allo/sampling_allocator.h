@@ -0,0 +1,79 @@
+#pragma once
+
+#include "allo/detail/abstracts.h"
+#include "allo/heap_profiler.h"
+#include "allo/structures/any_allocator.h"
+
+namespace allo {
+
+/// Wraps another allocator and reports a random sample of its allocations to a
+/// heap_profiler_t, along with the typehash and a backtrace of the caller.
+/// Otherwise behaves exactly like the wrapped allocator.
+///
+/// A successful remap is reported as a free of the old allocation followed by
+/// an allocation of the new size, since the memory may have moved.
+///
+/// The wrapped allocator may be of any kind, but remapping and freeing will
+/// return InvalidArgument if it cannot free.
+class sampling_allocator_t : public detail::abstract_heap_allocator_t
+{
+  private:
+    struct M
+    {
+        any_allocator_t parent;
+        heap_profiler_t* profiler;
+    } m;
+
+  public:
+    static constexpr detail::AllocatorType enum_value =
+        detail::AllocatorType::SamplingAllocator;
+
+    /// The profiler must outlive the sampling allocator. Many sampling
+    /// allocators, on many threads, may share one profiler.
+    [[nodiscard]] inline static sampling_allocator_t
+    make(any_allocator_t parent, heap_profiler_t& profiler) noexcept
+    {
+        ALLO_VALID_ARG_ASSERT(!parent.is_null());
+        return M{
+            .parent = parent,
+            .profiler = &profiler,
+        };
+    }
+
+    [[nodiscard]] allocation_result_t alloc_bytes(size_t bytes,
+                                                  uint8_t alignment_exponent,
+                                                  size_t typehash) noexcept;
+
+    [[nodiscard]] allocation_result_t remap_bytes(bytes_t mem,
+                                                  size_t old_typehash,
+                                                  size_t new_size,
+                                                  size_t new_typehash) noexcept;
+
+    allocation_status_t free_bytes(bytes_t mem, size_t typehash) noexcept;
+
+    [[nodiscard]] allocation_status_t
+    free_status(bytes_t mem, size_t typehash) const noexcept;
+
+    allocation_status_t
+    register_destruction_callback(destruction_callback_t callback,
+                                  void* user_data) noexcept;
+
+    ~sampling_allocator_t() noexcept = default;
+    // cannot be copied
+    sampling_allocator_t(const sampling_allocator_t& other) = delete;
+    sampling_allocator_t& operator=(const sampling_allocator_t& other) = delete;
+    // can be move constructed
+    sampling_allocator_t(sampling_allocator_t&& other) noexcept;
+    // but not move assigned
+    sampling_allocator_t& operator=(sampling_allocator_t&& other) = delete;
+
+    inline sampling_allocator_t(M&& members) noexcept : m(members)
+    {
+        m_type = enum_value;
+    }
+};
+} // namespace allo
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/sampling_allocator.h"
+#endif
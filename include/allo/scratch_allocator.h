@@ -68,6 +68,7 @@ class scratch_allocator_t : public detail::abstract_allocator_t
     scratch_allocator_t(M&& members) noexcept : m(members)
     {
         m_type = enum_value;
+        ALLO_RECORD_STATS(record_block_acquired());
     }
 
   private:
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "allo/detail/abstracts.h"
+#include "allo/detail/asserts.h"
+#include "allo/detail/cache_line_size.h"
+#include "allo/memory_map.h"
+#include <atomic>
+
+namespace allo {
+
+/// A block allocator whose blocks and free list live inside of a region of
+/// shared memory, so that several processes can allocate from and free to
+/// the same pool of blocks at once. A producer process can allocate directly
+/// into memory which a consumer process reads, with nothing copied or
+/// serialized in between.
+///
+/// The same shared memory is usually mapped at a different address in each
+/// process, so pointers should not be sent between processes. Instead, use
+/// offset_of() to convert an allocation into an offset from the start of
+/// the shared memory, send that, and use resolve() in the other process to
+/// turn it back into an allocation. offset_ptr<T> can also be stored inside
+/// the shared memory.
+///
+/// All operations are threadsafe and lock-free, both between threads and
+/// between processes. The allocator cannot grow, and allocations are untyped.
+/// Destruction callbacks cannot be registered, since function pointers are
+/// not meaningful in other processes.
+///
+/// NOTE: not supported on windows.
+class shared_block_allocator_t
+    : public detail::abstract_threadsafe_heap_allocator_t
+{
+  public:
+    /// Stored at the start of the shared memory. Every process which maps the
+    /// memory uses the same header.
+    struct shared_header_t
+    {
+        static constexpr uint64_t static_magic = 0x4B4C424853414C4CULL;
+        static constexpr uint64_t current_version = 1;
+        uint64_t magic;
+        uint64_t version;
+        uint64_t blocksize;
+        uint64_t total_blocks;
+        // offset from the start of the shared memory to the first block
+        uint64_t first_block_offset;
+        uint64_t alignment_exponent;
+        // upper 32 bits: counter incremented each time the head changes, to
+        // avoid ABA. lower 32 bits: index of the head block plus one, or zero
+        // if the free list is empty.
+        alignas(detail::cache_line_size) std::atomic<uint64_t> free_list_head;
+        std::atomic<uint64_t> blocks_free;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                      std::atomic<uint32_t>::is_always_lock_free,
+                  "Atomics must be lock free to be shared between processes");
+
+  private:
+    struct M
+    {
+        shared_header_t* header;
+        size_t mapped_bytes;
+        mm_file_t file;
+    } m;
+
+  public:
+    static constexpr detail::AllocatorType enum_value =
+        detail::AllocatorType::SharedBlockAllocator;
+
+    struct options_t
+    {
+        /// If null, the shared memory is anonymous and can only be shared by
+        /// passing file() to other processes (for example by forking). If not
+        /// null, the shared memory is given this name and can be opened by any
+        /// process with attach(). In that case, the caller is responsible for
+        /// eventually calling mm_unlink_shared_memory() with the name.
+        const char* name = nullptr;
+        size_t blocksize;
+        size_t num_blocks;
+    };
+
+    /// Create new shared memory and initialize all of its blocks as free.
+    /// Returns InvalidArgument if options.name is already taken by some other
+    /// shared memory. Use attach() to map that memory instead.
+    [[nodiscard]] static zl::res<shared_block_allocator_t, AllocationStatusCode>
+    make(const options_t& options) noexcept;
+
+    /// Map shared memory which was created by another
+    /// shared_block_allocator_t, possibly in another process. The file is
+    /// duplicated, so the caller still owns the file passed in. Returns
+    /// Corruption if the shared memory was not created by make().
+    [[nodiscard]] static zl::res<shared_block_allocator_t, AllocationStatusCode>
+    attach(mm_file_t file) noexcept;
+
+    /// Map named shared memory which was created by make() in this process or
+    /// another.
+    [[nodiscard]] static zl::res<shared_block_allocator_t, AllocationStatusCode>
+    attach(const char* name) noexcept;
+
+    [[nodiscard]] allocation_result_t alloc_bytes(size_t bytes,
+                                                  uint8_t alignment_exponent,
+                                                  size_t typehash) noexcept;
+
+    [[nodiscard]] allocation_result_t remap_bytes(bytes_t mem,
+                                                  size_t old_typehash,
+                                                  size_t new_size,
+                                                  size_t new_typehash) noexcept;
+
+    /// Identical to remap_bytes, since allocations never move
+    [[nodiscard]] allocation_result_t
+    threadsafe_realloc_bytes(bytes_t mem, size_t old_typehash, size_t new_size,
+                             size_t new_typehash) noexcept;
+
+    allocation_status_t free_bytes(bytes_t mem, size_t typehash) noexcept;
+
+    [[nodiscard]] allocation_status_t
+    free_status(bytes_t mem, size_t typehash) const noexcept;
+
+    /// Always returns invalid argument
+    inline constexpr allocation_status_t
+    register_destruction_callback(destruction_callback_t, void*) noexcept
+    {
+        return AllocationStatusCode::InvalidArgument;
+    }
+
+    /// Get the offset of some memory from the start of the shared memory.
+    /// The offset means the same thing in every process which has the shared
+    /// memory mapped.
+    [[nodiscard]] inline uint64_t offset_of(const void* item) const noexcept
+    {
+        const auto* const bytes = static_cast<const uint8_t*>(item);
+        const auto* const base = reinterpret_cast<const uint8_t*>(m.header);
+        ALLO_VALID_ARG_ASSERT(bytes >= base && bytes < base + m.mapped_bytes);
+        return bytes - base;
+    }
+
+    /// Turn an offset created by offset_of(), possibly in another process,
+    /// back into memory in this process.
+    [[nodiscard]] inline bytes_t resolve(uint64_t offset,
+                                         size_t bytes) const noexcept
+    {
+        ALLO_VALID_ARG_ASSERT(offset + bytes <= m.mapped_bytes);
+        return zl::raw_slice(*(reinterpret_cast<uint8_t*>(m.header) + offset),
+                             bytes);
+    }
+
+    /// Typed version of resolve()
+    template <typename T>
+    [[nodiscard]] inline T& resolve(uint64_t offset) const noexcept
+    {
+        return *reinterpret_cast<T*>(resolve(offset, sizeof(T)).data());
+    }
+
+    /// The file which refers to the shared memory. Can be passed to another
+    /// process and used with attach()
+    [[nodiscard]] inline constexpr mm_file_t file() const noexcept
+    {
+        return m.file;
+    }
+
+    [[nodiscard]] inline size_t blocksize() const noexcept
+    {
+        return m.header->blocksize;
+    }
+
+    /// Number of free blocks, across all processes. Only a snapshot: it may
+    /// be out of date by the time it is returned.
+    [[nodiscard]] inline size_t blocks_free() const noexcept
+    {
+        return m.header->blocks_free.load(std::memory_order_relaxed);
+    }
+
+    ~shared_block_allocator_t() noexcept;
+    // cannot be copied
+    shared_block_allocator_t(const shared_block_allocator_t& other) = delete;
+    shared_block_allocator_t&
+    operator=(const shared_block_allocator_t& other) = delete;
+    // can be move constructed
+    shared_block_allocator_t(shared_block_allocator_t&& other) noexcept;
+    // but not move assigned
+    shared_block_allocator_t&
+    operator=(shared_block_allocator_t&& other) = delete;
+
+    inline shared_block_allocator_t(M&& members) noexcept : m(members)
+    {
+        m_type = enum_value;
+        ALLO_RECORD_STATS(record_block_acquired());
+    }
+
+  private:
+    static constexpr size_t minimum_blocksize = sizeof(std::atomic<uint32_t>);
+
+    [[nodiscard]] static zl::res<shared_block_allocator_t, AllocationStatusCode>
+    attach_inner(mm_file_t file) noexcept;
+
+    [[nodiscard]] uint8_t* block_at(uint32_t index) const noexcept;
+
+    [[nodiscard]] bool is_block(bytes_t mem) const noexcept;
+};
+} // namespace allo
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/shared_block_allocator.h"
+#endif
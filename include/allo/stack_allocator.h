@@ -22,6 +22,9 @@ class stack_allocator_t : public detail::abstract_stack_allocator_t
         destruction_callback_entry_t* last_callback = nullptr;
         const size_t original_size;
         any_allocator_t parent;
+        // the last block which was emptied by freeing, kept to be reused the
+        // next time the allocator needs to grow
+        zl::opt<bytes_t> spare;
     } m;
 
     static constexpr size_t blocks_stack_initial_items = 2;
@@ -85,9 +88,18 @@ class stack_allocator_t : public detail::abstract_stack_allocator_t
     register_destruction_callback(destruction_callback_t callback,
                                   void* user_data) noexcept;
 
+    /// When freeing empties out a block, the stack allocator keeps it as a
+    /// spare instead of giving it back to the parent right away, so that a
+    /// stack which goes back and forth across the end of a block does not
+    /// free and reallocate it every time. This gives the spare block back to
+    /// the parent. Only possible if the parent is a heap allocator; otherwise
+    /// nothing is done. Returns the number of bytes given back.
+    size_t trim() noexcept;
+
     inline stack_allocator_t(M&& members) noexcept : m(members)
     {
         m_type = enum_value;
+        ALLO_RECORD_STATS(record_block_acquired());
     }
 
   private:
@@ -118,6 +130,13 @@ class stack_allocator_t : public detail::abstract_stack_allocator_t
     [[nodiscard]] size_t
     round_up_to_valid_buffersize(size_t needed_bytes) const noexcept;
 
+    /// Whether the given block is the one the blocks stack was placed in
+    [[nodiscard]] bool holds_blocks_stack(bytes_t block) const noexcept;
+
+    /// Keep a block which was just emptied as the spare, giving back
+    /// whichever block is not kept
+    void keep_as_spare(bytes_t block) noexcept;
+
     /// Common logic shared between freeing functions
     [[nodiscard]] zl::res<previous_state_t&, AllocationStatusCode>
     free_common(bytes_t mem, size_t typehash) const noexcept;
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace allo {
+
+/// A snapshot of the counters an allocator keeps about itself. They are only
+/// collected if allo is compiled with ALLO_ENABLE_STATS defined, otherwise
+/// every field is zero.
+///
+/// Bytes "requested" are the sizes that were asked for, and bytes "consumed"
+/// are what those allocations actually took up in the allocator, including
+/// bookkeeping, alignment padding, and rounding up to a whole block.
+struct allocator_stats_t
+{
+    size_t allocs;
+    size_t failed_allocs;
+    size_t frees;
+    size_t failed_frees;
+    /// Successful resizes of an allocation. For everything except
+    /// c_allocator_t's threadsafe_realloc_bytes, these are always in place.
+    size_t remaps;
+    size_t failed_remaps;
+    /// Bytes requested by allocations which are still live.
+    size_t bytes_requested;
+    size_t peak_bytes_requested;
+    /// Bytes consumed by allocations which are still live.
+    size_t bytes_consumed;
+    size_t peak_bytes_consumed;
+    /// Number of times the allocator asked its parent (or the OS) for more
+    /// memory, whether that was a new block or a remap of an existing one.
+    size_t parent_grow_calls;
+    /// Number of separate regions of memory the allocator currently holds,
+    /// including the memory it was created with and any empty blocks it is
+    /// keeping around for reuse.
+    size_t blocks_held;
+    /// Page faults taken by the thread while the allocator was growing. Only
+    /// counted if ALLO_ENABLE_PAGE_FAULT_STATS is also defined. Most faults on
+    /// new memory happen when the caller first touches it, after the
+    /// allocator has returned, so these are a lower bound.
+    size_t minor_page_faults;
+    size_t major_page_faults;
+};
+
+namespace detail {
+
+template <bool threadsafe> class allocator_stats_recorder_t;
+
+/// The counters behind allocator_stats_t. They are atomic so that stats can be
+/// read from another thread while the allocator is in use, and they are only
+/// ever updated through an allocator_stats_recorder_t.
+class allocator_stats_counters_t
+{
+  public:
+    [[nodiscard]] inline allocator_stats_t snapshot() const noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        return allocator_stats_t{
+            .allocs = m.allocs.load(relaxed),
+            .failed_allocs = m.failed_allocs.load(relaxed),
+            .frees = m.frees.load(relaxed),
+            .failed_frees = m.failed_frees.load(relaxed),
+            .remaps = m.remaps.load(relaxed),
+            .failed_remaps = m.failed_remaps.load(relaxed),
+            .bytes_requested = m.bytes_requested.load(relaxed),
+            .peak_bytes_requested = m.peak_bytes_requested.load(relaxed),
+            .bytes_consumed = m.bytes_consumed.load(relaxed),
+            .peak_bytes_consumed = m.peak_bytes_consumed.load(relaxed),
+            .parent_grow_calls = m.parent_grow_calls.load(relaxed),
+            .blocks_held = m.blocks_held.load(relaxed),
+            .minor_page_faults = m.minor_page_faults.load(relaxed),
+            .major_page_faults = m.major_page_faults.load(relaxed),
+        };
+    }
+
+    /// Start the peaks over from the bytes which are live right now.
+    inline void reset_peaks() noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        m.peak_bytes_requested.store(m.bytes_requested.load(relaxed), relaxed);
+        m.peak_bytes_consumed.store(m.bytes_consumed.load(relaxed), relaxed);
+    }
+
+    /// Overwrite these counters with a snapshot, used when an allocator is
+    /// moved. Not threadsafe.
+    inline void restore(const allocator_stats_t& stats) noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        m.allocs.store(stats.allocs, relaxed);
+        m.failed_allocs.store(stats.failed_allocs, relaxed);
+        m.frees.store(stats.frees, relaxed);
+        m.failed_frees.store(stats.failed_frees, relaxed);
+        m.remaps.store(stats.remaps, relaxed);
+        m.failed_remaps.store(stats.failed_remaps, relaxed);
+        m.bytes_requested.store(stats.bytes_requested, relaxed);
+        m.peak_bytes_requested.store(stats.peak_bytes_requested, relaxed);
+        m.bytes_consumed.store(stats.bytes_consumed, relaxed);
+        m.peak_bytes_consumed.store(stats.peak_bytes_consumed, relaxed);
+        m.parent_grow_calls.store(stats.parent_grow_calls, relaxed);
+        m.blocks_held.store(stats.blocks_held, relaxed);
+        m.minor_page_faults.store(stats.minor_page_faults, relaxed);
+        m.major_page_faults.store(stats.major_page_faults, relaxed);
+    }
+
+  private:
+    friend class allocator_stats_recorder_t<false>;
+    friend class allocator_stats_recorder_t<true>;
+
+    struct M
+    {
+        std::atomic<size_t> allocs{0};
+        std::atomic<size_t> failed_allocs{0};
+        std::atomic<size_t> frees{0};
+        std::atomic<size_t> failed_frees{0};
+        std::atomic<size_t> remaps{0};
+        std::atomic<size_t> failed_remaps{0};
+        std::atomic<size_t> bytes_requested{0};
+        std::atomic<size_t> peak_bytes_requested{0};
+        std::atomic<size_t> bytes_consumed{0};
+        std::atomic<size_t> peak_bytes_consumed{0};
+        std::atomic<size_t> parent_grow_calls{0};
+        std::atomic<size_t> blocks_held{0};
+        std::atomic<size_t> minor_page_faults{0};
+        std::atomic<size_t> major_page_faults{0};
+    } m;
+};
+
+/// Updates an allocator's counters. Threadsafe allocators update them with
+/// relaxed read-modify-writes. Every other allocator is only ever used by one
+/// thread at a time, so a relaxed load and store are enough, which compile to
+/// the same instructions as a plain counter.
+template <bool threadsafe> class allocator_stats_recorder_t
+{
+  public:
+    inline constexpr explicit allocator_stats_recorder_t(
+        allocator_stats_counters_t& counters) noexcept
+        : m(counters.m)
+    {
+    }
+
+    inline void record_alloc(size_t requested, size_t consumed) noexcept
+    {
+        add(m.allocs, 1);
+        add_live(m.bytes_requested, m.peak_bytes_requested, requested);
+        add_live(m.bytes_consumed, m.peak_bytes_consumed, consumed);
+    }
+
+    inline void record_failed_alloc() noexcept { add(m.failed_allocs, 1); }
+
+    inline void record_free(size_t requested, size_t consumed) noexcept
+    {
+        add(m.frees, 1);
+        sub(m.bytes_requested, requested);
+        sub(m.bytes_consumed, consumed);
+    }
+
+    inline void record_failed_free() noexcept { add(m.failed_frees, 1); }
+
+    inline void record_remap(size_t old_requested, size_t new_requested,
+                             size_t old_consumed, size_t new_consumed) noexcept
+    {
+        add(m.remaps, 1);
+        change_live(m.bytes_requested, m.peak_bytes_requested, old_requested,
+                    new_requested);
+        change_live(m.bytes_consumed, m.peak_bytes_consumed, old_consumed,
+                    new_consumed);
+    }
+
+    inline void record_failed_remap() noexcept { add(m.failed_remaps, 1); }
+
+    inline void record_parent_grow() noexcept { add(m.parent_grow_calls, 1); }
+
+    inline void record_block_acquired() noexcept { add(m.blocks_held, 1); }
+
+    inline void record_block_released() noexcept { sub(m.blocks_held, 1); }
+
+    inline void record_page_faults(size_t minor, size_t major) noexcept
+    {
+        add(m.minor_page_faults, minor);
+        add(m.major_page_faults, major);
+    }
+
+  private:
+    using counter_t = std::atomic<size_t>;
+
+    /// Returns the new value of the counter.
+    static inline size_t add(counter_t& counter, size_t amount) noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        if constexpr (threadsafe) {
+            return counter.fetch_add(amount, relaxed) + amount;
+        } else {
+            const size_t now = counter.load(relaxed) + amount;
+            counter.store(now, relaxed);
+            return now;
+        }
+    }
+
+    static inline void sub(counter_t& counter, size_t amount) noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        if constexpr (threadsafe)
+            counter.fetch_sub(amount, relaxed);
+        else
+            counter.store(counter.load(relaxed) - amount, relaxed);
+    }
+
+    static inline void add_live(counter_t& live, counter_t& peak,
+                                size_t amount) noexcept
+    {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        const size_t now = add(live, amount);
+        size_t old_peak = peak.load(relaxed);
+        if constexpr (threadsafe) {
+            while (now > old_peak &&
+                   !peak.compare_exchange_weak(old_peak, now, relaxed)) {
+            }
+        } else if (now > old_peak) {
+            peak.store(now, relaxed);
+        }
+    }
+
+    static inline void change_live(counter_t& live, counter_t& peak,
+                                   size_t old_size, size_t new_size) noexcept
+    {
+        if (new_size >= old_size)
+            add_live(live, peak, new_size - old_size);
+        else
+            sub(live, old_size - new_size);
+    }
+
+    allocator_stats_counters_t::M& m;
+};
+} // namespace detail
+} // namespace allo
+
+/// Used inside of allocators to update their stats, which compiles to nothing
+/// unless ALLO_ENABLE_STATS is defined. The arguments are not evaluated if
+/// stats are disabled.
+///
+/// ALLO_ENABLE_STATS changes the layout of every allocator, so it (like the
+/// other ALLO_ENABLE_* flags) must be defined the same way in every
+/// translation unit which includes allo, including the one which compiles
+/// allo's implementation when it is not header-only.
+#ifdef ALLO_ENABLE_STATS
+#define ALLO_RECORD_STATS(...) stats_recorder().__VA_ARGS__
+#else
+#define ALLO_RECORD_STATS(...)
+#endif
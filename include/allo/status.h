@@ -37,6 +37,8 @@ enum class AllocationStatusCode : uint8_t
     // Error propagated from another source which was not supposed to happen and
     // cannot be mapped to an AllocationStatusCode.
     UnknownOrUnexpectedError,
+    // the allocation would put its allocation tag over the budget set for it
+    BudgetExceeded,
 };
 
 using allocation_status_t = zl::status<AllocationStatusCode>;
@@ -141,6 +141,15 @@ class any_allocator_t
         }
     }
 
+    /// Get the stats of the referenced allocator, or all zeroes if there is
+    /// no allocator.
+    [[nodiscard]] inline allocator_stats_t stats() const noexcept
+    {
+        if (is_null())
+            return {};
+        return cast_to_basic().stats();
+    }
+
   private:
     struct M
     {
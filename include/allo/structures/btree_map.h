@@ -0,0 +1,940 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/block_allocator.h"
+#include "allo/detail/asserts.h"
+#include "allo/detail/cache_line_size.h"
+#include "allo/status.h"
+#include "allo/structures/uninitialized_array.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// An ordered map stored as a B+ tree. Every node is node_bytes long (a
+/// multiple of the cache line size) and comes from a block_allocator_t owned
+/// by the map, which gets its memory from the parent allocator. Entries are
+/// only stored in the leaves, and each leaf links to the next one, so range
+/// scans walk the leaves without going back up the tree.
+///
+/// If K and V are trivially destructible, destroying the map does not visit
+/// any nodes: the block allocator gives its memory back to the parent, or, if
+/// the parent is not a heap (an arena such as scratch_allocator_t), leaves it
+/// to be freed all at once along with the arena.
+template <typename K, typename V, typename Compare = std::less<K>,
+          size_t node_bytes = detail::cache_line_size * 4>
+class btree_map_t
+{
+  public:
+    static_assert(std::is_nothrow_destructible_v<K> &&
+                      std::is_nothrow_destructible_v<V>,
+                  "Cannot instantiate a btree map whose keys or values are not "
+                  "nothrow destructible.");
+    static_assert(std::is_nothrow_move_constructible_v<K> &&
+                      std::is_nothrow_move_constructible_v<V>,
+                  "Cannot instantiate a btree map whose keys or values may "
+                  "throw when moved, since entries are moved between nodes.");
+    static_assert(std::is_nothrow_copy_constructible_v<K>,
+                  "Cannot instantiate a btree map whose keys may throw when "
+                  "copied, since keys are copied into the inner nodes.");
+    static_assert(node_bytes % detail::cache_line_size == 0,
+                  "btree_map_t nodes must be a multiple of the cache line "
+                  "size.");
+
+    using key_type = K;
+    using value_type = V;
+
+    /// Entries in each leaf. Room is left for the node header and padding.
+    static constexpr size_t leaf_capacity =
+        (node_bytes - (sizeof(void*) * 4)) / (sizeof(K) + sizeof(V));
+    /// Keys in each inner node, which has one more child than keys.
+    static constexpr size_t internal_capacity =
+        (node_bytes - (sizeof(void*) * 4)) / (sizeof(K) + sizeof(void*));
+
+    static_assert(leaf_capacity >= 3 && internal_capacity >= 3,
+                  "Keys or values are too big to fit at least three in each "
+                  "node. Use a bigger node_bytes.");
+    static_assert(leaf_capacity < UINT16_MAX && internal_capacity < UINT16_MAX,
+                  "node_bytes is too big.");
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        AlreadyPresent,
+        NotFound,
+        InvalidArgument,
+        AllocatorError,
+        OOM,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    /// Create a btree map whose block allocator starts with room for
+    /// initial_nodes nodes, taken from parent_allocator, and takes more from
+    /// it when they run out. Nothing is given back to the parent, so this is
+    /// meant for arenas. If initial_nodes is zero, it is rounded up to one.
+    [[nodiscard]] static zl::res<btree_map_t, AllocationStatusCode>
+    make(detail::abstract_allocator_t& parent_allocator,
+         size_t initial_nodes) noexcept;
+
+    /// Same as make(), except all the nodes' memory is freed back to the
+    /// parent when the map is destroyed.
+    [[nodiscard]] static zl::res<btree_map_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_nodes) noexcept;
+
+    btree_map_t() = delete;
+    btree_map_t(const btree_map_t&) = delete;
+    btree_map_t& operator=(const btree_map_t&) = delete;
+    // the moved-from map is left empty, with no memory
+    inline btree_map_t(btree_map_t&& other) noexcept : m(std::move(other.m))
+    {
+        other.m.root = nullptr;
+        other.m.size = 0;
+    }
+    btree_map_t& operator=(btree_map_t&&) = delete;
+
+    [[nodiscard]] constexpr size_t size() const noexcept { return m.size; }
+
+    /// Insert an entry with the given key and a value constructed from args.
+    /// Returns AlreadyPresent, and does nothing, if the key is already in the
+    /// map.
+    template <typename... Args>
+    [[nodiscard]] status_t try_insert(const K& key, Args&&... args) noexcept;
+
+    /// Build the tree from entries whose keys are sorted in strictly
+    /// ascending order, filling the nodes bottom up without any searching or
+    /// splitting. The map must be empty. Returns InvalidArgument if it is
+    /// not, if the keys are not sorted, or if keys and values are not the
+    /// same length.
+    [[nodiscard]] status_t try_bulk_load(zl::slice<const K> keys,
+                                         zl::slice<const V> values) noexcept;
+
+    [[nodiscard]] zl::opt<V&> try_get(const K& key) noexcept;
+
+    [[nodiscard]] zl::opt<const V&> try_get(const K& key) const noexcept;
+
+    [[nodiscard]] bool contains(const K& key) const noexcept;
+
+    /// Remove the entry with the given key, or return NotFound.
+    [[nodiscard]] status_t try_remove(const K& key) noexcept;
+
+    /// Destroy every entry and give every node back to the block allocator.
+    void clear() noexcept;
+
+    /// Call callable(const K&, V&) with every entry, in order of key.
+    template <typename Callable> inline void for_each(Callable&& callable)
+    {
+        if (!m.root)
+            return;
+        node_t* node = m.root;
+        while (!node->is_leaf)
+            node = as_internal(node)->children[0];
+        for (; node; node = node->next) {
+            leaf_t* const leaf = as_leaf(node);
+            for (size_t i = 0; i < leaf->count; ++i) {
+                callable(std::as_const(leaf->keys.data()[i]),
+                         leaf->values.data()[i]);
+            }
+        }
+    }
+
+    /// Call callable(const K&, V&) with every entry whose key is not less than
+    /// "from" and less than "to", in order of key.
+    template <typename Callable>
+    inline void for_each_in_range(const K& from, const K& to,
+                                  Callable&& callable)
+    {
+        if (!m.root)
+            return;
+        leaf_t* leaf = find_leaf(from);
+        size_t i = lower_bound_in(leaf->keys.data(), leaf->count, from);
+        while (leaf) {
+            for (; i < leaf->count; ++i) {
+                if (!m.compare(leaf->keys.data()[i], to))
+                    return;
+                callable(std::as_const(leaf->keys.data()[i]),
+                         leaf->values.data()[i]);
+            }
+            leaf = as_leaf(leaf->next);
+            i = 0;
+        }
+    }
+
+    inline ~btree_map_t() noexcept
+    {
+        // otherwise the block allocator frees all the nodes at once
+        if constexpr (!std::is_trivially_destructible_v<K> ||
+                      !std::is_trivially_destructible_v<V>) {
+            clear();
+        }
+    }
+
+  private:
+    struct node_t
+    {
+        // the node to the right on the same level, even if it has a
+        // different parent
+        node_t* next;
+        uint16_t count;
+        bool is_leaf;
+    };
+
+    struct leaf_t : node_t
+    {
+        uninitialized_array_t<K, leaf_capacity> keys;
+        uninitialized_array_t<V, leaf_capacity> values;
+    };
+
+    struct internal_t : node_t
+    {
+        // keys[i] is the smallest key which may be in children[i + 1]
+        uninitialized_array_t<K, internal_capacity> keys;
+        node_t* children[internal_capacity + 1];
+    };
+
+    static_assert(sizeof(leaf_t) <= node_bytes &&
+                  sizeof(internal_t) <= node_bytes);
+
+    static constexpr size_t min_leaf_count = leaf_capacity / 2;
+    static constexpr size_t min_children = (internal_capacity + 2) / 2;
+    // every inner node but the root has at least two children, so this is
+    // enough for any number of entries that fits in a size_t
+    static constexpr size_t max_depth = 64;
+
+    struct path_entry_t
+    {
+        internal_t* node;
+        size_t child;
+    };
+
+    struct M
+    {
+        block_allocator_t nodes;
+        node_t* root;
+        size_t size;
+        Compare compare;
+    } m;
+
+    inline explicit btree_map_t(block_allocator_t&& nodes) noexcept
+        : m(M{
+              .nodes = std::move(nodes),
+              .root = nullptr,
+              .size = 0,
+              .compare = Compare{},
+          })
+    {
+    }
+
+    [[nodiscard]] static inline leaf_t* as_leaf(node_t* node) noexcept
+    {
+        ALLO_INTERNAL_ASSERT(!node || node->is_leaf);
+        return static_cast<leaf_t*>(node);
+    }
+
+    [[nodiscard]] static inline internal_t* as_internal(node_t* node) noexcept
+    {
+        ALLO_INTERNAL_ASSERT(!node->is_leaf);
+        return static_cast<internal_t*>(node);
+    }
+
+    /// Move-construct count items from source to destination, destroying the
+    /// originals. The ranges may overlap.
+    template <typename T>
+    static inline void relocate(T* source, T* destination,
+                                size_t count) noexcept
+    {
+        if (destination <= source) {
+            for (size_t i = 0; i < count; ++i) {
+                new (destination + i) T(std::move(source[i]));
+                source[i].~T();
+            }
+        } else {
+            for (size_t i = count; i-- > 0;) {
+                new (destination + i) T(std::move(source[i]));
+                source[i].~T();
+            }
+        }
+    }
+
+    /// Index of the first key which is not less than "key".
+    [[nodiscard]] inline size_t lower_bound_in(const K* keys, size_t count,
+                                               const K& key) const noexcept
+    {
+        if (count == 0)
+            return 0;
+        const K* base = keys;
+        while (count > 1) {
+            const size_t half = count / 2;
+            base = m.compare(base[half], key) ? base + half : base;
+            count -= half;
+        }
+        return static_cast<size_t>(base - keys) +
+               static_cast<size_t>(m.compare(*base, key));
+    }
+
+    /// Index of the first key which is greater than "key", which is the index
+    /// of the child of an inner node that "key" belongs in.
+    [[nodiscard]] inline size_t upper_bound_in(const K* keys, size_t count,
+                                               const K& key) const noexcept
+    {
+        if (count == 0)
+            return 0;
+        const K* base = keys;
+        while (count > 1) {
+            const size_t half = count / 2;
+            base = !m.compare(key, base[half]) ? base + half : base;
+            count -= half;
+        }
+        return static_cast<size_t>(base - keys) +
+               static_cast<size_t>(!m.compare(key, *base));
+    }
+
+    [[nodiscard]] inline leaf_t* find_leaf(const K& key) const noexcept
+    {
+        node_t* node = m.root;
+        while (!node->is_leaf) {
+            internal_t* const internal = as_internal(node);
+            node = internal->children[upper_bound_in(internal->keys.data(),
+                                                     internal->count, key)];
+        }
+        return as_leaf(node);
+    }
+
+    /// Walk from the root to the leaf which "key" belongs in, recording the
+    /// inner nodes passed through and which child was taken.
+    [[nodiscard]] inline leaf_t* find_leaf(const K& key, path_entry_t* path,
+                                           size_t& depth) const noexcept
+    {
+        depth = 0;
+        node_t* node = m.root;
+        while (!node->is_leaf) {
+            internal_t* const internal = as_internal(node);
+            const size_t child = upper_bound_in(internal->keys.data(),
+                                                internal->count, key);
+            ALLO_INTERNAL_ASSERT(depth < max_depth);
+            path[depth] = path_entry_t{internal, child};
+            ++depth;
+            node = internal->children[child];
+        }
+        return as_leaf(node);
+    }
+
+    [[nodiscard]] inline V* find_value(const K& key) const noexcept
+    {
+        if (!m.root)
+            return nullptr;
+        leaf_t* const leaf = find_leaf(key);
+        const size_t index =
+            lower_bound_in(leaf->keys.data(), leaf->count, key);
+        if (index < leaf->count && !m.compare(key, leaf->keys.data()[index]))
+            return leaf->values.data() + index;
+        return nullptr;
+    }
+
+    [[nodiscard]] static inline K& subtree_min(node_t* node) noexcept
+    {
+        while (!node->is_leaf)
+            node = as_internal(node)->children[0];
+        return as_leaf(node)->keys.data()[0];
+    }
+
+    [[nodiscard]] static constexpr StatusCode
+    convert(AllocationStatusCode code) noexcept
+    {
+        return code == AllocationStatusCode::OOM ? StatusCode::OOM
+                                                 : StatusCode::AllocatorError;
+    }
+
+    [[nodiscard]] zl::res<leaf_t&, AllocationStatusCode>
+    try_alloc_leaf() noexcept;
+
+    [[nodiscard]] zl::res<internal_t&, AllocationStatusCode>
+    try_alloc_internal() noexcept;
+
+    /// Destroy a node's contents and give it back to the block allocator.
+    void free_node(node_t* node) noexcept;
+
+    /// Free a node and every node to the right of it on the same level.
+    void free_level(node_t* first) noexcept;
+
+    /// After a leaf was split, insert the separator and the new node into
+    /// the inner nodes along path, splitting them too if they are full, using
+    /// already allocated spare inner nodes.
+    void insert_into_parents(path_entry_t* path, size_t depth, K&& separator,
+                             node_t* new_child, internal_t** spares) noexcept;
+
+    /// Remove keys[index] and children[index + 1] from an inner node.
+    static void remove_from_internal(internal_t* node, size_t index) noexcept;
+
+    /// Fix a leaf which has too few entries by borrowing one from a sibling,
+    /// or merging with it.
+    void rebalance_leaf(internal_t* parent, size_t index) noexcept;
+
+    /// Fix an inner node which has too few children by borrowing one from a
+    /// sibling, or merging with it.
+    void rebalance_internal(internal_t* parent, size_t index) noexcept;
+};
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+auto btree_map_t<K, V, Compare, node_bytes>::make(
+    detail::abstract_allocator_t& parent_allocator,
+    size_t initial_nodes) noexcept -> zl::res<btree_map_t, AllocationStatusCode>
+{
+    const size_t actual_initial = initial_nodes == 0 ? 1 : initial_nodes;
+    auto maybe_memory =
+        alloc<uint8_t, detail::abstract_allocator_t, detail::cache_line_size>(
+            parent_allocator, actual_initial * node_bytes);
+    if (!maybe_memory.okay())
+        return maybe_memory.err();
+    return zl::res<btree_map_t, AllocationStatusCode>{
+        std::in_place,
+        btree_map_t(block_allocator_t::make(maybe_memory.release(),
+                                            parent_allocator, node_bytes))};
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+auto btree_map_t<K, V, Compare, node_bytes>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_nodes) noexcept -> zl::res<btree_map_t, AllocationStatusCode>
+{
+    const size_t actual_initial = initial_nodes == 0 ? 1 : initial_nodes;
+    auto maybe_memory = alloc<uint8_t, detail::abstract_heap_allocator_t,
+                              detail::cache_line_size>(
+        parent_allocator, actual_initial * node_bytes);
+    if (!maybe_memory.okay())
+        return maybe_memory.err();
+    return zl::res<btree_map_t, AllocationStatusCode>{
+        std::in_place, btree_map_t(block_allocator_t::make_owning(
+                           maybe_memory.release(), parent_allocator,
+                           node_bytes))};
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+auto btree_map_t<K, V, Compare, node_bytes>::try_alloc_leaf() noexcept
+    -> zl::res<leaf_t&, AllocationStatusCode>
+{
+    auto maybe_leaf = alloc_one<leaf_t>(m.nodes);
+    if (!maybe_leaf.okay())
+        return maybe_leaf.err();
+    leaf_t* const leaf = new (&maybe_leaf.release()) leaf_t;
+    leaf->next = nullptr;
+    leaf->count = 0;
+    leaf->is_leaf = true;
+    return *leaf;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+auto btree_map_t<K, V, Compare, node_bytes>::try_alloc_internal() noexcept
+    -> zl::res<internal_t&, AllocationStatusCode>
+{
+    auto maybe_internal = alloc_one<internal_t>(m.nodes);
+    if (!maybe_internal.okay())
+        return maybe_internal.err();
+    internal_t* const internal = new (&maybe_internal.release()) internal_t;
+    internal->next = nullptr;
+    internal->count = 0;
+    internal->is_leaf = false;
+    return *internal;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+void btree_map_t<K, V, Compare, node_bytes>::free_node(node_t* node) noexcept
+{
+    if (node->is_leaf) {
+        leaf_t* const leaf = as_leaf(node);
+        for (size_t i = 0; i < leaf->count; ++i) {
+            leaf->keys.data()[i].~K();
+            leaf->values.data()[i].~V();
+        }
+        free_one(m.nodes, *leaf);
+    } else {
+        internal_t* const internal = as_internal(node);
+        for (size_t i = 0; i < internal->count; ++i)
+            internal->keys.data()[i].~K();
+        free_one(m.nodes, *internal);
+    }
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+void btree_map_t<K, V, Compare, node_bytes>::free_level(node_t* first) noexcept
+{
+    while (first) {
+        node_t* const next = first->next;
+        free_node(first);
+        first = next;
+    }
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+void btree_map_t<K, V, Compare, node_bytes>::clear() noexcept
+{
+    node_t* level = m.root;
+    while (level) {
+        node_t* const below =
+            level->is_leaf ? nullptr : as_internal(level)->children[0];
+        free_level(level);
+        level = below;
+    }
+    m.root = nullptr;
+    m.size = 0;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+template <typename... Args>
+auto btree_map_t<K, V, Compare, node_bytes>::try_insert(const K& key,
+                                                        Args&&... args) noexcept
+    -> status_t
+{
+    static_assert(std::is_nothrow_constructible_v<V, Args...>,
+                  "V is not nothrow constructible with the given arguments.");
+    if (!m.root) {
+        auto maybe_leaf = try_alloc_leaf();
+        if (!maybe_leaf.okay())
+            return convert(maybe_leaf.err());
+        m.root = &maybe_leaf.release();
+    }
+
+    path_entry_t path[max_depth];
+    size_t depth = 0;
+    leaf_t* leaf = find_leaf(key, path, depth);
+    size_t index = lower_bound_in(leaf->keys.data(), leaf->count, key);
+    if (index < leaf->count && !m.compare(key, leaf->keys.data()[index]))
+        return StatusCode::AlreadyPresent;
+
+    leaf_t* new_leaf = nullptr;
+    // one inner node for each full node on the path, plus a new root if
+    // they are all full. allocated before changing anything so that running
+    // out of memory leaves the tree as it was
+    internal_t* spares[max_depth + 1];
+    size_t spare_count = 0;
+    if (leaf->count == leaf_capacity) {
+        auto maybe_leaf = try_alloc_leaf();
+        if (!maybe_leaf.okay())
+            return convert(maybe_leaf.err());
+        new_leaf = &maybe_leaf.release();
+
+        size_t needed = 0;
+        bool root_splits = true;
+        for (size_t level = depth; level-- > 0;) {
+            if (path[level].node->count != internal_capacity) {
+                root_splits = false;
+                break;
+            }
+            ++needed;
+        }
+        if (root_splits)
+            ++needed;
+        for (; spare_count < needed; ++spare_count) {
+            auto maybe_internal = try_alloc_internal();
+            if (!maybe_internal.okay()) {
+                free_node(new_leaf);
+                for (size_t i = 0; i < spare_count; ++i)
+                    free_node(spares[i]);
+                return convert(maybe_internal.err());
+            }
+            spares[spare_count] = &maybe_internal.release();
+        }
+
+        // split evenly, counting the entry being inserted
+        const size_t left_count = (leaf_capacity + 1) / 2;
+        const size_t moved = index < left_count ? leaf_capacity - left_count + 1
+                                                : leaf_capacity - left_count;
+        const size_t first_moved = leaf_capacity - moved;
+        relocate(leaf->keys.data() + first_moved, new_leaf->keys.data(), moved);
+        relocate(leaf->values.data() + first_moved, new_leaf->values.data(),
+                 moved);
+        leaf->count = static_cast<uint16_t>(first_moved);
+        new_leaf->count = static_cast<uint16_t>(moved);
+        new_leaf->next = leaf->next;
+        leaf->next = new_leaf;
+        if (index >= left_count) {
+            index -= left_count;
+            leaf = new_leaf;
+        }
+    }
+
+    relocate(leaf->keys.data() + index, leaf->keys.data() + index + 1,
+             leaf->count - index);
+    relocate(leaf->values.data() + index, leaf->values.data() + index + 1,
+             leaf->count - index);
+    new (leaf->keys.data() + index) K(key);
+    new (leaf->values.data() + index) V(std::forward<Args>(args)...);
+    ++leaf->count;
+    ++m.size;
+
+    if (new_leaf) {
+        insert_into_parents(path, depth, K(new_leaf->keys.data()[0]), new_leaf,
+                            spares);
+    }
+    return StatusCode::Okay;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+void btree_map_t<K, V, Compare, node_bytes>::insert_into_parents(
+    path_entry_t* path, size_t depth, K&& separator, node_t* new_child,
+    internal_t** spares) noexcept
+{
+    // the key being passed up to the next level
+    uninitialized_array_t<K, 1> up_storage;
+    K* const up = new (up_storage.data()) K(std::move(separator));
+
+    for (size_t level = depth; level-- > 0;) {
+        internal_t* const node = path[level].node;
+        // the new key goes at keys[index] and the new child after it
+        const size_t index = path[level].child;
+        K* const keys = node->keys.data();
+        node_t** const children = node->children;
+
+        if (node->count < internal_capacity) {
+            relocate(keys + index, keys + index + 1, node->count - index);
+            relocate(children + index + 1, children + index + 2,
+                     node->count - index);
+            relocate(up, keys + index, 1);
+            children[index + 1] = new_child;
+            ++node->count;
+            return;
+        }
+
+        // lay out all the keys and children in order, then split them
+        uninitialized_array_t<K, internal_capacity + 1> all_keys_storage;
+        K* const all_keys = all_keys_storage.data();
+        node_t* all_children[internal_capacity + 2];
+        relocate(keys, all_keys, index);
+        relocate(up, all_keys + index, 1);
+        relocate(keys + index, all_keys + index + 1,
+                 internal_capacity - index);
+        for (size_t i = 0; i <= index; ++i)
+            all_children[i] = children[i];
+        all_children[index + 1] = new_child;
+        for (size_t i = index + 1; i <= internal_capacity; ++i)
+            all_children[i + 1] = children[i];
+
+        internal_t* const sibling = *spares;
+        ++spares;
+        const size_t left_children = (internal_capacity + 2) / 2;
+        const size_t right_children = internal_capacity + 2 - left_children;
+        relocate(all_keys, keys, left_children - 1);
+        relocate(all_keys + left_children - 1, up, 1);
+        relocate(all_keys + left_children, sibling->keys.data(),
+                 right_children - 1);
+        for (size_t i = 0; i < left_children; ++i)
+            children[i] = all_children[i];
+        for (size_t i = 0; i < right_children; ++i)
+            sibling->children[i] = all_children[left_children + i];
+        node->count = static_cast<uint16_t>(left_children - 1);
+        sibling->count = static_cast<uint16_t>(right_children - 1);
+        sibling->next = node->next;
+        node->next = sibling;
+        new_child = sibling;
+    }
+
+    // the root was split
+    internal_t* const root = *spares;
+    relocate(up, root->keys.data(), 1);
+    root->children[0] = m.root;
+    root->children[1] = new_child;
+    root->count = 1;
+    m.root = root;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+auto btree_map_t<K, V, Compare, node_bytes>::try_bulk_load(
+    zl::slice<const K> keys, zl::slice<const V> values) noexcept -> status_t
+{
+    static_assert(std::is_nothrow_copy_constructible_v<V>,
+                  "V is not nothrow copy constructible.");
+    if (m.size != 0 || keys.size() != values.size())
+        return StatusCode::InvalidArgument;
+    const size_t count = keys.size();
+    for (size_t i = 1; i < count; ++i) {
+        if (!m.compare(keys.data()[i - 1], keys.data()[i]))
+            return StatusCode::InvalidArgument;
+    }
+    if (count == 0)
+        return StatusCode::Okay;
+
+    // the first node of each level which has been built, to free them if
+    // running out of memory
+    node_t* levels[max_depth];
+    size_t level_count = 0;
+    const auto free_levels = [this, &levels, &level_count]() {
+        for (size_t i = 0; i < level_count; ++i)
+            free_level(levels[i]);
+    };
+
+    // spread the entries evenly over as few leaves as possible, so that
+    // every leaf is at least half full
+    const size_t leaves = (count + leaf_capacity - 1) / leaf_capacity;
+    levels[level_count++] = nullptr;
+    node_t* previous = nullptr;
+    size_t copied = 0;
+    for (size_t i = 0; i < leaves; ++i) {
+        auto maybe_leaf = try_alloc_leaf();
+        if (!maybe_leaf.okay()) {
+            free_levels();
+            return convert(maybe_leaf.err());
+        }
+        leaf_t& leaf = maybe_leaf.release();
+        const size_t in_leaf = (count / leaves) + (i < count % leaves ? 1 : 0);
+        for (size_t j = 0; j < in_leaf; ++j) {
+            new (leaf.keys.data() + j) K(keys.data()[copied + j]);
+            new (leaf.values.data() + j) V(values.data()[copied + j]);
+        }
+        copied += in_leaf;
+        leaf.count = static_cast<uint16_t>(in_leaf);
+        if (previous)
+            previous->next = &leaf;
+        else
+            levels[0] = &leaf;
+        previous = &leaf;
+    }
+
+    // then each level of inner nodes the same way, until there is only one
+    size_t nodes_below = leaves;
+    while (nodes_below > 1) {
+        const size_t nodes = (nodes_below + internal_capacity) /
+                             (internal_capacity + 1);
+        node_t* child = levels[level_count - 1];
+        levels[level_count++] = nullptr;
+        previous = nullptr;
+        for (size_t i = 0; i < nodes; ++i) {
+            auto maybe_internal = try_alloc_internal();
+            if (!maybe_internal.okay()) {
+                free_levels();
+                return convert(maybe_internal.err());
+            }
+            internal_t& internal = maybe_internal.release();
+            const size_t in_node =
+                (nodes_below / nodes) + (i < nodes_below % nodes ? 1 : 0);
+            for (size_t j = 0; j < in_node; ++j) {
+                internal.children[j] = child;
+                if (j != 0)
+                    new (internal.keys.data() + j - 1) K(subtree_min(child));
+                child = child->next;
+            }
+            internal.count = static_cast<uint16_t>(in_node - 1);
+            if (previous)
+                previous->next = &internal;
+            else
+                levels[level_count - 1] = &internal;
+            previous = &internal;
+        }
+        nodes_below = nodes;
+    }
+
+    m.root = levels[level_count - 1];
+    m.size = count;
+    return StatusCode::Okay;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+zl::opt<V&>
+btree_map_t<K, V, Compare, node_bytes>::try_get(const K& key) noexcept
+{
+    V* const value = find_value(key);
+    if (!value)
+        return {};
+    return *value;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+zl::opt<const V&>
+btree_map_t<K, V, Compare, node_bytes>::try_get(const K& key) const noexcept
+{
+    const V* const value = find_value(key);
+    if (!value)
+        return {};
+    return *value;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+bool btree_map_t<K, V, Compare, node_bytes>::contains(
+    const K& key) const noexcept
+{
+    return find_value(key) != nullptr;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+auto btree_map_t<K, V, Compare, node_bytes>::try_remove(const K& key) noexcept
+    -> status_t
+{
+    if (!m.root)
+        return StatusCode::NotFound;
+    path_entry_t path[max_depth];
+    size_t depth = 0;
+    leaf_t* const leaf = find_leaf(key, path, depth);
+    const size_t index = lower_bound_in(leaf->keys.data(), leaf->count, key);
+    if (index >= leaf->count || m.compare(key, leaf->keys.data()[index]))
+        return StatusCode::NotFound;
+
+    leaf->keys.data()[index].~K();
+    leaf->values.data()[index].~V();
+    relocate(leaf->keys.data() + index + 1, leaf->keys.data() + index,
+             leaf->count - index - 1);
+    relocate(leaf->values.data() + index + 1, leaf->values.data() + index,
+             leaf->count - index - 1);
+    --leaf->count;
+    --m.size;
+
+    if (depth == 0) {
+        if (leaf->count == 0) {
+            free_node(leaf);
+            m.root = nullptr;
+        }
+        return StatusCode::Okay;
+    }
+    if (leaf->count >= min_leaf_count)
+        return StatusCode::Okay;
+
+    rebalance_leaf(path[depth - 1].node, path[depth - 1].child);
+    // merging removes a child from the parent, which may leave it too small
+    for (size_t level = depth; level-- > 0;) {
+        internal_t* const node = path[level].node;
+        if (level == 0) {
+            if (node->count == 0) {
+                m.root = node->children[0];
+                free_node(node);
+            }
+            break;
+        }
+        if (static_cast<size_t>(node->count) + 1 >= min_children)
+            break;
+        rebalance_internal(path[level - 1].node, path[level - 1].child);
+    }
+    return StatusCode::Okay;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+void btree_map_t<K, V, Compare, node_bytes>::remove_from_internal(
+    internal_t* node, size_t index) noexcept
+{
+    node->keys.data()[index].~K();
+    relocate(node->keys.data() + index + 1, node->keys.data() + index,
+             node->count - index - 1);
+    relocate(node->children + index + 2, node->children + index + 1,
+             node->count - index - 1);
+    --node->count;
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+void btree_map_t<K, V, Compare, node_bytes>::rebalance_leaf(
+    internal_t* parent, size_t index) noexcept
+{
+    leaf_t* const leaf = as_leaf(parent->children[index]);
+    K* const separators = parent->keys.data();
+
+    if (index > 0) {
+        leaf_t* const left = as_leaf(parent->children[index - 1]);
+        if (left->count > min_leaf_count) {
+            relocate(leaf->keys.data(), leaf->keys.data() + 1, leaf->count);
+            relocate(leaf->values.data(), leaf->values.data() + 1,
+                     leaf->count);
+            relocate(left->keys.data() + left->count - 1, leaf->keys.data(),
+                     1);
+            relocate(left->values.data() + left->count - 1,
+                     leaf->values.data(), 1);
+            --left->count;
+            ++leaf->count;
+            separators[index - 1].~K();
+            new (separators + index - 1) K(leaf->keys.data()[0]);
+            return;
+        }
+    }
+    if (index < parent->count) {
+        leaf_t* const right = as_leaf(parent->children[index + 1]);
+        if (right->count > min_leaf_count) {
+            relocate(right->keys.data(), leaf->keys.data() + leaf->count, 1);
+            relocate(right->values.data(), leaf->values.data() + leaf->count,
+                     1);
+            relocate(right->keys.data() + 1, right->keys.data(),
+                     right->count - 1);
+            relocate(right->values.data() + 1, right->values.data(),
+                     right->count - 1);
+            --right->count;
+            ++leaf->count;
+            separators[index].~K();
+            new (separators + index) K(right->keys.data()[0]);
+            return;
+        }
+    }
+
+    // neither sibling has any to spare, so together they fit in one leaf
+    const size_t left_index = index > 0 ? index - 1 : index;
+    leaf_t* const left = as_leaf(parent->children[left_index]);
+    leaf_t* const right = as_leaf(parent->children[left_index + 1]);
+    relocate(right->keys.data(), left->keys.data() + left->count,
+             right->count);
+    relocate(right->values.data(), left->values.data() + left->count,
+             right->count);
+    left->count += right->count;
+    right->count = 0;
+    left->next = right->next;
+    free_node(right);
+    remove_from_internal(parent, left_index);
+}
+
+template <typename K, typename V, typename Compare, size_t node_bytes>
+void btree_map_t<K, V, Compare, node_bytes>::rebalance_internal(
+    internal_t* parent, size_t index) noexcept
+{
+    internal_t* const node = as_internal(parent->children[index]);
+    K* const separators = parent->keys.data();
+
+    if (index > 0) {
+        internal_t* const left = as_internal(parent->children[index - 1]);
+        if (static_cast<size_t>(left->count) + 1 > min_children) {
+            // the separator comes down, and left's last key goes up
+            relocate(node->keys.data(), node->keys.data() + 1, node->count);
+            relocate(node->children, node->children + 1, node->count + 1);
+            relocate(separators + index - 1, node->keys.data(), 1);
+            node->children[0] = left->children[left->count];
+            relocate(left->keys.data() + left->count - 1,
+                     separators + index - 1, 1);
+            --left->count;
+            ++node->count;
+            return;
+        }
+    }
+    if (index < parent->count) {
+        internal_t* const right = as_internal(parent->children[index + 1]);
+        if (static_cast<size_t>(right->count) + 1 > min_children) {
+            relocate(separators + index, node->keys.data() + node->count, 1);
+            node->children[node->count + 1] = right->children[0];
+            relocate(right->keys.data(), separators + index, 1);
+            relocate(right->keys.data() + 1, right->keys.data(),
+                     right->count - 1);
+            relocate(right->children + 1, right->children, right->count);
+            --right->count;
+            ++node->count;
+            return;
+        }
+    }
+
+    // merge the right one into the left one, with the separator between them
+    const size_t left_index = index > 0 ? index - 1 : index;
+    internal_t* const left = as_internal(parent->children[left_index]);
+    internal_t* const right = as_internal(parent->children[left_index + 1]);
+    new (left->keys.data() + left->count) K(separators[left_index]);
+    relocate(right->keys.data(), left->keys.data() + left->count + 1,
+             right->count);
+    for (size_t i = 0; i <= right->count; ++i)
+        left->children[left->count + 1 + i] = right->children[i];
+    left->count += right->count + 1;
+    right->count = 0;
+    left->next = right->next;
+    free_node(right);
+    remove_from_internal(parent, left_index);
+}
+} // namespace allo
@@ -0,0 +1,402 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/status.h"
+#include "allo/structures/any_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <cstring>
+#include <type_traits>
+#include <ziglike/slice.h>
+#if !defined(_WIN32)
+#include <sys/uio.h>
+#endif
+
+namespace allo {
+/// A queue of bytes stored in a linked list of fixed size segments, for
+/// building up messages out of many small pieces and handing them to the OS
+/// without copying them into one contiguous buffer first. Bytes are appended
+/// at the back and consumed from the front. Segments which have been
+/// consumed are kept to be written to again, until release_spare_segments()
+/// is called.
+///
+/// On POSIX systems, the filled and empty parts of the segments can be
+/// exported as arrays of iovec, to be passed to writev() and readv().
+class byte_buffer_t
+{
+  public:
+    static constexpr size_t default_segment_size = 16384;
+
+    /// Make a byte buffer whose segments are segment_size bytes long
+    /// (including a pointer-sized header), allocated from parent_allocator.
+    /// Segments are not freed when the buffer is destroyed. Returns
+    /// InvalidArgument if segment_size is too small to hold any bytes.
+    [[nodiscard]] static inline zl::res<byte_buffer_t, AllocationStatusCode>
+    make(detail::abstract_allocator_t& parent_allocator,
+         size_t segment_size = default_segment_size) noexcept
+    {
+        return make_inner(parent_allocator, segment_size);
+    }
+
+    /// Same as make(), except the segments are freed when the buffer is
+    /// destroyed.
+    [[nodiscard]] static inline zl::res<byte_buffer_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t segment_size = default_segment_size) noexcept
+    {
+        return make_inner(parent_allocator, segment_size);
+    }
+
+    byte_buffer_t() = delete;
+    byte_buffer_t(const byte_buffer_t&) = delete;
+    byte_buffer_t& operator=(const byte_buffer_t&) = delete;
+    // the moved-from buffer is left empty, with no segments
+    inline byte_buffer_t(byte_buffer_t&& other) noexcept : m(other.m)
+    {
+        other.m.head = nullptr;
+        other.m.tail = nullptr;
+        other.m.last = nullptr;
+        other.m.spare = nullptr;
+        other.m.segments_after_tail = 0;
+        other.m.read_offset = 0;
+        other.m.write_offset = 0;
+        other.m.size = 0;
+    }
+    byte_buffer_t& operator=(byte_buffer_t&&) = delete;
+
+    /// Number of bytes which have been appended and not consumed.
+    [[nodiscard]] constexpr size_t size() const noexcept { return m.size; }
+
+    /// Number of bytes which can be appended or committed without allocating.
+    [[nodiscard]] inline size_t writable_bytes() const noexcept
+    {
+        if (!m.tail)
+            return 0;
+        return (capacity() - m.write_offset) +
+               (m.segments_after_tail * capacity());
+    }
+
+    /// Make sure at least "bytes" more bytes can be written without
+    /// allocating, reusing spare segments before allocating new ones.
+    [[nodiscard]] allocation_status_t try_reserve(size_t bytes) noexcept;
+
+    /// Copy bytes onto the end of the buffer. If this fails, nothing is
+    /// appended.
+    [[nodiscard]] inline allocation_status_t
+    try_append(zl::slice<const uint8_t> bytes) noexcept
+    {
+        auto status = try_reserve(bytes.size());
+        if (!status.okay())
+            return status.err();
+        size_t written = 0;
+        while (written < bytes.size()) {
+            advance_tail_if_full();
+            const size_t room = capacity() - m.write_offset;
+            const size_t remaining = bytes.size() - written;
+            const size_t amount = room < remaining ? room : remaining;
+            std::memcpy(data_of(m.tail) + m.write_offset,
+                        bytes.data() + written, amount);
+            m.write_offset += amount;
+            written += amount;
+        }
+        m.size += bytes.size();
+        return AllocationStatusCode::Okay;
+    }
+
+    /// Mark "bytes" bytes of the reserved space as written, after they were
+    /// filled through writable_iovecs() (for example by readv()).
+    void commit(size_t bytes) noexcept;
+
+    /// Drop "bytes" bytes from the front of the buffer without copying
+    /// anything, for example after writev() has sent them. Segments which are
+    /// emptied become spare.
+    void consume(size_t bytes) noexcept;
+
+    /// Copy bytes from the front of the buffer into destination, without
+    /// consuming them. Returns the number copied.
+    [[nodiscard]] size_t copy_to(bytes_t destination) const noexcept;
+
+    /// Call callable(zl::slice<const uint8_t>) with each contiguous piece of
+    /// the contents, in order.
+    template <typename Callable>
+    inline void for_each_segment(Callable&& callable) const
+    {
+        static_assert(
+            std::is_invocable_v<Callable, zl::slice<const uint8_t>>,
+            "The given function cannot be called with a slice of bytes.");
+        for (segment_t* segment = m.head; segment; segment = segment->next) {
+            const size_t begin = segment == m.head ? m.read_offset : 0;
+            const size_t end =
+                segment == m.tail ? m.write_offset : capacity();
+            if (end != begin) {
+                const uint8_t& first = data_of(segment)[begin];
+                callable(zl::raw_slice(first, end - begin));
+            }
+            if (segment == m.tail)
+                break;
+        }
+    }
+
+#if !defined(_WIN32)
+    /// Fill "out" with the contents of the buffer, in order, for writev().
+    /// Returns the number of iovecs filled, which is less than needed if
+    /// "out" is too short.
+    [[nodiscard]] inline size_t
+    readable_iovecs(zl::slice<iovec> out) const noexcept
+    {
+        size_t count = 0;
+        for_each_segment([&count, out](zl::slice<const uint8_t> piece) {
+            if (count == out.size())
+                return;
+            out.data()[count] = iovec{
+                .iov_base = const_cast<uint8_t*>(piece.data()),
+                .iov_len = piece.size(),
+            };
+            ++count;
+        });
+        return count;
+    }
+
+    /// Fill "out" with the reserved space at the end of the buffer, for
+    /// readv(). Call try_reserve() first, and commit() with the number of
+    /// bytes read afterwards. Returns the number of iovecs filled.
+    [[nodiscard]] size_t writable_iovecs(zl::slice<iovec> out) noexcept;
+#endif
+
+    /// Destroy the contents, keeping every segment to be reused.
+    void clear() noexcept;
+
+    /// Free the spare segments, if the parent is a heap allocator. Returns
+    /// the number of segments freed.
+    size_t release_spare_segments() noexcept;
+
+    inline ~byte_buffer_t() noexcept
+    {
+        if (!m.parent.is_heap())
+            return;
+        free_list(m.head);
+        free_list(m.spare);
+    }
+
+  private:
+    struct segment_t
+    {
+        segment_t* next;
+    };
+
+    struct M
+    {
+        // the first segment with contents, or the one which will be written
+        // to next if there are none. null until the first reserve
+        segment_t* head;
+        // the segment currently being written to
+        segment_t* tail;
+        // the last segment linked after tail, which have been reserved
+        segment_t* last;
+        size_t segments_after_tail;
+        // unused segments, linked separately
+        segment_t* spare;
+        size_t read_offset;
+        size_t write_offset;
+        size_t size;
+        size_t segment_size;
+        any_allocator_t parent;
+    } m;
+
+    inline explicit byte_buffer_t(M members) noexcept : m(members) {}
+
+    [[nodiscard]] static inline zl::res<byte_buffer_t, AllocationStatusCode>
+    make_inner(any_allocator_t parent, size_t segment_size) noexcept
+    {
+        ALLO_VALID_ARG_ASSERT(segment_size > sizeof(segment_t));
+        if (segment_size <= sizeof(segment_t))
+            return AllocationStatusCode::InvalidArgument;
+        return zl::res<byte_buffer_t, AllocationStatusCode>{
+            std::in_place, byte_buffer_t(M{
+                               .head = nullptr,
+                               .tail = nullptr,
+                               .last = nullptr,
+                               .segments_after_tail = 0,
+                               .spare = nullptr,
+                               .read_offset = 0,
+                               .write_offset = 0,
+                               .size = 0,
+                               .segment_size = segment_size,
+                               .parent = parent,
+                           })};
+    }
+
+    /// Bytes of contents that fit in each segment.
+    [[nodiscard]] constexpr size_t capacity() const noexcept
+    {
+        return m.segment_size - sizeof(segment_t);
+    }
+
+    [[nodiscard]] static inline uint8_t* data_of(segment_t* segment) noexcept
+    {
+        return reinterpret_cast<uint8_t*>(segment + 1);
+    }
+
+    [[nodiscard]] inline bytes_t bytes_of(segment_t* segment) const noexcept
+    {
+        return zl::raw_slice(*reinterpret_cast<uint8_t*>(segment),
+                             m.segment_size);
+    }
+
+    /// Move on to the next reserved segment if the tail is full.
+    inline void advance_tail_if_full() noexcept
+    {
+        if (m.write_offset != capacity())
+            return;
+        ALLO_INTERNAL_ASSERT(m.tail->next && m.segments_after_tail != 0);
+        m.tail = m.tail->next;
+        m.write_offset = 0;
+        --m.segments_after_tail;
+    }
+
+    inline void free_list(segment_t* segment) noexcept
+    {
+        while (segment) {
+            segment_t* const next = segment->next;
+            allo::free(m.parent.get_heap_unchecked(), bytes_of(segment));
+            segment = next;
+        }
+    }
+};
+
+inline allocation_status_t byte_buffer_t::try_reserve(size_t bytes) noexcept
+{
+    size_t available = writable_bytes();
+    while (!m.tail || available < bytes) {
+        segment_t* segment = m.spare;
+        if (segment) {
+            m.spare = segment->next;
+        } else {
+            auto maybe_segment =
+                alloc<uint8_t, detail::abstract_allocator_t,
+                      alignof(segment_t)>(m.parent.cast_to_basic(),
+                                          m.segment_size);
+            if (!maybe_segment.okay())
+                return maybe_segment.err();
+            segment = reinterpret_cast<segment_t*>(
+                maybe_segment.release().data());
+        }
+        segment->next = nullptr;
+        if (!m.tail) {
+            m.head = segment;
+            m.tail = segment;
+            m.last = segment;
+            m.read_offset = 0;
+            m.write_offset = 0;
+        } else {
+            m.last->next = segment;
+            m.last = segment;
+            ++m.segments_after_tail;
+        }
+        available += capacity();
+    }
+    return AllocationStatusCode::Okay;
+}
+
+inline void byte_buffer_t::commit(size_t bytes) noexcept
+{
+    ALLO_VALID_ARG_ASSERT(bytes <= writable_bytes());
+    m.size += bytes;
+    while (bytes != 0) {
+        advance_tail_if_full();
+        const size_t room = capacity() - m.write_offset;
+        const size_t amount = room < bytes ? room : bytes;
+        m.write_offset += amount;
+        bytes -= amount;
+    }
+}
+
+inline void byte_buffer_t::consume(size_t bytes) noexcept
+{
+    ALLO_VALID_ARG_ASSERT(bytes <= m.size);
+    if (bytes > m.size)
+        bytes = m.size;
+    m.size -= bytes;
+    while (bytes != 0) {
+        const size_t end = m.head == m.tail ? m.write_offset : capacity();
+        const size_t in_head = end - m.read_offset;
+        const size_t amount = in_head < bytes ? in_head : bytes;
+        m.read_offset += amount;
+        bytes -= amount;
+        if (m.read_offset == capacity() && m.head != m.tail) {
+            segment_t* const emptied = m.head;
+            m.head = emptied->next;
+            m.read_offset = 0;
+            emptied->next = m.spare;
+            m.spare = emptied;
+        }
+    }
+    // start writing from the beginning of the tail again, if it is the only
+    // segment with contents and it has been emptied
+    if (m.size == 0 && m.head == m.tail && m.head) {
+        m.read_offset = 0;
+        m.write_offset = 0;
+    }
+}
+
+inline size_t byte_buffer_t::copy_to(bytes_t destination) const noexcept
+{
+    size_t copied = 0;
+    for_each_segment([&copied, destination](zl::slice<const uint8_t> piece) {
+        const size_t room = destination.size() - copied;
+        const size_t amount = piece.size() < room ? piece.size() : room;
+        std::memcpy(destination.data() + copied, piece.data(), amount);
+        copied += amount;
+    });
+    return copied;
+}
+
+#if !defined(_WIN32)
+inline size_t byte_buffer_t::writable_iovecs(zl::slice<iovec> out) noexcept
+{
+    if (!m.tail)
+        return 0;
+    size_t count = 0;
+    segment_t* segment = m.tail;
+    size_t begin = m.write_offset;
+    while (segment && count < out.size()) {
+        if (begin != capacity()) {
+            out.data()[count] = iovec{
+                .iov_base = data_of(segment) + begin,
+                .iov_len = capacity() - begin,
+            };
+            ++count;
+        }
+        if (segment == m.last)
+            break;
+        segment = segment->next;
+        begin = 0;
+    }
+    return count;
+}
+#endif
+
+inline void byte_buffer_t::clear() noexcept
+{
+    consume(m.size);
+}
+
+inline size_t byte_buffer_t::release_spare_segments() noexcept
+{
+    if (!m.parent.is_heap())
+        return 0;
+    size_t released = 0;
+    for (segment_t* segment = m.spare; segment; segment = segment->next)
+        ++released;
+    free_list(m.spare);
+    m.spare = nullptr;
+    return released;
+}
+} // namespace allo
@@ -0,0 +1,398 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/detail/calculate_segment_size.h"
+#include "allo/structures/uninitialized_array.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include <ziglike/opt.h>
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+
+namespace allo {
+/// A double ended queue made of cache-line sized segments, like
+/// segmented_stack_t, so items never move once they are pushed. Pushing and
+/// popping at either end is O(1), and so is indexing, through a ring buffer of
+/// pointers to each segment (the directory). Segments which become empty are
+/// kept for reuse instead of being freed, until release_spare_segments() is
+/// called or the deque is destroyed.
+template <typename T> class deque_t
+{
+  private:
+    struct Segment;
+    struct SegmentEndcap
+    {
+        // only used while the segment is spare, to link it to the next one
+        Segment* next;
+    };
+    using segment_info = detail::segment_size_with_endcap<T, SegmentEndcap>;
+    static constexpr size_t segment_size = segment_info::value;
+    struct Segment
+    {
+        uninitialized_array_t<T, segment_info::number_of_items> items;
+        SegmentEndcap endcap;
+    };
+    static_assert(sizeof(Segment) == segment_size);
+
+  public:
+    static_assert(std::is_nothrow_destructible_v<T>,
+                  "Cannot instantiate a deque whose contents are not nothrow "
+                  "destructible.");
+
+    using type = T;
+
+    static constexpr size_t items_per_segment = segment_info::number_of_items;
+
+    deque_t() = delete;
+    deque_t(const deque_t&) = delete;
+    deque_t& operator=(const deque_t&) = delete;
+    // the moved-from deque is left empty, with no memory
+    inline deque_t(deque_t&& other) noexcept : m(other.m) { other.m = M{}; }
+    deque_t& operator=(deque_t&&) = delete;
+
+    /// Make a deque which allocates segments and its directory from
+    /// parent_allocator, with segments for initial_items already allocated.
+    [[nodiscard]] static zl::res<deque_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_items) noexcept;
+
+    [[nodiscard]] constexpr size_t size() const noexcept { return m.size; }
+
+    [[nodiscard]] zl::opt<T&> front() noexcept;
+
+    [[nodiscard]] zl::opt<T&> back() noexcept;
+
+    [[nodiscard]] zl::opt<T&> try_get_at(size_t index) noexcept;
+
+    [[nodiscard]] zl::opt<const T&> try_get_at(size_t index) const noexcept;
+
+    [[nodiscard]] inline T& get_at_unchecked(size_t index) noexcept
+    {
+        ALLO_UNCHECKED_ASSERT(index < m.size);
+        const size_t position = m.front_offset + index;
+        return segment_at(position / items_per_segment)
+            ->items.data()[position % items_per_segment];
+    }
+
+    [[nodiscard]] inline const T& get_at_unchecked(size_t index) const noexcept
+    {
+        return const_cast<deque_t*>(this)->get_at_unchecked(index);
+    }
+
+    template <typename... Args>
+    [[nodiscard]] inline allocation_status_t
+    try_push_back(Args&&... args) noexcept
+    {
+        static_assert(std::is_nothrow_constructible_v<T, Args...>,
+                      "Constructor that is being called by try_push_back is "
+                      "not nothrow, or doesn't exist.");
+        const size_t position = m.front_offset + m.size;
+        if (position == m.segments_in_use * items_per_segment) {
+            auto status = try_add_segment_at_back();
+            if (!status.okay())
+                return status.err();
+        }
+        new (segment_at(position / items_per_segment)->items.data() +
+             (position % items_per_segment)) T(std::forward<Args>(args)...);
+        ++m.size;
+        return AllocationStatusCode::Okay;
+    }
+
+    template <typename... Args>
+    [[nodiscard]] inline allocation_status_t
+    try_push_front(Args&&... args) noexcept
+    {
+        static_assert(std::is_nothrow_constructible_v<T, Args...>,
+                      "Constructor that is being called by try_push_front is "
+                      "not nothrow, or doesn't exist.");
+        if (m.front_offset == 0) {
+            auto status = try_add_segment_at_front();
+            if (!status.okay())
+                return status.err();
+        }
+        --m.front_offset;
+        new (segment_at(0)->items.data() + m.front_offset)
+            T(std::forward<Args>(args)...);
+        ++m.size;
+        return AllocationStatusCode::Okay;
+    }
+
+    /// Destroy the last item, if there is one.
+    void pop_back() noexcept;
+
+    /// Destroy the first item, if there is one.
+    void pop_front() noexcept;
+
+    /// Destroy every item. The segments are kept as spares.
+    void clear() noexcept;
+
+    /// Free the segments which are not holding any items.
+    void release_spare_segments() noexcept;
+
+    template <typename Callable>
+    inline void for_each(Callable&& callable) noexcept
+    {
+        static_assert(std::is_invocable_r_v<void, Callable, T&>,
+                      "The given function either does not return void or "
+                      "cannot be called with just a T&.");
+        for (size_t i = 0; i < m.size; ++i)
+            callable(get_at_unchecked(i));
+    }
+
+    inline ~deque_t() noexcept
+    {
+        if (!m.parent)
+            return;
+        clear();
+        release_spare_segments();
+        allo::free(m.parent.value(),
+                   zl::raw_slice(*m.directory, m.directory_capacity));
+    }
+
+  private:
+    struct M
+    {
+        zl::opt<detail::abstract_heap_allocator_t&> parent;
+        // ring buffer of the segments holding items, in order. its capacity
+        // is always a power of two
+        Segment** directory;
+        size_t directory_capacity;
+        // index in the directory of the segment holding the first item
+        size_t first_segment;
+        size_t segments_in_use;
+        // index of the first item within the first segment
+        size_t front_offset;
+        size_t size;
+        // singly linked list of segments not in the directory
+        Segment* spare_segments;
+    } m;
+
+    inline constexpr explicit deque_t(M members) noexcept : m(members) {}
+
+    [[nodiscard]] inline Segment* segment_at(size_t index) const noexcept
+    {
+        ALLO_INTERNAL_ASSERT(index < m.segments_in_use);
+        return m.directory[(m.first_segment + index) &
+                           (m.directory_capacity - 1)];
+    }
+
+    [[nodiscard]] zl::res<Segment&, AllocationStatusCode>
+    take_segment() noexcept;
+
+    void give_back_segment(Segment* segment) noexcept;
+
+    [[nodiscard]] allocation_status_t try_grow_directory_if_full() noexcept;
+
+    [[nodiscard]] allocation_status_t try_add_segment_at_back() noexcept;
+
+    [[nodiscard]] allocation_status_t try_add_segment_at_front() noexcept;
+};
+
+template <typename T>
+auto deque_t<T>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_items) noexcept
+    -> zl::res<deque_t, AllocationStatusCode>
+{
+    const size_t segments_needed =
+        (initial_items + items_per_segment - 1) / items_per_segment;
+    // room for one more, since pushing to the front of a full first segment
+    // needs a new one even if the last segment is not full
+    size_t directory_capacity = 4;
+    while (directory_capacity < segments_needed + 1)
+        directory_capacity *= 2;
+    auto maybe_directory =
+        alloc<Segment*>(parent_allocator, directory_capacity);
+    if (!maybe_directory.okay())
+        return maybe_directory.err();
+
+    deque_t out(M{
+        .parent = parent_allocator,
+        .directory = maybe_directory.release().data(),
+        .directory_capacity = directory_capacity,
+        .first_segment = 0,
+        .segments_in_use = 0,
+        .front_offset = 0,
+        .size = 0,
+        .spare_segments = nullptr,
+    });
+    for (size_t i = 0; i < segments_needed; ++i) {
+        auto maybe_segment =
+            alloc_one<Segment, detail::abstract_heap_allocator_t,
+                      detail::cache_line_size>(parent_allocator);
+        // out frees the directory and the segments made so far
+        if (!maybe_segment.okay())
+            return maybe_segment.err();
+        out.give_back_segment(&maybe_segment.release());
+    }
+    return zl::res<deque_t, AllocationStatusCode>{std::in_place,
+                                                  std::move(out)};
+}
+
+template <typename T>
+auto deque_t<T>::take_segment() noexcept
+    -> zl::res<Segment&, AllocationStatusCode>
+{
+    if (m.spare_segments) {
+        Segment* const segment = m.spare_segments;
+        m.spare_segments = segment->endcap.next;
+        return *segment;
+    }
+    return alloc_one<Segment, detail::abstract_heap_allocator_t,
+                     detail::cache_line_size>(m.parent.value());
+}
+
+template <typename T>
+void deque_t<T>::give_back_segment(Segment* segment) noexcept
+{
+    segment->endcap.next = m.spare_segments;
+    m.spare_segments = segment;
+}
+
+template <typename T>
+allocation_status_t deque_t<T>::try_grow_directory_if_full() noexcept
+{
+    if (m.segments_in_use < m.directory_capacity)
+        return AllocationStatusCode::Okay;
+    const size_t new_capacity = m.directory_capacity * 2;
+    auto maybe_directory = alloc<Segment*>(m.parent.value(), new_capacity);
+    if (!maybe_directory.okay())
+        return maybe_directory.err();
+    Segment** const directory = maybe_directory.release().data();
+    // unwrap the ring while copying it
+    for (size_t i = 0; i < m.segments_in_use; ++i)
+        directory[i] = segment_at(i);
+    allo::free(m.parent.value(),
+               zl::raw_slice(*m.directory, m.directory_capacity));
+    m.directory = directory;
+    m.directory_capacity = new_capacity;
+    m.first_segment = 0;
+    return AllocationStatusCode::Okay;
+}
+
+template <typename T>
+allocation_status_t deque_t<T>::try_add_segment_at_back() noexcept
+{
+    auto status = try_grow_directory_if_full();
+    if (!status.okay())
+        return status.err();
+    auto maybe_segment = take_segment();
+    if (!maybe_segment.okay())
+        return maybe_segment.err();
+    m.directory[(m.first_segment + m.segments_in_use) &
+                (m.directory_capacity - 1)] = &maybe_segment.release();
+    ++m.segments_in_use;
+    return AllocationStatusCode::Okay;
+}
+
+template <typename T>
+allocation_status_t deque_t<T>::try_add_segment_at_front() noexcept
+{
+    auto status = try_grow_directory_if_full();
+    if (!status.okay())
+        return status.err();
+    auto maybe_segment = take_segment();
+    if (!maybe_segment.okay())
+        return maybe_segment.err();
+    m.first_segment = (m.first_segment - 1) & (m.directory_capacity - 1);
+    m.directory[m.first_segment] = &maybe_segment.release();
+    ++m.segments_in_use;
+    m.front_offset = items_per_segment;
+    return AllocationStatusCode::Okay;
+}
+
+template <typename T> zl::opt<T&> deque_t<T>::front() noexcept
+{
+    if (m.size == 0)
+        return {};
+    return get_at_unchecked(0);
+}
+
+template <typename T> zl::opt<T&> deque_t<T>::back() noexcept
+{
+    if (m.size == 0)
+        return {};
+    return get_at_unchecked(m.size - 1);
+}
+
+template <typename T> zl::opt<T&> deque_t<T>::try_get_at(size_t index) noexcept
+{
+    ALLO_VALID_ARG_ASSERT(index < m.size);
+    if (index >= m.size)
+        return {};
+    return get_at_unchecked(index);
+}
+
+template <typename T>
+zl::opt<const T&> deque_t<T>::try_get_at(size_t index) const noexcept
+{
+    ALLO_VALID_ARG_ASSERT(index < m.size);
+    if (index >= m.size)
+        return {};
+    return get_at_unchecked(index);
+}
+
+template <typename T> void deque_t<T>::pop_back() noexcept
+{
+    if (m.size == 0)
+        return;
+    get_at_unchecked(m.size - 1).~T();
+    --m.size;
+    if (m.size == 0) {
+        clear();
+        return;
+    }
+    // if the last segment no longer holds anything, it becomes a spare
+    if (m.front_offset + m.size <=
+        (m.segments_in_use - 1) * items_per_segment) {
+        give_back_segment(segment_at(m.segments_in_use - 1));
+        --m.segments_in_use;
+    }
+}
+
+template <typename T> void deque_t<T>::pop_front() noexcept
+{
+    if (m.size == 0)
+        return;
+    get_at_unchecked(0).~T();
+    --m.size;
+    ++m.front_offset;
+    if (m.size == 0) {
+        clear();
+        return;
+    }
+    if (m.front_offset == items_per_segment) {
+        give_back_segment(segment_at(0));
+        m.first_segment = (m.first_segment + 1) & (m.directory_capacity - 1);
+        --m.segments_in_use;
+        m.front_offset = 0;
+    }
+}
+
+template <typename T> void deque_t<T>::clear() noexcept
+{
+    for (size_t i = 0; i < m.size; ++i)
+        get_at_unchecked(i).~T();
+    for (size_t i = 0; i < m.segments_in_use; ++i)
+        give_back_segment(segment_at(i));
+    m.first_segment = 0;
+    m.segments_in_use = 0;
+    m.front_offset = 0;
+    m.size = 0;
+}
+
+template <typename T> void deque_t<T>::release_spare_segments() noexcept
+{
+    while (m.spare_segments) {
+        Segment* const next = m.spare_segments->endcap.next;
+        allo::free_one(m.parent.value(), *m.spare_segments);
+        m.spare_segments = next;
+    }
+}
+
+} // namespace allo
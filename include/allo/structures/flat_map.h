@@ -0,0 +1,372 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/status.h"
+#include "allo/structures/list.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// An ordered map which keeps its keys sorted in one contiguous list_t, and
+/// its values in another at the same indices. Lookups are a branchless binary
+/// search over the keys only, and iterating in order is a linear scan, which
+/// makes it much friendlier to the cache than a node based map when there
+/// are up to a few thousand entries. Inserting or removing in the middle moves
+/// every entry after it, so when adding many entries at once use
+/// try_append_unsorted() and then sort().
+template <typename K, typename V, typename Compare = std::less<K>>
+class flat_map_t
+{
+  public:
+    static_assert(std::is_nothrow_destructible_v<K> &&
+                      std::is_nothrow_destructible_v<V>,
+                  "Cannot instantiate a flat map whose keys or values are not "
+                  "nothrow destructible.");
+    static_assert(std::is_nothrow_move_constructible_v<K> &&
+                      std::is_nothrow_move_constructible_v<V> &&
+                      std::is_nothrow_swappable_v<K> &&
+                      std::is_nothrow_swappable_v<V>,
+                  "Cannot instantiate a flat map whose keys or values may "
+                  "throw when moved, since entries are moved when inserting "
+                  "and sorting.");
+
+    using key_type = K;
+    using value_type = V;
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        AlreadyPresent,
+        NotFound,
+        AllocatorError,
+        OOM,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    /// Create a flat map with room for initial_items entries before it needs
+    /// to grow, allocated with parent_allocator. If zero, will be rounded up
+    /// to one.
+    [[nodiscard]] static zl::res<flat_map_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_items) noexcept;
+
+    flat_map_t() = delete;
+    flat_map_t(const flat_map_t&) = delete;
+    flat_map_t& operator=(const flat_map_t&) = delete;
+    // the moved-from flat map is left empty, with no memory
+    inline flat_map_t(flat_map_t&& other) noexcept : m(std::move(other.m))
+    {
+        auto keys = m.keys.items();
+        auto values = m.values.items();
+        other.m.keys = list_t<K>::make(zl::slice<K>(keys, 0, 0));
+        other.m.values = list_t<V>::make(zl::slice<V>(values, 0, 0));
+        other.m.sorted = true;
+    }
+    flat_map_t& operator=(flat_map_t&&) = delete;
+
+    [[nodiscard]] constexpr size_t size() const noexcept
+    {
+        return m.keys.items().size();
+    }
+
+    /// Whether entries were appended with try_append_unsorted() since the
+    /// last sort(). Lookups and ordered inserts need the map to be sorted.
+    [[nodiscard]] constexpr bool is_sorted() const noexcept
+    {
+        return m.sorted;
+    }
+
+    /// Every key, in ascending order if the map is sorted.
+    [[nodiscard]] constexpr zl::slice<const K> keys() const noexcept
+    {
+        return m.keys.items();
+    }
+
+    /// Every value, at the same index as its key.
+    [[nodiscard]] constexpr zl::slice<V> values() noexcept
+    {
+        return m.values.items();
+    }
+
+    [[nodiscard]] constexpr zl::slice<const V> values() const noexcept
+    {
+        return m.values.items();
+    }
+
+    /// Index of the first key which is not less than "key", or size() if
+    /// there is none. Entries from there onwards can be used for range
+    /// queries.
+    [[nodiscard]] size_t lower_bound(const K& key) const noexcept;
+
+    /// Insert an entry with the given key and a value constructed from args,
+    /// in order. Returns AlreadyPresent, and does nothing, if the key is
+    /// already in the map.
+    template <typename... Args>
+    [[nodiscard]] status_t try_insert(const K& key, Args&&... args) noexcept
+    {
+        static_assert(std::is_nothrow_copy_constructible_v<K>,
+                      "K is not nothrow copy constructible.");
+        ALLO_VALID_ARG_ASSERT(m.sorted);
+        const size_t index = lower_bound(key);
+        if (index < size() && !m.compare(key, m.keys.get_at_unchecked(index)))
+            return StatusCode::AlreadyPresent;
+        auto key_status = m.keys.try_insert_at(index, key);
+        if (!key_status.okay())
+            return convert(key_status.err());
+        auto value_status =
+            m.values.try_insert_at(index, std::forward<Args>(args)...);
+        if (!value_status.okay()) {
+            m.keys.remove_at_unchecked(index);
+            return convert(value_status.err());
+        }
+        return StatusCode::Okay;
+    }
+
+    /// Add an entry to the end without looking at the other keys. The map
+    /// is unsorted until sort() is called.
+    template <typename... Args>
+    [[nodiscard]] status_t try_append_unsorted(const K& key,
+                                               Args&&... args) noexcept
+    {
+        static_assert(std::is_nothrow_copy_constructible_v<K>,
+                      "K is not nothrow copy constructible.");
+        auto key_status = m.keys.try_append(key);
+        if (!key_status.okay())
+            return convert(key_status.err());
+        auto value_status = m.values.try_append(std::forward<Args>(args)...);
+        if (!value_status.okay()) {
+            m.keys.remove_at_unchecked(size() - 1);
+            return convert(value_status.err());
+        }
+        m.sorted = false;
+        return StatusCode::Okay;
+    }
+
+    /// Sort the entries by key, after try_append_unsorted(). If a key was
+    /// added more than once, only one of its entries is kept, and which one
+    /// is unspecified.
+    void sort() noexcept;
+
+    [[nodiscard]] zl::opt<V&> try_get(const K& key) noexcept;
+
+    [[nodiscard]] zl::opt<const V&> try_get(const K& key) const noexcept;
+
+    [[nodiscard]] bool contains(const K& key) const noexcept;
+
+    /// Remove the entry with the given key, or return NotFound.
+    [[nodiscard]] status_t try_remove(const K& key) noexcept;
+
+    /// Destroy every entry, keeping the memory.
+    void clear() noexcept;
+
+    /// Call callable(const K&, V&) with every entry, in order of key if the
+    /// map is sorted.
+    template <typename Callable> inline void for_each(Callable&& callable)
+    {
+        for (size_t i = 0; i < size(); ++i) {
+            callable(std::as_const(m.keys.get_at_unchecked(i)),
+                     m.values.get_at_unchecked(i));
+        }
+    }
+
+    inline ~flat_map_t() noexcept { clear(); }
+
+  private:
+    struct M
+    {
+        list_t<K> keys;
+        list_t<V> values;
+        bool sorted;
+        Compare compare;
+    } m;
+
+    inline explicit flat_map_t(M&& members) noexcept : m(std::move(members))
+    {
+    }
+
+    /// Status of a failed list_t operation, for either of the lists.
+    template <typename ListStatusCode>
+    [[nodiscard]] static constexpr StatusCode
+    convert(ListStatusCode code) noexcept
+    {
+        return code == ListStatusCode::OOM ? StatusCode::OOM
+                                           : StatusCode::AllocatorError;
+    }
+
+    [[nodiscard]] zl::opt<size_t> find_index(const K& key) const noexcept
+    {
+        ALLO_VALID_ARG_ASSERT(m.sorted);
+        const size_t index = lower_bound(key);
+        if (index < size() && !m.compare(key, m.keys.get_at_unchecked(index)))
+            return index;
+        return {};
+    }
+
+    /// Swap the entries at two indices, in both lists.
+    inline void swap_entries(size_t a, size_t b) noexcept
+    {
+        using std::swap;
+        swap(m.keys.get_at_unchecked(a), m.keys.get_at_unchecked(b));
+        swap(m.values.get_at_unchecked(a), m.values.get_at_unchecked(b));
+    }
+
+    inline void remove_last() noexcept
+    {
+        const size_t last = size() - 1;
+        m.keys.remove_at_unchecked(last);
+        m.values.remove_at_unchecked(last);
+    }
+
+    void sift_down(size_t root, size_t end) noexcept;
+};
+
+template <typename K, typename V, typename Compare>
+auto flat_map_t<K, V, Compare>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_items) noexcept -> zl::res<flat_map_t, AllocationStatusCode>
+{
+    // list_t grows by a ratio of its capacity, so it must start non-empty
+    const size_t actual_initial = initial_items == 0 ? 1 : initial_items;
+    auto maybe_keys = list_t<K>::make_owning(parent_allocator, actual_initial);
+    if (!maybe_keys.okay())
+        return maybe_keys.err();
+    auto maybe_values =
+        list_t<V>::make_owning(parent_allocator, actual_initial);
+    if (!maybe_values.okay())
+        return maybe_values.err();
+    return zl::res<flat_map_t, AllocationStatusCode>{
+        std::in_place, flat_map_t(M{
+                           .keys = maybe_keys.release(),
+                           .values = maybe_values.release(),
+                           .sorted = true,
+                           .compare = Compare{},
+                       })};
+}
+
+template <typename K, typename V, typename Compare>
+size_t flat_map_t<K, V, Compare>::lower_bound(const K& key) const noexcept
+{
+    const K* const first = m.keys.items().data();
+    size_t length = size();
+    if (length == 0)
+        return 0;
+    const K* base = first;
+    // the only branch is the loop condition, which only depends on length,
+    // so the comparison result turns into a conditional move
+    while (length > 1) {
+        const size_t half = length / 2;
+        base = m.compare(base[half], key) ? base + half : base;
+        length -= half;
+    }
+    return static_cast<size_t>(base - first) +
+           static_cast<size_t>(m.compare(*base, key));
+}
+
+template <typename K, typename V, typename Compare>
+void flat_map_t<K, V, Compare>::sift_down(size_t root, size_t end) noexcept
+{
+    while (true) {
+        const size_t left = (root * 2) + 1;
+        if (left >= end)
+            return;
+        size_t largest = root;
+        if (m.compare(m.keys.get_at_unchecked(largest),
+                      m.keys.get_at_unchecked(left)))
+            largest = left;
+        const size_t right = left + 1;
+        if (right < end && m.compare(m.keys.get_at_unchecked(largest),
+                                     m.keys.get_at_unchecked(right)))
+            largest = right;
+        if (largest == root)
+            return;
+        swap_entries(root, largest);
+        root = largest;
+    }
+}
+
+template <typename K, typename V, typename Compare>
+void flat_map_t<K, V, Compare>::sort() noexcept
+{
+    if (m.sorted)
+        return;
+    // heapsort, since keys and values are in separate lists and have to be
+    // swapped together, and it needs no extra memory
+    const size_t count = size();
+    for (size_t i = count / 2; i-- > 0;)
+        sift_down(i, count);
+    for (size_t end = count; end > 1; --end) {
+        swap_entries(0, end - 1);
+        sift_down(0, end - 1);
+    }
+
+    // move one entry with each key to the front, and drop the rest
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (kept != 0 && !m.compare(m.keys.get_at_unchecked(kept - 1),
+                                    m.keys.get_at_unchecked(i)))
+            continue;
+        if (kept != i)
+            swap_entries(kept, i);
+        ++kept;
+    }
+    while (size() > kept)
+        remove_last();
+    m.sorted = true;
+}
+
+template <typename K, typename V, typename Compare>
+zl::opt<V&> flat_map_t<K, V, Compare>::try_get(const K& key) noexcept
+{
+    auto index = find_index(key);
+    if (!index)
+        return {};
+    return m.values.get_at_unchecked(index.value());
+}
+
+template <typename K, typename V, typename Compare>
+zl::opt<const V&>
+flat_map_t<K, V, Compare>::try_get(const K& key) const noexcept
+{
+    auto index = find_index(key);
+    if (!index)
+        return {};
+    return m.values.get_at_unchecked(index.value());
+}
+
+template <typename K, typename V, typename Compare>
+bool flat_map_t<K, V, Compare>::contains(const K& key) const noexcept
+{
+    return find_index(key).has_value();
+}
+
+template <typename K, typename V, typename Compare>
+auto flat_map_t<K, V, Compare>::try_remove(const K& key) noexcept -> status_t
+{
+    auto index = find_index(key);
+    if (!index)
+        return StatusCode::NotFound;
+    m.keys.remove_at_unchecked(index.value());
+    m.values.remove_at_unchecked(index.value());
+    return StatusCode::Okay;
+}
+
+template <typename K, typename V, typename Compare>
+void flat_map_t<K, V, Compare>::clear() noexcept
+{
+    while (size() != 0)
+        remove_last();
+    m.sorted = true;
+}
+} // namespace allo
@@ -0,0 +1,695 @@
+#pragma once
+// we have to make sure that impls arent included in header-only mode, because
+// otherwise we'll get circular header dependencies when the impl for
+// detail/abstracts includes stack allocator which includes this
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/status.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "allo/typed_reallocation.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ALLO_HASHMAP_USE_SSE2
+#endif
+
+namespace allo {
+
+namespace detail {
+/// Control bytes of a hashmap_t. A full slot stores 7 bits of its hash, so
+/// that most lookups only compare keys which almost certainly match.
+enum class HashmapCtrl : int8_t
+{
+    Empty = -128,
+    /// Only exists while rehashing in place: the slot holds an entry which has
+    /// not been moved to its position in the grown table yet.
+    Unplaced = -2,
+};
+
+/// Sixteen control bytes which are checked at once, with SSE2 if available.
+/// Each match is a bitmask where bit i is set if byte i matched.
+class hashmap_group_t
+{
+  public:
+    static constexpr size_t width = 16;
+
+    inline explicit hashmap_group_t(const int8_t* ctrl) noexcept
+    {
+#ifdef ALLO_HASHMAP_USE_SSE2
+        m.ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+        std::memcpy(m.ctrl, ctrl, width);
+#endif
+    }
+
+    [[nodiscard]] inline uint32_t match(int8_t h2) const noexcept
+    {
+#ifdef ALLO_HASHMAP_USE_SSE2
+        return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(m.ctrl, _mm_set1_epi8(h2))));
+#else
+        return match_where([h2](int8_t ctrl) { return ctrl == h2; });
+#endif
+    }
+
+    [[nodiscard]] inline uint32_t match_empty() const noexcept
+    {
+        return match(static_cast<int8_t>(HashmapCtrl::Empty));
+    }
+
+    /// Empty and unplaced slots, which are the only ones with the top bit set.
+    [[nodiscard]] inline uint32_t match_not_full() const noexcept
+    {
+#ifdef ALLO_HASHMAP_USE_SSE2
+        return static_cast<uint32_t>(_mm_movemask_epi8(m.ctrl));
+#else
+        return match_where([](int8_t ctrl) { return ctrl < 0; });
+#endif
+    }
+
+    [[nodiscard]] static inline uint32_t
+    lowest_bit_index(uint32_t mask) noexcept
+    {
+        ALLO_INTERNAL_ASSERT(mask != 0);
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<uint32_t>(__builtin_ctz(mask));
+#else
+        uint32_t index = 0;
+        while ((mask & 1) == 0) {
+            mask >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+  private:
+#ifndef ALLO_HASHMAP_USE_SSE2
+    template <typename Predicate>
+    [[nodiscard]] inline uint32_t
+    match_where(Predicate&& predicate) const noexcept
+    {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < width; ++i) {
+            if (predicate(m.ctrl[i]))
+                mask |= uint32_t(1) << i;
+        }
+        return mask;
+    }
+#endif
+
+    struct M
+    {
+#ifdef ALLO_HASHMAP_USE_SSE2
+        __m128i ctrl;
+#else
+        int8_t ctrl[width];
+#endif
+    } m;
+};
+} // namespace detail
+
+/// An unordered map from K to V, stored in a single allocation in the style of
+/// a Swiss table: an array of entries followed by one control byte per entry,
+/// which are scanned sixteen at a time when looking up a key.
+///
+/// Entries are found by linear probing from the position given by their hash,
+/// so removal shifts the entries after it back instead of leaving a tombstone,
+/// and the table never slows down from repeated inserts and removes. If the
+/// parent allocator can grow the allocation in place (for example a
+/// reservation_allocator_t), the table is grown and rehashed in place,
+/// otherwise the entries are moved to a new allocation.
+///
+/// Hash and Equal are default constructed for each use, so they must be
+/// stateless. The hash is mixed before use, so std::hash of integers is fine.
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename Equal = std::equal_to<K>>
+class hashmap_t
+{
+  public:
+    static_assert(std::is_nothrow_destructible_v<K> &&
+                      std::is_nothrow_destructible_v<V>,
+                  "Cannot instantiate a hashmap whose keys or values are not "
+                  "nothrow destructible.");
+    static_assert(std::is_nothrow_move_constructible_v<K> &&
+                      std::is_nothrow_move_constructible_v<V>,
+                  "Cannot instantiate a hashmap whose keys or values may throw "
+                  "when moved, since entries are moved when it grows.");
+
+    using key_type = K;
+    using value_type = V;
+
+    struct entry_t
+    {
+        K key;
+        V value;
+    };
+
+    static constexpr size_t min_capacity = detail::hashmap_group_t::width;
+    static constexpr size_t alignment =
+        alignof(entry_t) > 16 ? alignof(entry_t) : 16;
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        AlreadyPresent,
+        NotFound,
+        AllocatorError,
+        OOM,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    /// Number of bytes of memory needed for a table with the given capacity,
+    /// which must be a power of two and at least min_capacity.
+    [[nodiscard]] static constexpr size_t
+    bytes_needed(size_t capacity) noexcept;
+
+    /// Create a hashmap in a fixed buffer, which is not freed when the map is
+    /// destroyed. Inserts fail with OOM once it is 7/8 full. The buffer must be
+    /// aligned to hashmap_t::alignment and be at least
+    /// bytes_needed(min_capacity) bytes, otherwise InvalidArgument is returned.
+    [[nodiscard]] static zl::res<hashmap_t, AllocationStatusCode>
+    make(bytes_t memory) noexcept;
+
+    /// Create a hashmap in memory which was allocated with parent_allocator,
+    /// taking ownership of it. The map grows by remapping or reallocating it.
+    [[nodiscard]] static zl::res<hashmap_t, AllocationStatusCode>
+    make_owning(bytes_t memory,
+                detail::abstract_heap_allocator_t& parent_allocator) noexcept;
+
+    /// Create a hashmap with room for at least initial_items entries before it
+    /// needs to grow, allocated with parent_allocator.
+    [[nodiscard]] static zl::res<hashmap_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_items) noexcept;
+
+    hashmap_t() = delete;
+    hashmap_t(const hashmap_t&) = delete;
+    hashmap_t& operator=(const hashmap_t&) = delete;
+    // the moved-from hashmap is left empty, with no memory
+    inline hashmap_t(hashmap_t&& other) noexcept : m(other.m)
+    {
+        other.m = M{};
+    }
+    hashmap_t& operator=(hashmap_t&&) = delete;
+
+    [[nodiscard]] constexpr size_t size() const noexcept { return m.size; }
+
+    [[nodiscard]] constexpr size_t capacity() const noexcept
+    {
+        return m.capacity;
+    }
+
+    /// Insert an entry with the given key and a value constructed from args.
+    /// Returns AlreadyPresent, and does nothing, if the key is already in the
+    /// map.
+    template <typename... Args>
+    [[nodiscard]] status_t try_insert(const K& key, Args&&... args) noexcept
+    {
+        static_assert(std::is_nothrow_copy_constructible_v<K>,
+                      "K is not nothrow copy constructible.");
+        static_assert(
+            std::is_nothrow_constructible_v<V, Args...>,
+            "V is not nothrow constructible with the given arguments.");
+        const size_t hash = hash_of(key);
+        if (find_index(key, hash).has_value())
+            return StatusCode::AlreadyPresent;
+        if (m.size + 1 > max_load(m.capacity)) [[unlikely]] {
+            auto status = try_grow();
+            if (!status.okay())
+                return status.err();
+        }
+        entry_t* const entry = insert_unchecked(hash);
+        new (std::addressof(entry->key)) K(key);
+        new (std::addressof(entry->value)) V(std::forward<Args>(args)...);
+        return StatusCode::Okay;
+    }
+
+    [[nodiscard]] zl::opt<V&> try_get(const K& key) noexcept;
+
+    [[nodiscard]] zl::opt<const V&> try_get(const K& key) const noexcept;
+
+    [[nodiscard]] bool contains(const K& key) const noexcept;
+
+    /// Remove the entry with the given key, or return NotFound.
+    [[nodiscard]] status_t try_remove(const K& key) noexcept;
+
+    /// Destroy every entry, keeping the memory.
+    void clear() noexcept;
+
+    /// Grow (never shrink) so that at least "items" entries fit before the map
+    /// has to grow again.
+    [[nodiscard]] status_t try_reserve(size_t items) noexcept;
+
+    /// Call callable(const K&, V&) with every entry, in no particular order.
+    template <typename Callable> inline void for_each(Callable&& callable)
+    {
+        for (size_t i = 0; i < m.capacity; ++i) {
+            if (is_full(m.ctrl[i]))
+                callable(std::as_const(m.entries[i].key), m.entries[i].value);
+        }
+    }
+
+    inline ~hashmap_t() noexcept
+    {
+        clear();
+        if (m.parent)
+            allo::free(m.parent.value(), m.memory);
+    }
+
+  private:
+    struct M
+    {
+        zl::opt<detail::abstract_heap_allocator_t&> parent;
+        bytes_t memory;
+        entry_t* entries;
+        int8_t* ctrl;
+        size_t capacity;
+        size_t size;
+        // hashes are shifted right by this to get their home position
+        uint8_t home_shift;
+    } m;
+
+    using group_t = detail::hashmap_group_t;
+    using Ctrl = detail::HashmapCtrl;
+
+    inline constexpr explicit hashmap_t(M members) noexcept : m(members) {}
+
+    [[nodiscard]] static constexpr bool is_full(int8_t ctrl) noexcept
+    {
+        return ctrl >= 0;
+    }
+
+    [[nodiscard]] static constexpr size_t max_load(size_t capacity) noexcept
+    {
+        return capacity - (capacity / 8);
+    }
+
+    [[nodiscard]] static inline size_t hash_of(const K& key) noexcept
+    {
+        // hashes of integers and pointers are often the value itself.
+        // fibonacci hashing: multiplying by an odd constant makes the top bits
+        // of the product depend on every bit of the hash, which is not true of
+        // the bottom bits, so the top bits are kept when size_t is smaller.
+        return static_cast<size_t>(
+            (static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ULL) >>
+            (64 - (sizeof(size_t) * 8)));
+    }
+
+    /// Position in the table which a hash probes from, taken from the top bits
+    /// of the hash.
+    [[nodiscard]] inline size_t home_of(size_t hash) const noexcept
+    {
+        return hash >> m.home_shift;
+    }
+
+    [[nodiscard]] static constexpr uint8_t
+    home_shift_for(size_t capacity) noexcept
+    {
+        uint8_t shift = sizeof(size_t) * 8;
+        for (; capacity > 1; capacity >>= 1)
+            --shift;
+        return shift;
+    }
+
+    /// The part of the hash stored in the control byte. Taken from the middle
+    /// of the hash, since the top bits decide the position and the bottom
+    /// ones only depend on the bottom bits of the key's hash.
+    [[nodiscard]] static constexpr int8_t h2(size_t hash) noexcept
+    {
+        return static_cast<int8_t>((hash >> ((sizeof(size_t) * 4) - 7)) &
+                                   0x7F);
+    }
+
+    [[nodiscard]] static M layout(bytes_t memory, size_t capacity) noexcept;
+
+    /// Largest capacity that fits in this many bytes, or zero.
+    [[nodiscard]] static constexpr size_t
+    capacity_for_bytes(size_t bytes) noexcept;
+
+    inline void set_ctrl(size_t index, int8_t value) noexcept
+    {
+        m.ctrl[index] = value;
+        // the first group is repeated after the end, so that a group can be
+        // loaded starting from any position without wrapping around
+        if (index < group_t::width)
+            m.ctrl[m.capacity + index] = value;
+    }
+
+    [[nodiscard]] zl::opt<size_t> find_index(const K& key,
+                                             size_t hash) const noexcept;
+
+    /// First empty (or, while rehashing in place, unplaced) slot after the
+    /// home position of the hash.
+    [[nodiscard]] size_t find_first_not_full(size_t hash) const noexcept;
+
+    [[nodiscard]] inline entry_t* insert_unchecked(size_t hash) noexcept
+    {
+        const size_t index = find_first_not_full(hash);
+        ALLO_INTERNAL_ASSERT(m.ctrl[index] == int8_t(Ctrl::Empty));
+        set_ctrl(index, h2(hash));
+        ++m.size;
+        return m.entries + index;
+    }
+
+    void remove_at(size_t index) noexcept;
+
+    static inline void move_entry(entry_t& from, entry_t& to) noexcept
+    {
+        new (std::addressof(to.key)) K(std::move(from.key));
+        new (std::addressof(to.value)) V(std::move(from.value));
+        from.key.~K();
+        from.value.~V();
+    }
+
+    [[nodiscard]] status_t try_grow_to(size_t new_capacity) noexcept;
+
+    [[nodiscard]] inline status_t try_grow() noexcept
+    {
+        return try_grow_to(m.capacity * 2);
+    }
+
+    void rehash_in_place(size_t old_capacity, size_t new_capacity) noexcept;
+};
+
+template <typename K, typename V, typename Hash, typename Equal>
+constexpr size_t
+hashmap_t<K, V, Hash, Equal>::bytes_needed(size_t capacity) noexcept
+{
+    return (capacity * sizeof(entry_t)) + capacity + group_t::width;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+constexpr size_t
+hashmap_t<K, V, Hash, Equal>::capacity_for_bytes(size_t bytes) noexcept
+{
+    if (bytes < bytes_needed(min_capacity))
+        return 0;
+    size_t capacity = min_capacity;
+    while (bytes_needed(capacity * 2) <= bytes)
+        capacity *= 2;
+    return capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+auto hashmap_t<K, V, Hash, Equal>::layout(bytes_t memory,
+                                          size_t capacity) noexcept -> M
+{
+    M out{
+        .parent = {},
+        .memory = memory,
+        .entries = reinterpret_cast<entry_t*>(memory.data()),
+        .ctrl = reinterpret_cast<int8_t*>(memory.data() +
+                                          (capacity * sizeof(entry_t))),
+        .capacity = capacity,
+        .size = 0,
+        .home_shift = home_shift_for(capacity),
+    };
+    std::memset(out.ctrl, static_cast<int>(Ctrl::Empty),
+                capacity + group_t::width);
+    return out;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+auto hashmap_t<K, V, Hash, Equal>::make(bytes_t memory) noexcept
+    -> zl::res<hashmap_t, AllocationStatusCode>
+{
+    const size_t capacity = capacity_for_bytes(memory.size());
+    if (capacity == 0 ||
+        reinterpret_cast<uintptr_t>(memory.data()) % alignment != 0)
+        return AllocationStatusCode::InvalidArgument;
+    return zl::res<hashmap_t, AllocationStatusCode>{
+        std::in_place, hashmap_t(layout(memory, capacity))};
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+auto hashmap_t<K, V, Hash, Equal>::make_owning(
+    bytes_t memory,
+    detail::abstract_heap_allocator_t& parent_allocator) noexcept
+    -> zl::res<hashmap_t, AllocationStatusCode>
+{
+    auto res = make(memory);
+    if (!res.okay())
+        return res.err();
+    res.release_ref().m.parent = parent_allocator;
+    return res;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+auto hashmap_t<K, V, Hash, Equal>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_items) noexcept -> zl::res<hashmap_t, AllocationStatusCode>
+{
+    size_t capacity = min_capacity;
+    while (max_load(capacity) < initial_items)
+        capacity *= 2;
+    auto maybe_memory = alloc<uint8_t, detail::abstract_heap_allocator_t,
+                              alignment>(parent_allocator,
+                                         bytes_needed(capacity));
+    if (!maybe_memory.okay())
+        return maybe_memory.err();
+    M members = layout(maybe_memory.release(), capacity);
+    members.parent = parent_allocator;
+    return zl::res<hashmap_t, AllocationStatusCode>{std::in_place,
+                                                    hashmap_t(members)};
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+auto hashmap_t<K, V, Hash, Equal>::find_index(const K& key,
+                                              size_t hash) const noexcept
+    -> zl::opt<size_t>
+{
+    const size_t mask = m.capacity - 1;
+    size_t position = home_of(hash);
+    while (true) {
+        const group_t group(m.ctrl + position);
+        uint32_t matches = group.match(h2(hash));
+        while (matches != 0) {
+            const size_t index =
+                (position + group_t::lowest_bit_index(matches)) & mask;
+            if (Equal{}(m.entries[index].key, key))
+                return index;
+            matches &= matches - 1;
+        }
+        // entries are never placed past an empty slot in their probe sequence
+        if (group.match_empty() != 0)
+            return {};
+        position = (position + group_t::width) & mask;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+size_t
+hashmap_t<K, V, Hash, Equal>::find_first_not_full(size_t hash) const noexcept
+{
+    const size_t mask = m.capacity - 1;
+    size_t position = home_of(hash);
+    while (true) {
+        const uint32_t not_full = group_t(m.ctrl + position).match_not_full();
+        if (not_full != 0)
+            return (position + group_t::lowest_bit_index(not_full)) & mask;
+        position = (position + group_t::width) & mask;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+zl::opt<V&> hashmap_t<K, V, Hash, Equal>::try_get(const K& key) noexcept
+{
+    const auto index = find_index(key, hash_of(key));
+    if (!index.has_value())
+        return {};
+    return m.entries[index.value()].value;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+zl::opt<const V&>
+hashmap_t<K, V, Hash, Equal>::try_get(const K& key) const noexcept
+{
+    const auto index = find_index(key, hash_of(key));
+    if (!index.has_value())
+        return {};
+    return m.entries[index.value()].value;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+bool hashmap_t<K, V, Hash, Equal>::contains(const K& key) const noexcept
+{
+    return find_index(key, hash_of(key)).has_value();
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+auto hashmap_t<K, V, Hash, Equal>::try_remove(const K& key) noexcept
+    -> status_t
+{
+    const auto index = find_index(key, hash_of(key));
+    if (!index.has_value())
+        return StatusCode::NotFound;
+    remove_at(index.value());
+    return StatusCode::Okay;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+void hashmap_t<K, V, Hash, Equal>::remove_at(size_t index) noexcept
+{
+    ALLO_INTERNAL_ASSERT(is_full(m.ctrl[index]));
+    const size_t mask = m.capacity - 1;
+    m.entries[index].key.~K();
+    m.entries[index].value.~V();
+    --m.size;
+
+    // backward shift: move each following entry of the run into the hole if
+    // the hole is not before its home position, so that no entry ends up
+    // after an empty slot in its probe sequence
+    size_t hole = index;
+    size_t next = index;
+    while (true) {
+        next = (next + 1) & mask;
+        if (!is_full(m.ctrl[next]))
+            break;
+        const size_t home = home_of(hash_of(m.entries[next].key));
+        // distance from each slot's home, wrapping around the table
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            move_entry(m.entries[next], m.entries[hole]);
+            set_ctrl(hole, m.ctrl[next]);
+            hole = next;
+        }
+    }
+    set_ctrl(hole, static_cast<int8_t>(Ctrl::Empty));
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+void hashmap_t<K, V, Hash, Equal>::clear() noexcept
+{
+    if (m.size == 0)
+        return;
+    for (size_t i = 0; i < m.capacity; ++i) {
+        if (is_full(m.ctrl[i])) {
+            m.entries[i].key.~K();
+            m.entries[i].value.~V();
+        }
+    }
+    std::memset(m.ctrl, static_cast<int>(Ctrl::Empty),
+                m.capacity + group_t::width);
+    m.size = 0;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+auto hashmap_t<K, V, Hash, Equal>::try_reserve(size_t items) noexcept
+    -> status_t
+{
+    size_t capacity = m.capacity;
+    while (max_load(capacity) < items)
+        capacity *= 2;
+    if (capacity == m.capacity)
+        return StatusCode::Okay;
+    return try_grow_to(capacity);
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+auto hashmap_t<K, V, Hash, Equal>::try_grow_to(size_t new_capacity) noexcept
+    -> status_t
+{
+    if (!m.parent || m.capacity == 0)
+        return StatusCode::OOM;
+    auto& parent = m.parent.value();
+    const size_t old_capacity = m.capacity;
+
+    // the c allocator can never remap
+    if (parent.type() != detail::AllocatorType::CAllocator) {
+        auto remapped =
+            allo::remap(parent, m.memory, bytes_needed(new_capacity));
+        if (remapped.okay()) {
+            m.memory = remapped.release();
+            rehash_in_place(old_capacity, new_capacity);
+            return StatusCode::Okay;
+        }
+    }
+
+    auto maybe_memory =
+        alloc<uint8_t, detail::abstract_heap_allocator_t, alignment>(
+            parent, bytes_needed(new_capacity));
+    if (!maybe_memory.okay())
+        return StatusCode::AllocatorError;
+
+    const M old = m;
+    m = layout(maybe_memory.release(), new_capacity);
+    m.parent = old.parent;
+    for (size_t i = 0; i < old.capacity; ++i) {
+        if (is_full(old.ctrl[i])) {
+            entry_t& entry = old.entries[i];
+            move_entry(entry, *insert_unchecked(hash_of(entry.key)));
+        }
+    }
+    allo::free(parent, old.memory);
+    return StatusCode::Okay;
+}
+
+template <typename K, typename V, typename Hash, typename Equal>
+void hashmap_t<K, V, Hash, Equal>::rehash_in_place(
+    size_t old_capacity, size_t new_capacity) noexcept
+{
+    ALLO_INTERNAL_ASSERT(new_capacity >= old_capacity * 2);
+    // the entries grow over the old control bytes, so move those to where
+    // the new ones go first. they never overlap, since entries are at least
+    // two bytes and the capacity at least sixteen
+    int8_t* const old_ctrl = m.ctrl;
+    m.ctrl = reinterpret_cast<int8_t*>(m.memory.data() +
+                                       (new_capacity * sizeof(entry_t)));
+    std::memmove(m.ctrl, old_ctrl, old_capacity);
+    m.capacity = new_capacity;
+    m.home_shift = home_shift_for(new_capacity);
+    for (size_t i = 0; i < new_capacity + group_t::width; ++i) {
+        m.ctrl[i] = i < old_capacity && is_full(m.ctrl[i])
+                        ? static_cast<int8_t>(Ctrl::Unplaced)
+                        : static_cast<int8_t>(Ctrl::Empty);
+    }
+    std::memcpy(m.ctrl + new_capacity, m.ctrl, group_t::width);
+
+    // place every entry at the first slot from its home which is not full.
+    // the slots before it are then full of placed entries, which never move
+    // again, so lookups will find it.
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (m.ctrl[i] != static_cast<int8_t>(Ctrl::Unplaced))
+            continue;
+        const size_t hash = hash_of(m.entries[i].key);
+        const size_t target = find_first_not_full(hash);
+        if (target == i) {
+            set_ctrl(i, h2(hash));
+            continue;
+        }
+        if (m.ctrl[target] == static_cast<int8_t>(Ctrl::Empty)) {
+            move_entry(m.entries[i], m.entries[target]);
+            set_ctrl(target, h2(hash));
+            set_ctrl(i, static_cast<int8_t>(Ctrl::Empty));
+            continue;
+        }
+        // the target holds another unplaced entry. swap them, and place the
+        // one which is now in slot i next
+        ALLO_INTERNAL_ASSERT(m.ctrl[target] ==
+                             static_cast<int8_t>(Ctrl::Unplaced));
+        alignas(entry_t) uint8_t buffer[sizeof(entry_t)];
+        entry_t& temporary = *reinterpret_cast<entry_t*>(buffer);
+        move_entry(m.entries[target], temporary);
+        move_entry(m.entries[i], m.entries[target]);
+        move_entry(temporary, m.entries[i]);
+        set_ctrl(target, h2(hash));
+        --i;
+    }
+}
+} // namespace allo
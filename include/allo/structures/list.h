@@ -44,8 +44,22 @@ template <typename T> class list_t
     list_t() = delete;
     list_t(const list_t&) = delete;
     list_t& operator=(const list_t&) = delete;
-    list_t(list_t&&) noexcept = default;
-    list_t& operator=(list_t&&) noexcept = default;
+    // the moved-from list no longer frees the memory when destroyed
+    inline list_t(list_t&& other) noexcept : m(other.m)
+    {
+        other.m.parent = {};
+    }
+    // frees this list's memory before taking the other's
+    inline list_t& operator=(list_t&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        if (m.parent)
+            allo::free(m.parent.value(), m.memory);
+        m = other.m;
+        other.m.parent = {};
+        return *this;
+    }
 
     [[nodiscard]] static constexpr list_t make(zl::slice<T> memory) noexcept;
 
@@ -0,0 +1,306 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/detail/cache_line_size.h"
+#include "allo/status.h"
+#include "allo/structures/any_allocator.h"
+#include "allo/structures/uninitialized_array.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <atomic>
+#include <type_traits>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// A bounded queue which any number of threads may push to and pop from at
+/// the same time, without locking. Each slot has a sequence number saying
+/// which lap around the ring it is ready for and whether it is full (Dmitry
+/// Vyukov's bounded MPMC queue), so threads only contend on the shared
+/// enqueue and dequeue positions, which are on separate cache lines.
+///
+/// The batch functions claim several consecutive slots with one
+/// compare-and-swap of the shared position instead of one per item.
+template <typename T> class mpmc_queue_t
+{
+  public:
+    // the batch pops move assign into the caller's items
+    static_assert(std::is_nothrow_destructible_v<T> &&
+                      std::is_nothrow_move_constructible_v<T> &&
+                      std::is_nothrow_move_assignable_v<T>,
+                  "Cannot instantiate a queue whose contents are not nothrow "
+                  "movable and destructible.");
+
+    using type = T;
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        Full,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    /// Make a queue which holds at least minimum_capacity items, rounded up to
+    /// a power of two (and at least two). The ring is allocated from
+    /// parent_allocator, and not freed when the queue is destroyed.
+    [[nodiscard]] static zl::res<mpmc_queue_t, AllocationStatusCode>
+    make(detail::abstract_allocator_t& parent_allocator,
+         size_t minimum_capacity) noexcept;
+
+    /// Same as make(), except the ring is freed when the queue is destroyed.
+    [[nodiscard]] static zl::res<mpmc_queue_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t minimum_capacity) noexcept;
+
+    mpmc_queue_t() = delete;
+    mpmc_queue_t(const mpmc_queue_t&) = delete;
+    mpmc_queue_t& operator=(const mpmc_queue_t&) = delete;
+    // can be moved before it is shared between threads, but not after
+    inline mpmc_queue_t(mpmc_queue_t&& other) noexcept
+        : mpmc_queue_t(other.m.cells, other.m.mask + 1, other.m.parent)
+    {
+        m.enqueue_position.store(other.m.enqueue_position.load());
+        m.dequeue_position.store(other.m.dequeue_position.load());
+        other.m.cells = nullptr;
+    }
+    mpmc_queue_t& operator=(mpmc_queue_t&&) = delete;
+
+    [[nodiscard]] constexpr size_t capacity() const noexcept
+    {
+        return m.mask + 1;
+    }
+
+    /// Construct an item at the back of the queue.
+    template <typename... Args>
+    [[nodiscard]] inline status_t try_push(Args&&... args) noexcept
+    {
+        static_assert(
+            std::is_nothrow_constructible_v<T, Args...>,
+            "T is not nothrow constructible with the given arguments.");
+        size_t position = m.enqueue_position.load(std::memory_order_relaxed);
+        while (true) {
+            cell_t& cell = m.cells[position & m.mask];
+            const size_t sequence =
+                cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<intptr_t>(sequence) -
+                                    static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (m.enqueue_position.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed))
+                    break;
+            } else if (difference < 0) {
+                // the slot still holds an item from the previous lap
+                return StatusCode::Full;
+            } else {
+                position = m.enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+        cell_t& cell = m.cells[position & m.mask];
+        new (cell.item.data()) T(std::forward<Args>(args)...);
+        cell.sequence.store(position + 1, std::memory_order_release);
+        return StatusCode::Okay;
+    }
+
+    /// Move as many items from the start of "items" into the queue as fit,
+    /// and return how many that was.
+    [[nodiscard]] size_t try_push_batch(zl::slice<T> items) noexcept;
+
+    /// Remove the item at the front of the queue.
+    [[nodiscard]] zl::opt<T> try_pop() noexcept;
+
+    /// Move items from the front of the queue into "destination" (which must
+    /// hold constructed items, that are move assigned to) until either it is
+    /// full or the queue is empty, and return how many were moved.
+    [[nodiscard]] size_t try_pop_batch(zl::slice<T> destination) noexcept;
+
+    inline ~mpmc_queue_t() noexcept
+    {
+        if (!m.cells)
+            return;
+        while (try_pop().has_value()) {
+        }
+        if (m.parent.is_heap()) {
+            allo::free(m.parent.get_heap_unchecked(),
+                       zl::raw_slice(*m.cells, m.mask + 1));
+        }
+    }
+
+  private:
+    struct cell_t
+    {
+        // equal to the position of the next push which may use this cell if it
+        // is empty, or one more than the position of the item if it is full
+        std::atomic<size_t> sequence;
+        uninitialized_array_t<T, 1> item;
+    };
+
+    struct M
+    {
+        alignas(detail::cache_line_size) std::atomic<size_t> enqueue_position;
+        alignas(detail::cache_line_size) std::atomic<size_t> dequeue_position;
+        // never written after construction, so shared by every thread
+        alignas(detail::cache_line_size) cell_t* cells;
+        size_t mask;
+        any_allocator_t parent;
+    } m;
+
+    inline mpmc_queue_t(cell_t* cells, size_t capacity,
+                        any_allocator_t parent) noexcept
+    {
+        m.enqueue_position.store(0, std::memory_order_relaxed);
+        m.dequeue_position.store(0, std::memory_order_relaxed);
+        m.cells = cells;
+        m.mask = capacity - 1;
+        m.parent = parent;
+    }
+
+    [[nodiscard]] static zl::res<mpmc_queue_t, AllocationStatusCode>
+    make_inner(detail::abstract_allocator_t& allocator, any_allocator_t parent,
+               size_t minimum_capacity) noexcept;
+
+    /// Claim up to "wanted" consecutive cells, starting at the shared
+    /// position, whose sequence is "offset" ahead of their position. Returns
+    /// the first position claimed and the number of cells.
+    struct claim_t
+    {
+        size_t position;
+        size_t count;
+    };
+    [[nodiscard]] inline claim_t claim(std::atomic<size_t>& shared_position,
+                                       size_t offset, size_t wanted) noexcept
+    {
+        size_t position = shared_position.load(std::memory_order_relaxed);
+        while (true) {
+            size_t count = 0;
+            bool someone_else_moved = false;
+            while (count < wanted) {
+                const size_t sequence =
+                    m.cells[(position + count) & m.mask].sequence.load(
+                        std::memory_order_acquire);
+                const auto difference =
+                    static_cast<intptr_t>(sequence) -
+                    static_cast<intptr_t>(position + count + offset);
+                if (difference != 0) {
+                    // a cell which is ahead of us means the shared position
+                    // moved since we loaded it
+                    someone_else_moved = difference > 0 && count == 0;
+                    break;
+                }
+                ++count;
+            }
+            if (count == 0 && !someone_else_moved)
+                return claim_t{position, 0};
+            if (count != 0 && shared_position.compare_exchange_weak(
+                                  position, position + count,
+                                  std::memory_order_relaxed))
+                return claim_t{position, count};
+            if (someone_else_moved)
+                position = shared_position.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+template <typename T>
+auto mpmc_queue_t<T>::make_inner(detail::abstract_allocator_t& allocator,
+                                 any_allocator_t parent,
+                                 size_t minimum_capacity) noexcept
+    -> zl::res<mpmc_queue_t, AllocationStatusCode>
+{
+    ALLO_VALID_ARG_ASSERT(minimum_capacity != 0);
+    if (minimum_capacity == 0)
+        return AllocationStatusCode::InvalidArgument;
+    size_t capacity = 2;
+    while (capacity < minimum_capacity)
+        capacity *= 2;
+    auto maybe_cells = alloc<cell_t>(allocator, capacity);
+    if (!maybe_cells.okay())
+        return maybe_cells.err();
+    cell_t* const cells = maybe_cells.release().data();
+    for (size_t i = 0; i < capacity; ++i)
+        new (&cells[i].sequence) std::atomic<size_t>(i);
+    return zl::res<mpmc_queue_t, AllocationStatusCode>{
+        std::in_place, mpmc_queue_t(cells, capacity, parent)};
+}
+
+template <typename T>
+auto mpmc_queue_t<T>::make(detail::abstract_allocator_t& parent_allocator,
+                           size_t minimum_capacity) noexcept
+    -> zl::res<mpmc_queue_t, AllocationStatusCode>
+{
+    return make_inner(parent_allocator, parent_allocator, minimum_capacity);
+}
+
+template <typename T>
+auto mpmc_queue_t<T>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t minimum_capacity) noexcept
+    -> zl::res<mpmc_queue_t, AllocationStatusCode>
+{
+    return make_inner(parent_allocator, parent_allocator, minimum_capacity);
+}
+
+template <typename T> zl::opt<T> mpmc_queue_t<T>::try_pop() noexcept
+{
+    size_t position = m.dequeue_position.load(std::memory_order_relaxed);
+    while (true) {
+        cell_t& cell = m.cells[position & m.mask];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) -
+                                static_cast<intptr_t>(position + 1);
+        if (difference == 0) {
+            if (m.dequeue_position.compare_exchange_weak(
+                    position, position + 1, std::memory_order_relaxed))
+                break;
+        } else if (difference < 0) {
+            // nothing has been pushed to this slot yet
+            return {};
+        } else {
+            position = m.dequeue_position.load(std::memory_order_relaxed);
+        }
+    }
+    cell_t& cell = m.cells[position & m.mask];
+    T& item = *cell.item.data();
+    zl::opt<T> out(std::move(item));
+    item.~T();
+    // ready for the push one lap later
+    cell.sequence.store(position + m.mask + 1, std::memory_order_release);
+    return out;
+}
+
+template <typename T>
+size_t mpmc_queue_t<T>::try_push_batch(zl::slice<T> items) noexcept
+{
+    const claim_t claimed = claim(m.enqueue_position, 0, items.size());
+    for (size_t i = 0; i < claimed.count; ++i) {
+        const size_t position = claimed.position + i;
+        cell_t& cell = m.cells[position & m.mask];
+        new (cell.item.data()) T(std::move(items.data()[i]));
+        cell.sequence.store(position + 1, std::memory_order_release);
+    }
+    return claimed.count;
+}
+
+template <typename T>
+size_t mpmc_queue_t<T>::try_pop_batch(zl::slice<T> destination) noexcept
+{
+    const claim_t claimed = claim(m.dequeue_position, 1, destination.size());
+    for (size_t i = 0; i < claimed.count; ++i) {
+        const size_t position = claimed.position + i;
+        cell_t& cell = m.cells[position & m.mask];
+        T& item = *cell.item.data();
+        destination.data()[i] = std::move(item);
+        item.~T();
+        cell.sequence.store(position + m.mask + 1, std::memory_order_release);
+    }
+    return claimed.count;
+}
+} // namespace allo
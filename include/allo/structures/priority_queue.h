@@ -0,0 +1,207 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/status.h"
+#include "allo/structures/list.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// A priority queue stored as a d-ary heap in a list_t. Like
+/// std::priority_queue, the top is the greatest item according to Compare.
+/// Each node has "arity" children next to each other, so the heap is
+/// shallower than a binary one and the children compared when sifting down
+/// are usually on the same cache line.
+template <typename T, typename Compare = std::less<T>, size_t arity = 4>
+class priority_queue_t
+{
+  public:
+    static_assert(arity >= 2, "A heap needs at least two children per node.");
+    static_assert(std::is_nothrow_destructible_v<T>,
+                  "Cannot instantiate a priority queue whose contents are not "
+                  "nothrow destructible.");
+    static_assert(std::is_nothrow_move_constructible_v<T> &&
+                      std::is_nothrow_move_assignable_v<T>,
+                  "Cannot instantiate a priority queue whose contents may "
+                  "throw when moved, since items are moved when sifting.");
+
+    using type = T;
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        AllocatorError,
+        OOM,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    /// Create a priority queue with room for initial_items items before it
+    /// needs to grow, allocated with parent_allocator. If zero, will be
+    /// rounded up to one.
+    [[nodiscard]] static zl::res<priority_queue_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_items) noexcept;
+
+    priority_queue_t() = delete;
+    priority_queue_t(const priority_queue_t&) = delete;
+    priority_queue_t& operator=(const priority_queue_t&) = delete;
+    // the moved-from queue is left empty, with no memory
+    inline priority_queue_t(priority_queue_t&& other) noexcept
+        : m(std::move(other.m))
+    {
+        auto items = m.items.items();
+        other.m.items = list_t<T>::make(zl::slice<T>(items, 0, 0));
+    }
+    priority_queue_t& operator=(priority_queue_t&&) = delete;
+
+    [[nodiscard]] constexpr size_t size() const noexcept
+    {
+        return m.items.items().size();
+    }
+
+    /// Every item, in heap order.
+    [[nodiscard]] constexpr zl::slice<const T> items() const noexcept
+    {
+        return m.items.items();
+    }
+
+    /// The greatest item, if there are any.
+    [[nodiscard]] inline zl::opt<const T&> top() const noexcept
+    {
+        if (size() == 0)
+            return {};
+        return m.items.get_at_unchecked(0);
+    }
+
+    /// Construct an item and move it to its place in the heap.
+    template <typename... Args>
+    [[nodiscard]] inline status_t try_push(Args&&... args) noexcept
+    {
+        auto status = m.items.try_append(std::forward<Args>(args)...);
+        if (!status.okay()) {
+            return status.err() == list_t<T>::StatusCode::OOM
+                       ? StatusCode::OOM
+                       : StatusCode::AllocatorError;
+        }
+        sift_up(size() - 1);
+        return StatusCode::Okay;
+    }
+
+    /// Remove the greatest item.
+    [[nodiscard]] zl::opt<T> try_pop() noexcept;
+
+    /// Destroy every item, keeping the memory.
+    inline void clear() noexcept
+    {
+        while (size() != 0)
+            m.items.remove_at_unchecked(size() - 1);
+    }
+
+    inline ~priority_queue_t() noexcept { clear(); }
+
+  private:
+    struct M
+    {
+        list_t<T> items;
+        Compare compare;
+    } m;
+
+    inline explicit priority_queue_t(M&& members) noexcept
+        : m(std::move(members))
+    {
+    }
+
+    inline T* data() noexcept { return m.items.items().data(); }
+
+    void sift_up(size_t index) noexcept;
+    void sift_down(size_t index) noexcept;
+};
+
+template <typename T, typename Compare, size_t arity>
+auto priority_queue_t<T, Compare, arity>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_items) noexcept
+    -> zl::res<priority_queue_t, AllocationStatusCode>
+{
+    // list_t grows by a ratio of its capacity, so it must start non-empty
+    const size_t actual_initial = initial_items == 0 ? 1 : initial_items;
+    auto maybe_items = list_t<T>::make_owning(parent_allocator, actual_initial);
+    if (!maybe_items.okay())
+        return maybe_items.err();
+    return zl::res<priority_queue_t, AllocationStatusCode>{
+        std::in_place, priority_queue_t(M{
+                           .items = maybe_items.release(),
+                           .compare = Compare{},
+                       })};
+}
+
+template <typename T, typename Compare, size_t arity>
+void priority_queue_t<T, Compare, arity>::sift_up(size_t index) noexcept
+{
+    T* const items = data();
+    // move the item out once, and move each parent down into the hole,
+    // instead of swapping at every level
+    T item(std::move(items[index]));
+    while (index > 0) {
+        const size_t parent = (index - 1) / arity;
+        if (!m.compare(items[parent], item))
+            break;
+        items[index] = std::move(items[parent]);
+        index = parent;
+    }
+    items[index] = std::move(item);
+}
+
+template <typename T, typename Compare, size_t arity>
+void priority_queue_t<T, Compare, arity>::sift_down(size_t index) noexcept
+{
+    T* const items = data();
+    const size_t count = size();
+    T item(std::move(items[index]));
+    while (true) {
+        const size_t first_child = (index * arity) + 1;
+        if (first_child >= count)
+            break;
+        const size_t end_child =
+            first_child + arity < count ? first_child + arity : count;
+        size_t greatest = first_child;
+        for (size_t child = first_child + 1; child < end_child; ++child) {
+            if (m.compare(items[greatest], items[child]))
+                greatest = child;
+        }
+        if (!m.compare(item, items[greatest]))
+            break;
+        items[index] = std::move(items[greatest]);
+        index = greatest;
+    }
+    items[index] = std::move(item);
+}
+
+template <typename T, typename Compare, size_t arity>
+zl::opt<T> priority_queue_t<T, Compare, arity>::try_pop() noexcept
+{
+    if (size() == 0)
+        return {};
+    T* const items = data();
+    const size_t last = size() - 1;
+    zl::opt<T> out(std::move(items[0]));
+    if (last != 0)
+        items[0] = std::move(items[last]);
+    m.items.remove_at_unchecked(last);
+    if (last > 1)
+        sift_down(0);
+    return out;
+}
+} // namespace allo
@@ -39,7 +39,11 @@ template <typename T> class segmented_stack_t
     segmented_stack_t() = delete;
     segmented_stack_t(const segmented_stack_t&) = delete;
     segmented_stack_t& operator=(const segmented_stack_t&) = delete;
-    segmented_stack_t(segmented_stack_t&&) noexcept = default;
+    // the moved-from stack no longer frees the segments when destroyed
+    inline segmented_stack_t(segmented_stack_t&& other) noexcept : m(other.m)
+    {
+        other.m.parent = {};
+    }
     segmented_stack_t& operator=(segmented_stack_t&&) noexcept = default;
 
     /// Make a segmented stack with a generic allocator. A segmented
@@ -88,6 +92,54 @@ template <typename T> class segmented_stack_t
         }
     }
 
+    /// Remove every item for which the callable returns true, moving the
+    /// remaining items down to fill the gaps. The order of the remaining items
+    /// is preserved. Segments are not freed, the same as pop(). Returns the
+    /// number of items removed.
+    template <typename Callable>
+    inline size_t remove_if(Callable&& callable) noexcept
+    {
+        static_assert(std::is_invocable_r_v<bool, Callable, T&>,
+                      "The given function either does not return bool or "
+                      "cannot be called with just a T&.");
+        static_assert(std::is_nothrow_move_constructible_v<T> &&
+                          std::is_nothrow_destructible_v<T>,
+                      "Cannot remove items from a stack whose contents are "
+                      "not nothrow movable and destructible.");
+        const size_t original_size = size();
+        Segment* write_segment = &m.head;
+        size_t write_index = 0;
+        size_t removed = 0;
+        for_each([&](T& item) {
+            if (callable(item)) {
+                item.~T();
+                ++removed;
+                return;
+            }
+            T* const destination = write_segment->items.data() + write_index;
+            if (destination != &item) {
+                new (destination) T(std::move(item));
+                item.~T();
+            }
+            ++write_index;
+            if (write_index == items_per_segment) {
+                write_segment = write_segment->endcap.next;
+                write_index = 0;
+            }
+        });
+
+        const size_t new_size = original_size - removed;
+        m.segment_containing_end = &m.head;
+        m.index_of_segment_containing_end =
+            new_size == 0 ? 0 : (new_size - 1) / items_per_segment;
+        for (size_t i = 0; i < m.index_of_segment_containing_end; ++i) {
+            m.segment_containing_end = m.segment_containing_end->endcap.next;
+        }
+        m.items_in_segment_containing_end =
+            new_size - (m.index_of_segment_containing_end * items_per_segment);
+        return removed;
+    }
+
     template <typename... Args>
     [[nodiscard]] inline allocation_status_t try_push(Args&&... args) noexcept
     {
@@ -0,0 +1,406 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/detail/round_up_to_multiple_of.h"
+#include "allo/status.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <cstring>
+#include <type_traits>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// A container which gives out a handle for each item inserted into it, instead
+/// of a pointer. Each handle has an index and a generation, and the generation
+/// of a slot changes whenever its item is removed, so a handle to a removed
+/// item stops working instead of pointing at whatever replaced it.
+///
+/// Items are kept next to each other in one array, in no particular order, so
+/// iterating over items() touches no gaps. Looking up a handle reads its slot,
+/// which holds the index of the item in that array. Removing an item moves the
+/// last item into its place and puts the slot on a free list for reuse.
+template <typename T> class slot_map_t
+{
+  public:
+    static_assert(std::is_nothrow_destructible_v<T>,
+                  "Cannot instantiate a slot map whose contents are not "
+                  "nothrow destructible.");
+    static_assert(std::is_nothrow_move_constructible_v<T>,
+                  "Cannot instantiate a slot map whose contents may throw "
+                  "when moved, since items are moved when one is removed.");
+
+    using type = T;
+
+    struct handle_t
+    {
+        uint32_t index;
+        /// Never zero for a handle returned by the slot map, so a zeroed
+        /// handle is never valid.
+        uint32_t generation;
+
+        [[nodiscard]] constexpr bool
+        operator==(const handle_t& other) const noexcept
+        {
+            return index == other.index && generation == other.generation;
+        }
+
+        [[nodiscard]] constexpr bool
+        operator!=(const handle_t& other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    static constexpr size_t max_capacity = UINT32_MAX - 1;
+    static constexpr size_t alignment =
+        alignof(T) > alignof(uint32_t) ? alignof(T) : alignof(uint32_t);
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        NotFound,
+        AllocatorError,
+        OOM,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    /// Number of bytes of memory needed for a slot map with the given
+    /// capacity.
+    [[nodiscard]] static constexpr size_t
+    bytes_needed(size_t capacity) noexcept;
+
+    /// Create a slot map in a fixed buffer, which is not freed when the map is
+    /// destroyed, and which fits as many items as it can. The buffer must be
+    /// aligned to slot_map_t::alignment and have room for at least one item,
+    /// otherwise InvalidArgument is returned.
+    [[nodiscard]] static zl::res<slot_map_t, AllocationStatusCode>
+    make(bytes_t memory) noexcept;
+
+    [[nodiscard]] static zl::res<slot_map_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_items) noexcept;
+
+    slot_map_t() = delete;
+    slot_map_t(const slot_map_t&) = delete;
+    slot_map_t& operator=(const slot_map_t&) = delete;
+    // the moved-from slot map is left empty, with no memory
+    inline slot_map_t(slot_map_t&& other) noexcept : m(other.m)
+    {
+        other.m = M{};
+    }
+    slot_map_t& operator=(slot_map_t&&) = delete;
+
+    [[nodiscard]] constexpr size_t size() const noexcept { return m.size; }
+
+    [[nodiscard]] constexpr size_t capacity() const noexcept
+    {
+        return m.capacity;
+    }
+
+    /// Every item, densely packed. Removing an item changes the order.
+    [[nodiscard]] constexpr zl::slice<T> items() noexcept
+    {
+        return zl::raw_slice(*m.items, m.size);
+    }
+
+    [[nodiscard]] constexpr zl::slice<const T> items() const noexcept
+    {
+        return zl::raw_slice(*static_cast<const T*>(m.items), m.size);
+    }
+
+    /// The handle to the item at the given position in items().
+    [[nodiscard]] handle_t handle_at_unchecked(size_t index) const noexcept
+    {
+        ALLO_UNCHECKED_ASSERT(index < m.size);
+        const uint32_t slot = m.item_slots[index];
+        return handle_t{slot, m.slots[slot].generation};
+    }
+
+    /// Construct a new item from args and return its handle.
+    template <typename... Args>
+    [[nodiscard]] zl::res<handle_t, StatusCode>
+    try_insert(Args&&... args) noexcept
+    {
+        static_assert(
+            std::is_nothrow_constructible_v<T, Args...>,
+            "T is not nothrow constructible with the given arguments.");
+        if (m.size == m.capacity) [[unlikely]] {
+            auto status = try_grow_to(m.capacity * 2);
+            if (!status.okay())
+                return status.err();
+        }
+        new (m.items + m.size) T(std::forward<Args>(args)...);
+        return insert_slot_for_last_item();
+    }
+
+    [[nodiscard]] zl::opt<T&> try_get(handle_t handle) noexcept;
+
+    [[nodiscard]] zl::opt<const T&> try_get(handle_t handle) const noexcept;
+
+    [[nodiscard]] bool contains(handle_t handle) const noexcept;
+
+    /// Remove the item, or return NotFound if the handle is stale.
+    [[nodiscard]] status_t try_remove(handle_t handle) noexcept;
+
+    /// Remove every item. Every handle given out so far becomes stale.
+    void clear() noexcept;
+
+    /// Grow (never shrink) so that at least "items" items fit.
+    [[nodiscard]] status_t try_reserve(size_t items) noexcept;
+
+    inline ~slot_map_t() noexcept
+    {
+        clear();
+        if (m.parent)
+            allo::free(m.parent.value(), m.memory);
+    }
+
+  private:
+    struct slot_t
+    {
+        /// Index into items if the slot is in use, otherwise the next slot in
+        /// the free list.
+        uint32_t item_or_next_free;
+        uint32_t generation;
+    };
+
+    static constexpr uint32_t end_of_free_list = UINT32_MAX;
+
+    struct M
+    {
+        zl::opt<detail::abstract_heap_allocator_t&> parent;
+        bytes_t memory;
+        T* items;
+        slot_t* slots;
+        /// For each item, the slot pointing at it.
+        uint32_t* item_slots;
+        size_t capacity;
+        size_t size;
+        /// Slots below this have been used at some point, the rest are new.
+        uint32_t slots_used;
+        uint32_t free_list;
+    } m;
+
+    inline constexpr explicit slot_map_t(M members) noexcept : m(members) {}
+
+    [[nodiscard]] static constexpr size_t slots_offset(size_t capacity) noexcept
+    {
+        return detail::round_up_to_multiple_of<alignof(slot_t)>(capacity *
+                                                                sizeof(T));
+    }
+
+    [[nodiscard]] static M layout(bytes_t memory, size_t capacity) noexcept;
+
+    [[nodiscard]] inline bool is_live(handle_t handle) const noexcept
+    {
+        return handle.index < m.slots_used &&
+               m.slots[handle.index].generation == handle.generation &&
+               handle.generation != 0;
+    }
+
+    [[nodiscard]] handle_t insert_slot_for_last_item() noexcept;
+
+    void release_slot(uint32_t slot) noexcept;
+
+    [[nodiscard]] status_t try_grow_to(size_t new_capacity) noexcept;
+};
+
+template <typename T>
+constexpr size_t slot_map_t<T>::bytes_needed(size_t capacity) noexcept
+{
+    return slots_offset(capacity) + (capacity * sizeof(slot_t)) +
+           (capacity * sizeof(uint32_t));
+}
+
+template <typename T>
+auto slot_map_t<T>::layout(bytes_t memory, size_t capacity) noexcept -> M
+{
+    uint8_t* const slots = memory.data() + slots_offset(capacity);
+    return M{
+        .parent = {},
+        .memory = memory,
+        .items = reinterpret_cast<T*>(memory.data()),
+        .slots = reinterpret_cast<slot_t*>(slots),
+        .item_slots =
+            reinterpret_cast<uint32_t*>(slots + (capacity * sizeof(slot_t))),
+        .capacity = capacity,
+        .size = 0,
+        .slots_used = 0,
+        .free_list = end_of_free_list,
+    };
+}
+
+template <typename T>
+auto slot_map_t<T>::make(bytes_t memory) noexcept
+    -> zl::res<slot_map_t, AllocationStatusCode>
+{
+    if (reinterpret_cast<uintptr_t>(memory.data()) % alignment != 0)
+        return AllocationStatusCode::InvalidArgument;
+    size_t capacity = memory.size() / (sizeof(T) + sizeof(slot_t) +
+                                       sizeof(uint32_t));
+    if (capacity > max_capacity)
+        capacity = max_capacity;
+    // account for the padding between the items and the slots
+    while (capacity > 0 && bytes_needed(capacity) > memory.size())
+        --capacity;
+    if (capacity == 0)
+        return AllocationStatusCode::InvalidArgument;
+    return zl::res<slot_map_t, AllocationStatusCode>{
+        std::in_place, slot_map_t(layout(memory, capacity))};
+}
+
+template <typename T>
+auto slot_map_t<T>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_items) noexcept -> zl::res<slot_map_t, AllocationStatusCode>
+{
+    ALLO_VALID_ARG_ASSERT(initial_items <= max_capacity);
+    if (initial_items > max_capacity)
+        return AllocationStatusCode::InvalidArgument;
+    const size_t capacity = initial_items == 0 ? 1 : initial_items;
+    auto maybe_memory = alloc<uint8_t, detail::abstract_heap_allocator_t,
+                              alignment>(parent_allocator,
+                                         bytes_needed(capacity));
+    if (!maybe_memory.okay())
+        return maybe_memory.err();
+    M members = layout(maybe_memory.release(), capacity);
+    members.parent = parent_allocator;
+    return zl::res<slot_map_t, AllocationStatusCode>{std::in_place,
+                                                     slot_map_t(members)};
+}
+
+template <typename T>
+auto slot_map_t<T>::insert_slot_for_last_item() noexcept -> handle_t
+{
+    uint32_t slot;
+    if (m.free_list != end_of_free_list) {
+        slot = m.free_list;
+        m.free_list = m.slots[slot].item_or_next_free;
+    } else {
+        // every slot which was ever used is in use, so there are no more of
+        // them than there is room for items
+        ALLO_INTERNAL_ASSERT(m.slots_used < m.capacity);
+        slot = m.slots_used++;
+        m.slots[slot].generation = 1;
+    }
+    const auto item = static_cast<uint32_t>(m.size);
+    m.slots[slot].item_or_next_free = item;
+    m.item_slots[item] = slot;
+    ++m.size;
+    return handle_t{slot, m.slots[slot].generation};
+}
+
+template <typename T> void slot_map_t<T>::release_slot(uint32_t slot) noexcept
+{
+    slot_t& released = m.slots[slot];
+    ++released.generation;
+    // zero means "never valid", so skip it when the generation wraps around
+    if (released.generation == 0) [[unlikely]]
+        released.generation = 1;
+    released.item_or_next_free = m.free_list;
+    m.free_list = slot;
+}
+
+template <typename T>
+zl::opt<T&> slot_map_t<T>::try_get(handle_t handle) noexcept
+{
+    if (!is_live(handle))
+        return {};
+    return m.items[m.slots[handle.index].item_or_next_free];
+}
+
+template <typename T>
+zl::opt<const T&> slot_map_t<T>::try_get(handle_t handle) const noexcept
+{
+    if (!is_live(handle))
+        return {};
+    return m.items[m.slots[handle.index].item_or_next_free];
+}
+
+template <typename T>
+bool slot_map_t<T>::contains(handle_t handle) const noexcept
+{
+    return is_live(handle);
+}
+
+template <typename T>
+auto slot_map_t<T>::try_remove(handle_t handle) noexcept -> status_t
+{
+    if (!is_live(handle))
+        return StatusCode::NotFound;
+    const uint32_t item = m.slots[handle.index].item_or_next_free;
+    const uint32_t last = static_cast<uint32_t>(m.size - 1);
+    m.items[item].~T();
+    // fill the hole with the last item, and point its slot at the new place
+    if (item != last) {
+        new (m.items + item) T(std::move(m.items[last]));
+        m.items[last].~T();
+        const uint32_t moved_slot = m.item_slots[last];
+        m.item_slots[item] = moved_slot;
+        m.slots[moved_slot].item_or_next_free = item;
+    }
+    --m.size;
+    release_slot(handle.index);
+    return StatusCode::Okay;
+}
+
+template <typename T> void slot_map_t<T>::clear() noexcept
+{
+    for (size_t i = 0; i < m.size; ++i) {
+        m.items[i].~T();
+        release_slot(m.item_slots[i]);
+    }
+    m.size = 0;
+}
+
+template <typename T>
+auto slot_map_t<T>::try_reserve(size_t items) noexcept -> status_t
+{
+    if (items <= m.capacity)
+        return StatusCode::Okay;
+    return try_grow_to(items);
+}
+
+template <typename T>
+auto slot_map_t<T>::try_grow_to(size_t new_capacity) noexcept -> status_t
+{
+    if (!m.parent || m.capacity == 0)
+        return StatusCode::OOM;
+    if (new_capacity > max_capacity) {
+        if (m.capacity == max_capacity)
+            return StatusCode::OOM;
+        new_capacity = max_capacity;
+    }
+    auto& parent = m.parent.value();
+    auto maybe_memory =
+        alloc<uint8_t, detail::abstract_heap_allocator_t, alignment>(
+            parent, bytes_needed(new_capacity));
+    if (!maybe_memory.okay())
+        return StatusCode::AllocatorError;
+
+    const M old = m;
+    m = layout(maybe_memory.release(), new_capacity);
+    m.parent = old.parent;
+    m.size = old.size;
+    m.slots_used = old.slots_used;
+    m.free_list = old.free_list;
+    for (size_t i = 0; i < old.size; ++i) {
+        new (m.items + i) T(std::move(old.items[i]));
+        old.items[i].~T();
+    }
+    std::memcpy(m.slots, old.slots, old.slots_used * sizeof(slot_t));
+    std::memcpy(m.item_slots, old.item_slots, old.size * sizeof(uint32_t));
+    allo::free(parent, old.memory);
+    return StatusCode::Okay;
+}
+} // namespace allo
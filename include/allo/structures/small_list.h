@@ -0,0 +1,327 @@
+#pragma once
+#include <cmath>
+#include <type_traits>
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/status.h"
+#include "allo/structures/uninitialized_array.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "allo/typed_reallocation.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// A list_t which keeps its first N items inside of itself, and only allocates
+/// from its parent allocator once it has more than that. After that it grows
+/// with allo::realloc, like list_t.
+template <typename T, size_t N> class small_list_t
+{
+  public:
+    static_assert(std::is_nothrow_destructible_v<T>,
+                  "Cannot instantiate a list whose contents are not nothrow "
+                  "destructible.");
+    static_assert(std::is_nothrow_move_constructible_v<T>,
+                  "Cannot instantiate a small list whose contents may throw "
+                  "when moved, since items are moved out of the inline "
+                  "buffer.");
+    static_assert(N > 0, "Cannot instantiate a small list with no inline "
+                         "items, use list_t instead.");
+
+    using type = T;
+
+    static constexpr size_t inline_capacity = N;
+    static constexpr double realloc_ratio = 1.5;
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        IndexOutOfRange,
+        AllocatorError,
+        OOM,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    small_list_t() = delete;
+    small_list_t(const small_list_t&) = delete;
+    small_list_t& operator=(const small_list_t&) = delete;
+    // inline items are moved one by one, allocated ones are taken over. the
+    // moved-from list is left empty either way.
+    inline small_list_t(small_list_t&& other) noexcept
+        : m{.parent = other.m.parent,
+            .allocated = other.m.allocated,
+            .capacity = other.m.capacity,
+            .size = other.m.size}
+    {
+        if (!other.m.allocated) {
+            for (size_t i = 0; i < other.m.size; ++i) {
+                T& item = other.m.inline_items.data()[i];
+                new (m.inline_items.data() + i) T(std::move(item));
+                item.~T();
+            }
+        }
+        other.m.allocated = nullptr;
+        other.m.capacity = N;
+        other.m.size = 0;
+    }
+    small_list_t& operator=(small_list_t&&) = delete;
+
+    /// Create a small list which can never hold more than N items.
+    [[nodiscard]] static inline small_list_t make() noexcept
+    {
+        return small_list_t(zl::opt<detail::abstract_heap_allocator_t&>{});
+    }
+
+    /// Create a small list which allocates from parent_allocator once it has
+    /// more than N items. Only allocates right away if initial_items is more
+    /// than N.
+    [[nodiscard]] static zl::res<small_list_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_items = 0) noexcept;
+
+    [[nodiscard]] inline zl::slice<const T> items() const noexcept
+    {
+        return zl::raw_slice(*static_cast<const T*>(data()), m.size);
+    }
+
+    [[nodiscard]] inline zl::slice<T> items() noexcept
+    {
+        return zl::raw_slice(*data(), m.size);
+    }
+
+    [[nodiscard]] constexpr size_t capacity() const noexcept
+    {
+        return m.capacity;
+    }
+
+    /// Whether the items are still stored inside of the list.
+    [[nodiscard]] constexpr bool is_inline() const noexcept
+    {
+        return m.allocated == nullptr;
+    }
+
+    template <typename... Args>
+    [[nodiscard]] status_t try_insert_at(size_t index, Args&&... args) noexcept
+    {
+        ALLO_VALID_ARG_ASSERT(index <= m.size);
+        if (index > m.size) {
+            return StatusCode::IndexOutOfRange;
+        }
+        auto status = try_realloc_if_needed();
+        if (!status.okay())
+            return status.err();
+        ALLO_INTERNAL_ASSERT(m.capacity > m.size);
+        static_assert(
+            std::is_nothrow_constructible_v<T, Args...>,
+            "T is not nothrow constructible with the given arguments.");
+        T* const items = data();
+        // move all items between the end of the buffer and index up one to
+        // make room for the new item
+        for (size_t i = m.size; i > index; --i) {
+            new (items + i) T(std::move(items[i - 1]));
+            items[i - 1].~T();
+        }
+        new (items + index) T(std::forward<Args>(args)...);
+        ++m.size;
+        return StatusCode::Okay;
+    }
+
+    [[nodiscard]] status_t try_remove_at(size_t index) noexcept;
+
+    template <typename... Args>
+    [[nodiscard]] status_t try_append(Args&&... args) noexcept
+    {
+        auto status = try_realloc_if_needed();
+        if (!status.okay())
+            return status.err();
+        static_assert(
+            std::is_nothrow_constructible_v<T, Args...>,
+            "T is not nothrow constructible with the given arguments.");
+        new (data() + m.size) T(std::forward<Args>(args)...);
+        ++m.size;
+        return StatusCode::Okay;
+    }
+
+    [[nodiscard]] zl::opt<T&> try_get_at(size_t index) noexcept;
+
+    [[nodiscard]] zl::opt<const T&> try_get_at(size_t index) const noexcept;
+
+    void remove_at_unchecked(size_t index) noexcept;
+
+    [[nodiscard]] T& get_at_unchecked(size_t index) noexcept;
+
+    [[nodiscard]] const T& get_at_unchecked(size_t index) const noexcept;
+
+    inline ~small_list_t() noexcept
+    {
+        T* const items = data();
+        for (size_t i = 0; i < m.size; ++i)
+            items[i].~T();
+        if (m.allocated) {
+            ALLO_INTERNAL_ASSERT(m.parent);
+            allo::free(m.parent.value(),
+                       zl::raw_slice(*m.allocated, m.capacity));
+        }
+    }
+
+  private:
+    struct M
+    {
+        zl::opt<detail::abstract_heap_allocator_t&> parent;
+        /// Null while the items are in inline_items.
+        T* allocated = nullptr;
+        size_t capacity = N;
+        size_t size = 0;
+        uninitialized_array_t<T, N> inline_items;
+    } m;
+
+    inline explicit small_list_t(
+        zl::opt<detail::abstract_heap_allocator_t&> parent) noexcept
+        : m{.parent = parent}
+    {
+    }
+
+    [[nodiscard]] inline T* data() noexcept
+    {
+        return m.allocated ? m.allocated : m.inline_items.data();
+    }
+
+    [[nodiscard]] inline const T* data() const noexcept
+    {
+        return m.allocated ? m.allocated
+                           : const_cast<M&>(m).inline_items.data();
+    }
+
+    [[nodiscard]] status_t try_spill(size_t new_capacity) noexcept;
+
+    [[nodiscard]] status_t try_realloc_if_needed() noexcept;
+};
+
+template <typename T, size_t N>
+zl::res<small_list_t<T, N>, AllocationStatusCode>
+small_list_t<T, N>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_items) noexcept
+{
+    zl::res<small_list_t, AllocationStatusCode> out{
+        std::in_place, small_list_t(parent_allocator)};
+    if (initial_items > N) {
+        auto result = alloc<T>(parent_allocator, initial_items);
+        if (!result.okay())
+            return result.err();
+        small_list_t& list = out.release_ref();
+        list.m.allocated = result.release().data();
+        list.m.capacity = initial_items;
+    }
+    return out;
+}
+
+template <typename T, size_t N>
+auto small_list_t<T, N>::try_remove_at(size_t index) noexcept -> status_t
+{
+    ALLO_VALID_ARG_ASSERT(index < m.size);
+    if (index >= m.size) {
+        return StatusCode::IndexOutOfRange;
+    }
+    remove_at_unchecked(index);
+    return StatusCode::Okay;
+}
+
+template <typename T, size_t N>
+void small_list_t<T, N>::remove_at_unchecked(size_t index) noexcept
+{
+    ALLO_UNCHECKED_ASSERT(index < m.size);
+    T* const items = data();
+    items[index].~T();
+    for (size_t i = index; i < m.size - 1; ++i) {
+        new (items + i) T(std::move(items[i + 1]));
+        items[i + 1].~T();
+    }
+    --m.size;
+}
+
+template <typename T, size_t N>
+auto small_list_t<T, N>::try_spill(size_t new_capacity) noexcept -> status_t
+{
+    ALLO_INTERNAL_ASSERT(!m.allocated && m.parent);
+    auto result = alloc<T>(m.parent.value(), new_capacity);
+    if (!result.okay())
+        return StatusCode::AllocatorError;
+    T* const allocated = result.release().data();
+    for (size_t i = 0; i < m.size; ++i) {
+        T& item = m.inline_items.data()[i];
+        new (allocated + i) T(std::move(item));
+        item.~T();
+    }
+    m.allocated = allocated;
+    m.capacity = new_capacity;
+    return StatusCode::Okay;
+}
+
+template <typename T, size_t N>
+auto small_list_t<T, N>::try_realloc_if_needed() noexcept -> status_t
+{
+    // NOTE: like list_t, only one item is ever added at a time
+    if (m.capacity > m.size)
+        return StatusCode::Okay;
+    if (!m.parent)
+        return StatusCode::OOM;
+
+    const auto newsize = static_cast<size_t>(
+        std::ceil(static_cast<double>(m.capacity) * realloc_ratio));
+    if (!m.allocated)
+        return try_spill(newsize);
+
+    auto realloc_result = allo::realloc(
+        m.parent.value(), zl::raw_slice(*m.allocated, m.capacity), newsize);
+    if (!realloc_result.okay())
+        return StatusCode::AllocatorError;
+
+    m.allocated = realloc_result.release().data();
+    m.capacity = newsize;
+    return StatusCode::Okay;
+}
+
+template <typename T, size_t N>
+zl::opt<T&> small_list_t<T, N>::try_get_at(size_t index) noexcept
+{
+    ALLO_VALID_ARG_ASSERT(index < m.size);
+    if (index >= m.size)
+        return {};
+    return get_at_unchecked(index);
+}
+
+template <typename T, size_t N>
+zl::opt<const T&> small_list_t<T, N>::try_get_at(size_t index) const noexcept
+{
+    ALLO_VALID_ARG_ASSERT(index < m.size);
+    if (index >= m.size)
+        return {};
+    return get_at_unchecked(index);
+}
+
+template <typename T, size_t N>
+T& small_list_t<T, N>::get_at_unchecked(size_t index) noexcept
+{
+    ALLO_UNCHECKED_ASSERT(index < m.size);
+    return data()[index];
+}
+
+template <typename T, size_t N>
+const T& small_list_t<T, N>::get_at_unchecked(size_t index) const noexcept
+{
+    ALLO_UNCHECKED_ASSERT(index < m.size);
+    return data()[index];
+}
+
+} // namespace allo
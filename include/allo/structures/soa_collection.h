@@ -0,0 +1,329 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/detail/round_up_to_multiple_of.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "allo/typed_reallocation.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+#include <utility>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// A collection_t which stores each field of its items in a separate column,
+/// instead of storing whole items next to each other. All of the columns are
+/// in one allocation, each starting on a simd_alignment boundary, so a loop
+/// over one column only touches that column and can be vectorized with
+/// aligned loads. Like collection_t, the order of items is not kept when
+/// removing.
+template <typename... Fields> class soa_collection_t
+{
+  public:
+    static_assert(sizeof...(Fields) > 0,
+                  "Cannot instantiate a soa_collection_t with no fields.");
+    static_assert((std::is_trivially_copyable_v<Fields> && ...),
+                  "soa_collection_t moves columns with memmove when it grows, "
+                  "so every field must be trivially copyable.");
+
+    static constexpr size_t num_columns = sizeof...(Fields);
+    /// Alignment of the start of every column, enough for 256 bit vectors.
+    static constexpr size_t simd_alignment = 32;
+    static_assert(((alignof(Fields) <= simd_alignment) && ...),
+                  "Cannot put a field which is aligned to more than "
+                  "simd_alignment in a soa_collection_t.");
+
+    template <size_t column>
+    using field_t = std::tuple_element_t<column, std::tuple<Fields...>>;
+
+    static constexpr float realloc_ratio = 1.5f;
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        OutOfRange,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    /// Number of bytes needed to hold "capacity" items, including the padding
+    /// between columns.
+    [[nodiscard]] static constexpr size_t
+    bytes_needed(size_t capacity) noexcept
+    {
+        return column_offsets(capacity)[num_columns];
+    }
+
+    /// Create a new soa_collection_t with one buffer from a heap allocator.
+    /// initial_items is the number of items to reserve space for initially.
+    /// If zero, will be rounded up to one. The parent has to give out memory
+    /// aligned to simd_alignment, which malloc, and so c_allocator_t, often
+    /// does not. AllocationTooAligned is returned if it does not, either here
+    /// or when growing.
+    [[nodiscard]] static zl::res<soa_collection_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_items) noexcept;
+
+    /// Create a soa_collection_t which fits as many items as it can in the
+    /// given memory, and never grows. The memory must be aligned to
+    /// simd_alignment, otherwise InvalidArgument is returned.
+    [[nodiscard]] static zl::res<soa_collection_t, AllocationStatusCode>
+    make(bytes_t memory) noexcept;
+
+    soa_collection_t() = delete;
+    soa_collection_t(const soa_collection_t&) = delete;
+    soa_collection_t& operator=(const soa_collection_t&) = delete;
+    // the moved-from collection no longer frees the memory when destroyed
+    inline soa_collection_t(soa_collection_t&& other) noexcept : m(other.m)
+    {
+        other.m.parent = {};
+        other.m.size = 0;
+    }
+    soa_collection_t& operator=(soa_collection_t&&) = delete;
+
+    [[nodiscard]] constexpr size_t size() const noexcept { return m.size; }
+
+    [[nodiscard]] constexpr size_t capacity() const noexcept
+    {
+        return m.capacity;
+    }
+
+    /// Every item's value for one field.
+    template <size_t column>
+    [[nodiscard]] inline zl::slice<field_t<column>> items() noexcept
+    {
+        return zl::raw_slice(*column_data<column>(), m.size);
+    }
+
+    template <size_t column>
+    [[nodiscard]] inline zl::slice<const field_t<column>>
+    items() const noexcept
+    {
+        return zl::raw_slice(
+            *static_cast<const field_t<column>*>(
+                const_cast<soa_collection_t*>(this)->column_data<column>()),
+            m.size);
+    }
+
+    /// Add an item, made of one value for each field.
+    template <typename... Args>
+    [[nodiscard]] inline allocation_status_t try_put(Args&&... args) noexcept
+    {
+        if (m.capacity <= m.size) [[unlikely]] {
+            auto status = try_realloc();
+            if (!status.okay()) [[unlikely]] {
+                return status.err();
+            }
+        }
+        ALLO_INTERNAL_ASSERT(m.capacity > m.size);
+        put_unchecked(std::forward<Args>(args)...);
+        return AllocationStatusCode::Okay;
+    }
+
+    /// Remove the item at index by moving the last item into its place.
+    [[nodiscard]] inline status_t try_remove_at(size_t index) noexcept
+    {
+        if (index >= m.size) [[unlikely]]
+            return StatusCode::OutOfRange;
+        remove_at_unchecked(index);
+        return StatusCode::Okay;
+    }
+
+    // unsafe api
+    inline void remove_at_unchecked(size_t index) noexcept
+    {
+        ALLO_UNCHECKED_ASSERT(index < m.size);
+        remove_at_unchecked_inner(index,
+                                  std::make_index_sequence<num_columns>());
+    }
+
+    template <typename... Args>
+    inline void put_unchecked(Args&&... args) noexcept
+    {
+        static_assert(sizeof...(Args) == num_columns,
+                      "put needs one value for each field.");
+        ALLO_UNCHECKED_ASSERT(m.size < m.capacity);
+        put_unchecked_inner(std::make_index_sequence<num_columns>(),
+                            std::forward<Args>(args)...);
+        ++m.size;
+    }
+
+    inline ~soa_collection_t() noexcept
+    {
+        if (m.parent)
+            allo::free(m.parent.value(), m.memory);
+    }
+
+  private:
+    /// Unit of the allocation, so that allo::realloc keeps it aligned for
+    /// every column.
+    struct alignas(simd_alignment) chunk_t
+    {
+        uint8_t bytes[simd_alignment];
+    };
+
+    struct M
+    {
+        zl::opt<detail::abstract_heap_allocator_t&> parent;
+        zl::slice<chunk_t> memory;
+        size_t capacity;
+        size_t size;
+        // column_offsets(capacity), kept so that accessing a column does not
+        // recompute every offset
+        std::array<size_t, num_columns + 1> offsets;
+    } m;
+
+    inline constexpr explicit soa_collection_t(M members) noexcept
+        : m(members)
+    {
+    }
+
+    /// Where each column starts, and where the last one ends.
+    [[nodiscard]] static constexpr std::array<size_t, num_columns + 1>
+    column_offsets(size_t capacity) noexcept
+    {
+        constexpr std::array<size_t, num_columns> sizes = {sizeof(Fields)...};
+        std::array<size_t, num_columns + 1> offsets{};
+        size_t offset = 0;
+        for (size_t i = 0; i < num_columns; ++i) {
+            offsets[i] = offset;
+            offset = detail::round_up_to_multiple_of<simd_alignment>(
+                offset + (sizes[i] * capacity));
+        }
+        offsets[num_columns] = offset;
+        return offsets;
+    }
+
+    template <size_t column>
+    [[nodiscard]] inline field_t<column>* column_data() noexcept
+    {
+        return reinterpret_cast<field_t<column>*>(
+            reinterpret_cast<uint8_t*>(m.memory.data()) + m.offsets[column]);
+    }
+
+    template <size_t... columns, typename... Args>
+    inline void put_unchecked_inner(std::index_sequence<columns...>,
+                                    Args&&... args) noexcept
+    {
+        static_assert(
+            (std::is_nothrow_constructible_v<field_t<columns>, Args> && ...),
+            "A field is not nothrow constructible from the given argument.");
+        (new (column_data<columns>() + m.size)
+             field_t<columns>(std::forward<Args>(args)),
+         ...);
+    }
+
+    template <size_t... columns>
+    inline void remove_at_unchecked_inner(size_t index,
+                                          std::index_sequence<columns...>)
+    {
+        const size_t last = m.size - 1;
+        if (index != last) {
+            ((column_data<columns>()[index] = column_data<columns>()[last]),
+             ...);
+        }
+        m.size = last;
+    }
+
+    [[nodiscard]] allocation_status_t try_realloc() noexcept;
+};
+
+template <typename... Fields>
+auto soa_collection_t<Fields...>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_items) noexcept
+    -> zl::res<soa_collection_t, AllocationStatusCode>
+{
+    const size_t actual_initial = initial_items == 0 ? 1 : initial_items;
+    auto maybe_memory = allo::alloc<chunk_t>(
+        parent_allocator, bytes_needed(actual_initial) / sizeof(chunk_t));
+    if (!maybe_memory.okay())
+        return maybe_memory.err();
+    const zl::slice<chunk_t> memory = maybe_memory.release();
+    if (reinterpret_cast<uintptr_t>(memory.data()) % simd_alignment != 0)
+        [[unlikely]] {
+        allo::free(parent_allocator, memory);
+        return AllocationStatusCode::AllocationTooAligned;
+    }
+
+    return zl::res<soa_collection_t, AllocationStatusCode>{
+        std::in_place, soa_collection_t(M{
+                           .parent = parent_allocator,
+                           .memory = memory,
+                           .capacity = actual_initial,
+                           .size = 0,
+                           .offsets = column_offsets(actual_initial),
+                       })};
+}
+
+template <typename... Fields>
+auto soa_collection_t<Fields...>::make(bytes_t memory) noexcept
+    -> zl::res<soa_collection_t, AllocationStatusCode>
+{
+    if (reinterpret_cast<uintptr_t>(memory.data()) % simd_alignment != 0)
+        return AllocationStatusCode::InvalidArgument;
+    constexpr size_t bytes_per_item = (sizeof(Fields) + ...);
+    size_t capacity = memory.size() / bytes_per_item;
+    // account for the padding between columns
+    while (capacity > 0 && bytes_needed(capacity) > memory.size())
+        --capacity;
+    if (capacity == 0)
+        return AllocationStatusCode::InvalidArgument;
+    return zl::res<soa_collection_t, AllocationStatusCode>{
+        std::in_place,
+        soa_collection_t(M{
+            .parent = {},
+            .memory = zl::raw_slice(*reinterpret_cast<chunk_t*>(memory.data()),
+                                    memory.size() / sizeof(chunk_t)),
+            .capacity = capacity,
+            .size = 0,
+            .offsets = column_offsets(capacity),
+        })};
+}
+
+template <typename... Fields>
+allocation_status_t soa_collection_t<Fields...>::try_realloc() noexcept
+{
+    if (!m.parent)
+        return AllocationStatusCode::OOM;
+    size_t new_capacity = static_cast<size_t>(
+        std::ceil(static_cast<float>(m.capacity) * realloc_ratio));
+    if (new_capacity <= m.capacity)
+        new_capacity = m.capacity + 1;
+
+    auto result = allo::realloc(m.parent.value(), m.memory,
+                                bytes_needed(new_capacity) / sizeof(chunk_t));
+    if (!result.okay())
+        return result.err();
+    m.memory = result.release();
+    // the items were copied to the same offsets in the new memory, so they
+    // are still fine where they are, just not aligned for simd anymore
+    if (reinterpret_cast<uintptr_t>(m.memory.data()) % simd_alignment != 0)
+        [[unlikely]]
+        return AllocationStatusCode::AllocationTooAligned;
+
+    // every column starts at the same place or later than it did before, so
+    // moving the last one first never overwrites one which hasn't moved yet
+    constexpr std::array<size_t, num_columns> sizes = {sizeof(Fields)...};
+    const auto new_offsets = column_offsets(new_capacity);
+    auto* const bytes = reinterpret_cast<uint8_t*>(m.memory.data());
+    for (size_t i = num_columns; i-- > 1;) {
+        std::memmove(bytes + new_offsets[i], bytes + m.offsets[i],
+                     sizes[i] * m.size);
+    }
+    m.capacity = new_capacity;
+    m.offsets = new_offsets;
+    return AllocationStatusCode::Okay;
+}
+} // namespace allo
@@ -0,0 +1,275 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/detail/asserts.h"
+#include "allo/detail/cache_line_size.h"
+#include "allo/status.h"
+#include "allo/structures/any_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <atomic>
+#include <type_traits>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// A bounded queue for passing items from one producer thread to one consumer
+/// thread without locking. The producer and consumer each keep their index on
+/// their own cache line, along with a copy of the other's index which is only
+/// refreshed when the queue looks too full (or too empty) for the operation, so
+/// most pushes and pops touch no cache line written by the other thread.
+///
+/// The batch functions publish any number of items with a single atomic store.
+template <typename T> class spsc_queue_t
+{
+  public:
+    // the batch pops move assign into the caller's items
+    static_assert(std::is_nothrow_destructible_v<T> &&
+                      std::is_nothrow_move_constructible_v<T> &&
+                      std::is_nothrow_move_assignable_v<T>,
+                  "Cannot instantiate a queue whose contents are not nothrow "
+                  "movable and destructible.");
+
+    using type = T;
+
+    enum class StatusCode : uint8_t
+    {
+        Okay,
+        ResultReleased,
+        Full,
+    };
+
+    using status_t = zl::status<StatusCode>;
+
+    /// Make a queue which holds at least minimum_capacity items, rounded up to
+    /// a power of two. The ring is allocated from parent_allocator, and not
+    /// freed when the queue is destroyed.
+    [[nodiscard]] static zl::res<spsc_queue_t, AllocationStatusCode>
+    make(detail::abstract_allocator_t& parent_allocator,
+         size_t minimum_capacity) noexcept;
+
+    /// Same as make(), except the ring is freed when the queue is destroyed.
+    [[nodiscard]] static zl::res<spsc_queue_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t minimum_capacity) noexcept;
+
+    spsc_queue_t() = delete;
+    spsc_queue_t(const spsc_queue_t&) = delete;
+    spsc_queue_t& operator=(const spsc_queue_t&) = delete;
+    // can be moved before it is shared between threads, but not after
+    inline spsc_queue_t(spsc_queue_t&& other) noexcept
+        : spsc_queue_t(other.m.items, other.m.mask + 1, other.m.parent)
+    {
+        m.producer.tail.store(other.m.producer.tail.load());
+        m.producer.cached_head = other.m.producer.cached_head;
+        m.consumer.head.store(other.m.consumer.head.load());
+        m.consumer.cached_tail = other.m.consumer.cached_tail;
+        other.m.items = nullptr;
+    }
+    spsc_queue_t& operator=(spsc_queue_t&&) = delete;
+
+    [[nodiscard]] constexpr size_t capacity() const noexcept
+    {
+        return m.mask + 1;
+    }
+
+    /// Number of items in the queue. Only exact if neither thread is using it.
+    [[nodiscard]] inline size_t size() const noexcept
+    {
+        return m.producer.tail.load(std::memory_order_acquire) -
+               m.consumer.head.load(std::memory_order_acquire);
+    }
+
+    /// Construct an item at the back of the queue. Only the producer may call
+    /// this.
+    template <typename... Args>
+    [[nodiscard]] inline status_t try_push(Args&&... args) noexcept
+    {
+        static_assert(
+            std::is_nothrow_constructible_v<T, Args...>,
+            "T is not nothrow constructible with the given arguments.");
+        const size_t tail = m.producer.tail.load(std::memory_order_relaxed);
+        if (free_space_for_producer(tail, 1) == 0)
+            return StatusCode::Full;
+        new (m.items + (tail & m.mask)) T(std::forward<Args>(args)...);
+        m.producer.tail.store(tail + 1, std::memory_order_release);
+        return StatusCode::Okay;
+    }
+
+    /// Move as many items from the start of "items" into the queue as fit,
+    /// and return how many that was. Only the producer may call this.
+    [[nodiscard]] size_t try_push_batch(zl::slice<T> items) noexcept;
+
+    /// Remove the item at the front of the queue. Only the consumer may call
+    /// this.
+    [[nodiscard]] inline zl::opt<T> try_pop() noexcept
+    {
+        const size_t head = m.consumer.head.load(std::memory_order_relaxed);
+        if (items_for_consumer(head, 1) == 0)
+            return {};
+        T& item = m.items[head & m.mask];
+        zl::opt<T> out(std::move(item));
+        item.~T();
+        m.consumer.head.store(head + 1, std::memory_order_release);
+        return out;
+    }
+
+    /// Move items from the front of the queue into "destination" (which must
+    /// hold constructed items, that are move assigned to) until either it is
+    /// full or the queue is empty, and return how many were moved. Only the
+    /// consumer may call this.
+    [[nodiscard]] size_t try_pop_batch(zl::slice<T> destination) noexcept;
+
+    inline ~spsc_queue_t() noexcept
+    {
+        if (!m.items)
+            return;
+        const size_t tail = m.producer.tail.load(std::memory_order_acquire);
+        for (size_t i = m.consumer.head.load(std::memory_order_acquire);
+             i != tail; ++i) {
+            m.items[i & m.mask].~T();
+        }
+        if (m.parent.is_heap()) {
+            allo::free(m.parent.get_heap_unchecked(),
+                       zl::raw_slice(*m.items, m.mask + 1));
+        }
+    }
+
+  private:
+    struct M
+    {
+        struct alignas(detail::cache_line_size)
+        {
+            std::atomic<size_t> tail;
+            // the last head the producer saw, which only moves forward
+            size_t cached_head;
+        } producer;
+        struct alignas(detail::cache_line_size)
+        {
+            std::atomic<size_t> head;
+            size_t cached_tail;
+        } consumer;
+        // never written after construction, so shared by both threads
+        alignas(detail::cache_line_size) T* items;
+        size_t mask;
+        any_allocator_t parent;
+    } m;
+
+    inline spsc_queue_t(T* items, size_t capacity,
+                        any_allocator_t parent) noexcept
+    {
+        m.producer.tail.store(0, std::memory_order_relaxed);
+        m.producer.cached_head = 0;
+        m.consumer.head.store(0, std::memory_order_relaxed);
+        m.consumer.cached_tail = 0;
+        m.items = items;
+        m.mask = capacity - 1;
+        m.parent = parent;
+    }
+
+    [[nodiscard]] static zl::res<spsc_queue_t, AllocationStatusCode>
+    make_inner(detail::abstract_allocator_t& allocator, any_allocator_t parent,
+               size_t minimum_capacity) noexcept;
+
+    /// Only reloads the consumer's index if the cached copy says there is room
+    /// for fewer than wanted items.
+    [[nodiscard]] inline size_t free_space_for_producer(size_t tail,
+                                                        size_t wanted) noexcept
+    {
+        size_t free = capacity() - (tail - m.producer.cached_head);
+        if (free < wanted) {
+            m.producer.cached_head =
+                m.consumer.head.load(std::memory_order_acquire);
+            free = capacity() - (tail - m.producer.cached_head);
+        }
+        return free;
+    }
+
+    [[nodiscard]] inline size_t items_for_consumer(size_t head,
+                                                   size_t wanted) noexcept
+    {
+        size_t available = m.consumer.cached_tail - head;
+        if (available < wanted) {
+            m.consumer.cached_tail =
+                m.producer.tail.load(std::memory_order_acquire);
+            available = m.consumer.cached_tail - head;
+        }
+        return available;
+    }
+};
+
+template <typename T>
+auto spsc_queue_t<T>::make_inner(detail::abstract_allocator_t& allocator,
+                                 any_allocator_t parent,
+                                 size_t minimum_capacity) noexcept
+    -> zl::res<spsc_queue_t, AllocationStatusCode>
+{
+    ALLO_VALID_ARG_ASSERT(minimum_capacity != 0);
+    if (minimum_capacity == 0)
+        return AllocationStatusCode::InvalidArgument;
+    size_t capacity = 1;
+    while (capacity < minimum_capacity)
+        capacity *= 2;
+    auto maybe_items = alloc<T>(allocator, capacity);
+    if (!maybe_items.okay())
+        return maybe_items.err();
+    return zl::res<spsc_queue_t, AllocationStatusCode>{
+        std::in_place,
+        spsc_queue_t(maybe_items.release().data(), capacity, parent)};
+}
+
+template <typename T>
+auto spsc_queue_t<T>::make(detail::abstract_allocator_t& parent_allocator,
+                           size_t minimum_capacity) noexcept
+    -> zl::res<spsc_queue_t, AllocationStatusCode>
+{
+    return make_inner(parent_allocator, parent_allocator, minimum_capacity);
+}
+
+template <typename T>
+auto spsc_queue_t<T>::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t minimum_capacity) noexcept
+    -> zl::res<spsc_queue_t, AllocationStatusCode>
+{
+    return make_inner(parent_allocator, parent_allocator, minimum_capacity);
+}
+
+template <typename T>
+size_t spsc_queue_t<T>::try_push_batch(zl::slice<T> items) noexcept
+{
+    const size_t tail = m.producer.tail.load(std::memory_order_relaxed);
+    size_t count = free_space_for_producer(tail, items.size());
+    if (count > items.size())
+        count = items.size();
+    for (size_t i = 0; i < count; ++i)
+        new (m.items + ((tail + i) & m.mask)) T(std::move(items.data()[i]));
+    // publish them all at once
+    if (count != 0)
+        m.producer.tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+template <typename T>
+size_t spsc_queue_t<T>::try_pop_batch(zl::slice<T> destination) noexcept
+{
+    const size_t head = m.consumer.head.load(std::memory_order_relaxed);
+    size_t count = items_for_consumer(head, destination.size());
+    if (count > destination.size())
+        count = destination.size();
+    for (size_t i = 0; i < count; ++i) {
+        T& item = m.items[(head + i) & m.mask];
+        destination.data()[i] = std::move(item);
+        item.~T();
+    }
+    if (count != 0)
+        m.consumer.head.store(head + count, std::memory_order_release);
+    return count;
+}
+} // namespace allo
@@ -37,8 +37,24 @@ template <typename T> class stack_t
     stack_t() = delete;
     stack_t(const stack_t&) = delete;
     stack_t& operator=(const stack_t&) = delete;
-    stack_t(stack_t&&) noexcept = default;
-    stack_t& operator=(stack_t&&) noexcept = default;
+    // the moved-from stack no longer frees the memory when destroyed
+    inline stack_t(stack_t&& other) noexcept : m(other.m)
+    {
+        other.m.parent = {};
+    }
+    // frees this stack's memory before taking the other's
+    inline stack_t& operator=(stack_t&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        if (m.parent) {
+            allo::free(m.parent.value(),
+                       zl::raw_slice(*m.items.begin().ptr(), m.capacity));
+        }
+        m = other.m;
+        other.m.parent = {};
+        return *this;
+    }
 
     [[nodiscard]] constexpr zl::slice<const T> items() const noexcept;
 
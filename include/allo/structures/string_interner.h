@@ -0,0 +1,313 @@
+#pragma once
+#ifdef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY
+#endif
+#include "allo/ctti/detail/hash.h"
+#include "allo/detail/asserts.h"
+#include "allo/scratch_allocator.h"
+#include "allo/status.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "allo/typed_reallocation.h"
+#ifdef ALLO_HEADER_ONLY_AVOID
+#undef ALLO_HEADER_ONLY_AVOID
+#define ALLO_HEADER_ONLY
+#endif
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <ziglike/opt.h>
+#include <ziglike/slice.h>
+
+namespace allo {
+/// A table of unique strings, each identified by a 32 bit id. The bytes of
+/// the strings are copied one after another into a scratch_allocator_t owned
+/// by the interner, so they never move and are all freed at once when the
+/// interner is destroyed. The ids are looked up with an open addressing
+/// table of FNV-1a hashes, so two interned strings are equal if and only if
+/// their ids are.
+class string_interner_t
+{
+  public:
+    using id_t = uint32_t;
+    using hash_t = ctti::detail::hash_t;
+
+    /// The largest number of strings an interner can hold.
+    static constexpr size_t max_strings =
+        std::numeric_limits<id_t>::max() - 1;
+
+    /// Same result as ctti::detail::fnv1a_hash, so that hashes of string
+    /// literals can be computed at compile time and passed to try_intern()
+    /// and find(). This one is a loop instead of recursing once per
+    /// character.
+    [[nodiscard]] static constexpr hash_t
+    hash(std::string_view string) noexcept
+    {
+        hash_t out = ctti::detail::fnv_basis;
+        for (const char c : string)
+            out = (out ^ static_cast<hash_t>(c)) * ctti::detail::fnv_prime;
+        return out;
+    }
+
+    /// Make an interner with room for initial_strings strings before its
+    /// table needs to grow, and initial_bytes bytes of string contents before
+    /// its scratch allocator needs more memory. Everything is allocated from
+    /// parent_allocator. Zeroes are rounded up to one.
+    [[nodiscard]] static zl::res<string_interner_t, AllocationStatusCode>
+    make_owning(detail::abstract_heap_allocator_t& parent_allocator,
+                size_t initial_strings, size_t initial_bytes) noexcept;
+
+    string_interner_t() = delete;
+    string_interner_t(const string_interner_t&) = delete;
+    string_interner_t& operator=(const string_interner_t&) = delete;
+    // the moved-from interner is left empty, with no memory
+    inline string_interner_t(string_interner_t&& other) noexcept
+        : m(std::move(other.m))
+    {
+        other.m.parent = {};
+        other.m.size = 0;
+    }
+    string_interner_t& operator=(string_interner_t&&) = delete;
+
+    /// Number of unique strings interned.
+    [[nodiscard]] constexpr size_t size() const noexcept { return m.size; }
+
+    /// Get the id of the string, copying it into the interner if it has not
+    /// been interned before. If this fails, nothing is changed.
+    [[nodiscard]] inline zl::res<id_t, AllocationStatusCode>
+    try_intern(std::string_view string) noexcept
+    {
+        return try_intern(string, hash(string));
+    }
+
+    /// Same as try_intern(string), with the hash already computed with
+    /// hash() or ctti::detail::fnv1a_hash.
+    [[nodiscard]] zl::res<id_t, AllocationStatusCode>
+    try_intern(std::string_view string, hash_t hash) noexcept;
+
+    /// Get the id of the string if it has been interned, without adding it.
+    [[nodiscard]] inline zl::opt<id_t>
+    find(std::string_view string) const noexcept
+    {
+        return find(string, hash(string));
+    }
+
+    [[nodiscard]] zl::opt<id_t> find(std::string_view string,
+                                     hash_t hash) const noexcept;
+
+    /// The string with the given id. The view stays valid for as long as the
+    /// interner, and its data() is followed by a null terminator.
+    [[nodiscard]] inline zl::opt<std::string_view>
+    try_view(id_t id) const noexcept
+    {
+        if (id >= m.size) [[unlikely]]
+            return {};
+        return m.views.data()[id];
+    }
+
+    // unsafe api
+    [[nodiscard]] inline std::string_view
+    view_unchecked(id_t id) const noexcept
+    {
+        ALLO_UNCHECKED_ASSERT(id < m.size);
+        return m.views.data()[id];
+    }
+
+    inline ~string_interner_t() noexcept
+    {
+        if (!m.parent)
+            return;
+        allo::free(m.parent.value(), m.views);
+        allo::free(m.parent.value(), m.slots);
+    }
+
+  private:
+    /// One entry of the open addressing table. Keeping the folded hash next
+    /// to the id means most mismatches are found without touching the
+    /// string, and growing the table does not need to rehash any strings.
+    struct slot_t
+    {
+        uint32_t hash;
+        // zero if the slot is empty
+        uint32_t id_plus_one;
+    };
+
+    struct M
+    {
+        zl::opt<detail::abstract_heap_allocator_t&> parent;
+        scratch_allocator_t strings;
+        // indexed by id
+        zl::slice<std::string_view> views;
+        // a power of two long
+        zl::slice<slot_t> slots;
+        size_t size;
+    } m;
+
+    inline explicit string_interner_t(M&& members) noexcept
+        : m(std::move(members))
+    {
+    }
+
+    [[nodiscard]] static constexpr uint32_t fold(hash_t hash) noexcept
+    {
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    /// Smallest power of two number of slots which keeps the load factor at
+    /// most 3/4 with "strings" strings.
+    [[nodiscard]] static constexpr size_t
+    slots_needed(size_t strings) noexcept
+    {
+        size_t slots = 4;
+        while (slots * 3 < strings * 4)
+            slots *= 2;
+        return slots;
+    }
+
+    /// Index of the slot holding the string, or of the empty slot where it
+    /// would be inserted.
+    [[nodiscard]] size_t probe(std::string_view string,
+                               uint32_t folded) const noexcept;
+
+    [[nodiscard]] allocation_status_t try_grow_table() noexcept;
+};
+
+inline auto string_interner_t::make_owning(
+    detail::abstract_heap_allocator_t& parent_allocator,
+    size_t initial_strings, size_t initial_bytes) noexcept
+    -> zl::res<string_interner_t, AllocationStatusCode>
+{
+    const size_t actual_strings = initial_strings == 0 ? 1 : initial_strings;
+    const size_t actual_bytes = initial_bytes == 0 ? 1 : initial_bytes;
+
+    auto maybe_views =
+        allo::alloc<std::string_view>(parent_allocator, actual_strings);
+    if (!maybe_views.okay())
+        return maybe_views.err();
+    zl::slice<std::string_view> views = maybe_views.release();
+
+    auto maybe_slots =
+        allo::alloc<slot_t>(parent_allocator, slots_needed(actual_strings));
+    if (!maybe_slots.okay()) {
+        allo::free(parent_allocator, views);
+        return maybe_slots.err();
+    }
+    zl::slice<slot_t> slots = maybe_slots.release();
+    std::memset(slots.data(), 0, slots.size() * sizeof(slot_t));
+
+    auto maybe_strings = allo::alloc<uint8_t>(parent_allocator, actual_bytes);
+    if (!maybe_strings.okay()) {
+        allo::free(parent_allocator, views);
+        allo::free(parent_allocator, slots);
+        return maybe_strings.err();
+    }
+
+    return zl::res<string_interner_t, AllocationStatusCode>{
+        std::in_place,
+        string_interner_t(M{
+            .parent = parent_allocator,
+            .strings = scratch_allocator_t::make_owning(
+                maybe_strings.release(), parent_allocator),
+            .views = views,
+            .slots = slots,
+            .size = 0,
+        })};
+}
+
+inline size_t string_interner_t::probe(std::string_view string,
+                                       uint32_t folded) const noexcept
+{
+    const size_t mask = m.slots.size() - 1;
+    const slot_t* const slots = m.slots.data();
+    size_t index = folded & mask;
+    while (true) {
+        const slot_t& slot = slots[index];
+        if (slot.id_plus_one == 0)
+            return index;
+        if (slot.hash == folded &&
+            m.views.data()[slot.id_plus_one - 1] == string)
+            return index;
+        index = (index + 1) & mask;
+    }
+}
+
+inline zl::opt<string_interner_t::id_t>
+string_interner_t::find(std::string_view string, hash_t hash) const noexcept
+{
+    ALLO_INTERNAL_ASSERT(hash == string_interner_t::hash(string));
+    if (!m.parent) [[unlikely]]
+        return {};
+    const slot_t& slot = m.slots.data()[probe(string, fold(hash))];
+    if (slot.id_plus_one == 0)
+        return {};
+    return slot.id_plus_one - 1;
+}
+
+inline auto string_interner_t::try_intern(std::string_view string,
+                                          hash_t hash) noexcept
+    -> zl::res<id_t, AllocationStatusCode>
+{
+    ALLO_INTERNAL_ASSERT(hash == string_interner_t::hash(string));
+    if (!m.parent) [[unlikely]]
+        return AllocationStatusCode::OOM;
+    const uint32_t folded = fold(hash);
+    size_t index = probe(string, folded);
+    if (m.slots.data()[index].id_plus_one != 0)
+        return m.slots.data()[index].id_plus_one - 1;
+
+    if (m.size == max_strings) [[unlikely]]
+        return AllocationStatusCode::OOM;
+
+    // do everything which can fail before changing anything
+    if (m.size == m.views.size()) {
+        auto maybe_views =
+            allo::realloc(m.parent.value(), m.views, m.views.size() * 2);
+        if (!maybe_views.okay())
+            return maybe_views.err();
+        m.views = maybe_views.release();
+    }
+    if (slots_needed(m.size + 1) > m.slots.size()) {
+        auto status = try_grow_table();
+        if (!status.okay())
+            return status.err();
+        index = probe(string, folded);
+    }
+    auto maybe_copy = allo::alloc<char>(m.strings, string.size() + 1);
+    if (!maybe_copy.okay())
+        return maybe_copy.err();
+    char* const copy = maybe_copy.release().data();
+    std::memcpy(copy, string.data(), string.size());
+    copy[string.size()] = '\0';
+
+    const auto id = static_cast<id_t>(m.size);
+    m.views.data()[id] = std::string_view(copy, string.size());
+    m.slots.data()[index] = slot_t{.hash = folded, .id_plus_one = id + 1};
+    ++m.size;
+    return id;
+}
+
+inline allocation_status_t string_interner_t::try_grow_table() noexcept
+{
+    auto maybe_slots =
+        allo::alloc<slot_t>(m.parent.value(), m.slots.size() * 2);
+    if (!maybe_slots.okay())
+        return maybe_slots.err();
+    zl::slice<slot_t> slots = maybe_slots.release();
+    std::memset(slots.data(), 0, slots.size() * sizeof(slot_t));
+
+    // every string is unique, so each one only needs an empty slot
+    const size_t mask = slots.size() - 1;
+    for (const slot_t& slot : m.slots) {
+        if (slot.id_plus_one == 0)
+            continue;
+        size_t index = slot.hash & mask;
+        while (slots.data()[index].id_plus_one != 0)
+            index = (index + 1) & mask;
+        slots.data()[index] = slot;
+    }
+    allo::free(m.parent.value(), m.slots);
+    m.slots = slots;
+    return AllocationStatusCode::Okay;
+}
+} // namespace allo
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace allo {
+
+/// Process-wide counts of the calls allo makes which can enter the kernel.
+/// Comparing two snapshots taken around some code shows whether that code
+/// ever left the allocators' fast paths.
+struct syscall_stats_t
+{
+    /// Calls to the functions in memory_map.h which map, unmap, or change the
+    /// protection of memory, including ones which failed. These are always
+    /// counted, since they are cheap next to the syscall itself.
+    uint64_t reserve_pages;
+    uint64_t commit_pages;
+    uint64_t memory_unmap;
+    uint64_t memory_remap;
+    uint64_t map_file;
+    /// Calls to the functions in memory_map.h which open, resize, write,
+    /// sync, or close files and shared memory. Also always counted.
+    uint64_t open_file;
+    uint64_t close_file;
+    uint64_t duplicate_file;
+    uint64_t file_size;
+    uint64_t resize_file;
+    uint64_t write_file;
+    uint64_t sync;
+    uint64_t create_shared_memory;
+    uint64_t open_shared_memory;
+    uint64_t unlink_shared_memory;
+    /// Calls c_allocator_t made to malloc, realloc, and free. The C library
+    /// only sometimes enters the kernel for these, so they are an upper bound.
+    /// Only counted if allo is compiled with ALLO_ENABLE_STATS defined.
+    uint64_t malloc_calls;
+    uint64_t realloc_calls;
+    uint64_t free_calls;
+
+    [[nodiscard]] inline constexpr uint64_t memory_map_calls() const noexcept
+    {
+        return reserve_pages + commit_pages + memory_unmap + memory_remap +
+               map_file;
+    }
+
+    [[nodiscard]] inline constexpr uint64_t file_calls() const noexcept
+    {
+        return open_file + close_file + duplicate_file + file_size +
+               resize_file + write_file + sync + create_shared_memory +
+               open_shared_memory + unlink_shared_memory;
+    }
+};
+
+/// Read the current counts. Safe to call from any thread.
+[[nodiscard]] syscall_stats_t syscall_stats() noexcept;
+
+struct page_faults_t
+{
+    /// Faults which the kernel served without doing IO, for example the first
+    /// touch of a freshly committed page.
+    uint64_t minor;
+    /// Faults which had to read from disk.
+    uint64_t major;
+};
+
+/// Page faults taken by the calling thread so far, according to getrusage().
+/// On macos this is the whole process, and on windows it is always zero.
+[[nodiscard]] page_faults_t current_page_faults() noexcept;
+
+namespace detail {
+struct c_library_call_counters_t
+{
+    std::atomic<uint64_t> malloc_calls{0};
+    std::atomic<uint64_t> realloc_calls{0};
+    std::atomic<uint64_t> free_calls{0};
+};
+
+inline c_library_call_counters_t c_library_calls;
+
+/// Adds the page faults taken between its construction and destruction to
+/// the stats of an allocator. The recorder is a template so that this header
+/// does not depend on stats.h.
+template <typename recorder_t> class page_fault_scope_t
+{
+  public:
+    inline explicit page_fault_scope_t(recorder_t recorder) noexcept
+        : m{.recorder = recorder, .start = current_page_faults()}
+    {
+    }
+
+    inline ~page_fault_scope_t() noexcept
+    {
+        const page_faults_t end = current_page_faults();
+        m.recorder.record_page_faults(end.minor - m.start.minor,
+                                      end.major - m.start.major);
+    }
+
+    page_fault_scope_t(const page_fault_scope_t&) = delete;
+    page_fault_scope_t& operator=(const page_fault_scope_t&) = delete;
+    page_fault_scope_t(page_fault_scope_t&&) = delete;
+    page_fault_scope_t& operator=(page_fault_scope_t&&) = delete;
+
+  private:
+    struct M
+    {
+        recorder_t recorder;
+        page_faults_t start;
+    } m;
+};
+} // namespace detail
+} // namespace allo
+
+/// Used inside of c_allocator_t to count its calls into the C library, which
+/// compiles to nothing unless ALLO_ENABLE_STATS is defined.
+#ifdef ALLO_ENABLE_STATS
+#define ALLO_COUNT_C_LIBRARY_CALL(function)                     \
+    ::allo::detail::c_library_calls.function##_calls.fetch_add( \
+        1, std::memory_order_relaxed)
+#else
+#define ALLO_COUNT_C_LIBRARY_CALL(function)
+#endif
+
+/// Used at the start of the paths where an allocator grows, to count the page
+/// faults taken until the end of the enclosing scope. Never used on fast
+/// paths, since getrusage() is a syscall. Compiles to nothing unless both
+/// ALLO_ENABLE_STATS and ALLO_ENABLE_PAGE_FAULT_STATS are defined.
+#if defined(ALLO_ENABLE_STATS) && defined(ALLO_ENABLE_PAGE_FAULT_STATS)
+#define ALLO_COUNT_PAGE_FAULTS()                                     \
+    const ::allo::detail::page_fault_scope_t allo_page_fault_scope_( \
+        stats_recorder())
+#else
+#define ALLO_COUNT_PAGE_FAULTS()
+#endif
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/syscall_stats.h"
+#endif
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "allo/memory_map.h"
+#include "allo/ring_buffer.h"
+#include "allo/status.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <ziglike/opt.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace allo {
+
+enum class TraceOperation : uint8_t
+{
+    Alloc,
+    Remap,
+    Free,
+    RegisterDestructionCallback,
+    /// Not an allocator call. Written when a trace starts and when it ends,
+    /// pairing a timestamp with a time in nanoseconds so that timestamps can be
+    /// converted to real time.
+    Clock,
+};
+
+/// One fixed-size entry in a trace file. Which fields are meaningful depends
+/// on the operation:
+///  - Alloc: size and alignment_exponent requested, the returned address.
+///  - Remap: the address passed in as old_address, the returned address, and
+///    the new size and typehash.
+///  - Free: the address and size passed in.
+///  - RegisterDestructionCallback: the user data pointer as the address.
+///  - Clock: size is nanoseconds since an unspecified point in time.
+struct trace_record_t
+{
+    /// Ticks of detail::trace_clock(). Use the Clock records to convert.
+    uint64_t timestamp;
+    uint64_t address;
+    uint64_t old_address;
+    uint64_t size;
+    uint64_t typehash;
+    uint32_t allocator_id;
+    TraceOperation operation;
+    uint8_t alignment_exponent;
+    AllocationStatusCode status;
+    uint8_t reserved;
+};
+static_assert(sizeof(trace_record_t) == 48);
+
+/// Stored at the very beginning of a trace file, followed by records. Records
+/// from different threads are interleaved in batches, so they are only in
+/// order by timestamp within a single allocator.
+struct trace_file_header_t
+{
+    static constexpr uint64_t static_magic = 0x45434152544F4C4CULL;
+    static constexpr uint64_t current_version = 1;
+    uint64_t magic;
+    uint64_t version;
+    uint64_t record_size;
+};
+
+namespace detail {
+/// The clock used for trace timestamps. On x86 this is the timestamp counter,
+/// elsewhere it is the steady clock in nanoseconds.
+[[nodiscard]] inline uint64_t trace_clock() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+struct trace_thread_cache_t
+{
+    const void* state = nullptr;
+    uint64_t recorder_id = 0;
+    ring_buffer_t* ring = nullptr;
+};
+/// The ring buffer the current thread last recorded into, so that finding it
+/// again does not require a lock.
+inline thread_local trace_thread_cache_t trace_thread_cache;
+} // namespace detail
+
+/// Writes trace_record_t records to a file. Each thread which records gets its
+/// own ring_buffer_t, so recording is lock-free and costs about as much as a
+/// memcpy. A background thread periodically moves records out of the ring
+/// buffers and into the file.
+///
+/// If a thread's ring buffer is full because the background thread has not
+/// caught up, or more than max_threads threads have recorded, records are
+/// dropped and counted in dropped_records().
+///
+/// NOTE: not supported on windows, because ring_buffer_t is not.
+class trace_recorder_t
+{
+  public:
+    static constexpr size_t max_threads = 128;
+
+    struct options_t
+    {
+        /// File to write the trace to. It is created if it does not exist and
+        /// truncated if it does.
+        const char* path;
+        /// Minimum capacity in bytes of each thread's ring buffer.
+        size_t ring_capacity = 1UL << 20;
+        /// How long the background thread waits between flushes.
+        size_t flush_interval_ms = 10;
+    };
+
+  private:
+    struct state_t
+    {
+        uint64_t id;
+        mm_file_t file;
+        size_t ring_capacity;
+        size_t flush_interval_ms;
+        size_t mapped_bytes;
+        std::atomic<uint32_t> next_allocator_id;
+        std::atomic<size_t> dropped_records;
+        std::atomic<bool> running;
+        // rings are only ever added, and num_rings is increased after each
+        // is constructed
+        std::atomic<size_t> num_rings;
+        std::mutex register_mutex;
+        // held by whichever thread is moving records into the file
+        std::mutex flush_mutex;
+        std::thread flusher;
+        zl::opt<ring_buffer_t> rings[max_threads];
+        std::thread::id owners[max_threads];
+    };
+
+    struct M
+    {
+        state_t* state;
+    } m;
+
+  public:
+    /// Open the trace file and start the background thread. May return OOM,
+    /// or OsErr if the file could not be written or the thread could not be
+    /// started.
+    [[nodiscard]] static zl::res<trace_recorder_t, AllocationStatusCode>
+    make(const options_t& options) noexcept;
+
+    /// Add a record to the calling thread's ring buffer. Threadsafe.
+    inline void record(const trace_record_t& record) noexcept
+    {
+        const detail::trace_thread_cache_t& cache = detail::trace_thread_cache;
+        ring_buffer_t* ring =
+            (cache.state == m.state && cache.recorder_id == m.state->id)
+                ? cache.ring
+                : register_thread();
+        if (!ring) [[unlikely]] {
+            m.state->dropped_records.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const bytes_t span = ring->write_span();
+        if (span.size() < sizeof(trace_record_t)) [[unlikely]] {
+            m.state->dropped_records.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::memcpy(span.data(), &record, sizeof(trace_record_t));
+        ring->commit_write(sizeof(trace_record_t));
+    }
+
+    /// Immediately move all recorded records into the file, without waiting
+    /// for the background thread. Threadsafe.
+    allocation_status_t flush() noexcept;
+
+    /// Get a new id to identify an allocator in the trace.
+    [[nodiscard]] inline uint32_t new_allocator_id() noexcept
+    {
+        return m.state->next_allocator_id.fetch_add(1,
+                                                    std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] inline size_t dropped_records() const noexcept
+    {
+        return m.state->dropped_records.load(std::memory_order_relaxed);
+    }
+
+    /// Stops the background thread, flushes everything, and closes the file.
+    ~trace_recorder_t() noexcept;
+    // cannot be copied
+    trace_recorder_t(const trace_recorder_t& other) = delete;
+    trace_recorder_t& operator=(const trace_recorder_t& other) = delete;
+    // can be move constructed
+    trace_recorder_t(trace_recorder_t&& other) noexcept;
+    // but not move assigned
+    trace_recorder_t& operator=(trace_recorder_t&& other) = delete;
+
+  private:
+    inline trace_recorder_t(M&& members) noexcept : m(members) {}
+
+    /// Find or create the ring buffer for the calling thread, and cache it.
+    /// Returns nullptr if there are too many threads or a ring buffer could
+    /// not be created.
+    ring_buffer_t* register_thread() noexcept;
+
+    /// Move everything in the ring buffers into the file.
+    [[nodiscard]] static allocation_status_t drain(state_t& state) noexcept;
+
+    [[nodiscard]] static allocation_status_t
+    write_clock_record(state_t& state) noexcept;
+
+    static void flush_loop(state_t* state) noexcept;
+};
+} // namespace allo
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/trace.h"
+#endif
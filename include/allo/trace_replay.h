@@ -0,0 +1,135 @@
+#pragma once
+
+#include "allo/detail/abstracts.h"
+#include "allo/structures/any_allocator.h"
+#include "allo/trace.h"
+#include <cstdint>
+
+namespace allo {
+
+/// A trace file written by trace_recorder_t, mapped into memory so that its
+/// records can be read without copying them.
+class trace_reader_t
+{
+  private:
+    struct M
+    {
+        mm_file_t file;
+        void* mapping;
+        size_t mapped_bytes;
+        const trace_record_t* records;
+        size_t num_records;
+    } m;
+
+  public:
+    /// Open and map a trace file. Returns OsErr if it could not be opened or
+    /// mapped, and InvalidArgument if it is not a trace file, was written by a
+    /// different version of allo, or was cut off partway through a record.
+    [[nodiscard]] static zl::res<trace_reader_t, AllocationStatusCode>
+    make(const char* path) noexcept;
+
+    /// Every record in the file, including Clock records, in file order.
+    [[nodiscard]] inline zl::slice<const trace_record_t>
+    records() const noexcept
+    {
+        return zl::raw_slice(*m.records, m.num_records);
+    }
+
+    /// How many timestamp ticks there were per nanosecond on the machine which
+    /// recorded the trace, worked out from its first and last Clock records.
+    /// Zero if there are not two Clock records with different times.
+    [[nodiscard]] double ticks_per_nanosecond() const noexcept;
+
+    ~trace_reader_t() noexcept;
+    // cannot be copied
+    trace_reader_t(const trace_reader_t& other) = delete;
+    trace_reader_t& operator=(const trace_reader_t& other) = delete;
+    // can be move constructed
+    trace_reader_t(trace_reader_t&& other) noexcept;
+    // but not move assigned
+    trace_reader_t& operator=(trace_reader_t&& other) = delete;
+
+  private:
+    inline trace_reader_t(M&& members) noexcept : m(members) {}
+};
+
+struct replay_options_t
+{
+    static constexpr uint32_t all_allocators = UINT32_MAX;
+
+    /// Only replay the operations made by the allocator with this id in the
+    /// trace. By default the operations of every allocator are replayed onto
+    /// the one target.
+    uint32_t allocator_id = all_allocators;
+    /// The allocator whose peak_bytes_consumed counts as the peak committed
+    /// memory. This should be whatever the target gets its memory from, for
+    /// example the parent of a heap_allocator_t. If null, the target's own
+    /// stats are used. Its peaks are reset when the replay starts, so memory
+    /// it had committed before then only counts if it is still committed.
+    /// Requires ALLO_ENABLE_STATS, otherwise the peak committed memory and
+    /// fragmentation are reported as zero.
+    detail::abstract_allocator_t* committed_source = nullptr;
+};
+
+/// All in nanoseconds.
+struct replay_latencies_t
+{
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+};
+
+struct replay_result_t
+{
+    /// Operations which were performed on the target.
+    size_t operations;
+    /// Operations which succeeded when they were recorded, but failed when
+    /// replayed onto the target.
+    size_t failed_operations;
+    /// Operations which were not performed: ones which failed when they were
+    /// recorded, destruction callbacks (the callbacks are not in the trace),
+    /// frees and remaps of allocations which failed to replay, and frees when
+    /// the target cannot free.
+    size_t skipped_operations;
+    /// Total time spent inside the target allocator.
+    uint64_t elapsed_nanoseconds;
+    double operations_per_second;
+    replay_latencies_t latency;
+    /// The most bytes the trace had allocated at once, as requested.
+    size_t peak_live_bytes;
+    /// The peak_bytes_consumed of replay_options_t::committed_source during
+    /// the replay.
+    size_t peak_committed_bytes;
+    /// 1 - peak_live_bytes / peak_committed_bytes: the fraction of the
+    /// committed memory which was never in use, even at the busiest point.
+    double fragmentation;
+};
+
+/// Perform the exact sequence of operations in a trace on a different
+/// allocator, and measure how it does. Operations are replayed in file order
+/// on the calling thread, and each is timed separately.
+///
+/// Remaps which fail on the target are replayed as realloc would, with an
+/// allocation, a copy, and a free. If the target cannot remap or free at all
+/// (for example a scratch_allocator_t), remaps are replayed as allocations and
+/// frees are skipped. A stack_allocator_t asserts when it is used out of order,
+/// so replaying onto one requires either a trace where only the most recent
+/// allocation is ever freed or remapped, or building with
+/// ALLO_DISABLE_STACK_ALLOCATOR_USAGE_ASSERTS and
+/// ALLO_DISABLE_VALID_ARGUMENT_ASSERTS so that those operations just fail.
+///
+/// Allocations which are still live at the end of the trace are freed after
+/// the measurements are taken. The bookkeeping allocator is used for the table
+/// of live allocations and the latency of every operation. Returns OOM if it
+/// runs out of memory.
+[[nodiscard]] zl::res<replay_result_t, AllocationStatusCode>
+replay_trace(zl::slice<const trace_record_t> records, any_allocator_t target,
+             detail::abstract_heap_allocator_t& bookkeeping,
+             const replay_options_t& options = {}) noexcept;
+} // namespace allo
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/trace_replay.h"
+#endif
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "allo/detail/abstracts.h"
+#include "allo/structures/any_allocator.h"
+#include "allo/trace.h"
+
+namespace allo {
+
+/// Wraps another allocator and records every call made to it into a
+/// trace_recorder_t, along with the result. Otherwise behaves exactly like the
+/// wrapped allocator. Useful for finding out the exact sequence of operations
+/// which caused fragmentation, and for replaying it later.
+///
+/// The wrapped allocator may be of any kind, but remapping and freeing will
+/// return InvalidArgument if it cannot free.
+class tracing_allocator_t : public detail::abstract_heap_allocator_t
+{
+  private:
+    struct M
+    {
+        any_allocator_t parent;
+        trace_recorder_t* recorder;
+        uint32_t id;
+    } m;
+
+  public:
+    static constexpr detail::AllocatorType enum_value =
+        detail::AllocatorType::TracingAllocator;
+
+    /// The recorder must outlive the tracing allocator. Each tracing allocator
+    /// gets a different id in the trace.
+    [[nodiscard]] inline static tracing_allocator_t
+    make(any_allocator_t parent, trace_recorder_t& recorder) noexcept
+    {
+        ALLO_VALID_ARG_ASSERT(!parent.is_null());
+        return M{
+            .parent = parent,
+            .recorder = &recorder,
+            .id = recorder.new_allocator_id(),
+        };
+    }
+
+    [[nodiscard]] allocation_result_t alloc_bytes(size_t bytes,
+                                                  uint8_t alignment_exponent,
+                                                  size_t typehash) noexcept;
+
+    [[nodiscard]] allocation_result_t remap_bytes(bytes_t mem,
+                                                  size_t old_typehash,
+                                                  size_t new_size,
+                                                  size_t new_typehash) noexcept;
+
+    allocation_status_t free_bytes(bytes_t mem, size_t typehash) noexcept;
+
+    /// Not recorded, since it does not change anything.
+    [[nodiscard]] allocation_status_t
+    free_status(bytes_t mem, size_t typehash) const noexcept;
+
+    allocation_status_t
+    register_destruction_callback(destruction_callback_t callback,
+                                  void* user_data) noexcept;
+
+    /// The id of this allocator in the trace.
+    [[nodiscard]] inline constexpr uint32_t id() const noexcept
+    {
+        return m.id;
+    }
+
+    ~tracing_allocator_t() noexcept = default;
+    // cannot be copied
+    tracing_allocator_t(const tracing_allocator_t& other) = delete;
+    tracing_allocator_t& operator=(const tracing_allocator_t& other) = delete;
+    // can be move constructed
+    tracing_allocator_t(tracing_allocator_t&& other) noexcept;
+    // but not move assigned
+    tracing_allocator_t& operator=(tracing_allocator_t&& other) = delete;
+
+    inline tracing_allocator_t(M&& members) noexcept : m(members)
+    {
+        m_type = enum_value;
+    }
+
+  private:
+    inline void record(TraceOperation operation, uint64_t address,
+                       uint64_t old_address, uint64_t size, uint64_t typehash,
+                       uint8_t alignment_exponent,
+                       AllocationStatusCode status) noexcept
+    {
+        m.recorder->record(trace_record_t{
+            .timestamp = detail::trace_clock(),
+            .address = address,
+            .old_address = old_address,
+            .size = size,
+            .typehash = typehash,
+            .allocator_id = m.id,
+            .operation = operation,
+            .alignment_exponent = alignment_exponent,
+            .status = status,
+            .reserved = 0,
+        });
+    }
+};
+} // namespace allo
+
+#ifdef ALLO_HEADER_ONLY
+#include "allo/impl/tracing_allocator.h"
+#endif
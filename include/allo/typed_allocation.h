@@ -1,4 +1,5 @@
 #pragma once
+#include "allo/allocation_tags.h"
 #include "allo/detail/abstracts.h"
 #include "allo/detail/alignment.h"
 
@@ -86,6 +87,26 @@ alloc(Allocator& allocator, size_t number) noexcept
     return zl::raw_slice(*reinterpret_cast<T*>(mem.data()), number);
 }
 
+/// Same as alloc_one(), but the allocation is given the tag instead of the
+/// one from the current allocation_tag_scope_t.
+template <typename T, typename Allocator, uint8_t alignment = alignof(T)>
+[[nodiscard]] inline zl::res<T&, AllocationStatusCode>
+alloc_one(Allocator& allocator, allocation_tag_t tag) noexcept
+{
+    const allocation_tag_scope_t scope(tag);
+    return alloc_one<T, Allocator, alignment>(allocator);
+}
+
+/// Same as alloc(), but the allocation is given the tag instead of the one
+/// from the current allocation_tag_scope_t.
+template <typename T, typename Allocator, uint8_t alignment = alignof(T)>
+[[nodiscard]] inline zl::res<zl::slice<T>, AllocationStatusCode>
+alloc(Allocator& allocator, size_t number, allocation_tag_t tag) noexcept
+{
+    const allocation_tag_scope_t scope(tag);
+    return alloc<T, Allocator, alignment>(allocator, number);
+}
+
 /// Create one item of type T using an allocator, constructing it with "args".
 /// Effectively identical to the "new" keyword. T must not be a reference type.
 ///
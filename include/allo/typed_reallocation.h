@@ -155,7 +155,7 @@ realloc(Allocator& allocator, zl::slice<T> original, size_t new_size) noexcept
         allocator.free_bytes(original_bytes, typehash);
         // TODO: assert or something here maybe? should we allow failed
         // frees? probably a warning log message would be good
-        return dest;
+        return zl::raw_slice(*dest.data(), new_size);
     }
 }
 } // namespace allo
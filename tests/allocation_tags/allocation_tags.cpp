@@ -0,0 +1,171 @@
+#include "allo/allocation_tags.h"
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "test_header.h"
+#include <array>
+
+using namespace allo;
+
+#ifndef ALLO_ENABLE_ALLOCATION_TAGS
+#error these tests must be compiled with ALLO_ENABLE_ALLOCATION_TAGS
+#endif
+
+static constexpr allocation_tag_t rendering{1};
+static constexpr allocation_tag_t audio{2};
+
+struct tagged_thing_t
+{
+    uint64_t values[4];
+};
+
+TEST_SUITE("allocation tags")
+{
+    TEST_CASE("scopes nest and restore the previous tag")
+    {
+        REQUIRE(detail::current_allocation_tag == 0);
+        {
+            allocation_tag_scope_t outer(rendering);
+            REQUIRE(detail::current_allocation_tag == 1);
+            {
+                allocation_tag_scope_t inner(audio);
+                REQUIRE(detail::current_allocation_tag == 2);
+            }
+            REQUIRE(detail::current_allocation_tag == 1);
+        }
+        REQUIRE(detail::current_allocation_tag == 0);
+    }
+
+    TEST_CASE("the tag does not change the typehash as seen by frees")
+    {
+        const size_t typehash = 0x123456789ABCDEF;
+        const size_t tagged = detail::tag_typehash(typehash, 5);
+        REQUIRE(detail::tag_of_typehash(tagged) == 5);
+        REQUIRE(detail::typehashes_match(tagged, typehash));
+        REQUIRE(!detail::typehashes_match(tagged, typehash + 1));
+    }
+
+    TEST_CASE("heap counts live and peak bytes per tag")
+    {
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 8192).release();
+        {
+            heap_allocator_t heap = heap_allocator_t::make(mem);
+
+            auto untagged = alloc<uint8_t>(heap, 10).release();
+            auto& thing = alloc_one<tagged_thing_t>(heap, rendering).release();
+            zl::slice<uint8_t> sound;
+            {
+                allocation_tag_scope_t scope(audio);
+                sound = alloc<uint8_t>(heap, 300).release();
+            }
+            auto more_sound = alloc<uint8_t>(heap, 200, audio).release();
+
+            REQUIRE(heap.tag_stats({0}).live_allocations == 1);
+            REQUIRE(heap.tag_stats({0}).bytes_requested == 10);
+            REQUIRE(heap.tag_stats(rendering).live_allocations == 1);
+            REQUIRE(heap.tag_stats(rendering).bytes_requested ==
+                    sizeof(tagged_thing_t));
+            REQUIRE(heap.tag_stats(audio).live_allocations == 2);
+            REQUIRE(heap.tag_stats(audio).bytes_requested == 500);
+
+            // typed frees still match, and are counted against the tag the
+            // allocation was made with, not the current one
+            {
+                allocation_tag_scope_t scope(rendering);
+                REQUIRE(allo::free(heap, sound).okay());
+            }
+            REQUIRE(heap.tag_stats(audio).live_allocations == 1);
+            REQUIRE(heap.tag_stats(audio).bytes_requested == 200);
+            REQUIRE(heap.tag_stats(audio).peak_bytes_requested == 500);
+            REQUIRE(heap.tag_stats(rendering).live_allocations == 1);
+
+            // shrinking in place
+            auto shrunk = heap.remap_bytes(more_sound, 0, 50, 0);
+            REQUIRE(shrunk.okay());
+            more_sound = shrunk.release();
+            REQUIRE(heap.tag_stats(audio).bytes_requested == 50);
+
+            REQUIRE(free_one(heap, thing).okay());
+            REQUIRE(allo::free(heap, more_sound).okay());
+            REQUIRE(allo::free(heap, untagged).okay());
+            for (uint8_t tag = 0; tag < allocation_tag_t::max; ++tag) {
+                REQUIRE(heap.tag_stats({tag}).live_allocations == 0);
+                REQUIRE(heap.tag_stats({tag}).bytes_requested == 0);
+            }
+        }
+        allo::free(global_allocator, mem);
+    }
+
+    TEST_CASE("budgets")
+    {
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 8192).release();
+        {
+            heap_allocator_t heap = heap_allocator_t::make(mem);
+            REQUIRE(heap.set_tag_budget(audio, 1000).okay());
+            REQUIRE(heap.tag_stats(audio).budget == 1000);
+
+            std::array<zl::slice<uint8_t>, 3> sounds;
+            for (auto& sound : sounds)
+                sound = alloc<uint8_t>(heap, 300, audio).release();
+            auto over = alloc<uint8_t>(heap, 300, audio);
+            REQUIRE(over.err() == AllocationStatusCode::BudgetExceeded);
+            REQUIRE(heap.tag_stats(audio).bytes_requested == 900);
+            // exactly up to the budget is fine
+            auto exact = alloc<uint8_t>(heap, 100, audio).release();
+
+            // other tags are unaffected
+            auto other = alloc<uint8_t>(heap, 2000, rendering);
+            REQUIRE(other.okay());
+
+            // freeing makes room again
+            REQUIRE(allo::free(heap, sounds[0]).okay());
+            sounds[0] = alloc<uint8_t>(heap, 300, audio).release();
+
+            // removing the budget
+            REQUIRE(heap.set_tag_budget(audio, 0).okay());
+            auto unlimited = alloc<uint8_t>(heap, 2000, audio);
+            REQUIRE(unlimited.okay());
+            REQUIRE(heap.tag_stats(audio).bytes_requested == 3000);
+            REQUIRE(allo::free(heap, unlimited.release()).okay());
+            REQUIRE(allo::free(heap, other.release()).okay());
+            REQUIRE(allo::free(heap, exact).okay());
+            for (auto& sound : sounds)
+                REQUIRE(allo::free(heap, sound).okay());
+        }
+        allo::free(global_allocator, mem);
+    }
+
+    TEST_CASE("allocations above the mmap threshold")
+    {
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 4096).release();
+        {
+            heap_allocator_t heap = heap_allocator_t::make(mem);
+            REQUIRE(heap.set_mmap_threshold(16384).okay());
+            REQUIRE(heap.set_tag_budget(rendering, 100000).okay());
+
+            auto big = alloc<uint8_t>(heap, 50000, rendering).release();
+            REQUIRE(heap.mapped_allocation_count() == 1);
+            REQUIRE(heap.tag_stats(rendering).bytes_requested == 50000);
+
+            // growing past the budget fails and leaves it as it was
+            auto too_big = heap.remap_bytes(big, 0, 200000, 0);
+            REQUIRE(too_big.err() == AllocationStatusCode::BudgetExceeded);
+            REQUIRE(heap.tag_stats(rendering).bytes_requested == 50000);
+
+            auto smaller = heap.remap_bytes(big, 0, 20000, 0);
+            REQUIRE(smaller.okay());
+            big = smaller.release();
+            REQUIRE(heap.tag_stats(rendering).bytes_requested == 20000);
+            REQUIRE(heap.tag_stats(rendering).peak_bytes_requested == 50000);
+
+            REQUIRE(allo::free(heap, big).okay());
+            REQUIRE(heap.tag_stats(rendering).live_allocations == 0);
+            REQUIRE(heap.tag_stats(rendering).bytes_requested == 0);
+        }
+        allo::free(global_allocator, mem);
+    }
+}
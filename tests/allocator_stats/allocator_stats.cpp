@@ -0,0 +1,226 @@
+#include "allo/block_allocator.h"
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/stack_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "test_header.h"
+
+using namespace allo;
+
+#ifndef ALLO_ENABLE_STATS
+#error allocator_stats tests must be compiled with ALLO_ENABLE_STATS
+#endif
+
+TEST_SUITE("allocator stats")
+{
+    TEST_CASE("c_allocator_t")
+    {
+        c_allocator_t global_allocator;
+        const allocator_stats_t before = global_allocator.stats();
+
+        auto mem = allo::alloc<uint8_t>(global_allocator, 100).release();
+        allocator_stats_t stats = global_allocator.stats();
+        REQUIRE(stats.allocs == before.allocs + 1);
+        REQUIRE(stats.bytes_requested == before.bytes_requested + 100);
+        REQUIRE(stats.bytes_consumed == before.bytes_consumed + 100);
+
+        REQUIRE(global_allocator.alloc_bytes(1, 6, 0).err() ==
+                AllocationStatusCode::AllocationTooAligned);
+        REQUIRE(global_allocator.stats().failed_allocs ==
+                before.failed_allocs + 1);
+
+        auto bigger =
+            global_allocator.threadsafe_realloc_bytes(mem, 0, 200, 0).release();
+        stats = global_allocator.stats();
+        REQUIRE(stats.remaps == before.remaps + 1);
+        REQUIRE(stats.bytes_requested == before.bytes_requested + 200);
+
+        REQUIRE(global_allocator.free_bytes(bigger, 0).okay());
+        stats = global_allocator.stats();
+        REQUIRE(stats.frees == before.frees + 1);
+        REQUIRE(stats.bytes_requested == before.bytes_requested);
+        REQUIRE(stats.peak_bytes_requested >= before.bytes_requested + 200);
+    }
+
+    TEST_CASE("heap_allocator_t")
+    {
+        c_allocator_t global_allocator;
+        auto heap = heap_allocator_t::make_owning(
+            allo::alloc<uint8_t>(global_allocator, 2000).release(),
+            global_allocator);
+
+        allocator_stats_t stats = heap.stats();
+        REQUIRE(stats.allocs == 0);
+        REQUIRE(stats.blocks_held == 1);
+
+        auto first = heap.alloc_bytes(4, 2, 0).release();
+        auto second = heap.alloc_bytes(4, 2, 0).release();
+        stats = heap.stats();
+        REQUIRE(stats.allocs == 2);
+        REQUIRE(stats.bytes_requested == 8);
+        // bookkeeping and alignment make every allocation take up more
+        REQUIRE(stats.bytes_consumed > stats.bytes_requested);
+
+        REQUIRE(heap.free_bytes(first, 0).okay());
+        stats = heap.stats();
+        REQUIRE(stats.frees == 1);
+        REQUIRE(stats.bytes_requested == 4);
+        REQUIRE(stats.peak_bytes_requested == 8);
+
+        // freeing with the wrong size is counted as a failure
+        REQUIRE(heap.free_bytes(zl::raw_slice(*second.data(), 2), 0).err() ==
+                AllocationStatusCode::MemoryInvalid);
+        REQUIRE(heap.stats().failed_frees == 1);
+
+        REQUIRE(heap.free_bytes(second, 0).okay());
+        stats = heap.stats();
+        REQUIRE(stats.bytes_requested == 0);
+        REQUIRE(stats.bytes_consumed == 0);
+    }
+
+    TEST_CASE("heap_allocator_t growing")
+    {
+        c_allocator_t global_allocator;
+        auto parent_mem =
+            allo::alloc<uint8_t>(global_allocator, 100000).release();
+        {
+            auto parent = heap_allocator_t::make(parent_mem);
+            auto heap = heap_allocator_t::make_owning(
+                allo::alloc<uint8_t>(parent, 512).release(), parent);
+
+            auto first = allo::alloc<uint8_t>(heap, 400).release();
+            auto second = allo::alloc<uint8_t>(heap, 400).release();
+            allocator_stats_t stats = heap.stats();
+            REQUIRE(stats.parent_grow_calls >= 1);
+            REQUIRE(stats.blocks_held >= 2);
+
+            REQUIRE(allo::free(heap, second).okay());
+            REQUIRE(allo::free(heap, first).okay());
+            REQUIRE(heap.trim() > 0);
+            REQUIRE(heap.stats().blocks_held == 1);
+        }
+        allo::free(global_allocator, parent_mem);
+    }
+
+    TEST_CASE("block_allocator_t")
+    {
+        c_allocator_t global_allocator;
+        auto parent_mem =
+            allo::alloc<uint8_t>(global_allocator, 100000).release();
+        {
+            auto parent = heap_allocator_t::make(parent_mem);
+            auto block = block_allocator_t::make_owning(
+                allo::alloc<uint8_t>(parent, 400).release(), parent, 200);
+
+            auto first = block.alloc_bytes(10, 0, 0).release();
+            auto second = block.alloc_bytes(20, 0, 0).release();
+            allocator_stats_t stats = block.stats();
+            REQUIRE(stats.allocs == 2);
+            REQUIRE(stats.bytes_requested == 30);
+            REQUIRE(stats.bytes_consumed == 400);
+            REQUIRE(stats.parent_grow_calls == 0);
+
+            // a third allocation doesn't fit in the original memory
+            auto third = block.alloc_bytes(30, 0, 0).release();
+            stats = block.stats();
+            REQUIRE(stats.parent_grow_calls == 1);
+            REQUIRE(stats.blocks_held == 2);
+            REQUIRE(stats.peak_bytes_consumed == 600);
+
+            REQUIRE(block.alloc_bytes(8, 4, 0).err() ==
+                    AllocationStatusCode::AllocationTooAligned);
+            REQUIRE(block.stats().failed_allocs == 1);
+
+            REQUIRE(block.free_bytes(third, 0).okay());
+            REQUIRE(block.free_bytes(second, 0).okay());
+            REQUIRE(block.free_bytes(first, 0).okay());
+            stats = block.stats();
+            REQUIRE(stats.frees == 3);
+            REQUIRE(stats.bytes_requested == 0);
+            REQUIRE(stats.bytes_consumed == 0);
+
+            REQUIRE(block.trim() > 0);
+            REQUIRE(block.stats().blocks_held == 1);
+        }
+        allo::free(global_allocator, parent_mem);
+    }
+
+    TEST_CASE("stack_allocator_t")
+    {
+        c_allocator_t global_allocator;
+        auto parent_mem =
+            allo::alloc<uint8_t>(global_allocator, 100000).release();
+        {
+            auto parent = heap_allocator_t::make(parent_mem);
+            auto stack = stack_allocator_t::make_owning(
+                allo::alloc<uint8_t>(parent, 100).release(), parent);
+
+            auto first = stack.alloc_bytes(8, 3, 0).release();
+            auto second = stack.alloc_bytes(500, 3, 0).release();
+            allocator_stats_t stats = stack.stats();
+            REQUIRE(stats.allocs == 2);
+            REQUIRE(stats.bytes_requested == 508);
+            REQUIRE(stats.bytes_consumed > stats.bytes_requested);
+            REQUIRE(stats.parent_grow_calls == 1);
+            REQUIRE(stats.blocks_held == 2);
+
+            auto bigger = stack.remap_bytes(second, 0, 510, 0).release();
+            REQUIRE(stack.stats().bytes_requested == 518);
+
+            REQUIRE(stack.free_bytes(bigger, 0).okay());
+            REQUIRE(stack.free_bytes(first, 0).okay());
+            stats = stack.stats();
+            REQUIRE(stats.frees == 2);
+            REQUIRE(stats.bytes_requested == 0);
+            REQUIRE(stats.bytes_consumed == 0);
+        }
+        allo::free(global_allocator, parent_mem);
+    }
+
+    TEST_CASE("scratch_allocator_t")
+    {
+        c_allocator_t global_allocator;
+        auto parent_mem =
+            allo::alloc<uint8_t>(global_allocator, 100000).release();
+        {
+            auto parent = heap_allocator_t::make(parent_mem);
+            auto scratch = scratch_allocator_t::make_owning(
+                allo::alloc<uint8_t>(parent, 64).release(), parent);
+
+            REQUIRE(scratch.alloc_bytes(1, 0, 0).okay());
+            REQUIRE(scratch.alloc_bytes(8, 3, 0).okay());
+            allocator_stats_t stats = scratch.stats();
+            REQUIRE(stats.allocs == 2);
+            REQUIRE(stats.bytes_requested == 9);
+            // padding to align the second allocation
+            REQUIRE(stats.bytes_consumed == 16);
+
+            // needs more memory from the parent
+            REQUIRE(scratch.alloc_bytes(200, 0, 0).okay());
+            stats = scratch.stats();
+            REQUIRE(stats.allocs == 3);
+            REQUIRE(stats.parent_grow_calls >= 1);
+        }
+        allo::free(global_allocator, parent_mem);
+    }
+
+    TEST_CASE("any_allocator_t and moving")
+    {
+        c_allocator_t global_allocator;
+        auto heap = heap_allocator_t::make_owning(
+            allo::alloc<uint8_t>(global_allocator, 2000).release(),
+            global_allocator);
+        REQUIRE(allo::alloc_one<int>(heap).okay());
+
+        any_allocator_t any(heap);
+        REQUIRE(any.stats().allocs == 1);
+        REQUIRE(any_allocator_t().stats().allocs == 0);
+
+        heap_allocator_t moved(std::move(heap));
+        REQUIRE(moved.stats().allocs == 1);
+        REQUIRE(moved.stats().blocks_held == 1);
+        REQUIRE(heap.stats().allocs == 0);
+    }
+}
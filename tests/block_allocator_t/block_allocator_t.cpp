@@ -7,6 +7,7 @@
 #define ALLO_DISABLE_VALID_ARGUMENT_ASSERTS
 #include "allo/block_allocator.h"
 #include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
 #include "allo/make_into.h"
 #include "allo/reservation_allocator.h"
 #include "allo/typed_freeing.h"
@@ -14,6 +15,7 @@
 #include "heap_tests.h"
 #include "test_header.h"
 
+#include <array>
 #include <ziglike/stdmem.h>
 
 using namespace allo;
@@ -175,6 +177,63 @@ TEST_SUITE("block_allocator_t")
             allo::free(c, buffer);
         }
 
+        SUBCASE("freed blocks are reused")
+        {
+            c_allocator_t global_allocator;
+            auto mem = allo::alloc<uint8_t>(global_allocator, 64).release();
+            {
+                auto ally = block_allocator_t::make(mem, 32);
+                auto& first = alloc_one<uint64_t>(ally).release();
+                auto& second = alloc_one<uint64_t>(ally).release();
+                REQUIRE(alloc_one<uint64_t>(ally).err() ==
+                        AllocationStatusCode::OOM);
+                REQUIRE(free_one(ally, second).okay());
+                REQUIRE(free_one(ally, first).okay());
+                REQUIRE(&alloc_one<uint64_t>(ally).release() == &first);
+                REQUIRE(&alloc_one<uint64_t>(ally).release() == &second);
+            }
+            allo::free(global_allocator, mem);
+        }
+
+        SUBCASE("trim gives empty chunks back to the parent")
+        {
+            c_allocator_t global_allocator;
+            auto parent_mem =
+                allo::alloc<uint8_t>(global_allocator, 100000).release();
+            heap_allocator_t parent = heap_allocator_t::make(parent_mem);
+            for (bool auto_trim : {false, true}) {
+                auto ally = block_allocator_t::make_owning(
+                    allo::alloc<uint8_t>(parent, 32 * 4).release(), parent,
+                    32);
+                ally.set_auto_trim(auto_trim);
+                REQUIRE(ally.trim() == 0);
+
+                std::array<uint64_t*, 40> allocations{};
+                for (auto& allocation : allocations) {
+                    allocation = &alloc_one<uint64_t>(ally).release();
+                    *allocation = 0;
+                }
+                for (auto* allocation : allocations) {
+                    REQUIRE(free_one(ally, *allocation).okay());
+                }
+                if (auto_trim) {
+                    REQUIRE(ally.trim() == 0);
+                } else {
+                    REQUIRE(ally.trim() > 0);
+                    REQUIRE(ally.trim() == 0);
+                }
+
+                for (auto& allocation : allocations) {
+                    allocation = &alloc_one<uint64_t>(ally).release();
+                    *allocation = 1;
+                }
+                for (auto* allocation : allocations) {
+                    REQUIRE(*allocation == 1);
+                }
+            }
+            allo::free(global_allocator, parent_mem);
+        }
+
         SUBCASE("destruction callback and sometimes OOM on register, doesnt "
                 "get called")
         {
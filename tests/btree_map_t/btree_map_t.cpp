@@ -0,0 +1,283 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/structures/btree_map.h"
+#include "testing_types.h"
+// test header should be last
+#include "test_header.h"
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<btree_map_t<int, int>>,
+              "btree map of ints is default constructible");
+static_assert(!std::is_copy_constructible_v<btree_map_t<int, int>>,
+              "btree map of ints is copy constructible");
+static_assert(btree_map_t<int, int>::leaf_capacity > 16);
+
+namespace {
+// small nodes, so that the tree gets deep with few entries
+using small_map_t = btree_map_t<int, int, std::less<int>, 128>;
+
+template <typename Map>
+void require_matches(Map& map, const std::map<int, int>& expected)
+{
+    REQUIRE(map.size() == expected.size());
+    auto iter = expected.begin();
+    size_t visited = 0;
+    map.for_each([&](const int& key, int& value) {
+        REQUIRE(iter != expected.end());
+        REQUIRE(key == iter->first);
+        REQUIRE(value == iter->second);
+        ++iter;
+        ++visited;
+    });
+    REQUIRE(visited == expected.size());
+}
+} // namespace
+
+TEST_SUITE("btree_map_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto maybe_map = btree_map_t<int, int>::make_owning(heap, 16);
+            REQUIRE(maybe_map.okay());
+            REQUIRE(maybe_map.release_ref().size() == 0);
+            REQUIRE(!maybe_map.release_ref().contains(1));
+        }
+
+        SUBCASE("make in an arena")
+        {
+            c_allocator_t c;
+            auto arena =
+                scratch_allocator_t::make(alloc<uint8_t>(c, 200000).release());
+            auto map = small_map_t::make(arena, 4).release();
+            // more nodes than it started with
+            for (int i = 0; i < 1000; ++i)
+                REQUIRE(map.try_insert(i, i * 2).okay());
+            REQUIRE(map.size() == 1000);
+            REQUIRE(map.try_get(999).value() == 1998);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto map = btree_map_t<int, int>::make_owning(heap, 0).release();
+            REQUIRE(map.try_insert(1, 10).okay());
+            btree_map_t<int, int> moved(std::move(map));
+            REQUIRE(map.size() == 0);
+            REQUIRE(moved.size() == 1);
+            REQUIRE(moved.try_get(1).value() == 10);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("insert, get and remove")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto map = small_map_t::make_owning(heap, 8).release();
+            REQUIRE(!map.try_get(3).has_value());
+            REQUIRE(map.try_remove(3).err() ==
+                    small_map_t::StatusCode::NotFound);
+            for (int key : {5, 1, 9, 3, 7})
+                REQUIRE(map.try_insert(key, key * 10).okay());
+            REQUIRE(map.try_insert(5, 0).err() ==
+                    small_map_t::StatusCode::AlreadyPresent);
+            REQUIRE(map.try_get(5).value() == 50);
+            map.try_get(5).value() = 55;
+            REQUIRE(std::as_const(map).try_get(5).value() == 55);
+            REQUIRE(map.try_remove(5).okay());
+            REQUIRE(!map.contains(5));
+            REQUIRE(map.contains(7));
+            REQUIRE(map.size() == 4);
+        }
+
+        SUBCASE("matches std::map through splits and merges")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 2000000).release(), c);
+            auto map = small_map_t::make_owning(heap, 64).release();
+            std::map<int, int> expected;
+            std::mt19937 rng(7);
+            for (int round = 0; round < 4; ++round) {
+                // grow it, then shrink it most of the way
+                for (int i = 0; i < 5000; ++i) {
+                    const int key = static_cast<int>(rng() % 20000);
+                    const bool inserted = expected.emplace(key, i).second;
+                    REQUIRE(map.try_insert(key, i).okay() == inserted);
+                }
+                require_matches(map, expected);
+                for (int i = 0; i < 6000; ++i) {
+                    const int key = static_cast<int>(rng() % 20000);
+                    const bool present = expected.erase(key) != 0;
+                    REQUIRE(map.try_remove(key).okay() == present);
+                }
+                require_matches(map, expected);
+            }
+            for (const auto& [key, value] : expected)
+                REQUIRE(map.try_remove(key).okay());
+            REQUIRE(map.size() == 0);
+            REQUIRE(map.try_insert(1, 1).okay());
+        }
+
+        SUBCASE("ascending and descending inserts")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 1000000).release(), c);
+            auto map = small_map_t::make_owning(heap, 64).release();
+            std::map<int, int> expected;
+            for (int i = 0; i < 3000; ++i) {
+                REQUIRE(map.try_insert(i, -i).okay());
+                REQUIRE(map.try_insert(-i - 1, i).okay());
+                expected.emplace(i, -i);
+                expected.emplace(-i - 1, i);
+            }
+            require_matches(map, expected);
+            for (int i = 0; i < 3000; ++i)
+                REQUIRE(map.try_remove(i).okay());
+            for (int i = 0; i < 3000; ++i)
+                expected.erase(i);
+            require_matches(map, expected);
+        }
+
+        SUBCASE("range scan")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            auto map = small_map_t::make_owning(heap, 16).release();
+            for (int key = 0; key < 1000; key += 3)
+                REQUIRE(map.try_insert(key, key).okay());
+
+            std::vector<int> seen;
+            map.for_each_in_range(100, 200, [&](const int& key, int& value) {
+                REQUIRE(key == value);
+                seen.push_back(key);
+            });
+            REQUIRE(seen.size() == 33);
+            REQUIRE(seen.front() == 102);
+            REQUIRE(seen.back() == 198);
+            for (size_t i = 1; i < seen.size(); ++i)
+                REQUIRE(seen[i] == seen[i - 1] + 3);
+
+            seen.clear();
+            map.for_each_in_range(2000, 3000, [&](const int& key, int&) {
+                seen.push_back(key);
+            });
+            REQUIRE(seen.empty());
+            map.for_each_in_range(-100, 7, [&](const int& key, int&) {
+                seen.push_back(key);
+            });
+            REQUIRE(seen == std::vector<int>{0, 3, 6});
+        }
+
+        SUBCASE("bulk load")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 2000000).release(), c);
+            for (int count : {0, 1, 11, 12, 13, 500, 20000}) {
+                auto map = small_map_t::make_owning(heap, 16).release();
+                std::vector<int> keys;
+                std::vector<int> values;
+                std::map<int, int> expected;
+                for (int i = 0; i < count; ++i) {
+                    keys.push_back(i * 2);
+                    values.push_back(i);
+                    expected.emplace(i * 2, i);
+                }
+                REQUIRE(map.try_bulk_load(keys, values).okay());
+                require_matches(map, expected);
+
+                // still a valid tree afterwards
+                for (int i = 0; i < count; i += 2) {
+                    REQUIRE(map.try_remove(i * 2).okay());
+                    REQUIRE(map.try_insert(i * 2 + 1, i).okay());
+                    expected.erase(i * 2);
+                    expected.emplace(i * 2 + 1, i);
+                }
+                require_matches(map, expected);
+            }
+        }
+
+        SUBCASE("bulk load rejects bad input")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto map = small_map_t::make_owning(heap, 16).release();
+            std::vector<int> unsorted = {1, 3, 2};
+            std::vector<int> repeated = {1, 2, 2};
+            std::vector<int> values = {0, 0, 0};
+            std::vector<int> short_values = {0, 0};
+            REQUIRE(map.try_bulk_load(unsorted, values).err() ==
+                    small_map_t::StatusCode::InvalidArgument);
+            REQUIRE(map.try_bulk_load(repeated, values).err() ==
+                    small_map_t::StatusCode::InvalidArgument);
+            std::vector<int> sorted = {1, 2, 3};
+            REQUIRE(map.try_bulk_load(sorted, short_values).err() ==
+                    small_map_t::StatusCode::InvalidArgument);
+            REQUIRE(map.size() == 0);
+            REQUIRE(map.try_bulk_load(sorted, values).okay());
+            // not empty anymore
+            REQUIRE(map.try_bulk_load(sorted, values).err() ==
+                    small_map_t::StatusCode::InvalidArgument);
+        }
+
+        SUBCASE("values are destroyed")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 1000000).release(), c);
+            {
+                auto map =
+                    btree_map_t<int, counted_t, std::less<int>, 256>::
+                        make_owning(heap, 4)
+                            .release();
+                for (int i = 0; i < 500; ++i)
+                    REQUIRE(map.try_insert(i, i).okay());
+                REQUIRE(counted_t::alive == 500);
+                for (int i = 0; i < 500; i += 2)
+                    REQUIRE(map.try_remove(i).okay());
+                REQUIRE(counted_t::alive == 250);
+                map.clear();
+                REQUIRE(counted_t::alive == 0);
+                for (int i = 0; i < 100; ++i)
+                    REQUIRE(map.try_insert(i, i).okay());
+            }
+            REQUIRE(counted_t::alive == 0);
+        }
+
+        SUBCASE("memory goes back to the parent")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 1000000).release(), c);
+#ifdef ALLO_ENABLE_STATS
+            const size_t frees = heap.stats().frees;
+#endif
+            {
+                auto map = small_map_t::make_owning(heap, 4).release();
+                for (int i = 0; i < 2000; ++i)
+                    REQUIRE(map.try_insert(i, i).okay());
+            }
+#ifdef ALLO_ENABLE_STATS
+            REQUIRE(heap.stats().frees > frees);
+            REQUIRE(heap.stats().allocs == heap.stats().frees);
+#endif
+        }
+    }
+}
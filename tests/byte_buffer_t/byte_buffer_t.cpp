@@ -0,0 +1,198 @@
+#include "allo/c_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/structures/byte_buffer.h"
+// test header should be last
+#include "test_header.h"
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<byte_buffer_t>,
+              "byte buffer is default constructible");
+static_assert(!std::is_copy_constructible_v<byte_buffer_t>,
+              "byte buffer is copy constructible");
+
+namespace {
+zl::slice<const uint8_t> as_bytes(const std::string& string)
+{
+    return zl::raw_slice(*reinterpret_cast<const uint8_t*>(string.data()),
+                         string.size());
+}
+
+std::string contents(const byte_buffer_t& buffer)
+{
+    std::string out(buffer.size(), '\0');
+    const size_t copied = buffer.copy_to(
+        zl::raw_slice(*reinterpret_cast<uint8_t*>(out.data()), out.size()));
+    REQUIRE(copied == buffer.size());
+    return out;
+}
+} // namespace
+
+TEST_SUITE("byte_buffer_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning")
+        {
+            c_allocator_t c;
+            auto maybe_buffer = byte_buffer_t::make_owning(c);
+            REQUIRE(maybe_buffer.okay());
+            REQUIRE(maybe_buffer.release_ref().size() == 0);
+            REQUIRE(maybe_buffer.release_ref().writable_bytes() == 0);
+        }
+
+        SUBCASE("make with an arena")
+        {
+            c_allocator_t c;
+            auto arena =
+                scratch_allocator_t::make(alloc<uint8_t>(c, 100000).release());
+            auto buffer = byte_buffer_t::make(arena, 1024).release();
+            for (int i = 0; i < 100; ++i)
+                REQUIRE(buffer.try_append(as_bytes("0123456789")).okay());
+            REQUIRE(buffer.size() == 1000);
+        }
+
+        SUBCASE("custom segment size")
+        {
+            c_allocator_t c;
+            auto maybe_buffer = byte_buffer_t::make_owning(c, 1000);
+            REQUIRE(maybe_buffer.okay());
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto buffer = byte_buffer_t::make_owning(c, 64).release();
+            REQUIRE(buffer.try_append(as_bytes("hello")).okay());
+            byte_buffer_t moved(std::move(buffer));
+            REQUIRE(buffer.size() == 0);
+            REQUIRE(contents(moved) == "hello");
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("append across segments and consume")
+        {
+            c_allocator_t c;
+            auto buffer = byte_buffer_t::make_owning(c, 64).release();
+            std::string expected;
+            for (int i = 0; i < 200; ++i) {
+                const std::string piece = std::to_string(i) + ",";
+                REQUIRE(buffer.try_append(as_bytes(piece)).okay());
+                expected += piece;
+            }
+            REQUIRE(buffer.size() == expected.size());
+            REQUIRE(contents(buffer) == expected);
+
+            size_t pieces = 0;
+            std::string joined;
+            buffer.for_each_segment([&](zl::slice<const uint8_t> piece) {
+                joined.append(reinterpret_cast<const char*>(piece.data()),
+                              piece.size());
+                ++pieces;
+            });
+            REQUIRE(joined == expected);
+            REQUIRE(pieces > 1);
+
+            buffer.consume(100);
+            expected.erase(0, 100);
+            REQUIRE(contents(buffer) == expected);
+            buffer.consume(expected.size() - 3);
+            expected.erase(0, expected.size() - 3);
+            REQUIRE(contents(buffer) == expected);
+            buffer.clear();
+            REQUIRE(buffer.size() == 0);
+            REQUIRE(buffer.try_append(as_bytes("again")).okay());
+            REQUIRE(contents(buffer) == "again");
+        }
+
+        SUBCASE("consumed segments are reused")
+        {
+            c_allocator_t c;
+            auto buffer = byte_buffer_t::make_owning(c, 128).release();
+            const std::string piece(100, 'x');
+            for (int i = 0; i < 10; ++i)
+                REQUIRE(buffer.try_append(as_bytes(piece)).okay());
+            buffer.consume(buffer.size());
+#ifdef ALLO_ENABLE_STATS
+            const size_t allocs = c.stats().allocs;
+#endif
+            for (int round = 0; round < 20; ++round) {
+                for (int i = 0; i < 10; ++i)
+                    REQUIRE(buffer.try_append(as_bytes(piece)).okay());
+                buffer.consume(buffer.size());
+            }
+#ifdef ALLO_ENABLE_STATS
+            REQUIRE(c.stats().allocs == allocs);
+#endif
+            REQUIRE(buffer.release_spare_segments() > 0);
+            REQUIRE(buffer.release_spare_segments() == 0);
+        }
+
+        SUBCASE("reserve then commit")
+        {
+            c_allocator_t c;
+            auto buffer = byte_buffer_t::make_owning(c, 64).release();
+            REQUIRE(buffer.try_append(as_bytes("head")).okay());
+            REQUIRE(buffer.try_reserve(200).okay());
+            REQUIRE(buffer.writable_bytes() >= 200);
+#ifdef ALLO_ENABLE_STATS
+            const size_t allocs = c.stats().allocs;
+#endif
+            REQUIRE(buffer.try_append(as_bytes(std::string(200, 'y'))).okay());
+#ifdef ALLO_ENABLE_STATS
+            REQUIRE(c.stats().allocs == allocs);
+#endif
+            REQUIRE(contents(buffer) == "head" + std::string(200, 'y'));
+        }
+
+        SUBCASE("writev and readv through a pipe")
+        {
+            c_allocator_t c;
+            int fds[2];
+            REQUIRE(pipe(fds) == 0);
+
+            auto outgoing = byte_buffer_t::make_owning(c, 64).release();
+            std::string expected;
+            for (int i = 0; i < 50; ++i) {
+                const std::string piece = "piece " + std::to_string(i) + ";";
+                REQUIRE(outgoing.try_append(as_bytes(piece)).okay());
+                expected += piece;
+            }
+            iovec iovecs[64];
+            const size_t count = outgoing.readable_iovecs(
+                zl::raw_slice(*iovecs, 64));
+            REQUIRE(count > 1);
+            const ssize_t written = writev(fds[1], iovecs, int(count));
+            REQUIRE(written == ssize_t(expected.size()));
+            outgoing.consume(size_t(written));
+            REQUIRE(outgoing.size() == 0);
+
+            auto incoming = byte_buffer_t::make_owning(c, 64).release();
+            REQUIRE(incoming.try_reserve(expected.size()).okay());
+            const size_t writable = incoming.writable_iovecs(
+                zl::raw_slice(*iovecs, 64));
+            REQUIRE(writable > 1);
+            const ssize_t read = readv(fds[0], iovecs, int(writable));
+            REQUIRE(read == ssize_t(expected.size()));
+            incoming.commit(size_t(read));
+            REQUIRE(contents(incoming) == expected);
+
+            close(fds[0]);
+            close(fds[1]);
+        }
+
+        SUBCASE("iovecs which do not fit are left out")
+        {
+            c_allocator_t c;
+            auto buffer = byte_buffer_t::make_owning(c, 64).release();
+            REQUIRE(buffer.try_append(as_bytes(std::string(500, 'z'))).okay());
+            iovec iovecs[2];
+            REQUIRE(buffer.readable_iovecs(zl::raw_slice(*iovecs, 2)) == 2);
+            REQUIRE(iovecs[0].iov_len + iovecs[1].iov_len < 500);
+        }
+    }
+}
@@ -0,0 +1,188 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/structures/deque.h"
+#include "testing_types.h"
+// test header should be last
+#include "test_header.h"
+#include <deque>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<deque_t<int>>,
+              "deque of ints is default constructible");
+
+TEST_SUITE("deque_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning")
+        {
+            c_allocator_t c;
+            // segments are cache line aligned, which is more than
+            // c_allocator_t supports
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto maybe_deque = deque_t<int>::make_owning(heap, 100);
+            REQUIRE(maybe_deque.okay());
+            REQUIRE(maybe_deque.release_ref().size() == 0);
+            REQUIRE(!maybe_deque.release_ref().front().has_value());
+            REQUIRE(!maybe_deque.release_ref().back().has_value());
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto deque = deque_t<int>::make_owning(heap, 0).release();
+            REQUIRE(deque.try_push_back(1).okay());
+            deque_t<int> moved(std::move(deque));
+            REQUIRE(deque.size() == 0);
+            REQUIRE(moved.size() == 1);
+            REQUIRE(moved.front().value() == 1);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("push and pop at both ends")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto deque = deque_t<int>::make_owning(heap, 0).release();
+            REQUIRE(deque.try_push_back(2).okay());
+            REQUIRE(deque.try_push_front(1).okay());
+            REQUIRE(deque.try_push_back(3).okay());
+            REQUIRE(deque.try_push_front(0).okay());
+            REQUIRE(deque.size() == 4);
+            for (int i = 0; i < 4; ++i)
+                REQUIRE(deque.try_get_at(i).value() == i);
+            REQUIRE(deque.front().value() == 0);
+            REQUIRE(deque.back().value() == 3);
+
+            deque.pop_front();
+            deque.pop_back();
+            REQUIRE(deque.size() == 2);
+            REQUIRE(deque.front().value() == 1);
+            REQUIRE(deque.back().value() == 2);
+            deque.pop_back();
+            deque.pop_back();
+            REQUIRE(deque.size() == 0);
+            // popping an empty deque does nothing
+            deque.pop_back();
+            deque.pop_front();
+            REQUIRE(deque.size() == 0);
+        }
+
+        SUBCASE("many items across segments match std::deque")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto deque = deque_t<int>::make_owning(heap, 0).release();
+            std::deque<int> expected;
+            const size_t count = deque_t<int>::items_per_segment * 20;
+            for (size_t i = 0; i < count; ++i) {
+                const int value = static_cast<int>(i);
+                if (i % 3 == 0) {
+                    REQUIRE(deque.try_push_front(value).okay());
+                    expected.push_front(value);
+                } else {
+                    REQUIRE(deque.try_push_back(value).okay());
+                    expected.push_back(value);
+                }
+                if (i % 7 == 0 && !expected.empty()) {
+                    deque.pop_front();
+                    expected.pop_front();
+                }
+                if (i % 11 == 0 && !expected.empty()) {
+                    deque.pop_back();
+                    expected.pop_back();
+                }
+            }
+            REQUIRE(deque.size() == expected.size());
+            for (size_t i = 0; i < expected.size(); ++i)
+                REQUIRE(deque.get_at_unchecked(i) == expected[i]);
+
+            size_t index = 0;
+            deque.for_each([&](int& item) {
+                REQUIRE(item == expected[index]);
+                ++index;
+            });
+            REQUIRE(index == expected.size());
+        }
+
+        SUBCASE("items never move")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto deque = deque_t<int>::make_owning(heap, 0).release();
+            REQUIRE(deque.try_push_back(-1).okay());
+            int* const first = &deque.front().value();
+            for (int i = 0; i < 1000; ++i) {
+                REQUIRE(deque.try_push_back(i).okay());
+                REQUIRE(deque.try_push_front(i).okay());
+            }
+            REQUIRE(&deque.get_at_unchecked(1000) == first);
+            REQUIRE(*first == -1);
+        }
+
+        SUBCASE("used as a queue, segments are recycled")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto deque = deque_t<int>::make_owning(heap, 0).release();
+            // warm up, so that there are enough spare segments
+            for (int i = 0; i < 100; ++i)
+                REQUIRE(deque.try_push_back(i).okay());
+            for (int i = 0; i < 100; ++i)
+                deque.pop_front();
+#ifdef ALLO_ENABLE_STATS
+            const size_t allocs = heap.stats().allocs;
+            const size_t frees = heap.stats().frees;
+#endif
+
+            for (int round = 0; round < 50; ++round) {
+                for (int i = 0; i < 100; ++i)
+                    REQUIRE(deque.try_push_back(i).okay());
+                for (int i = 0; i < 100; ++i) {
+                    REQUIRE(deque.front().value() == i);
+                    deque.pop_front();
+                }
+            }
+#ifdef ALLO_ENABLE_STATS
+            REQUIRE(heap.stats().allocs == allocs);
+            REQUIRE(heap.stats().frees == frees);
+#endif
+            deque.release_spare_segments();
+#ifdef ALLO_ENABLE_STATS
+            REQUIRE(heap.stats().frees > frees);
+#endif
+        }
+
+        SUBCASE("items are destroyed")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            {
+                auto deque =
+                    deque_t<counted_t>::make_owning(heap, 10).release();
+                for (int i = 0; i < 100; ++i) {
+                    REQUIRE(deque.try_push_back(i).okay());
+                    REQUIRE(deque.try_push_front(i).okay());
+                }
+                REQUIRE(counted_t::alive == 200);
+                deque.pop_back();
+                deque.pop_front();
+                REQUIRE(counted_t::alive == 198);
+                deque.clear();
+                REQUIRE(counted_t::alive == 0);
+                REQUIRE(deque.try_push_back(1).okay());
+            }
+            REQUIRE(counted_t::alive == 0);
+        }
+    }
+}
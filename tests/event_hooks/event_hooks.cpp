@@ -0,0 +1,196 @@
+#include "allo/event_hooks.h"
+
+// NOTE: every translation unit which includes an allocator has to see the same
+// hooks. the universal tests linked into this executable are compiled with the
+// default policy, so these hooks only count events, and the tests below only
+// look at how much the counts change.
+struct counting_event_hooks_t : allo::null_event_hooks_t
+{
+    static inline size_t grows = 0;
+    static inline size_t bytes_grown = 0;
+    static inline size_t ooms = 0;
+    static inline size_t invalid_frees = 0;
+    static inline size_t type_mismatches = 0;
+    static inline size_t parent_remap_failures = 0;
+    static inline allo::AllocationStatusCode last_reason =
+        allo::AllocationStatusCode::Okay;
+
+    template <typename allocator_t>
+    static inline void on_grow(const allocator_t&, size_t bytes) noexcept
+    {
+        ++grows;
+        bytes_grown += bytes;
+    }
+
+    template <typename allocator_t>
+    static inline void on_oom(const allocator_t&, size_t) noexcept
+    {
+        ++ooms;
+    }
+
+    template <typename allocator_t>
+    static inline void
+    on_invalid_free(const allocator_t&, allo::bytes_t,
+                    allo::AllocationStatusCode reason) noexcept
+    {
+        ++invalid_frees;
+        last_reason = reason;
+    }
+
+    template <typename allocator_t>
+    static inline void on_type_mismatch(const allocator_t&, allo::bytes_t,
+                                        size_t, size_t) noexcept
+    {
+        ++type_mismatches;
+    }
+
+    template <typename allocator_t>
+    static inline void
+    on_parent_remap_failed(const allocator_t&, allo::bytes_t, size_t,
+                           allo::AllocationStatusCode) noexcept
+    {
+        ++parent_remap_failures;
+    }
+};
+
+#define ALLO_EVENT_HOOKS counting_event_hooks_t
+
+#include "allo/block_allocator.h"
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/reservation_allocator.h"
+#include "allo/stack_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "test_header.h"
+
+using namespace allo;
+using hooks = counting_event_hooks_t;
+
+TEST_SUITE("event hooks")
+{
+    TEST_CASE("the policy is chosen at compile time")
+    {
+        static_assert(std::is_same_v<detail::event_hooks_t, hooks>);
+        // the default hooks do nothing, and can be called at compile time
+        constexpr auto call_default = []() {
+            null_event_hooks_t::on_grow(0, 100);
+            return true;
+        };
+        static_assert(call_default());
+    }
+
+    TEST_CASE("growing by remapping the parent")
+    {
+        const size_t grows = hooks::grows;
+        const size_t bytes_grown = hooks::bytes_grown;
+        const size_t failures = hooks::parent_remap_failures;
+        auto reservation = reservation_allocator_t::make(
+                               {.committed = 1,
+                                .additional_pages_reserved = 100})
+                               .release();
+        auto heap = heap_allocator_t::make_owning(reservation.current_memory(),
+                                                  reservation);
+
+        // does not fit in the one committed page
+        auto big = alloc<uint8_t>(heap, 20000).release();
+        // both the heap and the reservation under it grew
+        REQUIRE(hooks::grows == grows + 2);
+        REQUIRE(hooks::bytes_grown >= bytes_grown + 20000);
+        REQUIRE(hooks::parent_remap_failures == failures);
+        REQUIRE(allo::free(heap, big).okay());
+    }
+
+    TEST_CASE("a parent refusing to remap")
+    {
+        const size_t failures = hooks::parent_remap_failures;
+        const size_t grows = hooks::grows;
+        c_allocator_t global_allocator;
+        auto parent_mem = alloc<uint8_t>(global_allocator, 20000).release();
+        heap_allocator_t parent =
+            heap_allocator_t::make_owning(parent_mem, global_allocator);
+        auto mem = alloc<uint8_t>(parent, 512).release();
+        stack_allocator_t stack = stack_allocator_t::make_owning(mem, parent);
+
+        // heap allocators cannot grow allocations in place, so the stack has
+        // to get a new block instead
+        auto big = alloc<uint8_t>(stack, 2000).release();
+        REQUIRE(hooks::parent_remap_failures == failures + 1);
+        REQUIRE(hooks::grows == grows + 1);
+        REQUIRE(allo::free(stack, big).okay());
+    }
+
+    TEST_CASE("running out of memory")
+    {
+        const size_t ooms = hooks::ooms;
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 1000).release();
+        {
+            heap_allocator_t heap = heap_allocator_t::make(mem);
+            REQUIRE(alloc<uint8_t>(heap, 4000).err() ==
+                    AllocationStatusCode::OOM);
+            REQUIRE(hooks::ooms == ooms + 1);
+        }
+        REQUIRE(allo::free(global_allocator, mem).okay());
+    }
+
+    TEST_CASE("freeing with the wrong size")
+    {
+        const size_t invalid_frees = hooks::invalid_frees;
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 2000).release();
+        heap_allocator_t heap =
+            heap_allocator_t::make_owning(mem, global_allocator);
+        auto ints = alloc<int>(heap, 10).release();
+        const bytes_t wrong_size = zl::raw_slice(
+            *reinterpret_cast<uint8_t*>(ints.data()), 9 * sizeof(int));
+
+        // only actual frees are reported, not queries
+        REQUIRE(heap.free_status(wrong_size, 0).err() ==
+                AllocationStatusCode::MemoryInvalid);
+        REQUIRE(hooks::invalid_frees == invalid_frees);
+
+        REQUIRE(heap.free_bytes(wrong_size, 0).err() ==
+                AllocationStatusCode::MemoryInvalid);
+        REQUIRE(hooks::invalid_frees == invalid_frees + 1);
+        REQUIRE(hooks::last_reason == AllocationStatusCode::MemoryInvalid);
+        REQUIRE(allo::free(heap, ints).okay());
+    }
+
+#ifndef ALLO_DISABLE_TYPEINFO
+    TEST_CASE("freeing as the wrong type")
+    {
+        const size_t type_mismatches = hooks::type_mismatches;
+        const size_t invalid_frees = hooks::invalid_frees;
+        c_allocator_t global_allocator;
+        auto blocks = block_allocator_t::make_owning(
+            alloc<uint8_t>(global_allocator, 2000).release(), global_allocator,
+            200);
+        auto mem = blocks.alloc_bytes(16, 0, 1234).release();
+
+        REQUIRE(blocks.free_bytes(mem, 4321).err() ==
+                AllocationStatusCode::InvalidType);
+        REQUIRE(hooks::type_mismatches == type_mismatches + 1);
+        REQUIRE(hooks::invalid_frees == invalid_frees);
+        REQUIRE(blocks.free_bytes(mem, 1234).okay());
+    }
+
+    TEST_CASE("checking a free does not emit events")
+    {
+        const size_t type_mismatches = hooks::type_mismatches;
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 2000).release();
+        heap_allocator_t heap =
+            heap_allocator_t::make_owning(mem, global_allocator);
+        auto bytes = heap.alloc_bytes(16, 0, 1234).release();
+
+        REQUIRE(heap.free_status(bytes, 4321).err() ==
+                AllocationStatusCode::InvalidType);
+        REQUIRE(hooks::type_mismatches == type_mismatches);
+        REQUIRE(heap.free_bytes(bytes, 4321).err() ==
+                AllocationStatusCode::InvalidType);
+        REQUIRE(hooks::type_mismatches == type_mismatches + 1);
+        REQUIRE(heap.free_bytes(bytes, 1234).okay());
+    }
+#endif
+}
@@ -0,0 +1,178 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/structures/flat_map.h"
+// test header should be last
+#include "test_header.h"
+#include <map>
+#include <random>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<flat_map_t<int, int>>,
+              "flat map of ints is default constructible");
+static_assert(!std::is_copy_constructible_v<flat_map_t<int, int>>,
+              "flat map of ints is copy constructible");
+
+TEST_SUITE("flat_map_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning with c allocator")
+        {
+            c_allocator_t c;
+            auto maybe_map = flat_map_t<int, float>::make_owning(c, 100);
+            REQUIRE(maybe_map.okay());
+            REQUIRE(maybe_map.release_ref().size() == 0);
+            REQUIRE(maybe_map.release_ref().is_sorted());
+        }
+
+        SUBCASE("make owning with heap allocator")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 10000).release(), c);
+            auto maybe_map = flat_map_t<int, int>::make_owning(heap, 0);
+            REQUIRE(maybe_map.okay());
+            auto& map = maybe_map.release_ref();
+            for (int i = 0; i < 100; ++i)
+                REQUIRE(map.try_insert(i, i).okay());
+            REQUIRE(map.size() == 100);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto map = flat_map_t<int, int>::make_owning(c, 4).release();
+            REQUIRE(map.try_insert(1, 10).okay());
+            flat_map_t<int, int> moved(std::move(map));
+            REQUIRE(map.size() == 0);
+            REQUIRE(moved.size() == 1);
+            REQUIRE(moved.try_get(1).value() == 10);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("insert keeps keys sorted")
+        {
+            c_allocator_t c;
+            auto map = flat_map_t<int, int>::make_owning(c, 1).release();
+            for (int key : {5, 1, 9, 3, 7, 0, 8})
+                REQUIRE(map.try_insert(key, key * 10).okay());
+            REQUIRE(map.try_insert(5, 0).err() ==
+                    flat_map_t<int, int>::StatusCode::AlreadyPresent);
+            REQUIRE(map.try_get(5).value() == 50);
+
+            const int expected[] = {0, 1, 3, 5, 7, 8, 9};
+            REQUIRE(map.size() == 7);
+            for (size_t i = 0; i < map.size(); ++i) {
+                REQUIRE(map.keys().data()[i] == expected[i]);
+                REQUIRE(map.values().data()[i] == expected[i] * 10);
+            }
+        }
+
+        SUBCASE("lower bound")
+        {
+            c_allocator_t c;
+            auto map = flat_map_t<int, int>::make_owning(c, 1).release();
+            REQUIRE(map.lower_bound(3) == 0);
+            for (int key = 0; key < 100; key += 2)
+                REQUIRE(map.try_insert(key, key).okay());
+            for (int key = -1; key < 102; ++key) {
+                const size_t index = map.lower_bound(key);
+                const size_t expected =
+                    key < 0 ? 0 : std::min<size_t>((key + 1) / 2, 50);
+                REQUIRE(index == expected);
+            }
+        }
+
+        SUBCASE("get, contains and remove")
+        {
+            c_allocator_t c;
+            auto map = flat_map_t<uint64_t, int>::make_owning(c, 8).release();
+            REQUIRE(!map.try_get(1).has_value());
+            REQUIRE(map.try_remove(1).err() ==
+                    flat_map_t<uint64_t, int>::StatusCode::NotFound);
+            for (uint64_t i = 0; i < 50; ++i)
+                REQUIRE(map.try_insert(i * 3, int(i)).okay());
+            REQUIRE(map.contains(30));
+            REQUIRE(!map.contains(31));
+            map.try_get(30).value() = -1;
+            REQUIRE(std::as_const(map).try_get(30).value() == -1);
+            REQUIRE(map.try_remove(30).okay());
+            REQUIRE(!map.contains(30));
+            REQUIRE(map.contains(33));
+            REQUIRE(map.size() == 49);
+            map.clear();
+            REQUIRE(map.size() == 0);
+            REQUIRE(map.try_insert(4, 4).okay());
+        }
+
+        SUBCASE("append unsorted then sort")
+        {
+            c_allocator_t c;
+            auto map = flat_map_t<int, int>::make_owning(c, 1).release();
+            REQUIRE(map.try_insert(500, -500).okay());
+            std::mt19937 rng(1234);
+            std::map<int, int> expected{{500, -500}};
+            for (int i = 0; i < 2000; ++i) {
+                const int key = static_cast<int>(rng() % 100000);
+                if (expected.count(key) != 0)
+                    continue;
+                REQUIRE(map.try_append_unsorted(key, -key).okay());
+                expected.emplace(key, -key);
+            }
+            REQUIRE(!map.is_sorted());
+            map.sort();
+            REQUIRE(map.is_sorted());
+            REQUIRE(map.size() == expected.size());
+            size_t index = 0;
+            map.for_each([&](const int& key, int& value) {
+                auto it = expected.begin();
+                std::advance(it, index);
+                REQUIRE(key == it->first);
+                REQUIRE(value == it->second);
+                ++index;
+            });
+            REQUIRE(index == expected.size());
+            REQUIRE(map.try_get(500).value() == -500);
+        }
+
+        SUBCASE("sort drops duplicate keys")
+        {
+            c_allocator_t c;
+            auto map = flat_map_t<int, int>::make_owning(c, 1).release();
+            for (int round = 0; round < 3; ++round) {
+                for (int key = 9; key >= 0; --key)
+                    REQUIRE(map.try_append_unsorted(key, key).okay());
+            }
+            REQUIRE(map.size() == 30);
+            map.sort();
+            REQUIRE(map.size() == 10);
+            for (int key = 0; key < 10; ++key) {
+                REQUIRE(map.keys().data()[key] == key);
+                REQUIRE(map.try_get(key).value() == key);
+            }
+        }
+
+        SUBCASE("matches std::map")
+        {
+            c_allocator_t c;
+            auto map = flat_map_t<int, int>::make_owning(c, 0).release();
+            std::map<int, int> expected;
+            std::mt19937 rng(42);
+            for (int i = 0; i < 5000; ++i) {
+                const int key = static_cast<int>(rng() % 500);
+                if (rng() % 3 == 0) {
+                    const bool present = expected.erase(key) != 0;
+                    REQUIRE(map.try_remove(key).okay() == present);
+                } else {
+                    const bool inserted = expected.emplace(key, i).second;
+                    REQUIRE(map.try_insert(key, i).okay() == inserted);
+                }
+            }
+            REQUIRE(map.size() == expected.size());
+            for (const auto& [key, value] : expected)
+                REQUIRE(map.try_get(key).value() == value);
+        }
+    }
+}
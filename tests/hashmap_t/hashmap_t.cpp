@@ -0,0 +1,250 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/reservation_allocator.h"
+#include "allo/structures/hashmap.h"
+#include "testing_types.h"
+// test header should be last
+#include "test_header.h"
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<hashmap_t<int, int>>,
+              "hashmap of ints is default constructible");
+static_assert(!std::is_copy_constructible_v<hashmap_t<int, int>>,
+              "hashmap of ints is copy constructible");
+
+namespace {
+// every key lands in the same few slots, so all of them collide
+struct bad_hash_t
+{
+    size_t operator()(int key) const noexcept { return size_t(key % 4); }
+};
+} // namespace
+
+TEST_SUITE("hashmap_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning with c allocator")
+        {
+            c_allocator_t c;
+            auto maybe_map = hashmap_t<int, int>::make_owning(c, 100);
+            REQUIRE(maybe_map.okay());
+            auto& map = maybe_map.release_ref();
+            REQUIRE(map.size() == 0);
+            REQUIRE(map.capacity() >= 100);
+        }
+
+        SUBCASE("make with a buffer which is too small")
+        {
+            alignas(16) uint8_t buffer[16];
+            auto maybe_map = hashmap_t<int, int>::make(
+                zl::raw_slice(buffer[0], sizeof(buffer)));
+            REQUIRE(maybe_map.err() == AllocationStatusCode::InvalidArgument);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto maybe_map = hashmap_t<int, int>::make_owning(c, 10);
+            REQUIRE(maybe_map.okay());
+            hashmap_t<int, int> map(std::move(maybe_map.release_ref()));
+            REQUIRE(map.try_insert(1, 2).okay());
+            hashmap_t<int, int> moved(std::move(map));
+            REQUIRE(map.size() == 0);
+            REQUIRE(map.capacity() == 0);
+            REQUIRE(moved.try_get(1).value() == 2);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("insert, get, and remove")
+        {
+            c_allocator_t c;
+            auto map = hashmap_t<int, int>::make_owning(c, 10).release();
+            REQUIRE(map.try_insert(1, 10).okay());
+            REQUIRE(map.try_insert(2, 20).okay());
+            REQUIRE(map.try_insert(1, 30).err() ==
+                    hashmap_t<int, int>::StatusCode::AlreadyPresent);
+            REQUIRE(map.size() == 2);
+            REQUIRE(map.try_get(1).value() == 10);
+            REQUIRE(map.contains(2));
+            REQUIRE(!map.contains(3));
+            REQUIRE(!map.try_get(3).has_value());
+
+            map.try_get(2).value() = 25;
+            const auto& const_map = map;
+            REQUIRE(const_map.try_get(2).value() == 25);
+
+            REQUIRE(map.try_remove(1).okay());
+            REQUIRE(map.try_remove(1).err() ==
+                    hashmap_t<int, int>::StatusCode::NotFound);
+            REQUIRE(!map.contains(1));
+            REQUIRE(map.size() == 1);
+        }
+
+        SUBCASE("removing keeps colliding keys findable")
+        {
+            c_allocator_t c;
+            auto map =
+                hashmap_t<int, int, bad_hash_t>::make_owning(c, 100).release();
+            for (int i = 0; i < 60; ++i)
+                REQUIRE(map.try_insert(i, i * 2).okay());
+            // remove every third key, then check everything
+            for (int i = 0; i < 60; i += 3)
+                REQUIRE(map.try_remove(i).okay());
+            for (int i = 0; i < 60; ++i) {
+                if (i % 3 == 0) {
+                    REQUIRE(!map.contains(i));
+                } else {
+                    REQUIRE(map.try_get(i).value() == i * 2);
+                }
+            }
+            // repeated inserts and removes never fill the table up
+            for (int i = 0; i < 1000; ++i) {
+                REQUIRE(map.try_insert(1000 + i, i).okay());
+                REQUIRE(map.try_remove(1000 + i).okay());
+            }
+            REQUIRE(map.size() == 40);
+        }
+
+        SUBCASE("grow into a new allocation from a heap")
+        {
+            c_allocator_t c;
+            auto mem = alloc<uint8_t>(c, 100000).release();
+            auto heap = heap_allocator_t::make_owning(mem, c);
+            auto map = hashmap_t<int, int>::make_owning(heap, 1).release();
+            const size_t initial_capacity = map.capacity();
+            for (int i = 0; i < 1000; ++i)
+                REQUIRE(map.try_insert(i * 7, i).okay());
+            REQUIRE(map.capacity() > initial_capacity);
+            REQUIRE(map.size() == 1000);
+            for (int i = 0; i < 1000; ++i)
+                REQUIRE(map.try_get(i * 7).value() == i);
+        }
+
+        SUBCASE("grow and rehash in place in a reservation")
+        {
+            auto reservation = reservation_allocator_t::make(
+                                   {.committed = 1,
+                                    .additional_pages_reserved = 100})
+                                   .release();
+            const uint8_t* const start = reservation.current_memory().data();
+            auto map = hashmap_t<int, int>::make_owning(
+                           reservation.current_memory(), reservation)
+                           .release();
+            const size_t initial_capacity = map.capacity();
+            const int count = static_cast<int>(initial_capacity) * 4;
+            for (int i = 0; i < count; ++i)
+                REQUIRE(map.try_insert(i, -i).okay());
+            REQUIRE(map.capacity() > initial_capacity);
+            // still the same memory
+            REQUIRE(reservation.current_memory().data() == start);
+            for (int i = 0; i < count; ++i)
+                REQUIRE(map.try_get(i).value() == -i);
+        }
+
+        SUBCASE("a fixed buffer runs out of memory")
+        {
+            using map_t = hashmap_t<int, int>;
+            alignas(map_t::alignment)
+                uint8_t buffer[map_t::bytes_needed(map_t::min_capacity)];
+            auto map =
+                map_t::make(zl::raw_slice(buffer[0], sizeof(buffer))).release();
+            int inserted = 0;
+            while (map.try_insert(inserted, inserted).okay())
+                ++inserted;
+            REQUIRE(inserted == 14);
+            REQUIRE(map.try_insert(100, 100).err() ==
+                    map_t::StatusCode::OOM);
+            REQUIRE(map.try_remove(0).okay());
+            REQUIRE(map.try_insert(100, 100).okay());
+        }
+
+        SUBCASE("entries are destroyed")
+        {
+            c_allocator_t c;
+            {
+                auto map =
+                    hashmap_t<int, counted_t>::make_owning(c, 4).release();
+                for (int i = 0; i < 100; ++i)
+                    REQUIRE(map.try_insert(i, i).okay());
+                REQUIRE(counted_t::alive == 100);
+                REQUIRE(map.try_remove(5).okay());
+                REQUIRE(counted_t::alive == 99);
+
+                int sum = 0;
+                map.for_each([&sum](const int& key, counted_t& value) {
+                    REQUIRE(key == value.value);
+                    sum += value.value;
+                });
+                REQUIRE(sum == (99 * 100 / 2) - 5);
+
+                map.clear();
+                REQUIRE(counted_t::alive == 0);
+                REQUIRE(map.size() == 0);
+                REQUIRE(map.try_insert(1, 1).okay());
+            }
+            REQUIRE(counted_t::alive == 0);
+        }
+
+        SUBCASE("reserve")
+        {
+            c_allocator_t c;
+            auto map = hashmap_t<int, int>::make_owning(c, 1).release();
+            REQUIRE(map.try_reserve(500).okay());
+            const size_t capacity = map.capacity();
+            for (int i = 0; i < 500; ++i)
+                REQUIRE(map.try_insert(i, i).okay());
+            REQUIRE(map.capacity() == capacity);
+        }
+
+        SUBCASE("keys which only differ above the table size")
+        {
+            // std::hash of integers and pointers is often the identity, so
+            // these all have the same low bits
+            c_allocator_t c;
+            auto map =
+                hashmap_t<size_t, size_t>::make_owning(c, 1000).release();
+            const size_t capacity = map.capacity();
+            for (size_t i = 0; i < 1000; ++i)
+                REQUIRE(map.try_insert(i * capacity, i).okay());
+            REQUIRE(map.capacity() == capacity);
+            for (size_t i = 0; i < 1000; ++i)
+                REQUIRE(map.try_get(i * capacity).value() == i);
+            for (size_t i = 0; i < 1000; i += 2)
+                REQUIRE(map.try_remove(i * capacity).okay());
+            for (size_t i = 1; i < 1000; i += 2)
+                REQUIRE(map.try_get(i * capacity).value() == i);
+
+            // page aligned addresses, through growth
+            auto pages =
+                hashmap_t<uintptr_t, size_t>::make_owning(c, 1).release();
+            for (size_t i = 0; i < 1000; ++i)
+                REQUIRE(pages.try_insert(uintptr_t(i) << 12, i).okay());
+            REQUIRE(pages.capacity() <= 2048);
+            for (size_t i = 0; i < 1000; ++i)
+                REQUIRE(pages.try_get(uintptr_t(i) << 12).value() == i);
+        }
+
+        SUBCASE("reserve in place in a reservation")
+        {
+            auto reservation = reservation_allocator_t::make(
+                                   {.committed = 1,
+                                    .additional_pages_reserved = 100})
+                                   .release();
+            auto map = hashmap_t<int, int>::make_owning(
+                           reservation.current_memory(), reservation)
+                           .release();
+            const size_t requested = map.capacity() * 8;
+            REQUIRE(map.try_reserve(requested).okay());
+            REQUIRE(map.capacity() >= requested);
+            const size_t capacity = map.capacity();
+            for (size_t i = 0; i < requested; ++i)
+                REQUIRE(map.try_insert(int(i), int(i)).okay());
+            REQUIRE(map.capacity() == capacity);
+            for (size_t i = 0; i < requested; ++i)
+                REQUIRE(map.try_get(int(i)).value() == int(i));
+        }
+    }
+}
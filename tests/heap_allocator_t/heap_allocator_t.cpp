@@ -9,6 +9,9 @@
 #include "heap_tests.h"
 #include "test_header.h"
 
+#include <array>
+#include <cstring>
+#include <string>
 #include <ziglike/stdmem.h>
 
 using namespace allo;
@@ -98,5 +101,302 @@ TEST_SUITE("heap_allocator_t")
             tests::allocate_480_bytes_related_objects(heap);
             tests::typed_alloc_realloc_free(heap);
         }
+
+        SUBCASE("free with the wrong size")
+        {
+            c_allocator_t global_allocator;
+            auto mem = alloc<uint8_t>(global_allocator, 2000).release();
+            heap_allocator_t heap =
+                heap_allocator_t::make_owning(mem, global_allocator);
+            auto ints = alloc<int>(heap, 10).release();
+            const bytes_t wrong_size = zl::raw_slice(
+                *reinterpret_cast<uint8_t*>(ints.data()), 9 * sizeof(int));
+            REQUIRE(heap.free_status(wrong_size, 0).err() ==
+                    AllocationStatusCode::MemoryInvalid);
+            REQUIRE(allo::free(heap, ints).okay());
+        }
+
+#ifndef ALLO_DISABLE_TYPEINFO
+        SUBCASE("free with the wrong type")
+        {
+            c_allocator_t global_allocator;
+            auto mem = alloc<uint8_t>(global_allocator, 2000).release();
+            heap_allocator_t heap =
+                heap_allocator_t::make_owning(mem, global_allocator);
+            REQUIRE(heap.set_mmap_threshold(1UL << 20).okay());
+            // small allocations and ones mapped from the OS both refuse it
+            for (size_t size : {size_t(64), size_t(2UL << 20)}) {
+                auto bytes = heap.alloc_bytes(size, 3, 1234).release();
+                REQUIRE(heap.free_status(bytes, 4321).err() ==
+                        AllocationStatusCode::InvalidType);
+                REQUIRE(heap.free_bytes(bytes, 4321).err() ==
+                        AllocationStatusCode::InvalidType);
+                REQUIRE(heap.remap_bytes(bytes, 4321, size / 2, 4321).err() ==
+                        AllocationStatusCode::InvalidType);
+                REQUIRE(heap.free_status(bytes, 1234).okay());
+                REQUIRE(heap.free_bytes(bytes, 1234).okay());
+            }
+            REQUIRE(heap.mapped_allocation_count() == 0);
+        }
+#endif
+
+        SUBCASE("large allocations bypass the heap")
+        {
+            c_allocator_t global_allocator;
+            auto mem = alloc<uint8_t>(global_allocator, 2000).release();
+            // no parent: the heap cannot grow, so anything big must bypass it
+            heap_allocator_t heap = heap_allocator_t::make(mem);
+            REQUIRE(heap.mmap_threshold() == 0);
+            REQUIRE(alloc<uint8_t>(heap, 4UL << 20).err() ==
+                    AllocationStatusCode::OOM);
+            REQUIRE(heap.set_mmap_threshold(1UL << 20).okay());
+
+            REQUIRE(alloc<uint8_t>(heap, 100).okay());
+            REQUIRE(heap.mapped_allocation_count() == 0);
+
+            auto big = alloc<uint8_t>(heap, 4UL << 20).release();
+            std::memset(big.data(), 1, big.size());
+            REQUIRE(heap.mapped_allocation_count() == 1);
+            REQUIRE(heap.mapped_allocation_bytes() >= big.size());
+            REQUIRE(heap.free_status(big, 0).okay());
+
+            auto aligned =
+                alloc<int, heap_allocator_t, 128>(heap, 1UL << 18).release();
+            REQUIRE(reinterpret_cast<uintptr_t>(aligned.data()) % 128 == 0);
+            REQUIRE(heap.mapped_allocation_count() == 2);
+
+            // shrinking always works in place
+            aligned = remap(heap, aligned, 100000).release();
+            REQUIRE(aligned.size() == 100000);
+            REQUIRE(allo::free(heap, aligned).okay());
+            REQUIRE(heap.mapped_allocation_count() == 1);
+
+            const size_t bytes_before_free = heap.mapped_allocation_bytes();
+            REQUIRE(allo::free(heap, big).okay());
+            REQUIRE(heap.mapped_allocation_count() == 0);
+            REQUIRE(heap.mapped_allocation_bytes() == 0);
+            REQUIRE(bytes_before_free > 0);
+
+            // destructor cleans up the ones that are not freed
+            REQUIRE(alloc<uint8_t>(heap, 2UL << 20).okay());
+            allo::free(global_allocator, mem);
+        }
+
+        SUBCASE("large allocations are only freed by their own heap")
+        {
+            c_allocator_t global_allocator;
+            auto first = heap_allocator_t::make_owning(
+                alloc<uint8_t>(global_allocator, 2000).release(),
+                global_allocator);
+            auto second = heap_allocator_t::make_owning(
+                alloc<uint8_t>(global_allocator, 2000).release(),
+                global_allocator);
+            REQUIRE(first.set_mmap_threshold(1UL << 20).okay());
+            REQUIRE(second.set_mmap_threshold(1UL << 20).okay());
+
+            auto big = alloc<uint8_t>(first, 2UL << 20).release();
+            REQUIRE(second.free_status(big, 0).err() ==
+                    AllocationStatusCode::MemoryInvalid);
+            REQUIRE(allo::free(second, big).err() ==
+                    AllocationStatusCode::MemoryInvalid);
+            REQUIRE(second.remap_bytes(big, 0, 1UL << 20, 0).err() ==
+                    AllocationStatusCode::MemoryInvalid);
+            REQUIRE(first.mapped_allocation_count() == 1);
+            REQUIRE(second.mapped_allocation_count() == 0);
+            std::memset(big.data(), 1, big.size());
+
+            // the allocations follow the heap when it is moved
+            heap_allocator_t moved(std::move(first));
+            REQUIRE(moved.free_status(big, 0).okay());
+            REQUIRE(allo::free(moved, big).okay());
+            REQUIRE(moved.mapped_allocation_count() == 0);
+        }
+
+        SUBCASE("trim gives empty blocks back to the parent")
+        {
+            c_allocator_t global_allocator;
+            auto parent_mem =
+                alloc<uint8_t>(global_allocator, 100000).release();
+            heap_allocator_t parent = heap_allocator_t::make(parent_mem);
+            {
+                heap_allocator_t heap = heap_allocator_t::make_owning(
+                    alloc<uint8_t>(parent, 512).release(), parent);
+                // nothing to give back before there are extra blocks
+                REQUIRE(heap.trim() == 0);
+
+                std::array<zl::slice<uint8_t>, 20> allocations;
+                for (auto& allocation : allocations) {
+                    allocation = alloc<uint8_t>(heap, 400).release();
+                }
+                for (auto& allocation : allocations) {
+                    REQUIRE(allo::free(heap, allocation).okay());
+                }
+                REQUIRE(heap.trim() > 0);
+                REQUIRE(heap.trim() == 0);
+
+                // still usable afterwards
+                for (auto& allocation : allocations) {
+                    allocation = alloc<uint8_t>(heap, 400).release();
+                    std::memset(allocation.data(), 0, allocation.size());
+                }
+            }
+            allo::free(global_allocator, parent_mem);
+        }
+
+        SUBCASE("automatic trim")
+        {
+            c_allocator_t global_allocator;
+            auto parent_mem =
+                alloc<uint8_t>(global_allocator, 100000).release();
+            heap_allocator_t parent = heap_allocator_t::make(parent_mem);
+            {
+                heap_allocator_t heap = heap_allocator_t::make_owning(
+                    alloc<uint8_t>(parent, 512).release(), parent);
+                heap.set_auto_trim(true);
+                std::array<zl::slice<uint8_t>, 20> allocations;
+                for (auto& allocation : allocations) {
+                    allocation = alloc<uint8_t>(heap, 400).release();
+                }
+                for (auto& allocation : allocations) {
+                    REQUIRE(allo::free(heap, allocation).okay());
+                }
+                // already given back while freeing
+                REQUIRE(heap.trim() == 0);
+            }
+            allo::free(global_allocator, parent_mem);
+        }
+    }
+
+    TEST_CASE("heap report")
+    {
+        auto append = [](const char* text, size_t length, void* user_data) {
+            static_cast<std::string*>(user_data)->append(text, length);
+        };
+
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 4096).release();
+        heap_allocator_t heap = heap_allocator_t::make(mem);
+
+        heap_report_t report = heap.heap_report();
+        REQUIRE(report.block_count == 1);
+        REQUIRE(report.heap_bytes == 4096);
+        REQUIRE(report.live_allocations == 0);
+        REQUIRE(report.bytes_in_use == 0);
+        REQUIRE(report.free_block_count == 1);
+        REQUIRE(report.free_bytes == 4096);
+        REQUIRE(report.largest_free_block == 4096);
+        REQUIRE(report.free_size_histogram[12] == 1);
+        REQUIRE(report.external_fragmentation() == 0);
+
+        std::array<zl::slice<uint8_t>, 8> allocations;
+        for (auto& allocation : allocations)
+            allocation = alloc<uint8_t>(heap, 100).release();
+        report = heap.heap_report();
+        REQUIRE(report.live_allocations == 8);
+        REQUIRE(report.bytes_requested == 800);
+        REQUIRE(report.bytes_in_use > 800);
+        REQUIRE(report.bookkeeping_bytes ==
+                8 * sizeof(heap_allocator_t::allocation_bookkeeping_t));
+        REQUIRE(report.bytes_in_use + report.free_bytes == 4096);
+        REQUIRE(report.free_block_count == 1);
+
+        // free every other allocation, leaving holes between them
+        for (size_t i = 0; i < allocations.size(); i += 2)
+            REQUIRE(allo::free(heap, allocations[i]).okay());
+        report = heap.heap_report();
+        REQUIRE(report.live_allocations == 4);
+        REQUIRE(report.bytes_requested == 400);
+        REQUIRE(report.free_block_count == 5);
+        REQUIRE(report.bytes_in_use + report.free_bytes == 4096);
+        REQUIRE(report.largest_free_block < report.free_bytes);
+        REQUIRE(report.external_fragmentation() > 0);
+        REQUIRE(report.external_fragmentation() < 1);
+        size_t histogram_total = 0;
+        for (size_t count : report.free_size_histogram)
+            histogram_total += count;
+        REQUIRE(histogram_total == report.free_block_count);
+
+        SUBCASE("remap counts the new requested size")
+        {
+            auto shrunk = heap.remap_bytes(allocations[1], 0, 50, 0);
+            REQUIRE(shrunk.okay());
+            allocations[1] = shrunk.release();
+            REQUIRE(heap.heap_report().bytes_requested == 350);
+        }
+
+        SUBCASE("text")
+        {
+            std::string text;
+            heap.write_heap_report(HeapReportFormat::Text, append, &text);
+            REQUIRE(text.rfind("heap report\n", 0) == 0);
+            REQUIRE(text.find("free blocks: 5") != std::string::npos);
+            REQUIRE(text.find("block 0 at ") != std::string::npos);
+            // the first allocation was freed and the end was never used,
+            // with live allocations in between
+            const size_t start = text.find('|') + 1;
+            const size_t end = text.find('|', start);
+            REQUIRE(end - start == heap_allocator_t::chunk_map_cells);
+            const std::string map = text.substr(start, end - start);
+            REQUIRE(map.front() == '.');
+            REQUIRE(map.back() == '.');
+            REQUIRE(map.find('#') != std::string::npos);
+            REQUIRE(map.find_first_not_of(".#+") == std::string::npos);
+        }
+
+        SUBCASE("json")
+        {
+            std::string json;
+            heap.write_heap_report(HeapReportFormat::Json, append, &json);
+            REQUIRE(json.front() == '{');
+            REQUIRE(json.back() == '}');
+            REQUIRE(json.find("\"free_block_count\":5,") != std::string::npos);
+            REQUIRE(json.find("\"live_allocations\":4,") != std::string::npos);
+            REQUIRE(json.find("\"blocks\":[{\"address\":") !=
+                    std::string::npos);
+            size_t opened = 0;
+            size_t closed = 0;
+            for (char c : json) {
+                opened += c == '{' || c == '[';
+                closed += c == '}' || c == ']';
+            }
+            REQUIRE(opened == closed);
+        }
+
+        for (size_t i = 1; i < allocations.size(); i += 2)
+            REQUIRE(allo::free(heap, allocations[i]).okay());
+        report = heap.heap_report();
+        REQUIRE(report.live_allocations == 0);
+        REQUIRE(report.bytes_requested == 0);
+        REQUIRE(report.bytes_in_use == 0);
+        REQUIRE(report.free_bytes == 4096);
+        allo::free(global_allocator, mem);
+    }
+
+    TEST_CASE("heap report with several blocks")
+    {
+        c_allocator_t global_allocator;
+        auto parent_mem = alloc<uint8_t>(global_allocator, 100000).release();
+        heap_allocator_t parent = heap_allocator_t::make(parent_mem);
+        {
+            heap_allocator_t heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(parent, 512).release(), parent);
+            std::array<zl::slice<uint8_t>, 10> allocations;
+            for (auto& allocation : allocations)
+                allocation = alloc<uint8_t>(heap, 400).release();
+            const heap_report_t report = heap.heap_report();
+            REQUIRE(report.block_count > 1);
+            REQUIRE(report.bytes_in_use + report.free_bytes ==
+                    report.heap_bytes);
+
+            std::string text;
+            heap.write_heap_report(
+                HeapReportFormat::Text,
+                [](const char* text, size_t length, void* user_data) {
+                    static_cast<std::string*>(user_data)->append(text, length);
+                },
+                &text);
+            REQUIRE(text.find("block 1 at ") != std::string::npos);
+        }
+        allo::free(global_allocator, parent_mem);
     }
 }
@@ -0,0 +1,167 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/reservation_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "test_header.h"
+#include <thread>
+
+using namespace allo;
+
+#ifndef ALLO_ENABLE_LATENCY_HISTOGRAMS
+#error these tests must be compiled with ALLO_ENABLE_LATENCY_HISTOGRAMS
+#endif
+
+TEST_SUITE("latency histograms")
+{
+    TEST_CASE("bucket bounds")
+    {
+        using histogram = latency_histogram_t;
+        for (uint64_t i = 0; i < 16; ++i) {
+            REQUIRE(histogram::bucket_of(i) == i);
+            REQUIRE(histogram::bucket_lower_bound(i) == i);
+            REQUIRE(histogram::bucket_upper_bound(i) == i);
+        }
+        // every bucket starts right after the previous one ends
+        for (size_t i = 1; i < histogram::num_buckets; ++i) {
+            REQUIRE(histogram::bucket_lower_bound(i) ==
+                    histogram::bucket_upper_bound(i - 1) + 1);
+        }
+        const uint64_t values[] = {16,    17,      100,        1000,
+                                   12345, 1 << 20, 1234567890, 60000000000};
+        for (uint64_t value : values) {
+            const size_t bucket = histogram::bucket_of(value);
+            REQUIRE(histogram::bucket_lower_bound(bucket) <= value);
+            REQUIRE(histogram::bucket_upper_bound(bucket) >= value);
+            // within 12.5%
+            REQUIRE(histogram::bucket_upper_bound(bucket) -
+                        histogram::bucket_lower_bound(bucket) <=
+                    value / 8);
+        }
+        // everything from about a minute up goes in the last bucket
+        REQUIRE(histogram::bucket_of(uint64_t(1) << 36) ==
+                histogram::num_buckets - 1);
+        REQUIRE(histogram::bucket_of(UINT64_MAX) == histogram::num_buckets - 1);
+    }
+
+    TEST_CASE("percentiles and merging")
+    {
+        latency_histogram_t first = latency_histogram_t::empty();
+        REQUIRE(first.percentile(0.5) == 0);
+        REQUIRE(first.mean() == 0);
+
+        for (uint64_t i = 1; i <= 100; ++i)
+            first.record(i);
+        REQUIRE(first.count == 100);
+        REQUIRE(first.min_nanoseconds == 1);
+        REQUIRE(first.max_nanoseconds == 100);
+        REQUIRE(first.mean() == 50.5);
+        REQUIRE(first.percentile(0) == 1);
+        REQUIRE(first.percentile(1) == 100);
+        const uint64_t median = first.percentile(0.5);
+        REQUIRE(median >= 50);
+        REQUIRE(median <= 50 + 50 / 8);
+
+        latency_histogram_t second = latency_histogram_t::empty();
+        second.record(5000);
+        first.merge(second);
+        REQUIRE(first.count == 101);
+        REQUIRE(first.max_nanoseconds == 5000);
+        REQUIRE(first.min_nanoseconds == 1);
+        REQUIRE(first.percentile(1) == 5000);
+        const size_t bucket_of_100 = latency_histogram_t::bucket_of(100);
+        REQUIRE(first.percentile(0.99) <=
+                latency_histogram_t::bucket_upper_bound(bucket_of_100));
+    }
+
+    TEST_CASE("heap separates fast and slow paths")
+    {
+        auto reservation = reservation_allocator_t::make(
+                               {.committed = 1,
+                                .additional_pages_reserved = 100})
+                               .release();
+        auto heap = heap_allocator_t::make_owning(reservation.current_memory(),
+                                                  reservation);
+        allocator_latencies_t latencies = heap.latencies();
+        REQUIRE(latencies.get(LatencyOperation::Alloc).count == 0);
+
+        auto small = allo::alloc<uint8_t>(heap, 64).release();
+        latencies = heap.latencies();
+        REQUIRE(latencies.get(LatencyOperation::Alloc, LatencyPath::Fast)
+                    .count == 1);
+        REQUIRE(latencies.get(LatencyOperation::Alloc, LatencyPath::Slow)
+                    .count == 0);
+
+        // does not fit in the one committed page
+        auto big = allo::alloc<uint8_t>(heap, 20000).release();
+        latencies = heap.latencies();
+        REQUIRE(latencies.get(LatencyOperation::Alloc, LatencyPath::Fast)
+                    .count == 1);
+        REQUIRE(latencies.get(LatencyOperation::Alloc, LatencyPath::Slow)
+                    .count == 1);
+        // the reservation timed its own remap, which was slow since it had
+        // to commit pages
+        REQUIRE(reservation.latencies()
+                    .get(LatencyOperation::Remap, LatencyPath::Slow)
+                    .count == 1);
+
+        allo::free(heap, big);
+        allo::free(heap, small);
+        latencies = heap.latencies();
+        REQUIRE(latencies.get(LatencyOperation::Free).count == 2);
+        REQUIRE(latencies.get(LatencyOperation::Remap).count == 0);
+
+        SUBCASE("reset")
+        {
+            heap.reset_latencies();
+            latencies = heap.latencies();
+            REQUIRE(latencies.get(LatencyOperation::Alloc).count == 0);
+            REQUIRE(latencies.get(LatencyOperation::Free).count == 0);
+            REQUIRE(latencies.get(LatencyOperation::Alloc).min_nanoseconds ==
+                    UINT64_MAX);
+        }
+
+        SUBCASE("moving keeps the histograms")
+        {
+            heap_allocator_t moved(std::move(heap));
+            REQUIRE(moved.latencies().get(LatencyOperation::Free).count == 2);
+            REQUIRE(heap.latencies().get(LatencyOperation::Free).count == 0);
+        }
+    }
+
+    TEST_CASE("threads share a threadsafe allocator's histograms")
+    {
+        constexpr size_t per_thread = 1000;
+        c_allocator_t global_allocator;
+        const allocator_latencies_t before = global_allocator.latencies();
+        auto work = [&global_allocator]() {
+            for (size_t i = 0; i < per_thread; ++i) {
+                auto mem = allo::alloc<uint8_t>(global_allocator, 32);
+                allo::free(global_allocator, mem.release());
+            }
+        };
+        std::thread first(work);
+        std::thread second(work);
+        first.join();
+        second.join();
+
+        const allocator_latencies_t after = global_allocator.latencies();
+        REQUIRE(after.get(LatencyOperation::Alloc).count -
+                    before.get(LatencyOperation::Alloc).count ==
+                per_thread * 2);
+        REQUIRE(after.get(LatencyOperation::Free).count -
+                    before.get(LatencyOperation::Free).count ==
+                per_thread * 2);
+        // malloc is never counted as a slow path
+        REQUIRE(after.get(LatencyOperation::Alloc, LatencyPath::Slow).count ==
+                0);
+
+        // snapshots from different allocators can be combined
+        c_allocator_t other;
+        (void)other.alloc_bytes(1, 6, 0);
+        allocator_latencies_t combined = after;
+        combined.merge(other.latencies());
+        REQUIRE(combined.get(LatencyOperation::Alloc).count ==
+                after.get(LatencyOperation::Alloc).count + 1);
+    }
+}
@@ -34,6 +34,31 @@ TEST_SUITE("list_t")
             allo::uninitialized_array_t<int, 120> mem;
             auto list = list_t<int>::make(mem);
         }
+
+        SUBCASE("move construction and move assignment")
+        {
+            c_allocator_t c;
+            allo::uninitialized_array_t<int, 4> buffer;
+            {
+                auto first = list_t<int>::make_owning(c, 4).release();
+                REQUIRE(first.try_append(1).okay());
+                REQUIRE(first.try_append(2).okay());
+                list_t<int> moved(std::move(first));
+                REQUIRE(moved.items().size() == 2);
+
+                auto second = list_t<int>::make_owning(c, 8).release();
+                REQUIRE(second.try_append(3).okay());
+                second = std::move(moved);
+                REQUIRE(second.items().size() == 2);
+                REQUIRE(second.get_at_unchecked(0) == 1);
+                REQUIRE(second.get_at_unchecked(1) == 2);
+
+                // the owning list is replaced by one which owns nothing
+                second = list_t<int>::make(buffer);
+                REQUIRE(second.items().size() == 0);
+                REQUIRE(second.try_append(4).okay());
+            }
+        }
     }
 
     TEST_CASE("functionality")
@@ -0,0 +1,231 @@
+#include "allo.h"
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/mapped_file_allocator.h"
+#include "allo/offset_ptr.h"
+#include "allo/structures/list.h"
+#include "allo/structures/segmented_stack.h"
+#include "allo/typed_allocation.h"
+#include "test_header.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace allo;
+
+struct temp_file_t
+{
+    std::array<char, 64> path{};
+    temp_file_t()
+    {
+        // NOLINTNEXTLINE
+        std::snprintf(path.data(), path.size(), "/tmp/allo_mapped_XXXXXX");
+        int fd = mkstemp(path.data());
+        REQUIRE(fd >= 0);
+        close(fd);
+    }
+    ~temp_file_t() { unlink(path.data()); }
+};
+
+struct node_t
+{
+    int value;
+    offset_ptr<node_t> next;
+};
+
+static constexpr size_t max_size = 1UL << 24;
+
+TEST_SUITE("mapped_file_allocator_t")
+{
+    TEST_CASE("offset_ptr")
+    {
+        SUBCASE("null by default and after assigning nullptr")
+        {
+            offset_ptr<int> ptr;
+            REQUIRE(!ptr);
+            REQUIRE(ptr.get() == nullptr);
+            int item = 10;
+            ptr = &item;
+            REQUIRE(ptr);
+            REQUIRE(*ptr == 10);
+            ptr = nullptr;
+            REQUIRE(!ptr);
+        }
+
+        SUBCASE("copies point at the same thing")
+        {
+            int item = 5;
+            offset_ptr<int> first(item);
+            offset_ptr<int> second(first);
+            REQUIRE(first == second);
+            REQUIRE(first.offset() != second.offset());
+            REQUIRE(second.get() == &item);
+        }
+
+        SUBCASE("list_t and segmented_stack_t of offset_ptrs")
+        {
+            c_allocator_t c;
+            auto heap =
+                heap_allocator_t::make(alloc<uint8_t>(c, 8000).release(), c);
+            std::array<int, 100> items{};
+            auto list =
+                list_t<offset_ptr<int>>::make_owning(heap, 2).release();
+            auto stack =
+                segmented_stack_t<offset_ptr<int>>::make_owning(heap, 2)
+                    .release();
+            for (int& item : items) {
+                REQUIRE(list.try_append(&item).okay());
+                REQUIRE(stack.try_push(&item).okay());
+            }
+            for (size_t i = 0; i < items.size(); ++i) {
+                REQUIRE(list.get_at_unchecked(i).get() == &items[i]);
+            }
+            for (size_t i = items.size(); i > 0; --i) {
+                REQUIRE(stack.end().value().get() == &items[i - 1]);
+                stack.pop();
+            }
+        }
+    }
+
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make creates a fresh file")
+        {
+            temp_file_t temp;
+            const mapped_file_allocator_t::options_t options = {
+                .path = temp.path.data(),
+                .initial_size = 4096,
+                .max_size = max_size,
+            };
+            auto file = mapped_file_allocator_t::make(options).release();
+            REQUIRE(file.is_fresh());
+            REQUIRE(!file.was_relocated());
+            REQUIRE(!file.root<node_t>().has_value());
+            REQUIRE(file.bytes_used() ==
+                    sizeof(mapped_file_allocator_t::file_header_t));
+        }
+
+        SUBCASE("refuses to open files it did not create")
+        {
+            temp_file_t temp;
+            FILE* handle = std::fopen(temp.path.data(), "w");
+            REQUIRE(handle);
+            std::fputs("this is not an allo file, but it is long enough to "
+                       "have a header",
+                       handle);
+            std::fclose(handle);
+            auto res = mapped_file_allocator_t::make({
+                .path = temp.path.data(),
+                .initial_size = 4096,
+                .max_size = max_size,
+            });
+            REQUIRE(!res.okay());
+            REQUIRE(res.err() == AllocationStatusCode::Corruption);
+        }
+
+        SUBCASE("upcast to abstract allocator")
+        {
+            temp_file_t temp;
+            const mapped_file_allocator_t::options_t options = {
+                .path = temp.path.data(),
+                .initial_size = 4096,
+                .max_size = max_size,
+            };
+            auto file = mapped_file_allocator_t::make(options).release();
+            abstract_allocator_t& ally = file;
+            REQUIRE(alloc_one<int>(ally).okay());
+            REQUIRE(ally.register_destruction_callback([](void*) {}, nullptr)
+                        .err() == AllocationStatusCode::InvalidArgument);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("allocations persist after reopening")
+        {
+            temp_file_t temp;
+            const mapped_file_allocator_t::options_t options = {
+                .path = temp.path.data(),
+                .initial_size = 4096,
+                .max_size = max_size,
+            };
+            size_t used = 0;
+            {
+                auto file = mapped_file_allocator_t::make(options).release();
+                // build a linked list which is big enough to grow the file
+                node_t* previous = nullptr;
+                for (int i = 0; i < 10000; ++i) {
+                    node_t& node = construct_one<node_t>(file).release();
+                    node.value = i;
+                    if (previous) {
+                        previous->next = &node;
+                    } else {
+                        file.set_root(node);
+                    }
+                    previous = &node;
+                }
+                REQUIRE(file.file_size() > options.initial_size);
+                REQUIRE(file.sync().okay());
+                used = file.bytes_used();
+            }
+            {
+                auto file = mapped_file_allocator_t::make(options).release();
+                REQUIRE(!file.is_fresh());
+                REQUIRE(file.bytes_used() == used);
+                auto root = file.root<node_t>();
+                REQUIRE(root.has_value());
+                node_t* iter = &root.value();
+                int expected = 0;
+                while (iter) {
+                    REQUIRE(iter->value == expected);
+                    ++expected;
+                    iter = iter->next.get();
+                }
+                REQUIRE(expected == 10000);
+                // allocation resumes after what was already there
+                int& after = alloc_one<int>(file).release();
+                REQUIRE(reinterpret_cast<uint8_t*>(&after) >=
+                        reinterpret_cast<uint8_t*>(&root.value()) + used -
+                            sizeof(mapped_file_allocator_t::file_header_t));
+            }
+        }
+
+        SUBCASE("cannot grow past max size")
+        {
+            temp_file_t temp;
+            const size_t pagesize = mm_get_page_size().value;
+            const mapped_file_allocator_t::options_t options = {
+                .path = temp.path.data(),
+                .initial_size = pagesize,
+                .max_size = pagesize * 2,
+            };
+            auto file = mapped_file_allocator_t::make(options).release();
+            auto res = alloc<uint8_t>(file, pagesize * 3);
+            REQUIRE(!res.okay());
+            REQUIRE(res.err() == AllocationStatusCode::OOM);
+            REQUIRE(alloc<uint8_t>(file, pagesize + 100).okay());
+            REQUIRE(file.file_size() == pagesize * 2);
+            // big enough that the end of the allocation would wrap around
+            REQUIRE(file.alloc_bytes(SIZE_MAX - 10, 0, 0).err() ==
+                    AllocationStatusCode::OOM);
+        }
+
+        SUBCASE("heap allocator nested inside file")
+        {
+            temp_file_t temp;
+            const mapped_file_allocator_t::options_t options = {
+                .path = temp.path.data(),
+                .initial_size = 4096,
+                .max_size = max_size,
+            };
+            auto file = mapped_file_allocator_t::make(options).release();
+            auto heap = heap_allocator_t::make(
+                alloc<uint8_t>(file, 2000).release(), file);
+            for (size_t i = 0; i < 100; ++i) {
+                auto mem = alloc<uint8_t>(heap, 500);
+                REQUIRE(mem.okay());
+            }
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include "allo/c_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/structures/mpmc_queue.h"
+#include "allo/structures/uninitialized_array.h"
+#include "testing_types.h"
+// test header should be last
+#include "test_header.h"
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<mpmc_queue_t<int>>,
+              "mpmc queue of ints is default constructible");
+
+TEST_SUITE("mpmc_queue_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("capacity is rounded up to a power of two")
+        {
+            c_allocator_t c;
+            auto queue = mpmc_queue_t<int>::make_owning(c, 100).release();
+            REQUIRE(queue.capacity() == 128);
+            auto tiny = mpmc_queue_t<int>::make_owning(c, 1).release();
+            REQUIRE(tiny.capacity() == 2);
+        }
+
+        SUBCASE("make with a scratch allocator")
+        {
+            uninitialized_array_t<uint8_t, 1024> mem;
+            auto scratch = scratch_allocator_t::make(mem);
+            auto queue = mpmc_queue_t<int>::make(scratch, 16).release();
+            REQUIRE(queue.try_push(1).okay());
+            REQUIRE(queue.try_pop().value() == 1);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto maybe_queue = mpmc_queue_t<int>::make_owning(c, 4);
+            REQUIRE(maybe_queue.okay());
+            mpmc_queue_t<int> queue(std::move(maybe_queue.release_ref()));
+            REQUIRE(queue.try_push(1).okay());
+            mpmc_queue_t<int> moved(std::move(queue));
+            REQUIRE(moved.try_pop().value() == 1);
+            REQUIRE(!moved.try_pop().has_value());
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("push until full, then pop in order")
+        {
+            c_allocator_t c;
+            auto queue = mpmc_queue_t<int>::make_owning(c, 4).release();
+            for (int lap = 0; lap < 3; ++lap) {
+                for (int i = 0; i < 4; ++i)
+                    REQUIRE(queue.try_push(i).okay());
+                REQUIRE(queue.try_push(4).err() ==
+                        mpmc_queue_t<int>::StatusCode::Full);
+                for (int i = 0; i < 4; ++i)
+                    REQUIRE(queue.try_pop().value() == i);
+                REQUIRE(!queue.try_pop().has_value());
+            }
+        }
+
+        SUBCASE("batches wrap around the ring")
+        {
+            c_allocator_t c;
+            auto queue = mpmc_queue_t<int>::make_owning(c, 8).release();
+            std::array<int, 6> in = {1, 2, 3, 4, 5, 6};
+            std::array<int, 6> out = {};
+            for (int round = 0; round < 10; ++round) {
+                REQUIRE(queue.try_push_batch(zl::slice<int>(in)) == 6);
+                REQUIRE(queue.try_push_batch(zl::slice<int>(in)) == 2);
+                REQUIRE(queue.try_pop_batch(zl::slice<int>(out)) == 6);
+                REQUIRE(out == in);
+                REQUIRE(queue.try_pop_batch(zl::slice<int>(out)) == 2);
+                REQUIRE(out[0] == 1);
+                REQUIRE(out[1] == 2);
+                REQUIRE(queue.try_pop_batch(zl::slice<int>(out)) == 0);
+            }
+        }
+
+        SUBCASE("items left in the queue are destroyed")
+        {
+            c_allocator_t c;
+            {
+                auto queue =
+                    mpmc_queue_t<counted_t>::make_owning(c, 8).release();
+                for (int i = 0; i < 5; ++i)
+                    REQUIRE(queue.try_push(i).okay());
+                REQUIRE(queue.try_pop().value().value == 0);
+                REQUIRE(counted_t::alive == 4);
+            }
+            REQUIRE(counted_t::alive == 0);
+        }
+
+        SUBCASE("many producers and consumers")
+        {
+            c_allocator_t c;
+            auto queue = mpmc_queue_t<uint64_t>::make_owning(c, 64).release();
+            constexpr size_t threads = 3;
+            constexpr uint64_t per_producer = 20000;
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> popped{0};
+
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&queue, t]() {
+                    std::array<uint64_t, 8> batch;
+                    uint64_t next = 0;
+                    while (next < per_producer) {
+                        size_t filled = 0;
+                        for (; filled < batch.size() &&
+                               next + filled < per_producer;
+                             ++filled)
+                            batch[filled] = (next + filled) * threads + t;
+                        next += queue.try_push_batch(
+                            zl::slice<uint64_t>(batch, 0, filled));
+                    }
+                });
+                workers.emplace_back([&queue, &sum, &popped]() {
+                    std::array<uint64_t, 8> batch;
+                    while (popped.load() < threads * per_producer) {
+                        size_t count = 0;
+                        if (auto one = queue.try_pop(); one.has_value()) {
+                            batch[0] = one.value();
+                            count = 1;
+                        } else {
+                            count = queue.try_pop_batch(
+                                zl::slice<uint64_t>(batch));
+                        }
+                        for (size_t i = 0; i < count; ++i)
+                            sum.fetch_add(batch[i]);
+                        popped.fetch_add(count);
+                    }
+                });
+            }
+            for (auto& worker : workers)
+                worker.join();
+
+            // every value from 0 to n - 1 was pushed exactly once
+            const uint64_t n = threads * per_producer;
+            REQUIRE(popped.load() == n);
+            REQUIRE(sum.load() == (n * (n - 1)) / 2);
+            REQUIRE(!queue.try_pop().has_value());
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/structures/priority_queue.h"
+// test header should be last
+#include "test_header.h"
+#include <queue>
+#include <random>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<priority_queue_t<int>>,
+              "priority queue of ints is default constructible");
+static_assert(!std::is_copy_constructible_v<priority_queue_t<int>>,
+              "priority queue of ints is copy constructible");
+
+namespace {
+struct timer_entry_t
+{
+    uint64_t deadline;
+    int id;
+};
+
+struct later_deadline_t
+{
+    bool operator()(const timer_entry_t& a,
+                    const timer_entry_t& b) const noexcept
+    {
+        return a.deadline > b.deadline;
+    }
+};
+
+template <size_t arity> void compare_with_std(uint32_t seed)
+{
+    c_allocator_t c;
+    auto queue = priority_queue_t<int, std::less<int>, arity>::make_owning(c, 0)
+                     .release();
+    std::priority_queue<int> expected;
+    std::mt19937 rng(seed);
+    for (int i = 0; i < 5000; ++i) {
+        if (rng() % 3 == 0) {
+            auto popped = queue.try_pop();
+            REQUIRE(popped.has_value() == !expected.empty());
+            if (!expected.empty()) {
+                REQUIRE(popped.value() == expected.top());
+                expected.pop();
+            }
+        } else {
+            const int value = static_cast<int>(rng() % 1000);
+            REQUIRE(queue.try_push(value).okay());
+            expected.push(value);
+        }
+        REQUIRE(queue.size() == expected.size());
+        if (!expected.empty())
+            REQUIRE(queue.top().value() == expected.top());
+    }
+    while (!expected.empty()) {
+        REQUIRE(queue.try_pop().value() == expected.top());
+        expected.pop();
+    }
+    REQUIRE(!queue.try_pop().has_value());
+}
+} // namespace
+
+TEST_SUITE("priority_queue_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning with c allocator")
+        {
+            c_allocator_t c;
+            auto maybe_queue = priority_queue_t<int>::make_owning(c, 100);
+            REQUIRE(maybe_queue.okay());
+            REQUIRE(maybe_queue.release_ref().size() == 0);
+            REQUIRE(!maybe_queue.release_ref().top().has_value());
+        }
+
+        SUBCASE("make owning with heap allocator")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 10000).release(), c);
+            auto maybe_queue = priority_queue_t<int>::make_owning(heap, 0);
+            REQUIRE(maybe_queue.okay());
+            auto& queue = maybe_queue.release_ref();
+            for (int i = 0; i < 100; ++i)
+                REQUIRE(queue.try_push(i).okay());
+            REQUIRE(queue.top().value() == 99);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto queue = priority_queue_t<int>::make_owning(c, 4).release();
+            REQUIRE(queue.try_push(3).okay());
+            priority_queue_t<int> moved(std::move(queue));
+            REQUIRE(queue.size() == 0);
+            REQUIRE(moved.size() == 1);
+            REQUIRE(moved.top().value() == 3);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("pops in descending order")
+        {
+            c_allocator_t c;
+            auto queue = priority_queue_t<int>::make_owning(c, 1).release();
+            for (int value : {4, 8, 1, 9, 3, 3, 7, 0})
+                REQUIRE(queue.try_push(value).okay());
+            REQUIRE(queue.items().size() == 8);
+            for (int expected : {9, 8, 7, 4, 3, 3, 1, 0})
+                REQUIRE(queue.try_pop().value() == expected);
+            REQUIRE(!queue.try_pop().has_value());
+            REQUIRE(!queue.top().has_value());
+        }
+
+        SUBCASE("matches std::priority_queue for several arities")
+        {
+            compare_with_std<2>(1);
+            compare_with_std<3>(2);
+            compare_with_std<4>(3);
+            compare_with_std<8>(4);
+        }
+
+        SUBCASE("timer queue with custom comparison")
+        {
+            c_allocator_t c;
+            using timer_queue_t =
+                priority_queue_t<timer_entry_t, later_deadline_t>;
+            auto timers = timer_queue_t::make_owning(c, 16).release();
+            REQUIRE(timers.try_push(timer_entry_t{300, 0}).okay());
+            REQUIRE(timers.try_push(timer_entry_t{100, 1}).okay());
+            REQUIRE(timers.try_push(timer_entry_t{200, 2}).okay());
+            REQUIRE(timers.top().value().id == 1);
+            REQUIRE(timers.try_pop().value().deadline == 100);
+            REQUIRE(timers.try_pop().value().deadline == 200);
+            REQUIRE(timers.try_pop().value().deadline == 300);
+        }
+
+        SUBCASE("clear")
+        {
+            c_allocator_t c;
+            auto queue = priority_queue_t<int>::make_owning(c, 1).release();
+            for (int i = 0; i < 20; ++i)
+                REQUIRE(queue.try_push(i).okay());
+            queue.clear();
+            REQUIRE(queue.size() == 0);
+            REQUIRE(queue.try_push(5).okay());
+            REQUIRE(queue.top().value() == 5);
+        }
+    }
+}
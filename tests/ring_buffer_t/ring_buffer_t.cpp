@@ -0,0 +1,111 @@
+#include "allo/ring_buffer.h"
+#include "test_header.h"
+#include <cstring>
+#include <thread>
+
+using namespace allo;
+
+TEST_SUITE("ring_buffer_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("capacity is rounded up to pages")
+        {
+            const size_t pagesize = mm_get_page_size().value;
+            auto ring = ring_buffer_t::make(pagesize + 1).release();
+            REQUIRE(ring.capacity() == pagesize * 2);
+            REQUIRE(ring.size() == 0);
+            REQUIRE(ring.write_span().size() == ring.capacity());
+            REQUIRE(ring.read_span().size() == 0);
+        }
+
+        SUBCASE("move construction")
+        {
+            auto maybe_ring = ring_buffer_t::make(1);
+            REQUIRE(maybe_ring.okay());
+            ring_buffer_t ring(std::move(maybe_ring.release_ref()));
+            ring.write_span().data()[0] = 'a';
+            ring.commit_write(1);
+            REQUIRE(ring.size() == 1);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("memory is mapped twice")
+        {
+            auto ring = ring_buffer_t::make(1).release();
+            bytes_t span = ring.write_span();
+            span.data()[0] = 42;
+            REQUIRE(span.data()[ring.capacity()] == 42);
+            span.data()[ring.capacity() + 1] = 10;
+            REQUIRE(span.data()[1] == 10);
+        }
+
+        SUBCASE("spans are contiguous across the wrap")
+        {
+            auto ring = ring_buffer_t::make(1).release();
+            const size_t capacity = ring.capacity();
+            // move both cursors near the end of the buffer
+            ring.commit_write(capacity - 3);
+            ring.commit_read(capacity - 3);
+            REQUIRE(ring.size() == 0);
+
+            const char message[] = "wraps around the end";
+            bytes_t span = ring.write_span();
+            REQUIRE(span.size() == capacity);
+            std::memcpy(span.data(), message, sizeof(message));
+            ring.commit_write(sizeof(message));
+
+            bytes_t readable = ring.read_span();
+            REQUIRE(readable.size() == sizeof(message));
+            REQUIRE(std::memcmp(readable.data(), message, sizeof(message)) ==
+                    0);
+            ring.commit_read(readable.size());
+            REQUIRE(ring.size() == 0);
+            REQUIRE(ring.read_span().data() == ring.write_span().data());
+        }
+
+        SUBCASE("full buffer has no write span")
+        {
+            auto ring = ring_buffer_t::make(1).release();
+            ring.commit_write(ring.capacity());
+            REQUIRE(ring.write_span().size() == 0);
+            REQUIRE(ring.read_span().size() == ring.capacity());
+            ring.commit_read(10);
+            REQUIRE(ring.write_span().size() == 10);
+        }
+
+        SUBCASE("producer and consumer threads")
+        {
+            auto ring = ring_buffer_t::make(1).release();
+            constexpr size_t total = 1UL << 22;
+            std::thread producer([&ring]() {
+                size_t written = 0;
+                while (written < total) {
+                    bytes_t span = ring.write_span();
+                    size_t amount = span.size() < total - written
+                                        ? span.size()
+                                        : total - written;
+                    for (size_t i = 0; i < amount; ++i) {
+                        span.data()[i] = static_cast<uint8_t>(written + i);
+                    }
+                    ring.commit_write(amount);
+                    written += amount;
+                }
+            });
+            size_t read = 0;
+            bool okay = true;
+            while (read < total) {
+                bytes_t span = ring.read_span();
+                for (size_t i = 0; i < span.size(); ++i) {
+                    okay &= span.data()[i] == static_cast<uint8_t>(read + i);
+                }
+                ring.commit_read(span.size());
+                read += span.size();
+            }
+            producer.join();
+            REQUIRE(okay);
+        }
+    }
+}
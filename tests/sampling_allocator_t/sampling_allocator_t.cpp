@@ -0,0 +1,312 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/heap_profiler.h"
+#include "allo/reservation_allocator.h"
+#include "allo/sampling_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "allo/typed_reallocation.h"
+#include "test_header.h"
+#include <array>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace allo;
+
+struct temp_file_t
+{
+    std::array<char, 64> path{};
+    temp_file_t()
+    {
+        // NOLINTNEXTLINE
+        std::snprintf(path.data(), path.size(), "/tmp/allo_profile_XXXXXX");
+        int fd = mkstemp(path.data());
+        REQUIRE(fd >= 0);
+        close(fd);
+    }
+    ~temp_file_t() { unlink(path.data()); }
+};
+
+static std::string read_file(const char* path)
+{
+    std::string contents;
+    std::FILE* file = std::fopen(path, "r");
+    REQUIRE(file);
+    char buffer[4096];
+    size_t read = 0;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), file)))
+        contents.append(buffer, read);
+    std::fclose(file);
+    return contents;
+}
+
+struct sampled_thing_t
+{
+    uint64_t values[8];
+};
+
+TEST_SUITE("sampling_allocator_t")
+{
+    TEST_CASE("invalid options")
+    {
+        REQUIRE(heap_profiler_t::make({.sample_interval = 0}).err() ==
+                AllocationStatusCode::InvalidArgument);
+        REQUIRE(heap_profiler_t::make({.max_live_samples = 0}).err() ==
+                AllocationStatusCode::InvalidArgument);
+    }
+
+    TEST_CASE("every allocation is sampled with an interval of one byte")
+    {
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1}).release();
+        c_allocator_t global_allocator;
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(global_allocator, profiler);
+
+        std::vector<zl::slice<uint8_t>> allocations;
+        for (size_t i = 0; i < 100; ++i)
+            allocations.push_back(
+                allo::alloc<uint8_t>(sampling, 16 + i).release());
+        REQUIRE(profiler.total_samples() == 100);
+        REQUIRE(profiler.live_samples() == 100);
+        REQUIRE(profiler.dropped_samples() == 0);
+
+        size_t seen = 0;
+        profiler.for_each_live_sample([&](const heap_sample_t& sample) {
+            ++seen;
+            REQUIRE(sample.size >= 16);
+            REQUIRE(sample.size < 116);
+            REQUIRE(sample.typehash == 0);
+            REQUIRE(sample.depth > 0);
+        });
+        REQUIRE(seen == 100);
+
+        for (size_t i = 0; i < 50; ++i)
+            allo::free(sampling, allocations[i]);
+        REQUIRE(profiler.live_samples() == 50);
+        for (size_t i = 50; i < 100; ++i)
+            allo::free(sampling, allocations[i]);
+        REQUIRE(profiler.live_samples() == 0);
+        REQUIRE(profiler.estimated_live_bytes() == 0);
+        REQUIRE(profiler.total_samples() == 100);
+    }
+
+    TEST_CASE("typehash and alignment are recorded")
+    {
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1}).release();
+        c_allocator_t global_allocator;
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(global_allocator, profiler);
+
+        sampled_thing_t& thing =
+            allo::alloc_one<sampled_thing_t>(sampling).release();
+        size_t typehash = 0;
+        profiler.for_each_live_sample([&](const heap_sample_t& sample) {
+            REQUIRE(sample.address == reinterpret_cast<uintptr_t>(&thing));
+            REQUIRE(sample.size == sizeof(sampled_thing_t));
+            REQUIRE(sample.alignment_exponent ==
+                    detail::alignment_exponent(alignof(sampled_thing_t)));
+            typehash = sample.typehash;
+        });
+        REQUIRE(typehash != 0);
+        allo::free_one(sampling, thing);
+        REQUIRE(profiler.live_samples() == 0);
+    }
+
+    TEST_CASE("realloc moves the sample")
+    {
+        auto reservation = reservation_allocator_t::make(
+                               {.committed = 1,
+                                .additional_pages_reserved = 100})
+                               .release();
+        auto heap = heap_allocator_t::make_owning(reservation.current_memory(),
+                                                  reservation);
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1}).release();
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(heap, profiler);
+
+        auto mem = allo::alloc<uint32_t>(sampling, 16).release();
+        auto bigger = allo::realloc(sampling, mem, 500).release();
+        REQUIRE(profiler.live_samples() == 1);
+        profiler.for_each_live_sample([&](const heap_sample_t& sample) {
+            REQUIRE(sample.address ==
+                    reinterpret_cast<uintptr_t>(bigger.data()));
+            REQUIRE(sample.size == 2000);
+        });
+        allo::free(sampling, bigger);
+        REQUIRE(profiler.live_samples() == 0);
+    }
+
+    TEST_CASE("a failed remap keeps the sample")
+    {
+        c_allocator_t global_allocator;
+        auto heap = heap_allocator_t::make_owning(
+            allo::alloc<uint8_t>(global_allocator, 4000).release(),
+            global_allocator);
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1}).release();
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(heap, profiler);
+
+        auto mem = sampling.alloc_bytes(64, 3, 0).release();
+        REQUIRE(!sampling.remap_bytes(mem, 0, 100000, 0).okay());
+        REQUIRE(profiler.live_samples() == 1);
+        REQUIRE(profiler.total_samples() == 1);
+        profiler.for_each_live_sample([&](const heap_sample_t& sample) {
+            REQUIRE(sample.address == reinterpret_cast<uintptr_t>(mem.data()));
+            REQUIRE(sample.size == 64);
+            REQUIRE(sample.alignment_exponent == 3);
+        });
+        REQUIRE(sampling.free_bytes(mem, 0).okay());
+        REQUIRE(profiler.live_samples() == 0);
+    }
+
+    TEST_CASE("a failed free keeps the sample")
+    {
+        c_allocator_t global_allocator;
+        auto heap = heap_allocator_t::make_owning(
+            allo::alloc<uint8_t>(global_allocator, 4000).release(),
+            global_allocator);
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1}).release();
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(heap, profiler);
+
+        auto mem = sampling.alloc_bytes(64, 3, 1234).release();
+        REQUIRE(sampling.free_bytes(mem, 4321).err() ==
+                AllocationStatusCode::InvalidType);
+        REQUIRE(profiler.live_samples() == 1);
+        profiler.for_each_live_sample([&](const heap_sample_t& sample) {
+            REQUIRE(sample.address == reinterpret_cast<uintptr_t>(mem.data()));
+            REQUIRE(sample.typehash == 1234);
+        });
+        REQUIRE(sampling.free_bytes(mem, 1234).okay());
+        REQUIRE(profiler.live_samples() == 0);
+    }
+
+    TEST_CASE("samples past the limit are dropped")
+    {
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1, .max_live_samples = 8})
+                .release();
+        c_allocator_t global_allocator;
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(global_allocator, profiler);
+
+        std::vector<zl::slice<uint8_t>> allocations;
+        for (size_t i = 0; i < 20; ++i)
+            allocations.push_back(allo::alloc<uint8_t>(sampling, 32).release());
+        REQUIRE(profiler.live_samples() == 8);
+        REQUIRE(profiler.dropped_samples() == 12);
+        REQUIRE(profiler.total_samples() == 20);
+        for (auto& allocation : allocations)
+            allo::free(sampling, allocation);
+        REQUIRE(profiler.live_samples() == 0);
+    }
+
+    TEST_CASE("estimated live bytes are close to the real amount")
+    {
+        constexpr size_t allocation_size = 256;
+        constexpr size_t count = 20000;
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 8192}).release();
+        c_allocator_t global_allocator;
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(global_allocator, profiler);
+
+        std::vector<zl::slice<uint8_t>> allocations;
+        allocations.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            allocations.push_back(
+                allo::alloc<uint8_t>(sampling, allocation_size).release());
+
+        // about 600 samples, so within a third is very generous
+        const double real = allocation_size * count;
+        const auto estimate =
+            static_cast<double>(profiler.estimated_live_bytes());
+        REQUIRE(profiler.live_samples() > 0);
+        REQUIRE(profiler.live_samples() < count);
+        REQUIRE(estimate > real * 0.66);
+        REQUIRE(estimate < real * 1.33);
+
+        for (auto& allocation : allocations)
+            allo::free(sampling, allocation);
+        REQUIRE(profiler.live_samples() == 0);
+    }
+
+    TEST_CASE("write_profile")
+    {
+        temp_file_t file;
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1}).release();
+        c_allocator_t global_allocator;
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(global_allocator, profiler);
+
+        auto first = allo::alloc<uint8_t>(sampling, 100).release();
+        auto second = allo::alloc<uint8_t>(sampling, 200).release();
+        REQUIRE(profiler.write_profile(file.path.data()).okay());
+        const std::string contents = read_file(file.path.data());
+        REQUIRE(contents.rfind("heap profile: 2: 300 [2: 300] @ heap_v2/1\n",
+                               0) == 0);
+        REQUIRE(contents.find("\n1: 100 [1: 100] @ 0x") != std::string::npos);
+        REQUIRE(contents.find("\n1: 200 [1: 200] @ 0x") != std::string::npos);
+#if defined(__linux__)
+        REQUIRE(contents.find("\nMAPPED_LIBRARIES:\n") != std::string::npos);
+#endif
+        allo::free(sampling, first);
+        allo::free(sampling, second);
+
+        REQUIRE(profiler.write_profile("/nonexistent/directory/heap.prof")
+                    .err() == AllocationStatusCode::OsErr);
+    }
+
+    TEST_CASE("threads share a profiler")
+    {
+        constexpr size_t per_thread = 2000;
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1024}).release();
+        c_allocator_t global_allocator;
+
+        auto work = [&profiler, &global_allocator]() {
+            sampling_allocator_t sampling =
+                sampling_allocator_t::make(global_allocator, profiler);
+            std::vector<zl::slice<uint8_t>> allocations;
+            for (size_t i = 0; i < per_thread; ++i)
+                allocations.push_back(
+                    allo::alloc<uint8_t>(sampling, 64).release());
+            for (auto& allocation : allocations)
+                allo::free(sampling, allocation);
+        };
+        std::thread first(work);
+        std::thread second(work);
+        first.join();
+        second.join();
+
+        REQUIRE(profiler.total_samples() > 0);
+        REQUIRE(profiler.live_samples() == 0);
+    }
+
+    TEST_CASE("moving")
+    {
+        heap_profiler_t profiler =
+            heap_profiler_t::make({.sample_interval = 1}).release();
+        // the state stays where it is, only the handle moves
+        heap_profiler_t moved_profiler(std::move(profiler));
+        c_allocator_t global_allocator;
+        sampling_allocator_t sampling =
+            sampling_allocator_t::make(global_allocator, moved_profiler);
+        auto mem = allo::alloc<uint8_t>(sampling, 8).release();
+
+        sampling_allocator_t moved(std::move(sampling));
+        REQUIRE(moved.type() == detail::AllocatorType::SamplingAllocator);
+        REQUIRE(moved_profiler.live_samples() == 1);
+        allo::free(moved, mem);
+        REQUIRE(moved_profiler.live_samples() == 0);
+    }
+}
@@ -3,11 +3,21 @@
 #include "allo/structures/segmented_stack.h"
 // test header should be last
 #include "test_header.h"
+#include <vector>
 
 template <typename T> using stack = allo::segmented_stack_t<T>;
 static_assert(!std::is_default_constructible_v<stack<int>>,
               "Segmented stack of ints is default constructible");
 
+namespace {
+std::vector<int> contents(stack<int>& st)
+{
+    std::vector<int> out;
+    st.for_each([&out](int& item) { out.push_back(item); });
+    return out;
+}
+} // namespace
+
 TEST_SUITE("segmented_stack_t")
 {
     TEST_CASE("Construction and type behavior")
@@ -183,5 +193,72 @@ TEST_SUITE("segmented_stack_t")
                 st.pop();
             }
         }
+
+        SUBCASE("remove_if")
+        {
+            allo::c_allocator_t c;
+            auto heap = allo::heap_allocator_t::make(
+                allo::alloc<uint8_t>(c, 20000).release());
+            auto st = stack<int>::make_owning(heap, 1).release();
+            // enough items to span several segments
+            constexpr int count = 500;
+            std::vector<int> expected;
+            for (int i = 0; i < count; ++i) {
+                REQUIRE(st.try_push(i).okay());
+                expected.push_back(i);
+            }
+
+            SUBCASE("removing none")
+            {
+                REQUIRE(st.remove_if([](int&) { return false; }) == 0);
+                REQUIRE(st.size() == count);
+                REQUIRE(contents(st) == expected);
+            }
+
+            SUBCASE("removing all")
+            {
+                REQUIRE(st.remove_if([](int&) { return true; }) == count);
+                REQUIRE(st.size() == 0);
+                REQUIRE(!st.end().has_value());
+                REQUIRE(st.try_push(7).okay());
+                REQUIRE(st.size() == 1);
+                REQUIRE(st.end_unchecked() == 7);
+            }
+
+            SUBCASE("removing across segment boundaries keeps the order")
+            {
+                auto remove = [](int& item) {
+                    return item % 3 == 0 || (item > 100 && item < 300);
+                };
+                std::vector<int> remaining;
+                for (int item : expected) {
+                    if (!remove(item))
+                        remaining.push_back(item);
+                }
+                REQUIRE(st.remove_if(remove) == count - remaining.size());
+                REQUIRE(st.size() == remaining.size());
+                REQUIRE(contents(st) == remaining);
+
+                // pushing and popping still work at the new end
+                REQUIRE(st.end_unchecked() == remaining.back());
+                REQUIRE(st.try_push(-1).okay());
+                REQUIRE(st.end_unchecked() == -1);
+                st.pop();
+                for (auto iter = remaining.rbegin(); iter != remaining.rend();
+                     ++iter) {
+                    REQUIRE(st.end_unchecked() == *iter);
+                    st.pop();
+                }
+                REQUIRE(st.size() == 0);
+            }
+
+            SUBCASE("removing a prefix")
+            {
+                REQUIRE(st.remove_if([](int& item) { return item < 250; }) ==
+                        250);
+                expected.erase(expected.begin(), expected.begin() + 250);
+                REQUIRE(contents(st) == expected);
+            }
+        }
     }
 }
@@ -0,0 +1,251 @@
+#include "allo.h"
+#include "allo/shared_block_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "test_header.h"
+#include <array>
+#include <cstring>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace allo;
+
+static_assert(detail::is_threadsafe<shared_block_allocator_t>);
+
+TEST_SUITE("shared_block_allocator_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make anonymous")
+        {
+            const shared_block_allocator_t::options_t options = {
+                .blocksize = 64,
+                .num_blocks = 100,
+            };
+            auto shared = shared_block_allocator_t::make(options).release();
+            REQUIRE(shared.blocksize() == 64);
+            REQUIRE(shared.blocks_free() == 100);
+        }
+
+        SUBCASE("attach to anonymous shared memory")
+        {
+            const shared_block_allocator_t::options_t options = {
+                .blocksize = 64,
+                .num_blocks = 100,
+            };
+            auto first = shared_block_allocator_t::make(options).release();
+            auto second =
+                shared_block_allocator_t::attach(first.file()).release();
+            REQUIRE(second.blocks_free() == 100);
+            int& item = alloc_one<int>(first).release();
+            item = 42;
+            REQUIRE(first.blocks_free() == 99);
+            REQUIRE(second.blocks_free() == 99);
+            REQUIRE(second.resolve<int>(first.offset_of(&item)) == 42);
+        }
+
+        SUBCASE("attach to named shared memory")
+        {
+            std::array<char, 64> name{};
+            // NOLINTNEXTLINE
+            std::snprintf(name.data(), name.size(), "/allo_test_%d",
+                          static_cast<int>(getpid()));
+            const shared_block_allocator_t::options_t options = {
+                .name = name.data(),
+                .blocksize = 32,
+                .num_blocks = 10,
+            };
+            auto first = shared_block_allocator_t::make(options).release();
+            auto second = shared_block_allocator_t::attach(name.data());
+            REQUIRE(mm_unlink_shared_memory(name.data()) == 0);
+            REQUIRE(second.okay());
+            REQUIRE(second.release_ref().blocksize() == 32);
+        }
+
+        SUBCASE("make refuses a name which is already taken")
+        {
+            std::array<char, 64> name{};
+            // NOLINTNEXTLINE
+            std::snprintf(name.data(), name.size(), "/allo_test_taken_%d",
+                          static_cast<int>(getpid()));
+            const shared_block_allocator_t::options_t options = {
+                .name = name.data(),
+                .blocksize = 32,
+                .num_blocks = 10,
+            };
+            auto first = shared_block_allocator_t::make(options).release();
+            int& item = alloc_one<int>(first).release();
+            item = 42;
+            auto second = shared_block_allocator_t::make(options);
+            REQUIRE(mm_unlink_shared_memory(name.data()) == 0);
+            REQUIRE(!second.okay());
+            REQUIRE(second.err() == AllocationStatusCode::InvalidArgument);
+            REQUIRE(first.blocks_free() == 9);
+            REQUIRE(item == 42);
+            int& other = alloc_one<int>(first).release();
+            REQUIRE(&other != &item);
+            REQUIRE(first.blocks_free() == 8);
+        }
+
+        SUBCASE("refuses to attach to other shared memory")
+        {
+            const auto file = mm_create_anonymous_shared_memory("not_allo");
+            REQUIRE(file.code == 0);
+            REQUIRE(mm_resize_file(file.file, 4096) == 0);
+            auto res = shared_block_allocator_t::attach(file.file);
+            REQUIRE(!res.okay());
+            REQUIRE(res.err() == AllocationStatusCode::Corruption);
+            mm_close_file(file.file);
+        }
+
+        SUBCASE("upcast to abstract threadsafe heap")
+        {
+            const shared_block_allocator_t::options_t options = {
+                .blocksize = 64,
+                .num_blocks = 10,
+            };
+            auto shared = shared_block_allocator_t::make(options).release();
+            abstract_threadsafe_heap_allocator_t& ally = shared;
+            REQUIRE(detail::is_threadsafe_runtime(ally));
+            int& item = alloc_one<int>(ally).release();
+            REQUIRE(free_one(ally, item).okay());
+            REQUIRE(ally.register_destruction_callback([](void*) {}, nullptr)
+                        .err() == AllocationStatusCode::InvalidArgument);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("allocate every block then free them")
+        {
+            const shared_block_allocator_t::options_t options = {
+                .blocksize = 48,
+                .num_blocks = 50,
+            };
+            auto shared = shared_block_allocator_t::make(options).release();
+            std::vector<bytes_t> allocations;
+            while (true) {
+                auto res = shared.alloc_bytes(48, 3, 0);
+                if (!res.okay()) {
+                    REQUIRE(res.err() == AllocationStatusCode::OOM);
+                    break;
+                }
+                std::memset(res.release_ref().data(), 0xFF, 48);
+                allocations.push_back(res.release());
+            }
+            REQUIRE(allocations.size() == 50);
+            REQUIRE(shared.blocks_free() == 0);
+            for (bytes_t mem : allocations) {
+                REQUIRE(shared.free_bytes(mem, 0).okay());
+            }
+            REQUIRE(shared.blocks_free() == 50);
+            REQUIRE(shared.alloc_bytes(48, 3, 0).okay());
+        }
+
+        SUBCASE("invalid frees and oversized allocations")
+        {
+            const shared_block_allocator_t::options_t options = {
+                .blocksize = 64,
+                .num_blocks = 10,
+            };
+            auto shared = shared_block_allocator_t::make(options).release();
+            bytes_t mem = shared.alloc_bytes(64, 0, 0).release();
+            REQUIRE(shared.free_status(zl::raw_slice(*(mem.data() + 1), 8), 0)
+                        .err() == AllocationStatusCode::MemoryInvalid);
+            REQUIRE(shared.remap_bytes(mem, 0, 65, 0).err() ==
+                    AllocationStatusCode::OOM);
+            REQUIRE(shared.remap_bytes(mem, 0, 10, 0).okay());
+            REQUIRE(shared.alloc_bytes(8, 7, 0).err() ==
+                    AllocationStatusCode::AllocationTooAligned);
+        }
+
+        SUBCASE("many threads allocating and freeing")
+        {
+            constexpr size_t num_threads = 8;
+            const shared_block_allocator_t::options_t options = {
+                .blocksize = 64,
+                .num_blocks = num_threads * 16,
+            };
+            auto shared = shared_block_allocator_t::make(options).release();
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < num_threads; ++t) {
+                threads.emplace_back([&shared, t]() {
+                    std::array<size_t*, 16> mine{};
+                    for (size_t round = 0; round < 2000; ++round) {
+                        for (auto& item : mine) {
+                            item = &alloc_one<size_t>(shared).release();
+                            *item = t;
+                        }
+                        for (auto* item : mine) {
+                            // nobody else should have been given our block
+                            if (*item != t)
+                                std::abort();
+                            free_one(shared, *item);
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            REQUIRE(shared.blocks_free() == options.num_blocks);
+        }
+
+        SUBCASE("exchange allocations with another process")
+        {
+            const shared_block_allocator_t::options_t options = {
+                .blocksize = 256,
+                .num_blocks = 32,
+            };
+            auto shared = shared_block_allocator_t::make(options).release();
+            // allocated by the parent, freed by the child
+            int& for_child = alloc_one<int>(shared).release();
+            const uint64_t for_child_offset = shared.offset_of(&for_child);
+
+            std::array<int, 2> pipe_ends{};
+            REQUIRE(pipe(pipe_ends.data()) == 0);
+
+            const pid_t pid = fork();
+            REQUIRE(pid >= 0);
+            if (pid == 0) {
+                close(pipe_ends[0]);
+                auto maybe_child =
+                    shared_block_allocator_t::attach(shared.file());
+                if (!maybe_child.okay())
+                    _exit(1);
+                auto& child = maybe_child.release_ref();
+                bytes_t message = child.alloc_bytes(256, 0, 0).release();
+                std::snprintf(reinterpret_cast<char*>(message.data()),
+                              message.size(), "hello from the child");
+                const uint64_t offset = child.offset_of(message.data());
+                if (!free_one(child, child.resolve<int>(for_child_offset))
+                         .okay())
+                    _exit(1);
+                if (write(pipe_ends[1], &offset, sizeof(offset)) !=
+                    sizeof(offset))
+                    _exit(1);
+                _exit(0);
+            }
+
+            close(pipe_ends[1]);
+            uint64_t offset = 0;
+            REQUIRE(read(pipe_ends[0], &offset, sizeof(offset)) ==
+                    sizeof(offset));
+            close(pipe_ends[0]);
+            int status = 0;
+            REQUIRE(waitpid(pid, &status, 0) == pid);
+            REQUIRE(WIFEXITED(status));
+            REQUIRE(WEXITSTATUS(status) == 0);
+
+            bytes_t message = shared.resolve(offset, 256);
+            REQUIRE(std::strcmp(reinterpret_cast<char*>(message.data()),
+                                "hello from the child") == 0);
+            // one still allocated by the child, one freed by the child
+            REQUIRE(shared.blocks_free() == 31);
+            REQUIRE(shared.free_bytes(message, 0).okay());
+            REQUIRE(shared.blocks_free() == 32);
+        }
+    }
+}
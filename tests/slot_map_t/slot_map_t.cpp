@@ -0,0 +1,182 @@
+#include "allo/block_allocator.h"
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/structures/slot_map.h"
+#include "testing_types.h"
+// test header should be last
+#include "test_header.h"
+#include <vector>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<slot_map_t<int>>,
+              "slot map of ints is default constructible");
+static_assert(sizeof(slot_map_t<int>::handle_t) == 8,
+              "slot map handles are not 32+32 bits");
+
+TEST_SUITE("slot_map_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning with c allocator")
+        {
+            c_allocator_t c;
+            auto maybe_map = slot_map_t<int>::make_owning(c, 100);
+            REQUIRE(maybe_map.okay());
+            REQUIRE(maybe_map.release_ref().capacity() == 100);
+            REQUIRE(maybe_map.release_ref().size() == 0);
+        }
+
+        SUBCASE("make with a buffer")
+        {
+            alignas(slot_map_t<int>::alignment) uint8_t buffer[200];
+            auto map = slot_map_t<int>::make(
+                           zl::raw_slice(buffer[0], sizeof(buffer)))
+                           .release();
+            REQUIRE(map.capacity() == 200 / 16);
+
+            alignas(slot_map_t<int>::alignment) uint8_t tiny[8];
+            REQUIRE(slot_map_t<int>::make(zl::raw_slice(tiny[0], sizeof(tiny)))
+                        .err() == AllocationStatusCode::InvalidArgument);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto map = slot_map_t<int>::make_owning(c, 4).release();
+            const auto handle = map.try_insert(5).release();
+            slot_map_t<int> moved(std::move(map));
+            REQUIRE(map.size() == 0);
+            REQUIRE(!map.contains(handle));
+            REQUIRE(moved.try_get(handle).value() == 5);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("insert, get, and remove")
+        {
+            c_allocator_t c;
+            auto map = slot_map_t<int>::make_owning(c, 4).release();
+            const auto a = map.try_insert(1).release();
+            const auto b = map.try_insert(2).release();
+            REQUIRE(a != b);
+            REQUIRE(map.try_get(a).value() == 1);
+            REQUIRE(map.try_get(b).value() == 2);
+
+            map.try_get(b).value() = 20;
+            const auto& const_map = map;
+            REQUIRE(const_map.try_get(b).value() == 20);
+
+            REQUIRE(map.try_remove(a).okay());
+            REQUIRE(map.try_remove(a).err() ==
+                    slot_map_t<int>::StatusCode::NotFound);
+            REQUIRE(!map.contains(a));
+            REQUIRE(map.try_get(b).value() == 20);
+            REQUIRE(map.size() == 1);
+
+            // a zeroed handle is never valid
+            REQUIRE(!map.contains(slot_map_t<int>::handle_t{}));
+        }
+
+        SUBCASE("stale handles do not see reused slots")
+        {
+            c_allocator_t c;
+            auto map = slot_map_t<int>::make_owning(c, 4).release();
+            const auto old_handle = map.try_insert(1).release();
+            REQUIRE(map.try_remove(old_handle).okay());
+            const auto new_handle = map.try_insert(2).release();
+            // same slot, different generation
+            REQUIRE(new_handle.index == old_handle.index);
+            REQUIRE(new_handle.generation != old_handle.generation);
+            REQUIRE(!map.try_get(old_handle).has_value());
+            REQUIRE(map.try_get(new_handle).value() == 2);
+            REQUIRE(map.capacity() == 4);
+        }
+
+        SUBCASE("items stay dense and handles follow them")
+        {
+            c_allocator_t c;
+            auto map = slot_map_t<int>::make_owning(c, 1).release();
+            std::vector<slot_map_t<int>::handle_t> handles;
+            for (int i = 0; i < 100; ++i)
+                handles.push_back(map.try_insert(i).release());
+            for (int i = 0; i < 100; i += 2)
+                REQUIRE(map.try_remove(handles[i]).okay());
+
+            REQUIRE(map.items().size() == 50);
+            int sum = 0;
+            for (size_t i = 0; i < map.items().size(); ++i) {
+                const int item = map.items().data()[i];
+                REQUIRE(item % 2 == 1);
+                sum += item;
+                // the handle at each position leads back to the same item
+                REQUIRE(&map.try_get(map.handle_at_unchecked(i)).value() ==
+                        map.items().data() + i);
+            }
+            REQUIRE(sum == 50 * 50);
+            for (int i = 1; i < 100; i += 2)
+                REQUIRE(map.try_get(handles[i]).value() == i);
+        }
+
+        SUBCASE("grow inside a heap")
+        {
+            c_allocator_t c;
+            auto mem = alloc<uint8_t>(c, 100000).release();
+            auto heap = heap_allocator_t::make_owning(mem, c);
+            auto map = slot_map_t<int>::make_owning(heap, 2).release();
+            std::vector<slot_map_t<int>::handle_t> handles;
+            for (int i = 0; i < 1000; ++i)
+                handles.push_back(map.try_insert(i).release());
+            REQUIRE(map.capacity() >= 1000);
+            for (int i = 0; i < 1000; ++i)
+                REQUIRE(map.try_get(handles[i]).value() == i);
+        }
+
+        SUBCASE("grow inside a block allocator")
+        {
+            c_allocator_t c;
+            auto blocks = block_allocator_t::make_owning(
+                alloc<uint8_t>(c, 8192).release(), c, 1024);
+            auto map = slot_map_t<int>::make_owning(blocks, 16).release();
+            // 64 items of 16 bytes each fill one block exactly
+            for (int i = 0; i < 64; ++i)
+                REQUIRE(map.try_insert(i).okay());
+            REQUIRE(map.capacity() == 64);
+            REQUIRE(map.items().size() == 64);
+        }
+
+        SUBCASE("a fixed buffer runs out of memory")
+        {
+            alignas(slot_map_t<int>::alignment) uint8_t buffer[64];
+            auto map = slot_map_t<int>::make(
+                           zl::raw_slice(buffer[0], sizeof(buffer)))
+                           .release();
+            for (size_t i = 0; i < map.capacity(); ++i)
+                REQUIRE(map.try_insert(0).okay());
+            REQUIRE(map.try_insert(0).err() ==
+                    slot_map_t<int>::StatusCode::OOM);
+        }
+
+        SUBCASE("items are destroyed, and clear invalidates handles")
+        {
+            c_allocator_t c;
+            {
+                auto map = slot_map_t<counted_t>::make_owning(c, 2).release();
+                const auto first = map.try_insert(0).release();
+                for (int i = 1; i < 50; ++i)
+                    REQUIRE(map.try_insert(i).okay());
+                REQUIRE(counted_t::alive == 50);
+                REQUIRE(map.try_remove(first).okay());
+                REQUIRE(counted_t::alive == 49);
+
+                const auto second = map.try_insert(100).release();
+                map.clear();
+                REQUIRE(counted_t::alive == 0);
+                REQUIRE(!map.contains(second));
+                REQUIRE(map.try_insert(1).okay());
+                REQUIRE(map.try_insert(2).okay());
+            }
+            REQUIRE(counted_t::alive == 0);
+        }
+    }
+}
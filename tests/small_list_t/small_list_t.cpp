@@ -0,0 +1,141 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/structures/small_list.h"
+#include "testing_types.h"
+// test header should be last
+#include "test_header.h"
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<small_list_t<int, 4>>,
+              "small list of ints is default constructible");
+static_assert(sizeof(small_list_t<uint64_t, 8>) >= 8 * sizeof(uint64_t),
+              "small list does not store its items inline");
+
+TEST_SUITE("small_list_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("making does not allocate")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make(
+                allo::alloc<uint8_t>(c, 4000).release());
+            {
+                auto list = small_list_t<int, 4>::make_owning(heap).release();
+                REQUIRE(list.is_inline());
+                REQUIRE(list.capacity() == 4);
+#ifdef ALLO_ENABLE_STATS
+                REQUIRE(heap.stats().allocs == 0);
+#endif
+            }
+            {
+                auto list =
+                    small_list_t<int, 4>::make_owning(heap, 10).release();
+                REQUIRE(!list.is_inline());
+                REQUIRE(list.capacity() == 10);
+#ifdef ALLO_ENABLE_STATS
+                REQUIRE(heap.stats().allocs == 1);
+#endif
+            }
+#ifdef ALLO_ENABLE_STATS
+            REQUIRE(heap.stats().frees == 1);
+#endif
+        }
+
+        SUBCASE("move construction, inline and allocated")
+        {
+            c_allocator_t c;
+            auto list = small_list_t<int, 2>::make_owning(c).release();
+            REQUIRE(list.try_append(1).okay());
+            small_list_t<int, 2> moved(std::move(list));
+            REQUIRE(list.items().size() == 0);
+            REQUIRE(moved.items().size() == 1);
+            REQUIRE(moved.get_at_unchecked(0) == 1);
+
+            REQUIRE(moved.try_append(2).okay());
+            REQUIRE(moved.try_append(3).okay());
+            REQUIRE(!moved.is_inline());
+            small_list_t<int, 2> moved_again(std::move(moved));
+            REQUIRE(moved.is_inline());
+            REQUIRE(moved_again.items().size() == 3);
+            REQUIRE(moved_again.get_at_unchecked(2) == 3);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("fixed size list runs out of room")
+        {
+            auto list = small_list_t<int, 3>::make();
+            for (int i = 0; i < 3; ++i)
+                REQUIRE(list.try_append(i).okay());
+            REQUIRE(list.try_append(3).err() ==
+                    small_list_t<int, 3>::StatusCode::OOM);
+            REQUIRE(list.try_insert_at(0, 3).err() ==
+                    small_list_t<int, 3>::StatusCode::OOM);
+            REQUIRE(list.try_remove_at(1).okay());
+            REQUIRE(list.try_insert_at(0, 10).okay());
+            REQUIRE(list.get_at_unchecked(0) == 10);
+            REQUIRE(list.get_at_unchecked(1) == 0);
+            REQUIRE(list.get_at_unchecked(2) == 2);
+        }
+
+        SUBCASE("spill and keep growing")
+        {
+            c_allocator_t c;
+            auto list = small_list_t<int, 4>::make_owning(c).release();
+            for (int i = 0; i < 4; ++i)
+                REQUIRE(list.try_append(i).okay());
+            REQUIRE(list.is_inline());
+            for (int i = 4; i < 100; ++i)
+                REQUIRE(list.try_append(i).okay());
+            REQUIRE(!list.is_inline());
+            REQUIRE(list.capacity() >= 100);
+            for (int i = 0; i < 100; ++i)
+                REQUIRE(list.try_get_at(i).value() == i);
+        }
+
+        SUBCASE("insert and remove in the middle")
+        {
+            c_allocator_t c;
+            auto list = small_list_t<int, 4>::make_owning(c).release();
+            REQUIRE(list.try_append(1).okay());
+            REQUIRE(list.try_append(3).okay());
+            REQUIRE(list.try_insert_at(1, 2).okay());
+            REQUIRE(list.try_insert_at(0, 0).okay());
+            // spills while inserting
+            REQUIRE(list.try_insert_at(4, 4).okay());
+            REQUIRE(!list.is_inline());
+            for (int i = 0; i < 5; ++i)
+                REQUIRE(list.get_at_unchecked(i) == i);
+            REQUIRE(list.try_remove_at(0).okay());
+            REQUIRE(list.items().size() == 4);
+            REQUIRE(list.get_at_unchecked(0) == 1);
+            REQUIRE(list.get_at_unchecked(3) == 4);
+        }
+
+        SUBCASE("items are destroyed")
+        {
+            c_allocator_t c;
+            {
+                auto list =
+                    small_list_t<counted_t, 4>::make_owning(c).release();
+                for (int i = 0; i < 6; ++i)
+                    REQUIRE(list.try_append(i).okay());
+                REQUIRE(counted_t::alive == 6);
+                REQUIRE(list.try_remove_at(2).okay());
+                REQUIRE(counted_t::alive == 5);
+                REQUIRE(list.try_insert_at(0, 100).okay());
+                REQUIRE(counted_t::alive == 6);
+            }
+            REQUIRE(counted_t::alive == 0);
+            {
+                auto list = small_list_t<counted_t, 4>::make();
+                REQUIRE(list.try_append(1).okay());
+                auto moved(std::move(list));
+                REQUIRE(counted_t::alive == 1);
+            }
+            REQUIRE(counted_t::alive == 0);
+        }
+    }
+}
@@ -0,0 +1,210 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/structures/soa_collection.h"
+// test header should be last
+#include "test_header.h"
+#include <vector>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<soa_collection_t<int, float>>,
+              "soa collection is default constructible");
+static_assert(!std::is_copy_constructible_v<soa_collection_t<int, float>>,
+              "soa collection is copy constructible");
+static_assert(std::is_same_v<soa_collection_t<int, char, double>::field_t<1>,
+                             char>,
+              "wrong type for column");
+
+namespace {
+template <size_t column, typename Collection>
+bool column_is_aligned(Collection& collection)
+{
+    return reinterpret_cast<uintptr_t>(
+               collection.template items<column>().data()) %
+               Collection::simd_alignment ==
+           0;
+}
+} // namespace
+
+TEST_SUITE("soa_collection_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning")
+        {
+            c_allocator_t c;
+            // malloc does not promise simd_alignment, the heap does
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto maybe_soa =
+                soa_collection_t<int, char, double>::make_owning(heap, 100);
+            REQUIRE(maybe_soa.okay());
+            auto& soa = maybe_soa.release_ref();
+            REQUIRE(soa.size() == 0);
+            REQUIRE(soa.capacity() == 100);
+            REQUIRE(soa.items<0>().size() == 0);
+        }
+
+        SUBCASE("make owning with zero items")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto soa =
+                soa_collection_t<int, float>::make_owning(heap, 0).release();
+            REQUIRE(soa.capacity() == 1);
+        }
+
+        SUBCASE("make with fixed buffer")
+        {
+            alignas(32) uint8_t buffer[512];
+            auto maybe_soa = soa_collection_t<int, char>::make(
+                zl::raw_slice(buffer[0], sizeof(buffer)));
+            REQUIRE(maybe_soa.okay());
+            auto& soa = maybe_soa.release_ref();
+            REQUIRE(soa.capacity() > 0);
+            REQUIRE(soa_collection_t<int, char>::bytes_needed(
+                        soa.capacity()) <= sizeof(buffer));
+            while (soa.size() < soa.capacity())
+                REQUIRE(soa.try_put(1, 'a').okay());
+            REQUIRE(soa.try_put(1, 'a').err() == AllocationStatusCode::OOM);
+        }
+
+        SUBCASE("make with misaligned buffer")
+        {
+            alignas(32) uint8_t buffer[512];
+            auto maybe_soa = soa_collection_t<int, char>::make(
+                zl::raw_slice(buffer[1], sizeof(buffer) - 1));
+            REQUIRE(!maybe_soa.okay());
+            REQUIRE(maybe_soa.err() == AllocationStatusCode::InvalidArgument);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto soa =
+                soa_collection_t<int, float>::make_owning(heap, 4).release();
+            REQUIRE(soa.try_put(1, 1.5f).okay());
+            soa_collection_t<int, float> moved(std::move(soa));
+            REQUIRE(soa.size() == 0);
+            REQUIRE(moved.size() == 1);
+            REQUIRE(moved.items<1>().data()[0] == 1.5f);
+        }
+
+        SUBCASE("bytes needed pads every column")
+        {
+            using soa = soa_collection_t<char, double>;
+            // one char padded to 32, then one double padded to 32
+            REQUIRE(soa::bytes_needed(1) == 64);
+            REQUIRE(soa::bytes_needed(32) == 32 + 256);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("put and read columns")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto soa = soa_collection_t<int, char, double>::make_owning(heap, 4)
+                           .release();
+            for (int i = 0; i < 100; ++i) {
+                REQUIRE(soa.try_put(i, char('a' + (i % 26)), i * 0.5).okay());
+                REQUIRE(column_is_aligned<0>(soa));
+                REQUIRE(column_is_aligned<1>(soa));
+                REQUIRE(column_is_aligned<2>(soa));
+            }
+            REQUIRE(soa.size() == 100);
+            REQUIRE(soa.capacity() >= 100);
+
+            // growing must keep every column's items in place
+            auto ints = soa.items<0>();
+            auto chars = soa.items<1>();
+            auto doubles = soa.items<2>();
+            REQUIRE(ints.size() == 100);
+            for (int i = 0; i < 100; ++i) {
+                REQUIRE(ints.data()[i] == i);
+                REQUIRE(chars.data()[i] == char('a' + (i % 26)));
+                REQUIRE(doubles.data()[i] == i * 0.5);
+            }
+        }
+
+        SUBCASE("columns can be written through")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto soa =
+                soa_collection_t<float, float>::make_owning(heap, 8).release();
+            for (int i = 0; i < 8; ++i)
+                REQUIRE(soa.try_put(float(i), 0.0f).okay());
+            for (float& x : soa.items<1>())
+                x = 2.0f;
+            const auto& const_soa = soa;
+            for (const float& x : const_soa.items<1>())
+                REQUIRE(x == 2.0f);
+        }
+
+        SUBCASE("remove swaps the last item in")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto soa = soa_collection_t<int, long>::make_owning(heap, 4).release();
+            for (int i = 0; i < 5; ++i)
+                REQUIRE(soa.try_put(i, long(i) * 10).okay());
+
+            REQUIRE(soa.try_remove_at(1).okay());
+            REQUIRE(soa.size() == 4);
+            REQUIRE(soa.items<0>().data()[1] == 4);
+            REQUIRE(soa.items<1>().data()[1] == 40);
+
+            // removing the last item
+            REQUIRE(soa.try_remove_at(3).okay());
+            REQUIRE(soa.size() == 3);
+            REQUIRE(soa.items<0>().data()[0] == 0);
+            REQUIRE(soa.items<0>().data()[1] == 4);
+            REQUIRE(soa.items<0>().data()[2] == 2);
+
+            REQUIRE(soa.try_remove_at(3).err() ==
+                    soa_collection_t<int, long>::StatusCode::OutOfRange);
+            REQUIRE(soa.size() == 3);
+        }
+
+        SUBCASE("matches a vector of structs")
+        {
+            struct row_t
+            {
+                int id;
+                float weight;
+                uint8_t flags;
+            };
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 100000).release(), c);
+            auto soa =
+                soa_collection_t<int, float, uint8_t>::make_owning(heap, 1)
+                    .release();
+            std::vector<row_t> expected;
+            for (int i = 0; i < 2000; ++i) {
+                const row_t row{i, float(i) * 0.25f, uint8_t(i)};
+                REQUIRE(soa.try_put(row.id, row.weight, row.flags).okay());
+                expected.push_back(row);
+                if (i % 5 == 0) {
+                    const size_t index = (size_t(i) * 7) % expected.size();
+                    REQUIRE(soa.try_remove_at(index).okay());
+                    expected[index] = expected.back();
+                    expected.pop_back();
+                }
+            }
+            REQUIRE(soa.size() == expected.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                REQUIRE(soa.items<0>().data()[i] == expected[i].id);
+                REQUIRE(soa.items<1>().data()[i] == expected[i].weight);
+                REQUIRE(soa.items<2>().data()[i] == expected[i].flags);
+            }
+        }
+    }
+}
@@ -0,0 +1,160 @@
+#include "allo/c_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/structures/spsc_queue.h"
+#include "allo/structures/uninitialized_array.h"
+#include "testing_types.h"
+// test header should be last
+#include "test_header.h"
+#include <array>
+#include <thread>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<spsc_queue_t<int>>,
+              "spsc queue of ints is default constructible");
+
+TEST_SUITE("spsc_queue_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("capacity is rounded up to a power of two")
+        {
+            c_allocator_t c;
+            auto queue = spsc_queue_t<int>::make_owning(c, 100).release();
+            REQUIRE(queue.capacity() == 128);
+            REQUIRE(queue.size() == 0);
+        }
+
+        SUBCASE("make with a scratch allocator")
+        {
+            uninitialized_array_t<uint8_t, 1024> mem;
+            auto scratch = scratch_allocator_t::make(mem);
+            auto queue = spsc_queue_t<int>::make(scratch, 16).release();
+            REQUIRE(queue.try_push(1).okay());
+            REQUIRE(queue.try_pop().value() == 1);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto maybe_queue = spsc_queue_t<int>::make_owning(c, 4);
+            REQUIRE(maybe_queue.okay());
+            spsc_queue_t<int> queue(std::move(maybe_queue.release_ref()));
+            REQUIRE(queue.try_push(1).okay());
+            spsc_queue_t<int> moved(std::move(queue));
+            REQUIRE(moved.size() == 1);
+            REQUIRE(moved.try_pop().value() == 1);
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("push until full, then pop in order")
+        {
+            c_allocator_t c;
+            auto queue = spsc_queue_t<int>::make_owning(c, 4).release();
+            for (int i = 0; i < 4; ++i)
+                REQUIRE(queue.try_push(i).okay());
+            REQUIRE(queue.try_push(4).err() ==
+                    spsc_queue_t<int>::StatusCode::Full);
+            for (int i = 0; i < 4; ++i)
+                REQUIRE(queue.try_pop().value() == i);
+            REQUIRE(!queue.try_pop().has_value());
+        }
+
+        SUBCASE("batches wrap around the ring")
+        {
+            c_allocator_t c;
+            auto queue = spsc_queue_t<int>::make_owning(c, 8).release();
+            std::array<int, 6> in = {1, 2, 3, 4, 5, 6};
+            std::array<int, 6> out = {};
+            for (int round = 0; round < 10; ++round) {
+                REQUIRE(queue.try_push_batch(zl::slice<int>(in)) == 6);
+                // only two more fit
+                REQUIRE(queue.try_push_batch(zl::slice<int>(in)) == 2);
+                REQUIRE(queue.try_pop_batch(zl::slice<int>(out)) == 6);
+                REQUIRE(out == in);
+                REQUIRE(queue.try_pop_batch(zl::slice<int>(out)) == 2);
+                REQUIRE(out[0] == 1);
+                REQUIRE(out[1] == 2);
+                REQUIRE(queue.try_pop_batch(zl::slice<int>(out)) == 0);
+            }
+        }
+
+        SUBCASE("batches see items pushed since the last refresh")
+        {
+            c_allocator_t c;
+            auto queue = spsc_queue_t<int>::make_owning(c, 8).release();
+            std::array<int, 4> in = {1, 2, 3, 4};
+            std::array<int, 4> out = {};
+            REQUIRE(queue.try_push_batch(zl::slice<int>(in, 0, 2)) == 2);
+            REQUIRE(queue.try_pop_batch(zl::slice<int>(out, 0, 1)) == 1);
+            REQUIRE(queue.try_push_batch(zl::slice<int>(in, 2, 4)) == 2);
+            // the consumer's copy of the tail only knows about one item
+            REQUIRE(queue.try_pop_batch(zl::slice<int>(out)) == 3);
+            REQUIRE(out[0] == 2);
+            REQUIRE(out[1] == 3);
+            REQUIRE(out[2] == 4);
+
+            // and the same for the producer's copy of the head
+            std::array<int, 8> many = {};
+            REQUIRE(queue.try_push_batch(zl::slice<int>(many)) == 8);
+            REQUIRE(queue.try_pop_batch(zl::slice<int>(out)) == 4);
+            REQUIRE(queue.try_push_batch(zl::slice<int>(in, 0, 1)) == 1);
+            REQUIRE(queue.try_pop_batch(zl::slice<int>(out, 0, 1)) == 1);
+            REQUIRE(queue.try_push_batch(zl::slice<int>(in)) == 4);
+        }
+
+        SUBCASE("items left in the queue are destroyed")
+        {
+            c_allocator_t c;
+            {
+                auto queue =
+                    spsc_queue_t<counted_t>::make_owning(c, 8).release();
+                for (int i = 0; i < 5; ++i)
+                    REQUIRE(queue.try_push(i).okay());
+                REQUIRE(queue.try_pop().value().value == 0);
+                REQUIRE(counted_t::alive == 4);
+            }
+            REQUIRE(counted_t::alive == 0);
+        }
+
+        SUBCASE("producer and consumer threads")
+        {
+            c_allocator_t c;
+            auto queue = spsc_queue_t<uint64_t>::make_owning(c, 64).release();
+            constexpr uint64_t count = 100000;
+            std::thread producer([&queue]() {
+                std::array<uint64_t, 16> batch;
+                uint64_t next = 0;
+                while (next < count) {
+                    if (next % 3 == 0) {
+                        if (queue.try_push(next).okay())
+                            ++next;
+                        continue;
+                    }
+                    size_t filled = 0;
+                    for (; filled < batch.size() && next + filled < count;
+                         ++filled)
+                        batch[filled] = next + filled;
+                    next += queue.try_push_batch(
+                        zl::slice<uint64_t>(batch, 0, filled));
+                }
+            });
+
+            uint64_t expected = 0;
+            std::array<uint64_t, 16> batch;
+            bool in_order = true;
+            while (expected < count) {
+                const size_t popped =
+                    queue.try_pop_batch(zl::slice<uint64_t>(batch));
+                for (size_t i = 0; i < popped; ++i) {
+                    in_order = in_order && batch[i] == expected;
+                    ++expected;
+                }
+            }
+            producer.join();
+            REQUIRE(in_order);
+            REQUIRE(queue.size() == 0);
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #define ALLO_ALLOW_DESTRUCTORS // we allocate a std::set and std::vector
                                // TODO: make this not necessary
+#include "allo/heap_allocator.h"
 #include "allo/make_into.h"
 #include "allo/stack_allocator.h"
 #include "allo/typed_allocation.h"
@@ -208,6 +209,28 @@ TEST_SUITE("stack_allocator_t")
             REQUIRE(allo::destroy_one(ally, set).okay());
         }
 
+        SUBCASE("emptied blocks are kept as a spare until trimmed")
+        {
+            std::array<uint8_t, 100000> parent_mem;
+            heap_allocator_t parent = heap_allocator_t::make(parent_mem);
+            auto stack = stack_allocator_t::make_owning(
+                alloc<uint8_t>(parent, 200).release(), parent);
+            REQUIRE(stack.trim() == 0);
+
+            auto small = alloc<uint8_t>(stack, 10).release();
+            auto big = alloc<uint8_t>(stack, 1000).release();
+            REQUIRE(allo::free(stack, big).okay());
+            // allocating across the end of the block again reuses the spare
+            auto big_again = alloc<uint8_t>(stack, 1000).release();
+            REQUIRE(big_again.data() == big.data());
+            REQUIRE(allo::free(stack, big_again).okay());
+
+            REQUIRE(stack.trim() > 0);
+            REQUIRE(stack.trim() == 0);
+            REQUIRE(alloc<uint8_t>(stack, 1000).okay());
+            REQUIRE(small.data() != nullptr);
+        }
+
         SUBCASE("register destruction callback")
         {
             std::array<uint8_t, 512> mem;
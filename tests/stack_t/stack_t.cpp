@@ -67,6 +67,30 @@ TEST_SUITE("stack_t")
 
             consumer(std::move(st));
         }
+
+        SUBCASE("move construction and move assignment")
+        {
+            allo::c_allocator_t c;
+            allo::uninitialized_array_t<int, 4> buffer;
+            {
+                auto first = stack<int>::make_owning(c, 4).release();
+                REQUIRE(first.try_push(1).okay());
+                REQUIRE(first.try_push(2).okay());
+                stack<int> moved(std::move(first));
+                REQUIRE(moved.items().size() == 2);
+
+                auto second = stack<int>::make_owning(c, 8).release();
+                REQUIRE(second.try_push(3).okay());
+                second = std::move(moved);
+                REQUIRE(second.items().size() == 2);
+                REQUIRE(second.end().value() == 2);
+
+                // the owning stack is replaced by one which owns nothing
+                second = stack<int>::make(buffer);
+                REQUIRE(second.items().size() == 0);
+                REQUIRE(second.try_push(4).okay());
+            }
+        }
     }
 
     TEST_CASE("functionality")
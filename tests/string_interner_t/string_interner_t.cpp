@@ -0,0 +1,168 @@
+#include "allo/c_allocator.h"
+#include "allo/ctti/detail/hash.h"
+#include "allo/heap_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/structures/string_interner.h"
+// test header should be last
+#include "test_header.h"
+#include <string>
+#include <vector>
+
+using namespace allo;
+static_assert(!std::is_default_constructible_v<string_interner_t>,
+              "string interner is default constructible");
+static_assert(!std::is_copy_constructible_v<string_interner_t>,
+              "string interner is copy constructible");
+static_assert(string_interner_t::hash("identifier") ==
+                  ctti::detail::fnv1a_hash("identifier"),
+              "interner hash does not match the ctti hash");
+
+TEST_SUITE("string_interner_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        SUBCASE("make owning")
+        {
+            c_allocator_t c;
+            auto maybe_interner = string_interner_t::make_owning(c, 16, 256);
+            REQUIRE(maybe_interner.okay());
+            REQUIRE(maybe_interner.release_ref().size() == 0);
+        }
+
+        SUBCASE("make owning with zero sizes")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            auto interner =
+                string_interner_t::make_owning(heap, 0, 0).release();
+            REQUIRE(interner.try_intern("a").okay());
+            REQUIRE(interner.try_intern("bc").okay());
+            REQUIRE(interner.size() == 2);
+        }
+
+        SUBCASE("move construction")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            auto interner =
+                string_interner_t::make_owning(heap, 4, 64).release();
+            const auto id = interner.try_intern("moved").release();
+            string_interner_t moved(std::move(interner));
+            REQUIRE(interner.size() == 0);
+            REQUIRE(!interner.find("moved").has_value());
+            REQUIRE(moved.find("moved").value() == id);
+            REQUIRE(moved.view_unchecked(id) == "moved");
+        }
+
+        SUBCASE("heap parent is freed back to")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            {
+                auto interner =
+                    string_interner_t::make_owning(heap, 2, 16).release();
+                for (int i = 0; i < 500; ++i) {
+                    REQUIRE(
+                        interner.try_intern(std::to_string(i * 7)).okay());
+                }
+            }
+#ifdef ALLO_ENABLE_STATS
+            REQUIRE(heap.stats().allocs == heap.stats().frees);
+#endif
+        }
+    }
+
+    TEST_CASE("functionality")
+    {
+        SUBCASE("same string gives same id")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            auto interner =
+                string_interner_t::make_owning(heap, 4, 64).release();
+            const auto hello = interner.try_intern("hello").release();
+            const auto world = interner.try_intern("world").release();
+            REQUIRE(hello != world);
+            REQUIRE(interner.try_intern("hello").release() == hello);
+            REQUIRE(interner.try_intern(std::string("wor") + "ld").release() ==
+                    world);
+            REQUIRE(interner.size() == 2);
+            REQUIRE(interner.view_unchecked(hello) == "hello");
+            REQUIRE(interner.try_view(world).value() == "world");
+            REQUIRE(!interner.try_view(2).has_value());
+        }
+
+        SUBCASE("empty string and prefixes are distinct")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            auto interner =
+                string_interner_t::make_owning(heap, 4, 64).release();
+            const auto empty = interner.try_intern("").release();
+            const auto a = interner.try_intern("a").release();
+            const auto aa = interner.try_intern("aa").release();
+            REQUIRE(empty != a);
+            REQUIRE(a != aa);
+            REQUIRE(interner.view_unchecked(empty).empty());
+            REQUIRE(interner.try_intern("").release() == empty);
+        }
+
+        SUBCASE("find does not insert")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            auto interner =
+                string_interner_t::make_owning(heap, 4, 64).release();
+            REQUIRE(!interner.find("missing").has_value());
+            REQUIRE(interner.size() == 0);
+            const auto id = interner.try_intern("present").release();
+            REQUIRE(interner.find("present").value() == id);
+        }
+
+        SUBCASE("precomputed hashes")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            auto interner =
+                string_interner_t::make_owning(heap, 4, 64).release();
+            constexpr auto keyword_hash = ctti::detail::fnv1a_hash("return");
+            const auto id =
+                interner.try_intern("return", keyword_hash).release();
+            REQUIRE(interner.try_intern("return").release() == id);
+            REQUIRE(interner.find("return", keyword_hash).value() == id);
+        }
+
+        SUBCASE("views are stable and null terminated")
+        {
+            c_allocator_t c;
+            auto heap = heap_allocator_t::make_owning(
+                alloc<uint8_t>(c, 200000).release(), c);
+            auto interner =
+                string_interner_t::make_owning(heap, 2, 32).release();
+            std::vector<std::string> strings;
+            std::vector<const char*> pointers;
+            for (int i = 0; i < 2000; ++i) {
+                strings.push_back("identifier_" + std::to_string(i));
+                const auto id = interner.try_intern(strings.back()).release();
+                REQUIRE(id == i);
+                pointers.push_back(interner.view_unchecked(id).data());
+            }
+            REQUIRE(interner.size() == 2000);
+            for (int i = 0; i < 2000; ++i) {
+                const auto id = interner.try_intern(strings[i]).release();
+                REQUIRE(id == i);
+                REQUIRE(interner.view_unchecked(id).data() == pointers[i]);
+                REQUIRE(interner.view_unchecked(id) == strings[i]);
+                REQUIRE(std::string(pointers[i]) == strings[i]);
+            }
+            REQUIRE(interner.size() == 2000);
+        }
+    }
+}
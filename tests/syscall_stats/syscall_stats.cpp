@@ -0,0 +1,180 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/mapped_file_allocator.h"
+#include "allo/memory_map.h"
+#include "allo/reservation_allocator.h"
+#include "allo/stack_allocator.h"
+#include "allo/syscall_stats.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "test_header.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace allo;
+
+#if !defined(ALLO_ENABLE_STATS) || !defined(ALLO_ENABLE_PAGE_FAULT_STATS)
+#error syscall_stats tests must be compiled with ALLO_ENABLE_STATS and \
+    ALLO_ENABLE_PAGE_FAULT_STATS
+#endif
+
+TEST_SUITE("syscall stats")
+{
+    TEST_CASE("memory_map functions are counted")
+    {
+        const mm_syscall_counts_t before = mm_get_syscall_counts();
+        const auto pagesize = mm_get_page_size();
+        REQUIRE(pagesize.has_value);
+
+        const auto reserved = mm_reserve_pages(nullptr, 2);
+        REQUIRE(reserved.code == 0);
+        REQUIRE(mm_commit_pages(reserved.data, 1) == 0);
+        REQUIRE(mm_memory_unmap(reserved.data, reserved.bytes) == 0);
+
+        const mm_syscall_counts_t after = mm_get_syscall_counts();
+        REQUIRE(after.reserve_pages == before.reserve_pages + 1);
+        REQUIRE(after.commit_pages == before.commit_pages + 1);
+        REQUIRE(after.memory_unmap == before.memory_unmap + 1);
+        REQUIRE(after.map_file == before.map_file);
+
+        const syscall_stats_t stats = syscall_stats();
+        REQUIRE(stats.reserve_pages == after.reserve_pages);
+        REQUIRE(stats.memory_map_calls() >= 3);
+    }
+
+    TEST_CASE("file functions are counted")
+    {
+        std::array<char, 64> path{};
+        // NOLINTNEXTLINE
+        std::snprintf(path.data(), path.size(), "/tmp/allo_syscalls_XXXXXX");
+        const int fd = mkstemp(path.data());
+        REQUIRE(fd >= 0);
+        close(fd);
+
+        const size_t pagesize = mm_get_page_size().value;
+        const mapped_file_allocator_t::options_t options = {
+            .path = path.data(),
+            .initial_size = pagesize,
+            .max_size = pagesize * 16,
+        };
+        const syscall_stats_t before = syscall_stats();
+        {
+            auto file = mapped_file_allocator_t::make(options).release();
+            const syscall_stats_t made = syscall_stats();
+            REQUIRE(made.open_file == before.open_file + 1);
+            REQUIRE(made.file_size > before.file_size);
+            REQUIRE(made.resize_file > before.resize_file);
+
+            // does not fit, so the file is resized and mapped again
+            REQUIRE(alloc<uint8_t>(file, pagesize * 2).okay());
+            const syscall_stats_t grown = syscall_stats();
+            REQUIRE(grown.resize_file == made.resize_file + 1);
+            REQUIRE(grown.map_file == made.map_file + 1);
+            REQUIRE(grown.memory_map_calls() == made.memory_map_calls() + 1);
+
+            REQUIRE(file.sync().okay());
+            REQUIRE(syscall_stats().sync == grown.sync + 1);
+        }
+        const syscall_stats_t after = syscall_stats();
+        REQUIRE(after.close_file == before.close_file + 1);
+        REQUIRE(after.file_calls() > before.file_calls());
+        unlink(path.data());
+    }
+
+    TEST_CASE("c_allocator_t calls into the C library are counted")
+    {
+        c_allocator_t global_allocator;
+        const syscall_stats_t before = syscall_stats();
+
+        auto mem = alloc<uint8_t>(global_allocator, 40).release();
+        auto bigger =
+            global_allocator.threadsafe_realloc_bytes(mem, 0, 80, 0).release();
+        REQUIRE(global_allocator.free_bytes(bigger, 0).okay());
+
+        const syscall_stats_t after = syscall_stats();
+        REQUIRE(after.malloc_calls == before.malloc_calls + 1);
+        REQUIRE(after.realloc_calls == before.realloc_calls + 1);
+        REQUIRE(after.free_calls == before.free_calls + 1);
+        REQUIRE(after.memory_map_calls() == before.memory_map_calls());
+    }
+
+    TEST_CASE("a warmed up stack never calls into the kernel or C library")
+    {
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 4096).release();
+        stack_allocator_t stack =
+            stack_allocator_t::make_owning(mem, global_allocator);
+
+        const syscall_stats_t before = syscall_stats();
+        for (size_t i = 0; i < 100; ++i) {
+            auto& one = alloc_one<uint64_t>(stack).release();
+            auto many = alloc<uint64_t>(stack, 32).release();
+            REQUIRE(allo::free(stack, many).okay());
+            REQUIRE(free_one(stack, one).okay());
+        }
+        const syscall_stats_t after = syscall_stats();
+        REQUIRE(after.memory_map_calls() == before.memory_map_calls());
+        REQUIRE(after.malloc_calls == before.malloc_calls);
+        REQUIRE(after.realloc_calls == before.realloc_calls);
+        REQUIRE(after.free_calls == before.free_calls);
+        REQUIRE(stack.stats().minor_page_faults == 0);
+        REQUIRE(stack.stats().major_page_faults == 0);
+    }
+
+    TEST_CASE("page faults never go backwards")
+    {
+        const page_faults_t before = current_page_faults();
+        const page_faults_t after = current_page_faults();
+        REQUIRE(after.minor >= before.minor);
+        REQUIRE(after.major >= before.major);
+    }
+
+    TEST_CASE("page faults are only counted while growing")
+    {
+        c_allocator_t global_allocator;
+        auto mem = alloc<uint8_t>(global_allocator, 4096).release();
+        heap_allocator_t heap =
+            heap_allocator_t::make_owning(mem, global_allocator);
+        const auto pagesize = mm_get_page_size();
+        REQUIRE(pagesize.has_value);
+        REQUIRE(heap.set_mmap_threshold(pagesize.value).okay());
+
+        // small allocations from memory the heap already has
+        auto small = alloc<uint64_t>(heap, 8).release();
+        allo::free(heap, small);
+        REQUIRE(heap.stats().minor_page_faults == 0);
+        REQUIRE(heap.stats().major_page_faults == 0);
+
+        // a large allocation gets fresh pages from the OS, and the heap writes
+        // its bookkeeping to the first one before returning
+        const syscall_stats_t before = syscall_stats();
+        auto large = alloc<uint64_t>(heap, pagesize.value).release();
+        REQUIRE(syscall_stats().memory_map_calls() > before.memory_map_calls());
+#if defined(__linux__)
+        REQUIRE(heap.stats().minor_page_faults >= 1);
+#endif
+        allo::free(heap, large);
+    }
+
+    TEST_CASE("page fault counts survive moving the allocator")
+    {
+        auto reservation = reservation_allocator_t::make(
+                               {.committed = 1,
+                                .additional_pages_reserved = 100})
+                               .release();
+        auto heap = heap_allocator_t::make_owning(reservation.current_memory(),
+                                                  reservation);
+
+        // does not fit in the one committed page, so the heap grows
+        auto big = alloc<uint64_t>(heap, 4000).release();
+        const allocator_stats_t stats = heap.stats();
+        REQUIRE(stats.parent_grow_calls == 1);
+
+        heap_allocator_t moved(std::move(heap));
+        REQUIRE(moved.stats().minor_page_faults == stats.minor_page_faults);
+        REQUIRE(moved.stats().major_page_faults == stats.major_page_faults);
+        allo::free(moved, big);
+    }
+}
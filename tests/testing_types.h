@@ -2,6 +2,10 @@
 #include <cstdint>
 #include <utility>
 
+#ifndef TESTING_NOEXCEPT
+#define TESTING_NOEXCEPT noexcept
+#endif
+
 enum class StatusCodeA : uint8_t
 {
     Okay,
@@ -68,3 +72,20 @@ struct nonmoveable_t
     nonmoveable_t& operator=(nonmoveable_t&& other) = delete;
     nonmoveable_t(nonmoveable_t&& other) = delete;
 };
+
+/// Keeps count of how many are alive, to check that containers construct and
+/// destroy each of their items exactly once.
+struct counted_t
+{
+    static inline int alive = 0;
+    int value;
+    explicit counted_t(int v) noexcept : value(v) { ++alive; }
+    counted_t(const counted_t& other) noexcept : value(other.value)
+    {
+        ++alive;
+    }
+    counted_t(counted_t&& other) noexcept : value(other.value) { ++alive; }
+    counted_t& operator=(const counted_t& other) noexcept = default;
+    counted_t& operator=(counted_t&& other) noexcept = default;
+    ~counted_t() noexcept { --alive; }
+};
@@ -0,0 +1,267 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/reservation_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/stack_allocator.h"
+#include "allo/trace.h"
+#include "allo/trace_replay.h"
+#include "allo/tracing_allocator.h"
+#include "allo/typed_allocation.h"
+#include "test_header.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace allo;
+
+struct temp_file_t
+{
+    std::array<char, 64> path{};
+    temp_file_t()
+    {
+        // NOLINTNEXTLINE
+        std::snprintf(path.data(), path.size(), "/tmp/allo_replay_XXXXXX");
+        int fd = mkstemp(path.data());
+        REQUIRE(fd >= 0);
+        close(fd);
+    }
+    ~temp_file_t() { unlink(path.data()); }
+};
+
+static constexpr size_t num_allocations = 200;
+// every allocation is freed, and half are remapped
+static constexpr size_t workload_operations = num_allocations * 5 / 2;
+
+/// Allocate a bunch of differently sized things, shrink some of them, and free
+/// them in a different order than they were allocated. The most memory live
+/// at once is the sum of all the allocations.
+static void record_workload(detail::abstract_heap_allocator_t& ally)
+{
+    std::vector<bytes_t> allocations;
+    for (size_t i = 0; i < num_allocations; ++i) {
+        auto res = ally.alloc_bytes(16 + (i % 7) * 24, 3, 0);
+        REQUIRE(res.okay());
+        allocations.push_back(res.release());
+    }
+    for (size_t i = 0; i < num_allocations; i += 2) {
+        auto res = ally.remap_bytes(allocations[i], 0, 8, 0);
+        REQUIRE(res.okay());
+        allocations[i] = res.release();
+    }
+    for (size_t i = 0; i < num_allocations; i += 2) {
+        REQUIRE(ally.free_bytes(allocations[i], 0).okay());
+    }
+    for (size_t i = 1; i < num_allocations; i += 2) {
+        REQUIRE(ally.free_bytes(allocations[i], 0).okay());
+    }
+}
+
+/// Allocate and free in an order which a stack allocator can handle.
+static void record_lifo_workload(detail::abstract_heap_allocator_t& ally)
+{
+    std::vector<bytes_t> allocations;
+    for (size_t i = 0; i < num_allocations; ++i) {
+        auto res = ally.alloc_bytes(16 + (i % 7) * 24, 3, 0);
+        REQUIRE(res.okay());
+        allocations.push_back(res.release());
+        if (i % 2 == 0) {
+            auto remapped = ally.remap_bytes(allocations.back(), 0, 8, 0);
+            REQUIRE(remapped.okay());
+            allocations.back() = remapped.release();
+        }
+    }
+    while (!allocations.empty()) {
+        REQUIRE(ally.free_bytes(allocations.back(), 0).okay());
+        allocations.pop_back();
+    }
+}
+
+static size_t workload_peak_bytes()
+{
+    size_t total = 0;
+    for (size_t i = 0; i < num_allocations; ++i)
+        total += 16 + (i % 7) * 24;
+    return total;
+}
+
+TEST_SUITE("trace_replay")
+{
+    TEST_CASE("reading traces")
+    {
+        SUBCASE("missing file")
+        {
+            auto reader = trace_reader_t::make("/tmp/allo_replay_missing");
+            REQUIRE(!reader.okay());
+            REQUIRE(reader.err() == AllocationStatusCode::OsErr);
+            // and it is not created by trying to read it
+            REQUIRE(access("/tmp/allo_replay_missing", F_OK) != 0);
+        }
+
+        SUBCASE("not a trace")
+        {
+            temp_file_t temp;
+            FILE* file = std::fopen(temp.path.data(), "wb");
+            REQUIRE(file);
+            const std::array<uint64_t, 4> garbage{1, 2, 3, 4};
+            std::fwrite(garbage.data(), sizeof(uint64_t), garbage.size(), file);
+            std::fclose(file);
+
+            auto reader = trace_reader_t::make(temp.path.data());
+            REQUIRE(!reader.okay());
+            REQUIRE(reader.err() == AllocationStatusCode::InvalidArgument);
+        }
+
+        SUBCASE("recorded trace")
+        {
+            temp_file_t temp;
+            c_allocator_t global_allocator;
+            auto heap = heap_allocator_t::make_owning(
+                allo::alloc<uint8_t>(global_allocator, 100000).release(),
+                global_allocator);
+            {
+                auto recorder =
+                    trace_recorder_t::make({.path = temp.path.data()})
+                        .release();
+                auto tracing = tracing_allocator_t::make(heap, recorder);
+                record_workload(tracing);
+            }
+
+            // traces only need to be readable
+            REQUIRE(chmod(temp.path.data(), 0444) == 0);
+            auto reader_res = trace_reader_t::make(temp.path.data());
+            REQUIRE(reader_res.okay());
+            trace_reader_t reader(std::move(reader_res.release_ref()));
+            REQUIRE(reader.records().size() == workload_operations + 2);
+            REQUIRE(reader.ticks_per_nanosecond() > 0);
+        }
+    }
+
+    TEST_CASE("replaying")
+    {
+        temp_file_t temp;
+        c_allocator_t global_allocator;
+        {
+            // remapping is not supported by the c allocator
+            auto heap = heap_allocator_t::make_owning(
+                allo::alloc<uint8_t>(global_allocator, 100000).release(),
+                global_allocator);
+            auto recorder =
+                trace_recorder_t::make({.path = temp.path.data()}).release();
+            auto first = tracing_allocator_t::make(heap, recorder);
+            auto second = tracing_allocator_t::make(heap, recorder);
+            record_workload(first);
+            record_workload(second);
+        }
+        auto reader = trace_reader_t::make(temp.path.data()).release();
+        c_allocator_t bookkeeping;
+
+        SUBCASE("onto a heap which has to grow")
+        {
+            auto reservation = reservation_allocator_t::make(
+                                   {.committed = 1,
+                                    .additional_pages_reserved = 100})
+                                   .release();
+            auto heap = heap_allocator_t::make_owning(
+                reservation.current_memory(), reservation);
+            auto res = replay_trace(reader.records(), heap, bookkeeping,
+                                    {.committed_source = &reservation});
+            REQUIRE(res.okay());
+            const replay_result_t& result = res.release_ref();
+            REQUIRE(result.operations == workload_operations * 2);
+            REQUIRE(result.failed_operations == 0);
+            REQUIRE(result.skipped_operations == 0);
+            // the two allocators allocate everything before freeing anything
+            // but the trace has them one after the other
+            REQUIRE(result.peak_live_bytes == workload_peak_bytes());
+            REQUIRE(result.peak_committed_bytes > result.peak_live_bytes);
+            REQUIRE(result.fragmentation > 0);
+            REQUIRE(result.fragmentation < 1);
+            REQUIRE(result.latency.p50 <= result.latency.p90);
+            REQUIRE(result.latency.p90 <= result.latency.p99);
+            REQUIRE(result.latency.p99 <= result.latency.p999);
+            REQUIRE(result.latency.p999 <= result.latency.max);
+            REQUIRE(result.operations_per_second > 0);
+        }
+
+        SUBCASE("onto the c allocator")
+        {
+            c_allocator_t target;
+            auto res = replay_trace(reader.records(), target, bookkeeping);
+            REQUIRE(res.okay());
+            const replay_result_t& result = res.release_ref();
+            REQUIRE(result.operations == workload_operations * 2);
+            REQUIRE(result.failed_operations == 0);
+            REQUIRE(result.peak_live_bytes == workload_peak_bytes());
+            REQUIRE(target.stats().bytes_requested == 0);
+        }
+
+        SUBCASE("committed memory from before the replay is not counted")
+        {
+            c_allocator_t parent;
+            auto earlier = allo::alloc<uint8_t>(parent, 1000000).release();
+            REQUIRE(allo::free(parent, earlier).okay());
+            auto heap = heap_allocator_t::make_owning(
+                allo::alloc<uint8_t>(parent, 100000).release(), parent);
+            auto res = replay_trace(reader.records(), heap, bookkeeping,
+                                    {.committed_source = &parent});
+            REQUIRE(res.okay());
+            const replay_result_t& result = res.release_ref();
+            REQUIRE(result.peak_committed_bytes == 100000);
+            REQUIRE(parent.stats().peak_bytes_consumed == 100000);
+        }
+
+        SUBCASE("only one allocator from the trace")
+        {
+            c_allocator_t target;
+            auto res = replay_trace(reader.records(), target, bookkeeping,
+                                    {.allocator_id = 1});
+            REQUIRE(res.okay());
+            REQUIRE(res.release_ref().operations == workload_operations);
+        }
+
+        SUBCASE("onto a scratch allocator, which cannot free")
+        {
+            c_allocator_t parent;
+            auto scratch = scratch_allocator_t::make_owning(
+                allo::alloc<uint8_t>(parent, 100000).release(), parent);
+            auto res = replay_trace(reader.records(), scratch, bookkeeping);
+            REQUIRE(res.okay());
+            const replay_result_t& result = res.release_ref();
+            REQUIRE(result.operations == num_allocations * 3);
+            REQUIRE(result.skipped_operations == num_allocations * 2);
+            REQUIRE(result.failed_operations == 0);
+        }
+    }
+
+    TEST_CASE("replaying onto a stack")
+    {
+        // the stack asserts when it is used out of order, so this trace must
+        // only ever free or remap the most recent allocation
+        temp_file_t temp;
+        c_allocator_t global_allocator;
+        {
+            auto heap = heap_allocator_t::make_owning(
+                allo::alloc<uint8_t>(global_allocator, 100000).release(),
+                global_allocator);
+            auto recorder =
+                trace_recorder_t::make({.path = temp.path.data()}).release();
+            auto tracing = tracing_allocator_t::make(heap, recorder);
+            record_lifo_workload(tracing);
+        }
+        auto reader = trace_reader_t::make(temp.path.data()).release();
+
+        c_allocator_t bookkeeping;
+        c_allocator_t parent;
+        auto stack = stack_allocator_t::make_owning(
+            allo::alloc<uint8_t>(parent, 100000).release(), parent);
+        auto res = replay_trace(reader.records(), stack, bookkeeping);
+        REQUIRE(res.okay());
+        const replay_result_t& result = res.release_ref();
+        REQUIRE(result.operations == workload_operations);
+        REQUIRE(result.failed_operations == 0);
+        REQUIRE(result.skipped_operations == 0);
+    }
+}
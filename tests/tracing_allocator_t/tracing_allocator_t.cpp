@@ -0,0 +1,184 @@
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/trace.h"
+#include "allo/tracing_allocator.h"
+#include "allo/typed_allocation.h"
+#include "allo/typed_freeing.h"
+#include "test_header.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace allo;
+
+struct temp_file_t
+{
+    std::array<char, 64> path{};
+    temp_file_t()
+    {
+        // NOLINTNEXTLINE
+        std::snprintf(path.data(), path.size(), "/tmp/allo_trace_XXXXXX");
+        int fd = mkstemp(path.data());
+        REQUIRE(fd >= 0);
+        close(fd);
+    }
+    ~temp_file_t() { unlink(path.data()); }
+};
+
+/// Read back all the records in a trace file
+static std::vector<trace_record_t> read_trace(const char* path)
+{
+    const mm_file_result_t file_res = mm_open_file(path);
+    REQUIRE(file_res.code == 0);
+    uint64_t size = 0;
+    REQUIRE(mm_file_size(file_res.file, &size) == 0);
+    REQUIRE(size >= sizeof(trace_file_header_t));
+    const auto map_res = mm_map_file(nullptr, file_res.file, size, 0);
+    REQUIRE(map_res.code == 0);
+
+    const auto* header = static_cast<trace_file_header_t*>(map_res.data);
+    REQUIRE(header->magic == trace_file_header_t::static_magic);
+    REQUIRE(header->version == trace_file_header_t::current_version);
+    REQUIRE(header->record_size == sizeof(trace_record_t));
+    REQUIRE((size - sizeof(trace_file_header_t)) % sizeof(trace_record_t) ==
+            0);
+
+    const auto* first = reinterpret_cast<const trace_record_t*>(header + 1);
+    std::vector<trace_record_t> records(
+        first,
+        first + (size - sizeof(trace_file_header_t)) / sizeof(trace_record_t));
+    mm_memory_unmap(map_res.data, map_res.bytes);
+    mm_close_file(file_res.file);
+    return records;
+}
+
+TEST_SUITE("tracing_allocator_t")
+{
+    TEST_CASE("Construction and type behavior")
+    {
+        temp_file_t temp;
+        auto recorder = trace_recorder_t::make({.path = temp.path.data()});
+        REQUIRE(recorder.okay());
+        trace_recorder_t moved(std::move(recorder.release_ref()));
+
+        c_allocator_t global_allocator;
+        auto first = tracing_allocator_t::make(global_allocator, moved);
+        auto second = tracing_allocator_t::make(global_allocator, moved);
+        REQUIRE(first.id() != second.id());
+        REQUIRE(std::string(first.name()) == "tracing_allocator_t");
+
+        tracing_allocator_t moved_allocator(std::move(first));
+        auto& number = allo::construct_one<int>(moved_allocator, 1).release();
+        REQUIRE(number == 1);
+        REQUIRE(allo::free_one(moved_allocator, number).okay());
+    }
+
+    TEST_CASE("records every operation")
+    {
+        temp_file_t temp;
+        c_allocator_t global_allocator;
+        auto heap = heap_allocator_t::make_owning(
+            allo::alloc<uint8_t>(global_allocator, 4000).release(),
+            global_allocator);
+        uint64_t address = 0;
+        uint32_t id = 0;
+        {
+            auto recorder =
+                trace_recorder_t::make({.path = temp.path.data()}).release();
+            auto tracing = tracing_allocator_t::make(heap, recorder);
+            id = tracing.id();
+
+            auto mem = tracing.alloc_bytes(100, 3, 42).release();
+            address = reinterpret_cast<uint64_t>(mem.data());
+            auto smaller = tracing.remap_bytes(mem, 42, 50, 42).release();
+            // wrong size
+            REQUIRE(!tracing.free_bytes(zl::raw_slice(*smaller.data(), 2), 42)
+                         .okay());
+            REQUIRE(tracing.free_bytes(smaller, 42).okay());
+            REQUIRE(recorder.dropped_records() == 0);
+        }
+
+        const auto records = read_trace(temp.path.data());
+        REQUIRE(records.size() == 6);
+        REQUIRE(records.front().operation == TraceOperation::Clock);
+        REQUIRE(records.back().operation == TraceOperation::Clock);
+        REQUIRE(records.back().size >= records.front().size);
+
+        const trace_record_t& alloc = records[1];
+        REQUIRE(alloc.operation == TraceOperation::Alloc);
+        REQUIRE(alloc.allocator_id == id);
+        REQUIRE(alloc.address == address);
+        REQUIRE(alloc.size == 100);
+        REQUIRE(alloc.alignment_exponent == 3);
+        REQUIRE(alloc.typehash == 42);
+        REQUIRE(alloc.status == AllocationStatusCode::Okay);
+
+        const trace_record_t& remap = records[2];
+        REQUIRE(remap.operation == TraceOperation::Remap);
+        REQUIRE(remap.old_address == address);
+        REQUIRE(remap.address == address);
+        REQUIRE(remap.size == 50);
+
+        const trace_record_t& failed = records[3];
+        REQUIRE(failed.operation == TraceOperation::Free);
+        REQUIRE(failed.size == 2);
+        REQUIRE(failed.status == AllocationStatusCode::MemoryInvalid);
+
+        const trace_record_t& free = records[4];
+        REQUIRE(free.operation == TraceOperation::Free);
+        REQUIRE(free.address == address);
+        REQUIRE(free.size == 50);
+        REQUIRE(free.status == AllocationStatusCode::Okay);
+
+        for (size_t i = 1; i < records.size(); ++i) {
+            REQUIRE(records[i].timestamp >= records[i - 1].timestamp);
+        }
+    }
+
+    TEST_CASE("many threads")
+    {
+        temp_file_t temp;
+        constexpr size_t num_threads = 8;
+        constexpr size_t allocations_per_thread = 5000;
+        {
+            auto recorder =
+                trace_recorder_t::make(
+                    {.path = temp.path.data(), .flush_interval_ms = 1})
+                    .release();
+            std::array<std::thread, num_threads> threads;
+            for (auto& thread : threads) {
+                thread = std::thread([&recorder]() {
+                    c_allocator_t global_allocator;
+                    auto tracing =
+                        tracing_allocator_t::make(global_allocator, recorder);
+                    for (size_t i = 0; i < allocations_per_thread; ++i) {
+                        auto mem = tracing.alloc_bytes(16, 0, 0).release();
+                        REQUIRE(tracing.free_bytes(mem, 0).okay());
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            REQUIRE(recorder.flush().okay());
+            REQUIRE(recorder.dropped_records() == 0);
+        }
+
+        const auto records = read_trace(temp.path.data());
+        REQUIRE(records.size() == num_threads * allocations_per_thread * 2 + 2);
+        std::array<size_t, num_threads> allocs_per_allocator{};
+        for (const auto& record : records) {
+            if (record.operation == TraceOperation::Alloc) {
+                REQUIRE(record.allocator_id < num_threads);
+                ++allocs_per_allocator[record.allocator_id];
+            }
+        }
+        for (size_t count : allocs_per_allocator) {
+            REQUIRE(count == allocations_per_thread);
+        }
+    }
+}
@@ -0,0 +1,282 @@
+// allo-replay: perform the operations in a trace recorded with
+// tracing_allocator_t on each of allo's allocators, and compare how they did.
+//
+// usage: allo-replay [options] TRACE
+//   --allocator NAME  replay onto this allocator only, may be repeated.
+//                     one of: c, heap, block, stack, scratch, reservation
+//   --id ID           only replay the operations of this allocator in the trace
+//   --size BYTES      memory given to heap, stack, and scratch up front, which
+//                     should be enough for the whole trace (default 64 MiB)
+//   --blocksize BYTES blocksize of the block allocator (default: the largest
+//                     allocation in the trace)
+
+// committed memory is measured with stats, and traces are not expected to use
+// stacks in order, which should fail instead of asserting
+#ifndef ALLO_HEADER_ONLY
+#define ALLO_HEADER_ONLY
+#endif
+#ifndef ALLO_ENABLE_STATS
+#define ALLO_ENABLE_STATS
+#endif
+#ifndef ALLO_DISABLE_STACK_ALLOCATOR_USAGE_ASSERTS
+#define ALLO_DISABLE_STACK_ALLOCATOR_USAGE_ASSERTS
+#endif
+#ifndef ALLO_DISABLE_VALID_ARGUMENT_ASSERTS
+#define ALLO_DISABLE_VALID_ARGUMENT_ASSERTS
+#endif
+
+#include "allo/block_allocator.h"
+#include "allo/c_allocator.h"
+#include "allo/heap_allocator.h"
+#include "allo/reservation_allocator.h"
+#include "allo/scratch_allocator.h"
+#include "allo/stack_allocator.h"
+#include "allo/trace_replay.h"
+#include "allo/typed_allocation.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace allo;
+
+namespace {
+using replay_res_t = zl::res<replay_result_t, AllocationStatusCode>;
+
+struct config_t
+{
+    zl::slice<const trace_record_t> records;
+    replay_options_t options;
+    size_t size;
+    size_t blocksize;
+    size_t pagesize;
+};
+
+// plenty of room to grow, it is only address space
+constexpr size_t reserved_pages = 1UL << 20;
+
+replay_res_t replay_c(const config_t& config)
+{
+    c_allocator_t bookkeeping;
+    c_allocator_t target;
+    replay_options_t options = config.options;
+    // malloc's own overhead is invisible, so this is only what was requested
+    options.committed_source = &target;
+    return replay_trace(config.records, target, bookkeeping, options);
+}
+
+replay_res_t replay_heap(const config_t& config)
+{
+    c_allocator_t bookkeeping;
+    c_allocator_t parent;
+    auto mem = allo::alloc<uint8_t>(parent, config.size);
+    if (!mem.okay())
+        return mem.err();
+    auto target = heap_allocator_t::make_owning(mem.release(), parent);
+    replay_options_t options = config.options;
+    options.committed_source = &parent;
+    return replay_trace(config.records, target, bookkeeping, options);
+}
+
+replay_res_t replay_stack(const config_t& config)
+{
+    c_allocator_t bookkeeping;
+    c_allocator_t parent;
+    auto mem = allo::alloc<uint8_t>(parent, config.size);
+    if (!mem.okay())
+        return mem.err();
+    auto target = stack_allocator_t::make_owning(mem.release(), parent);
+    replay_options_t options = config.options;
+    options.committed_source = &parent;
+    return replay_trace(config.records, target, bookkeeping, options);
+}
+
+replay_res_t replay_scratch(const config_t& config)
+{
+    c_allocator_t bookkeeping;
+    c_allocator_t parent;
+    auto mem = allo::alloc<uint8_t>(parent, config.size);
+    if (!mem.okay())
+        return mem.err();
+    auto target = scratch_allocator_t::make_owning(mem.release(), parent);
+    replay_options_t options = config.options;
+    options.committed_source = &parent;
+    return replay_trace(config.records, target, bookkeeping, options);
+}
+
+replay_res_t replay_block(const config_t& config)
+{
+    c_allocator_t bookkeeping;
+    // the first page(s) must fit at least one block
+    const size_t committed =
+        (config.blocksize + config.pagesize - 1) / config.pagesize;
+    auto reservation = reservation_allocator_t::make(
+        {.committed = committed, .additional_pages_reserved = reserved_pages});
+    if (!reservation.okay())
+        return reservation.err();
+    reservation_allocator_t& parent = reservation.release_ref();
+    auto target = block_allocator_t::make_owning(parent.current_memory(),
+                                                 parent, config.blocksize);
+    replay_options_t options = config.options;
+    options.committed_source = &parent;
+    return replay_trace(config.records, target, bookkeeping, options);
+}
+
+replay_res_t replay_reservation(const config_t& config)
+{
+    c_allocator_t bookkeeping;
+    auto reservation = reservation_allocator_t::make(
+        {.committed = 1, .additional_pages_reserved = reserved_pages});
+    if (!reservation.okay())
+        return reservation.err();
+    reservation_allocator_t& parent = reservation.release_ref();
+    auto target =
+        heap_allocator_t::make_owning(parent.current_memory(), parent);
+    replay_options_t options = config.options;
+    options.committed_source = &parent;
+    return replay_trace(config.records, target, bookkeeping, options);
+}
+
+struct target_t
+{
+    const char* name;
+    replay_res_t (*replay)(const config_t&);
+};
+
+constexpr target_t targets[] = {
+    {"c", replay_c},
+    {"heap", replay_heap},
+    {"block", replay_block},
+    {"stack", replay_stack},
+    {"scratch", replay_scratch},
+    {"reservation", replay_reservation},
+};
+constexpr size_t num_targets = sizeof(targets) / sizeof(targets[0]);
+
+int usage(const char* program)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--allocator NAME]... [--id ID] [--size BYTES] "
+                 "[--blocksize BYTES] TRACE\n"
+                 "allocators: c, heap, block, stack, scratch, reservation\n",
+                 program);
+    return 2;
+}
+
+bool parse_size(const char* text, size_t& out)
+{
+    char* end = nullptr;
+    const unsigned long long value = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0')
+        return false;
+    out = static_cast<size_t>(value);
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool selected[num_targets] = {};
+    bool any_selected = false;
+    const char* path = nullptr;
+    replay_options_t options;
+    size_t size = 64UL << 20;
+    size_t blocksize = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(arg, "--allocator") == 0 && has_value) {
+            const char* name = argv[++i];
+            bool found = false;
+            for (size_t t = 0; t < num_targets; ++t) {
+                if (std::strcmp(targets[t].name, name) == 0) {
+                    selected[t] = true;
+                    found = true;
+                }
+            }
+            if (!found)
+                return usage(argv[0]);
+            any_selected = true;
+        } else if (std::strcmp(arg, "--id") == 0 && has_value) {
+            size_t id = 0;
+            if (!parse_size(argv[++i], id))
+                return usage(argv[0]);
+            options.allocator_id = static_cast<uint32_t>(id);
+        } else if (std::strcmp(arg, "--size") == 0 && has_value) {
+            if (!parse_size(argv[++i], size))
+                return usage(argv[0]);
+        } else if (std::strcmp(arg, "--blocksize") == 0 && has_value) {
+            if (!parse_size(argv[++i], blocksize))
+                return usage(argv[0]);
+        } else if (arg[0] != '-' && !path) {
+            path = arg;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (!path)
+        return usage(argv[0]);
+
+    auto reader_res = trace_reader_t::make(path);
+    if (!reader_res.okay()) {
+        std::fprintf(stderr, "%s: could not read trace (%s)\n", path,
+                     reader_res.err() == AllocationStatusCode::OsErr
+                         ? "could not open or map the file"
+                         : "not a trace, or a different version");
+        return 1;
+    }
+    const trace_reader_t& reader = reader_res.release_ref();
+
+    const auto pagesize = mm_get_page_size();
+    if (!pagesize.has_value) {
+        std::fprintf(stderr, "could not get the page size\n");
+        return 1;
+    }
+
+    if (blocksize == 0) {
+        for (const trace_record_t& record : reader.records()) {
+            if ((record.operation == TraceOperation::Alloc ||
+                 record.operation == TraceOperation::Remap) &&
+                record.size > blocksize)
+                blocksize = record.size;
+        }
+    }
+
+    const config_t config{
+        .records = reader.records(),
+        .options = options,
+        .size = size,
+        .blocksize = blocksize,
+        .pagesize = pagesize.value,
+    };
+
+    std::printf("%-12s %10s %8s %8s %12s %8s %8s %8s %8s %10s %12s %12s %6s\n",
+                "allocator", "ops", "failed", "skipped", "ops/s", "p50 ns",
+                "p90 ns", "p99 ns", "p999 ns", "max ns", "peak live",
+                "committed", "frag");
+    int status = 0;
+    for (size_t t = 0; t < num_targets; ++t) {
+        if (any_selected && !selected[t])
+            continue;
+        auto res = targets[t].replay(config);
+        if (!res.okay()) {
+            std::printf("%-12s failed to replay, error %d\n", targets[t].name,
+                        static_cast<int>(res.err()));
+            status = 1;
+            continue;
+        }
+        const replay_result_t& r = res.release_ref();
+        std::printf("%-12s %10zu %8zu %8zu %12.0f %8llu %8llu %8llu %8llu "
+                    "%10llu %12zu %12zu %6.3f\n",
+                    targets[t].name, r.operations, r.failed_operations,
+                    r.skipped_operations, r.operations_per_second,
+                    static_cast<unsigned long long>(r.latency.p50),
+                    static_cast<unsigned long long>(r.latency.p90),
+                    static_cast<unsigned long long>(r.latency.p99),
+                    static_cast<unsigned long long>(r.latency.p999),
+                    static_cast<unsigned long long>(r.latency.max),
+                    r.peak_live_bytes, r.peak_committed_bytes,
+                    r.fragmentation);
+    }
+    return status;
+}